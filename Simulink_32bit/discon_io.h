@@ -0,0 +1,70 @@
+/*
+ * File    : discon_io.h
+ *
+ * Abstract:
+ *      Root-level inports and outports of the model BlankCntrlr_model and their
+ *      location in the Bladed avrSwap array.
+ *
+ *      Generated by DISCON_GenerateIOMap.m -- do not edit, regenerate
+ *      the file after changing the root ports of the model.
+ *
+ *      The lists are X-macros in port order, but for the LOG entries:
+ *        IN(port, i)      inport read from avrSwap[i]
+ *        OUT(port, i)     outport written to avrSwap[i]
+ *        LOG(port, unit)  logging outport: its elements are the logging
+ *                         channels, avrSwap[iFirstLog] on; LogN in order
+ *                         of N, then Log_<name> in port order
+ *        C(i, value)      constant written to avrSwap[i] on every call
+ *      They also define the signal numbers of the struct-of-arrays
+ *      interface in discon.h.
+ */
+
+#ifndef DISCON_IO_H
+#define DISCON_IO_H
+
+#define DISCON_INPUTS(IN) \
+    IN(Generator_Speed,            19) \
+    IN(Below_Rated_Pitch_Angle,     4) \
+    IN(Fore_Aft_Tower_Accel,       52) \
+    IN(Sidewards_Tower_Accel,      53) \
+    IN(Measured_Pitch,              3) \
+    IN(Measured_Torque,            22) \
+    IN(Rated_Speed,                18) \
+    IN(Mode_Gain,                  15) \
+    IN(Blade1_OP_Root_Moment,      29) \
+    IN(Blade2_OP_Root_Moment,      30) \
+    IN(Blade3_OP_Root_Moment,      31) \
+    IN(Rotor_Azimuth_Angle,        59) \
+    /* end */
+
+#define DISCON_OUTPUTS(OUT, LOG) \
+    OUT(Generator_Torque,          46) \
+    OUT(Blade1_Pitch_Angle,        41) \
+    OUT(Blade2_Pitch_Angle,        42) \
+    OUT(Blade3_Pitch_Angle,        43) \
+    /* end */
+
+#define DISCON_SWAP_CONSTANTS(C) \
+    C(27, 1)  /* Individual Pitch control       */ \
+    C(34, 1)  /* Generator contactor status     */ \
+    C(35, 0)  /* Shaft brake status: 0=off      */ \
+    C(40, 0)  /* Demanded yaw actuator torque   */ \
+    C(47, 0)  /* Demanded nacelle yaw rate      */ \
+    C(54, 0)  /* Pitch override                 */ \
+    C(55, 0)  /* Torque override                */ \
+    C(71, 0)  /* Generator start-up resistance  */ \
+    C(78, 1)  /* Request for loads: 0=none      */ \
+    C(79, 0)  /* Variable slip current status   */ \
+    C(80, 0)  /* Variable slip current demand   */ \
+    /* end */
+
+/* Signal numbers, e.g. DISCON_IN_Generator_Speed, DISCON_OUT_Log1 */
+#define DISCON_IO_ENUM_IN(name, i)  DISCON_IN_##name,
+#define DISCON_IO_ENUM_OUT(name, i) DISCON_OUT_##name,
+
+enum { DISCON_INPUTS(DISCON_IO_ENUM_IN) DISCON_NUM_INPUTS };
+enum { DISCON_OUTPUTS(DISCON_IO_ENUM_OUT, DISCON_IO_ENUM_OUT) DISCON_NUM_OUTPUTS };
+
+#endif /* DISCON_IO_H */
+
+/* EOF: discon_io.h */
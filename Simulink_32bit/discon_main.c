@@ -26,6 +26,7 @@
  * Headers *
  *=========*/
 #include <float.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -40,6 +41,7 @@
 #endif
 #include "rt_nonfinite.h"
 #include "ext_work.h"
+#include "discon_io.h"
 
 /*=========*
  * Defines *
@@ -125,9 +127,10 @@
 #define CONCAT(name1,name2) EXPAND_CONCAT(name1,name2)
 #define RT_MODEL            CONCAT(MODEL,_rtModel)
 
-#define EXPAND_CONCAT3(name1,name2,name3) name1 ## _ ## name2.name3
-#define CONCAT3(name1,name2,name3) EXPAND_CONCAT3(name1,name2,name3)
-#define SIG_MODEL(suffix,name)     CONCAT3(MODEL,suffix,name)
+#define MODEL_U             CONCAT(MODEL,_U)
+#define MODEL_Y             CONCAT(MODEL,_Y)
+#define MODEL_EXTU          CONCAT(ExtU_,CONCAT(MODEL,_T))
+#define MODEL_EXTY          CONCAT(ExtY_,CONCAT(MODEL,_T))
 
 #define NINT(a) ((a) >= 0.0 ? (int)((a)+0.5) : (int)((a)-0.5))
 #define MIN(a,b) ((a)>(b)?(b):(a))
@@ -186,10 +189,121 @@ static struct {
 #endif
 
 
+/*
+ * Root inports/outports of the model and their avrSwap locations, see
+ * discon_io.h (generated by DISCON_GenerateIOMap.m). The {0, -1} entries
+ * end tables that may otherwise be empty.
+ */
+typedef struct {
+    size_t offset;    /* member offset in the model input/output structure */
+    int_T  swap;      /* avrSwap index, or width of a logging outport      */
+} IOMap;
+
+typedef struct {
+    int_T  swap;
+    float  value;
+} IOConstant;
+
+#define DISCON_IO_MAP_U(name, i)   { offsetof(MODEL_EXTU, name), i },
+#define DISCON_IO_MAP_Y(name, i)   { offsetof(MODEL_EXTY, name), i },
+#define DISCON_IO_SKIP(name, i)
+#define DISCON_IO_CONST(i, value)  { i, value },
+
+#define NUM_MAPPED(table) ((int_T)(sizeof(table)/sizeof((table)[0])) - 1)
+
+static const IOMap SwapInputs[] = {
+    DISCON_INPUTS(DISCON_IO_MAP_U) { 0, -1 }
+};
+static const IOMap SwapOutputs[] = {
+    DISCON_OUTPUTS(DISCON_IO_MAP_Y, DISCON_IO_SKIP) { 0, -1 }
+};
+
+/* Logging outports, scalar or vector: their elements are consecutive
+ * logging channels in the order of discon_io.h */
+#define DISCON_IO_MAP_LOG(name, unit) \
+    { offsetof(MODEL_EXTY, name), (int_T)(sizeof(MODEL_Y.name)/sizeof(real_T)) },
+static const IOMap SwapLogs[] = {
+    DISCON_OUTPUTS(DISCON_IO_SKIP, DISCON_IO_MAP_LOG) { 0, -1 }
+};
+static const IOConstant SwapConstants[] = {
+    DISCON_SWAP_CONSTANTS(DISCON_IO_CONST) { -1, 0 }
+};
+
+/* Outputs of the last successful step, in the order of SwapOutputs. They
+ * are returned on every call, also after a failed step. */
+static float HeldOutputs[sizeof(SwapOutputs)/sizeof(SwapOutputs[0])];
+
 /*=================*
  * Local functions *
  *=================*/
 
+/* Function: loadSwapInputs ===============================================
+ *
+ * Abstract:
+ *      Gather the model inputs straight from avrSwap.
+ */
+static void loadSwapInputs(const float *avrSwap) {
+    char_T *U = (char_T *)&MODEL_U;
+    int_T  k;
+
+    for (k=0; k<NUM_MAPPED(SwapInputs); k++) {
+        *(real_T *)(U + SwapInputs[k].offset) = avrSwap[SwapInputs[k].swap];
+    }
+}  /* end loadSwapInputs */
+
+/* Function: holdSwapOutput ==============================================
+ *
+ * Abstract:
+ *      Hold value as the output returned in avrSwap[swap], if a model
+ *      outport writes it.
+ */
+static void holdSwapOutput(int_T swap, float value) {
+    int_T k;
+
+    for (k=0; k<NUM_MAPPED(SwapOutputs); k++) {
+        if (SwapOutputs[k].swap == swap) HeldOutputs[k] = value;
+    }
+}  /* end holdSwapOutput */
+
+/* Function: holdSwapOutputs ==============================================
+ *
+ * Abstract:
+ *      Hold the model outputs of a successful step and scatter its logging
+ *      outports straight into avrSwap. Logging channel n goes to
+ *      avrSwap[iFirstLog+n], up to the limit in avrSwap[63]. Returns the
+ *      number of logging channels written.
+ */
+static int_T holdSwapOutputs(float *avrSwap) {
+    const char_T *Y = (const char_T *)&MODEL_Y;
+    int_T        k, i, n = 0, iFirstLog = NINT(avrSwap[62])-1;
+    int_T        maxLog = iFirstLog < 0 ? 0 : NINT(avrSwap[63]);
+
+    for (k=0; k<NUM_MAPPED(SwapOutputs); k++) {
+        HeldOutputs[k] = (float)*(const real_T *)(Y + SwapOutputs[k].offset);
+    }
+    for (k=0; k<NUM_MAPPED(SwapLogs); k++) {
+        const real_T *src = (const real_T *)(Y + SwapLogs[k].offset);
+
+        for (i=0; i<SwapLogs[k].swap && n<maxLog; i++) {
+            avrSwap[iFirstLog + n++] = (float)src[i];
+        }
+    }
+    return n;
+}  /* end holdSwapOutputs */
+
+/* Function: storeSwapOutputs =============================================
+ *
+ * Abstract:
+ *      Scatter the held model outputs into avrSwap.
+ */
+static void storeSwapOutputs(float *avrSwap) {
+    int_T k;
+
+    for (k=0; k<NUM_MAPPED(SwapOutputs); k++) {
+        avrSwap[SwapOutputs[k].swap] = HeldOutputs[k];
+    }
+}  /* end storeSwapOutputs */
+
 /* Function: initiateController ===========================================
  *
  * Abstract:
@@ -208,9 +322,6 @@ DISCON_LOCAL int initiateController(char *errorMsg) {
     
     S = MODEL();
     if (rtmGetErrorStatus(S) != NULL) {
-        (void)fprintf(stderr, "Error during model registration: %s\n",
-                rtmGetErrorStatus(S));
-        exit(EXIT_FAILURE);
         sprintf(errorMsg, "Error during model registration: %s",
                 rtmGetErrorStatus(S));
         return -1;
@@ -231,9 +342,6 @@ DISCON_LOCAL int initiateController(char *errorMsg) {
             &rtmGetTimingData(S));
     
     if (status != NULL) {
-        (void)fprintf(stderr,
-                "Failed to initialize sample time engine: %s\n", status);
-        exit(EXIT_FAILURE);
         sprintf(errorMsg, "Failed to initialize sample time engine: %s", status);
         return -1;
     }
@@ -248,8 +356,6 @@ DISCON_LOCAL int initiateController(char *errorMsg) {
             rtmGetStepSize(S),
             &rtmGetErrorStatus(S));
     if (GBLbuf.errmsg != NULL) {
-        (void)fprintf(stderr, "Error starting data logging: %s\n", GBLbuf.errmsg);
-        exit(EXIT_FAILURE);
         sprintf(errorMsg,  "Error starting data logging: %s", GBLbuf.errmsg);
         return -1;
     }
@@ -278,26 +384,10 @@ DISCON_LOCAL int initiateController(char *errorMsg) {
  *      minor modifications.
  */
 #if !defined(MULTITASKING)  /* SINGLETASKING */
-DISCON_LOCAL int calcOutputController(float rGeneratorSpeed, float rRatedSpeed,
-        float rBelowRatedPitch, float rForeAftTower, float rSideTower,
-        float rRotorAzimuth, float rOP1RootMoment, float rOP2RootMoment,
-        float rOP3RootMoment, float rMeasuredPitch, float rMeasuredTorque, 
-        float rModeGain, float *rTorqueDemand, float *rBlade1Pitch, 
-        float *rBlade2Pitch, float *rBlade3Pitch, char *errorMsg) {
+DISCON_LOCAL int calcOutputController(float *avrSwap, char *errorMsg) {
     real_T tnext;
     
-    SIG_MODEL(U,Generator_Speed) = rGeneratorSpeed;
-    SIG_MODEL(U,Rated_Speed) = rRatedSpeed;
-    SIG_MODEL(U,Below_Rated_Pitch_Angle) = rBelowRatedPitch;
-    SIG_MODEL(U,Fore_Aft_Tower_Accel) = rForeAftTower;
-    SIG_MODEL(U,Sidewards_Tower_Accel) = rSideTower;
-    SIG_MODEL(U,Measured_Pitch) = rMeasuredPitch;
-    SIG_MODEL(U,Measured_Torque) = rMeasuredTorque;
-    SIG_MODEL(U,Mode_Gain) = rModeGain;
-    SIG_MODEL(U,Rotor_Azimuth_Angle) = rRotorAzimuth;
-    SIG_MODEL(U,Blade1_OP_Root_Moment) = rOP1RootMoment;
-    SIG_MODEL(U,Blade2_OP_Root_Moment) = rOP2RootMoment;
-    SIG_MODEL(U,Blade3_OP_Root_Moment) = rOP3RootMoment;
+    loadSwapInputs(avrSwap);
     
     /* Check and see if base step time is too fast */
     if (GBLbuf.isrOverrun++) {
@@ -352,11 +442,6 @@ DISCON_LOCAL int calcOutputController(float rGeneratorSpeed, float rRatedSpeed,
     GBLbuf.isrOverrun--;
     rtExtModeCheckEndTrigger();
     
-    rTorqueDemand[0] = SIG_MODEL(Y,Generator_Torque);   
-    rBlade1Pitch[0] = SIG_MODEL(Y,Blade1_Pitch_Angle);
-    rBlade2Pitch[0] = SIG_MODEL(Y,Blade2_Pitch_Angle);
-    rBlade3Pitch[0] = SIG_MODEL(Y,Blade3_Pitch_Angle);
-
     return 0;
 }  /* end calcOutputController */
 
@@ -368,27 +453,12 @@ DISCON_LOCAL int calcOutputController(float rGeneratorSpeed, float rRatedSpeed,
 #  define FIRST_TID 0
 # endif
 
-DISCON_LOCAL int calcOutputController(float rGeneratorSpeed, float rRatedSpeed,
-        float rBelowRatedPitch, float rForeAftTower, float rSideTower,
-        float rRotorAzimuth, float rOP1RootMoment, float rOP2RootMoment,
-        float rOP3RootMoment, float rMeasuredPitch, float rMeasuredTorque, 
-        float rModeGain, float *rTorqueDemand, float *rBlade1Pitch, 
-        float *rBlade2Pitch, float *rBlade3Pitch, char *errorMsg) {    int_T  i;
+DISCON_LOCAL int calcOutputController(float *avrSwap, char *errorMsg) {
+    int_T  i;
     real_T tnext;
     int_T  *sampleHit = rtmGetSampleHitPtr(S);
     
-    SIG_MODEL(U,Generator_Speed) = rGeneratorSpeed;
-    SIG_MODEL(U,Rated_Speed) = rRatedSpeed;
-    SIG_MODEL(U,Below_Rated_Pitch_Angle) = rBelowRatedPitch;
-    SIG_MODEL(U,Fore_Aft_Tower_Accel) = rForeAftTower;
-    SIG_MODEL(U,Sidewards_Tower_Accel) = rSideTower;
-    SIG_MODEL(U,Measured_Pitch) = rMeasuredPitch;
-    SIG_MODEL(U,Measured_Torque) = rMeasuredTorque;
-    SIG_MODEL(U,Mode_Gain) = rModeGain;
-	SIG_MODEL(U,Rotor_Azimuth_Angle) = rRotorAzimuth;
-    SIG_MODEL(U,Blade1_OP_Root_Moment) = rOP1RootMoment;
-    SIG_MODEL(U,Blade2_OP_Root_Moment) = rOP2RootMoment;
-    SIG_MODEL(U,Blade3_OP_Root_Moment) = rOP3RootMoment;
+    loadSwapInputs(avrSwap);
     
     /* Check and see if base step time is too fast */
     if (GBLbuf.isrOverrun++) {
@@ -488,11 +558,6 @@ DISCON_LOCAL int calcOutputController(float rGeneratorSpeed, float rRatedSpeed,
     
     rtExtModeCheckEndTrigger();
     
-	rTorqueDemand[0] = SIG_MODEL(Y,Generator_Torque);
-    rBlade1Pitch[0] = SIG_MODEL(Y,Blade1_Pitch_Angle);
-    rBlade2Pitch[0] = SIG_MODEL(Y,Blade2_Pitch_Angle);
-    rBlade3Pitch[0] = SIG_MODEL(Y,Blade3_Pitch_Angle);
-    
     return 0;
 }  /* end calcOutputController */
 
@@ -513,24 +578,16 @@ DISCON_LOCAL int performCleanup(char *errorMsg) {
     rtExtModeShutdown(rtmGetNumSampleTimes(S));
     
     if (GBLbuf.errmsg) {
-        (void)fprintf(stderr, "%s\n", GBLbuf.errmsg);
-        exit(EXIT_FAILURE);
         sprintf(errorMsg, "%s", GBLbuf.errmsg);
         return -1;
     }
     
     if (rtmGetErrorStatus(S) != NULL) {
-        (void)fprintf(stderr, "ErrorStatus set: \"%s\"\n", rtmGetErrorStatus(S));
-        exit(EXIT_FAILURE);
         sprintf(errorMsg, "ErrorStatus set: \"%s\"", rtmGetErrorStatus(S));
         return -1;
     }
     
     if (GBLbuf.isrOverrun) {
-        (void)fprintf(stderr,
-                "%s: ISR overrun - base sampling rate is too fast\n",
-                QUOTE(MODEL));
-        exit(EXIT_FAILURE);
         sprintf(errorMsg,
                 "%s: ISR overrun - base sampling rate is too fast",
                 QUOTE(MODEL));
@@ -560,14 +617,8 @@ DISCON_LOCAL int performCleanup(char *errorMsg) {
 
 void DISCON_API CDECL DISCON(float *avrSwap, int *aviFail,
           char *accInfile, char *avcOutname, char *avcMsg) {
-    int iStatus;
+    int iStatus, k, nLog = 0;
     char errorMsg[257]; // inFile[257], outName[1025];
-    float rTime, rSample, rGeneratorSpeed, rRatedSpeed, rBelowRatedPitch, 
-            rRotorAzimuth, rOP1RootMoment, rOP2RootMoment, rOP3RootMoment,
-            rForeAftTower, rSideTower, rMeasuredPitch, rMeasuredTorque, 
-            rModeGain;
-    static float rTorqueDemand, rPitchDemand, rBlade1Pitch, rBlade2Pitch, 
-            rBlade3Pitch;
     
     /* Take local copies of strings */
     //memcpy(inFile, accInfile, NINT(avrSwap[49]));
@@ -581,50 +632,27 @@ void DISCON_API CDECL DISCON(float *avrSwap, int *aviFail,
     /* Set constants */
     //SetParams(avrSwap);
     
-    /* Load variables from Bladed (See Appendix A) */
+    /* Variables are read from and written to Bladed (See Appendix A)
+     * through the port tables of discon_io.h */
     iStatus          = NINT(avrSwap[0]);
-    rTime            = avrSwap[1];
-    rSample          = avrSwap[2];
-    rMeasuredPitch   = avrSwap[3];
-    rBelowRatedPitch = avrSwap[4];
-    rModeGain        = avrSwap[15];
-    rRatedSpeed      = avrSwap[18];
-    rGeneratorSpeed  = avrSwap[19];
-    rMeasuredTorque  = avrSwap[22];
-    rOP1RootMoment   = avrSwap[29]; 
-    rOP2RootMoment   = avrSwap[30];
-    rOP3RootMoment   = avrSwap[31];
-    rForeAftTower    = avrSwap[52];
-    rSideTower       = avrSwap[53];
-    rRotorAzimuth    = avrSwap[59];
     
     /* determine iStatus */
     aviFail[0] = 0;
     if (iStatus == 0) {
         /* Initialize Controller */
         aviFail[0] = initiateController(errorMsg);
-        rPitchDemand = rMeasuredPitch;     
-        rTorqueDemand = rMeasuredTorque;
+        /* Hold the measured torque until the first time step */
+        holdSwapOutput(46, avrSwap[22]);
     }
     else if (iStatus >= 0) {
         /* Main calculation */
-        aviFail[0] = calcOutputController(rGeneratorSpeed, rRatedSpeed,
-                        rBelowRatedPitch, rForeAftTower, rSideTower,
-                        rRotorAzimuth, rOP1RootMoment, rOP2RootMoment,
-                        rOP3RootMoment, rMeasuredPitch, rMeasuredTorque, 
-                        rModeGain, &rTorqueDemand, &rBlade1Pitch, 
-                        &rBlade2Pitch, &rBlade3Pitch, errorMsg);
-						//&rBlade2Pitch, &rBlade3Pitch, &errorMsg);
+        aviFail[0] = calcOutputController(avrSwap, errorMsg);
+        if (aviFail[0] == 0) nLog = holdSwapOutputs(avrSwap);
     }
     else if (iStatus == -1) {
         /* Main calculation */
-        aviFail[0] = calcOutputController(rGeneratorSpeed, rRatedSpeed,
-                        rBelowRatedPitch, rForeAftTower, rSideTower,
-                        rRotorAzimuth, rOP1RootMoment, rOP2RootMoment,
-                        rOP3RootMoment, rMeasuredPitch, rMeasuredTorque, 
-                        rModeGain, &rTorqueDemand, &rBlade1Pitch, 
-                        &rBlade2Pitch, &rBlade3Pitch, errorMsg);
-						//&rBlade2Pitch, &rBlade3Pitch, &errorMsg);
+        aviFail[0] = calcOutputController(avrSwap, errorMsg);
+        if (aviFail[0] == 0) nLog = holdSwapOutputs(avrSwap);
         
         /* Perform Cleanup */
         aviFail[0] = performCleanup(errorMsg);
@@ -635,22 +663,11 @@ void DISCON_API CDECL DISCON(float *avrSwap, int *aviFail,
     }
     
     /* Store variables too Bladed (See Appendix A) */
-    avrSwap[27] = 1; /* Individual Pitch control */
-    avrSwap[34] = 1; /* Generator contactor status */
-    avrSwap[35] = 0; /* Shaft brake status: 0=off */
-    avrSwap[40] = 0; /* Demanded yaw actuator torque */
-    avrSwap[41] = rBlade1Pitch;  /* Blade 1 pitch angle demand */
-    avrSwap[42] = rBlade2Pitch;  /* Blade 2 pitch angle demand */
-    avrSwap[43] = rBlade3Pitch;  /* Blade 3 pitch angle demand */
-    avrSwap[46] = rTorqueDemand; /* Torque angle demand */
-    avrSwap[47] = 0; /* Demanded nacelle yaw rate */
-    avrSwap[54] = 0; /* Pitch override */
-    avrSwap[55] = 0; /* Torque override */
-    avrSwap[64] = 0; /* Number of variables returned for logging */
-    avrSwap[71] = 0; /* Generator start-up resistance */
-    avrSwap[78] = 1; /* Request for loads: 0=none */
-    avrSwap[79] = 0; /* Variable slip current status */
-    avrSwap[80] = 0; /* Variable slip current demand */
+    storeSwapOutputs(avrSwap);
+    for (k=0; k<NUM_MAPPED(SwapConstants); k++) {
+        avrSwap[SwapConstants[k].swap] = SwapConstants[k].value;
+    }
+    avrSwap[64] = (float)nLog; /* Number of variables returned for logging */
     
     /* Return message */
     memcpy(avcMsg, errorMsg, MIN(256, NINT(avrSwap[48])));
@@ -0,0 +1,218 @@
+function DISCON_GenerateIOMap(SmlkMdl, headerFile, target)
+% DISCON_GenerateIOMap  Write discon_io.h from the root ports of a model.
+%
+%   DISCON_GenerateIOMap('DISCON_NREL5MW') writes discon_io.h in the
+%   current folder. DISCON_GenerateIOMap(SmlkMdl, headerFile) writes it to
+%   headerFile instead. DISCON_GenerateIOMap(SmlkMdl, headerFile, '32bit')
+%   writes the header of the 32-bit main file in ../Simulink_32bit, which
+%   returns its own set of constants.
+%
+%   discon_io.h lists every root inport and outport of the model, in port
+%   order, together with its location in the Bladed avrSwap array. The
+%   DISCON main file expands these lists into the tables that copy data
+%   between avrSwap and the model inputs/outputs, so the header must be
+%   regenerated whenever a root port is added, removed or renamed.
+%
+%   The avrSwap locations of all known port names are kept in the tables
+%   below (0-based C indices, see Appendix A of the Bladed user manual).
+%   Adding a new signal means adding a root port to the model and, when
+%   its name is not known yet, one line to swapIn or swapOut.
+
+if nargin < 2
+    headerFile = 'discon_io.h';
+end
+if nargin < 3
+    target = '64bit';
+end
+if ~any(strcmp(target, {'64bit', '32bit'}))
+    error('DISCON_GenerateIOMap:target', ...
+          'Target must be ''64bit'' or ''32bit'', found "%s"', target);
+end
+
+% Inports: port name, avrSwap index
+swapIn = {
+    'Init',                      0
+    'Measured_Pitch',            3
+    'Below_Rated_Pitch_Angle',   4
+    'ElectricalPower',          14
+    'Mode_Gain',                15
+    'Rated_Speed',              18
+    'Generator_Speed',          19
+    'Measured_Torque',          22
+    'YawError',                 23
+    'Blade1_OP_Root_Moment',    29
+    'Blade2_OP_Root_Moment',    30
+    'Blade3_OP_Root_Moment',    31
+    'Fore_Aft_Tower_Accel',     52
+    'Sidewards_Tower_Accel',    53
+    'Rotor_Azimuth_Angle',      59
+    'Blade1_IP_Root_Moment',    68
+    'Blade2_IP_Root_Moment',    69
+    'Blade3_IP_Root_Moment',    70
+    'Shaft_Torque',            108
+    'YawBearingRate',          162
+    };
+for k = 1:20 % rUserVar1..20, filled from discon.in
+    swapIn(end+1,:) = {sprintf('userVar%d',k), 118+k}; %#ok<AGROW>
+end
+
+% Outports: port name, avrSwap index. Outports named LogN or Log_<name>
+% are logging outports instead: their elements, scalar or vector, become
+% the logging channels returned to Bladed, LogN in order of N (as the
+% original DISCON returned LogN as channel N) and then Log_<name> in port
+% order. The Unit parameter of a logging outport gives the unit reported
+% with it.
+swapOut = {
+    'Blade1_Pitch_Angle',       41
+    'Blade2_Pitch_Angle',       42
+    'Blade3_Pitch_Angle',       43
+    'Collective_Pitch_Angle',   44
+    'Generator_Torque',         46
+    'Yaw_Rate',                 47
+    };
+
+% Values returned to Bladed on every call: avrSwap index, value, comment,
+% and whether the 32-bit main file returns it too. An entry is dropped
+% when a model outport writes the same location.
+swapConst = {
+     9, 0, 'Pitch angle',                    false
+    27, 1, 'Individual Pitch control',       true
+    34, 1, 'Generator contactor status',     true
+    35, 0, 'Shaft brake status: 0=off',      true
+    40, 0, 'Demanded yaw actuator torque',   true
+    47, 0, 'Demanded nacelle yaw rate',      true
+    54, 0, 'Pitch override',                 true
+    55, 0, 'Torque override',                true
+    71, 0, 'Generator start-up resistance',  true
+    78, 1, 'Request for loads: 0=none',      true
+    79, 0, 'Variable slip current status',   true
+    80, 0, 'Variable slip current demand',   true
+    };
+if strcmp(target, '32bit')
+    swapConst = swapConst([swapConst{:,4}],:);
+end
+
+load_system(SmlkMdl);
+inports  = rootPorts(SmlkMdl, 'Inport');
+[outports, units] = rootPorts(SmlkMdl, 'Outport');
+
+inLines = cell(numel(inports),1);
+for k = 1:numel(inports)
+    idx = find(strcmp(swapIn(:,1), inports{k}), 1);
+    if isempty(idx)
+        error('DISCON_GenerateIOMap:unknownPort', ...
+              'No avrSwap location known for inport "%s"', inports{k});
+    end
+    inLines{k} = sprintf('    IN(%-26s %3d)', [inports{k} ','], swapIn{idx,2});
+end
+
+outLines = cell(numel(outports),1);
+outSwap  = [];
+for k = 1:numel(outports)
+    if ~isempty(regexp(outports{k}, '^Log(\d+|_\w+)$', 'once'))
+        outLines{k} = sprintf('    LOG(%-25s "%s")', [outports{k} ','], units{k});
+        continue
+    end
+    idx = find(strcmp(swapOut(:,1), outports{k}), 1);
+    if isempty(idx)
+        error('DISCON_GenerateIOMap:unknownPort', ...
+              'No avrSwap location known for outport "%s"', outports{k});
+    end
+    outLines{k} = sprintf('    OUT(%-25s %3d)', [outports{k} ','], swapOut{idx,2});
+    outSwap(end+1) = swapOut{idx,2}; %#ok<AGROW>
+end
+
+% Logging outports in channel order: LogN by N, then Log_<name> (no
+% number, Inf) in port order, as sort is stable. They trade places among
+% themselves only, so the other outports keep their signal numbers.
+logIdx = find(~cellfun(@isempty, regexp(outports, '^Log(\d+|_\w+)$', 'once')));
+logNum = str2double(regexprep(outports(logIdx), '^Log', ''));
+logNum(isnan(logNum)) = Inf;
+[~, order] = sort(logNum);
+outLines(logIdx) = outLines(logIdx(order));
+
+constLines = {};
+for k = 1:size(swapConst,1)
+    if ~any(outSwap == swapConst{k,1})
+        constLines{end+1,1} = sprintf('    C(%2d, %d)  /* %-30s */', ...
+            swapConst{k,1}, swapConst{k,2}, swapConst{k,3}); %#ok<AGROW>
+    end
+end
+
+[~, name, ext] = fileparts(headerFile);
+fid = fopen(headerFile, 'w');
+if fid < 0
+    error('DISCON_GenerateIOMap:open', 'Unable to write %s', headerFile);
+end
+cleanup = onCleanup(@() fclose(fid));
+
+fprintf(fid, '/*\n');
+fprintf(fid, ' * File    : %s%s\n', name, ext);
+fprintf(fid, ' *\n');
+fprintf(fid, ' * Abstract:\n');
+fprintf(fid, ' *      Root-level inports and outports of the model %s and their\n', SmlkMdl);
+fprintf(fid, ' *      location in the Bladed avrSwap array.\n');
+fprintf(fid, ' *\n');
+fprintf(fid, ' *      Generated by DISCON_GenerateIOMap.m -- do not edit, regenerate\n');
+fprintf(fid, ' *      the file after changing the root ports of the model.\n');
+fprintf(fid, ' *\n');
+fprintf(fid, ' *      The lists are X-macros in port order, but for the LOG entries:\n');
+fprintf(fid, ' *        IN(port, i)      inport read from avrSwap[i]\n');
+fprintf(fid, ' *        OUT(port, i)     outport written to avrSwap[i]\n');
+fprintf(fid, ' *        LOG(port, unit)  logging outport: its elements are the logging\n');
+fprintf(fid, ' *                         channels, avrSwap[iFirstLog] on; LogN in order\n');
+fprintf(fid, ' *                         of N, then Log_<name> in port order\n');
+fprintf(fid, ' *        C(i, value)      constant written to avrSwap[i] on every call\n');
+fprintf(fid, ' *      They also define the signal numbers of the struct-of-arrays\n');
+fprintf(fid, ' *      interface in discon.h.\n');
+fprintf(fid, ' */\n\n');
+fprintf(fid, '#ifndef DISCON_IO_H\n#define DISCON_IO_H\n\n');
+writeList(fid, 'DISCON_INPUTS(IN)', inLines);
+writeList(fid, 'DISCON_OUTPUTS(OUT, LOG)', outLines);
+writeList(fid, 'DISCON_SWAP_CONSTANTS(C)', constLines);
+fprintf(fid, '/* Signal numbers, e.g. DISCON_IN_Generator_Speed, DISCON_OUT_Log1 */\n');
+fprintf(fid, '#define DISCON_IO_ENUM_IN(name, i)  DISCON_IN_##name,\n');
+fprintf(fid, '#define DISCON_IO_ENUM_OUT(name, i) DISCON_OUT_##name,\n\n');
+fprintf(fid, 'enum { DISCON_INPUTS(DISCON_IO_ENUM_IN) DISCON_NUM_INPUTS };\n');
+fprintf(fid, 'enum { DISCON_OUTPUTS(DISCON_IO_ENUM_OUT, DISCON_IO_ENUM_OUT) DISCON_NUM_OUTPUTS };\n\n');
+fprintf(fid, '#endif /* DISCON_IO_H */\n\n');
+fprintf(fid, '/* EOF: %s%s */\n', name, ext);
+
+fprintf('Wrote %s: %d inports, %d outports\n', headerFile, numel(inports), numel(outports));
+end
+
+function [names, units] = rootPorts(SmlkMdl, blockType)
+% Names and units of the root-level ports of one type, sorted by port
+% number. Ports without a unit (or an inherited one) get '-'.
+blocks = find_system(SmlkMdl, 'SearchDepth', 1, 'BlockType', blockType);
+ports  = str2double(get_param(blocks, 'Port'));
+[~, order] = sort(ports);
+blocks = blocks(order);
+names  = cellstr(get_param(blocks, 'Name'));
+units  = repmat({'-'}, size(names));
+for k = 1:numel(blocks)
+    try
+        unit = get_param(blocks{k}, 'Unit');
+    catch
+        unit = '';      % releases without port units
+    end
+    if ~isempty(unit) && ~strcmp(unit, 'inherit') && isempty(regexp(unit, '[:;"\\]', 'once'))
+        units{k} = unit;
+    end
+end
+for k = 1:numel(names)
+    if ~isvarname(names{k})
+        error('DISCON_GenerateIOMap:portName', ...
+              'Port name "%s" is not a valid C identifier', names{k});
+    end
+end
+end
+
+function writeList(fid, macro, lines)
+% One X-macro definition with a continuation after every entry
+fprintf(fid, '#define %s \\\n', macro);
+for k = 1:numel(lines)
+    fprintf(fid, '%s \\\n', lines{k});
+end
+fprintf(fid, '    /* end */\n\n');
+end
@@ -0,0 +1,63 @@
+function DISCON_KernelBlocks
+% DISCON_KernelBlocks  Build the optimised controller kernel blocks.
+%
+%   DISCON_KernelBlocks generates and compiles Legacy Code Tool
+%   S-functions for the kernels of discon_kernels.c in the current folder
+%   and opens a library with their blocks:
+%
+%     discon_coleman_fwd   y = [mean; d; q] of the blade signals u1 (3x1)
+%                          at blade 1 azimuth u2 (rad, avrSwap[59])
+%     discon_coleman_inv   blade demands (3x1) from the collective, d and q
+%                          demands u1 at azimuth u2; parameter: the phase
+%                          lead of the demand (rad)
+%     discon_biquad_bank   cascade of second order sections on the three
+%                          blade signals u1 (3x1); parameter: a 5xN matrix
+%                          with one section [b0; b1; b2; a1; a2] (a0 = 1)
+%                          per column
+%     discon_gs_pi         PI controller of the error u1 with its gains
+%                          divided by 1 + u2/sched, e.g. u2 the pitch angle;
+%                          parameter: [Kp Ki sched yMin yMax Ts y0], sched
+%                          0 for fixed gains. The integrator stays within
+%                          [yMin, yMax] (anti-windup)
+%
+%   A section designed as [b, a] = butter(2, fc*2*Ts) is the column
+%   [b(:); a(2:3)']. Blade k is at azimuth u2 + (k-1)*2*pi/3.
+%
+%   The blocks replace the transforms, Discrete Filter blocks and PI
+%   subsystems built from generic blocks; discon_kernels_bench compares
+%   both. Set the sample time of each block to that of the controller.
+%
+%   Run this script from Simulink_64bit before building a model that uses
+%   the blocks. discon_kernels.c is compiled into the DISCON library through
+%   DISCON_SRCS in the template makefile, so no rtwmakecfg is generated.
+
+common = legacy_code('initialize');
+common.HeaderFiles  = {'discon_kernels.h'};
+common.SourceFiles  = {'discon_kernels.c'};
+common.SampleTime   = 'parameterized';
+common.Options.useTlcWithAccel = true;
+
+defs = [common common common common];
+
+defs(1).SFunctionName = 'discon_coleman_fwd';
+defs(1).OutputFcnSpec = 'void DISCON_ColemanForward(double u1[3], double u2, double y1[3])';
+
+defs(2).SFunctionName = 'discon_coleman_inv';
+defs(2).OutputFcnSpec = ['void DISCON_ColemanInverse(double u1[3], double u2, ' ...
+                         'double p1, double y1[3])'];
+
+defs(3).SFunctionName = 'discon_biquad_bank';
+defs(3).InitializeConditionsFcnSpec = 'void DISCON_BiquadBankInit(double work1[6][size(p1,2)], int32 size(p1,2))';
+defs(3).OutputFcnSpec = ['void DISCON_BiquadBank(double u1[3], double y1[3], ' ...
+                         'double work1[6][size(p1,2)], double p1[], int32 size(p1,2))'];
+
+defs(4).SFunctionName = 'discon_gs_pi';
+defs(4).InitializeConditionsFcnSpec = 'void DISCON_PIInit(double work1[2], double p1[7])';
+defs(4).OutputFcnSpec = 'double y1 = DISCON_PIOutput(double work1[2], double u1, double u2, double p1[7])';
+defs(4).UpdateFcnSpec = 'void DISCON_PIUpdate(double work1[2])';
+
+legacy_code('sfcn_cmex_generate', defs);
+legacy_code('compile', defs);
+legacy_code('sfcn_tlc_generate', defs);
+legacy_code('slblock_generate', defs);
+end
@@ -0,0 +1,45 @@
+function DISCON_ParamBlocks
+% DISCON_ParamBlocks  Build the blocks that read discon.in inside the model.
+%
+%   DISCON_ParamBlocks generates and compiles two Legacy Code Tool
+%   S-functions in the current folder and opens a library with their
+%   blocks:
+%
+%     discon_param_lookup   y = table(u), linear interpolation in a 2xN
+%                           entry whose first row holds the breakpoints,
+%                           e.g. a gain schedule over pitch angle
+%     discon_param_element  y = entry(u), element u (1-based, column-major)
+%                           of an entry, e.g. a filter coefficient
+%
+%   The only block parameter is the entry name as a NUL terminated int8
+%   vector, e.g. [int8('Kp_sched') 0]. The name is resolved once, when the
+%   model starts; every step then reads the value straight from the parsed
+%   or memory mapped parameter file, so tables of any size cost no copy
+%   and the same controller binary runs whatever tuning the file holds.
+%
+%   In the DISCON library each controller instance sees the file it was
+%   created with. In a Simulink simulation the blocks read discon.in (or
+%   the file named by the environment variable DISCON_PARAMETER_FILE) from
+%   the current folder.
+%
+%   Run this script from Simulink_64bit before building a model that uses
+%   the blocks. discon_params.c is compiled into the DISCON library through
+%   DISCON_SRCS in the template makefile, so no rtwmakecfg is generated.
+
+common = legacy_code('initialize');
+common.StartFcnSpec = 'DISCON_ParamStart(void **work1, int8 p1[])';
+common.HeaderFiles  = {'discon_params.h'};
+common.SourceFiles  = {'discon_params.c', 'discon_threads.c'};
+common.Options.useTlcWithAccel = true;
+
+defs = [common common];
+defs(1).SFunctionName = 'discon_param_lookup';
+defs(1).OutputFcnSpec = 'double y1 = DISCON_ParamLookup(void *work1, double u1)';
+defs(2).SFunctionName = 'discon_param_element';
+defs(2).OutputFcnSpec = 'double y1 = DISCON_ParamElement(void *work1, int32 u1)';
+
+legacy_code('sfcn_cmex_generate', defs);
+legacy_code('compile', defs);
+legacy_code('sfcn_tlc_generate', defs);
+legacy_code('slblock_generate', defs);
+end
@@ -0,0 +1,79 @@
+function log = DISCON_ReadLog(fileName)
+% DISCON_ReadLog  Read a streaming controller log (.dlog).
+%
+%   log = DISCON_ReadLog('DISCON_NREL5MW.dlog') returns a struct with the
+%   field Time and one column vector per logged channel, named after the
+%   model inport or outport, e.g. log.Generator_Speed or log.Log1. The
+%   field StepSize holds the nominal sample time of the model.
+%
+%   The controller writes the file in chunks while it runs. A file left by
+%   an aborted run is read up to its last complete chunk, with a warning.
+%   The layout is described in discon_log.h.
+
+magic      = 'DISCONL';     % DISCON_LOG_MAGIC
+version    = 1;             % DISCON_LOG_VERSION
+nameLen    = 48;            % DISCON_LOG_NAME_LEN
+chunkMagic = 1263421507;    % DISCON_LOG_CHUNK_MAGIC, 'CHNK'
+
+fid = fopen(fileName, 'r', 'native');
+if fid < 0
+    error('DISCON_ReadLog:open', 'Unable to open %s', fileName);
+end
+cleanup = onCleanup(@() fclose(fid));
+
+% Header
+hdrMagic = fread(fid, [1 8], 'char*1=>char');
+if numel(hdrMagic) < 8 || ~strcmp(deblank(strtok(hdrMagic, char(0))), magic)
+    error('DISCON_ReadLog:format', '%s is not a DISCON log file', fileName);
+end
+hdr = fread(fid, 4, 'uint32');
+if hdr(1) ~= version
+    error('DISCON_ReadLog:version', 'Unsupported log version %d', hdr(1));
+end
+nChannels = hdr(2);
+chunkRows = hdr(3);
+stepSize  = fread(fid, 1, 'double');
+
+names = cell(nChannels, 1);
+for k = 1:nChannels
+    raw      = fread(fid, [1 nameLen], 'char*1=>char');
+    names{k} = strtok(raw, char(0));
+end
+
+% Chunks, preallocated in blocks as the file size gives the row count
+bytesPerRow = 8 + 4*nChannels;
+here = ftell(fid);
+fseek(fid, 0, 'eof');
+maxRows = floor((ftell(fid) - here)/bytesPerRow);
+fseek(fid, here, 'bof');
+
+time = zeros(maxRows, 1);
+data = zeros(maxRows, nChannels, 'single');
+n    = 0;
+while true
+    chunk = fread(fid, 2, 'uint32');
+    if numel(chunk) < 2
+        break                                   % end of file
+    end
+    rows = chunk(2);
+    if chunk(1) ~= chunkMagic || rows > chunkRows
+        warning('DISCON_ReadLog:corrupt', 'Stopped at a corrupt chunk after %d rows', n);
+        break
+    end
+    t = fread(fid, rows, 'double');
+    x = fread(fid, [rows nChannels], 'single=>single');
+    if numel(t) < rows || numel(x) < rows*nChannels
+        warning('DISCON_ReadLog:truncated', ...
+                'Incomplete last chunk ignored, %d rows read', n);
+        break
+    end
+    time(n+1:n+rows)    = t;
+    data(n+1:n+rows, :) = x;
+    n = n + rows;
+end
+
+log = struct('Time', time(1:n), 'StepSize', stepSize);
+for k = 1:nChannels
+    log.(names{k}) = double(data(1:n, k));
+end
+end
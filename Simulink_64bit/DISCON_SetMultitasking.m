@@ -0,0 +1,38 @@
+function DISCON_SetMultitasking(SmlkMdl)
+% DISCON_SetMultitasking  Set up a multi-rate controller model for MT.
+%
+%   DISCON_SetMultitasking('DISCON_NREL5MW') configures a multi-rate model
+%   for a build with MULTITASKING, in which each DISCON call runs the base
+%   rate and the slower sample-time tasks run on a background thread:
+%
+%     - fixed-step solver in multitasking mode;
+%     - no automatic Rate Transition blocks, and an error for a signal
+%       that crosses rates without one;
+%     - every Rate Transition block set to ensure data integrity but not
+%       deterministic transfer, so that the generated code double buffers
+%       the signal and neither rate ever waits for the other.
+%
+%   A deterministic transfer assumes that the slower task is done before
+%   its next hit of the faster one, which a background thread does not
+%   guarantee. The values a slower task reads may therefore be one base
+%   step later than in simulation.
+
+load_system(SmlkMdl);
+set_param(SmlkMdl, 'SolverType', 'Fixed-step');
+set_param(SmlkMdl, 'SolverMode', 'MultiTasking');
+set_param(SmlkMdl, 'AutoInsertRateTranBlk', 'off');
+try
+    set_param(SmlkMdl, 'MultiTaskRateTransMsg', 'error');
+catch
+    warning('DISCON_SetMultitasking:diagnostic', ...
+            'Unable to make unprotected rate transitions an error in %s', SmlkMdl);
+end
+
+rtbs = find_system(SmlkMdl, 'LookUnderMasks', 'all', 'BlockType', 'RateTransition');
+for k = 1:numel(rtbs)
+    set_param(rtbs{k}, 'Integrity', 'on');
+    set_param(rtbs{k}, 'Deterministic', 'off');
+end
+fprintf('%s is now multitasking, %d Rate Transition blocks double buffered\n', ...
+        SmlkMdl, numel(rtbs));
+end
@@ -0,0 +1,85 @@
+function DISCON_SetPrecision(SmlkMdl, precision)
+% DISCON_SetPrecision  Switch a controller model between double and single.
+%
+%   DISCON_SetPrecision('DISCON_NREL5MW', 'single') configures the model
+%   for a single-precision controller:
+%
+%     - data type override 'Single' on all floating-point blocks, so the
+%       signals, discrete states and block parameters of the model are
+%       single; parameters from Parameters_NREL5MW.mat are cast when the
+%       model compiles;
+%     - single as the type of underspecified signals;
+%     - single root inports, and so outports, which discon_main.c reads
+%       and writes through a real32_T view of the model I/O;
+%     - the 'Single-precision controller' option of discon.tlc, which
+%       passes DISCON_SINGLE=1 to the template makefile.
+%
+%   Simulink.Parameter objects of the base workspace typed double become
+%   single too. Continuous states stay double, as Simulink integrates them
+%   in double whatever the override.
+%
+%   DISCON_SetPrecision(SmlkMdl, 'double') restores the double controller.
+%
+%   The Legacy Code Tool blocks of DISCON_ParamBlocks and
+%   DISCON_KernelBlocks have double ports in both builds; connect them
+%   through Data Type Conversion blocks in a single-precision model.
+%
+%   Compare the two builds with discon_replay: build the double library,
+%   copy it aside, build the single one and replay a trace corpus with
+%     discon_replay -lib ./DISCON.so -ref ./DISCON_double.so -stats dev.tsv ...
+%   which writes the largest and RMS deviation of every output and logging
+%   channel.
+
+if nargin < 2
+    precision = 'single';
+end
+switch lower(precision)
+    case 'single'
+        override = 'Single';
+        portType = 'single';
+        onoff    = 'on';
+    case 'double'
+        override = 'UseLocalSettings';
+        portType = 'double';
+        onoff    = 'off';
+    otherwise
+        error('DISCON_SetPrecision:precision', ...
+              'Precision must be ''single'' or ''double'', found "%s"', precision);
+end
+
+load_system(SmlkMdl);
+set_param(SmlkMdl, 'DataTypeOverride', override);
+set_param(SmlkMdl, 'DataTypeOverrideAppliesTo', 'Floating-point');
+set_param(SmlkMdl, 'DefaultUnderspecifiedDataType', portType);
+
+inports = find_system(SmlkMdl, 'SearchDepth', 1, 'BlockType', 'Inport');
+for k = 1:numel(inports)
+    set_param(inports{k}, 'OutDataTypeStr', portType);
+end
+
+vars = evalin('base', 'whos');
+for k = 1:numel(vars)
+    if strcmp(vars(k).class, 'Simulink.Parameter')
+        param = evalin('base', vars(k).name);
+        if any(strcmp(param.DataType, {'double', 'single'}))
+            param.DataType = portType;      % handle object: updates the base copy
+        end
+    end
+end
+
+try
+    set_param(SmlkMdl, 'DisconSingle', onoff);
+catch
+    warning('DISCON_SetPrecision:target', ...
+            ['%s does not use the DISCON target (discon.tlc); build with ' ...
+             'DISCON_SINGLE=%d in the template makefile'], SmlkMdl, strcmp(onoff, 'on'));
+end
+
+sfuns = find_system(SmlkMdl, 'LookUnderMasks', 'all', 'BlockType', 'S-Function');
+lct   = sfuns(~cellfun(@isempty, regexp(get_param(sfuns, 'FunctionName'), ...
+                                        '^discon_', 'once')));
+if strcmp(portType, 'single') && ~isempty(lct)
+    fprintf('%d DISCON blocks keep double ports, e.g. %s\n', numel(lct), lct{1});
+end
+fprintf('%s is now a %s-precision controller\n', SmlkMdl, portType);
+end
@@ -0,0 +1,72 @@
+function DISCON_WriteParams(fileName, params)
+% DISCON_WriteParams  Write controller parameters in the binary DISCON format.
+%
+%   DISCON_WriteParams('discon.in', params) writes every field of the
+%   struct params, a real scalar, vector or matrix, as a named entry of a
+%   binary parameter file. The controller reads the file instead of the
+%   text form of discon.in; fields userVar1..userVar20 set the model inputs
+%   of the same names. For example
+%
+%       p = load('Parameters_NREL5MW.mat');
+%       p.userVar1 = 1;
+%       DISCON_WriteParams('discon.in', p);
+%
+%   Fields that are not real numeric arrays (structs, strings, ...) are
+%   skipped with a warning. The layout is described in discon_params.h.
+%
+%   Running controllers map the file instead of reading it, so the new file
+%   is written next to the old one and then renamed over it; controllers
+%   created afterwards see the new values, existing ones keep the old.
+
+magic    = 'DISCONP';       % DISCON_PARAM_MAGIC
+version  = 1;               % DISCON_PARAM_VERSION
+nameLen  = 48;              % DISCON_PARAM_NAME_LEN
+hdrBytes = 16;
+entBytes = 64;
+
+names = fieldnames(params);
+keep  = false(size(names));
+for k = 1:numel(names)
+    v = params.(names{k});
+    keep(k) = (isnumeric(v) || islogical(v)) && isreal(v) && ~isempty(v) && ndims(v) == 2;
+    if ~keep(k)
+        warning('DISCON_WriteParams:skipped', 'Skipping %s: not a real 2-D array', names{k});
+    elseif numel(names{k}) >= nameLen
+        error('DISCON_WriteParams:name', 'Name %s is longer than %d characters', names{k}, nameLen-1);
+    end
+end
+names = names(keep);
+
+tmpName = [fileName '.tmp'];
+fid = fopen(tmpName, 'w', 'native');
+if fid < 0
+    error('DISCON_WriteParams:open', 'Unable to write %s', tmpName);
+end
+
+% Header
+fwrite(fid, [magic 0], 'char*1');
+fwrite(fid, [version numel(names)], 'uint32');
+
+% Entry table; the data follows it, each array 8-byte aligned
+offset = hdrBytes + entBytes*numel(names);
+for k = 1:numel(names)
+    v    = params.(names{k});
+    name = zeros(1, nameLen);
+    name(1:numel(names{k})) = names{k};
+    fwrite(fid, name, 'char*1');
+    fwrite(fid, size(v), 'uint32');
+    fwrite(fid, offset, 'uint64');
+    offset = offset + 8*numel(v);
+end
+
+% Data, column-major
+for k = 1:numel(names)
+    fwrite(fid, double(params.(names{k})), 'double');
+end
+fclose(fid);
+
+[ok, msg] = movefile(tmpName, fileName, 'f');
+if ~ok
+    error('DISCON_WriteParams:rename', 'Unable to replace %s: %s', fileName, msg);
+end
+end
@@ -0,0 +1,327 @@
+/*
+ * File    : discon.h
+ *
+ * Abstract:
+ *      Public interface of the DISCON controller library.
+ *
+ *      Besides the Bladed style DISCON() entry point, a host that simulates
+ *      several turbines in one process (e.g. a wind-farm solver) can create
+ *      and destroy controller instances explicitly. DISCON() itself binds
+ *      every avrSwap buffer it is called with to its own instance, so N
+ *      turbines can share one loaded DISCON.dll/DISCON.so.
+ *
+ *      More than one live instance requires the model to be generated with
+ *      MULTI_INSTANCE_CODE (reusable code with an allocation function). The
+ *      classic (GRT) interface keeps the model data in globals and therefore
+ *      supports exactly one instance per process.
+ *
+ *      Hosts that drive the model directly can bypass the avrSwap protocol
+ *      and exchange the model inports and outports as float vectors, either
+ *      one vector per call or as struct-of-arrays buffers for many instances
+ *      or many time steps. The signal numbering is defined in discon_io.h.
+ *      A vector logging outport appears there as its first element only;
+ *      all its elements reach the host through the avrSwap logging record.
+ */
+
+#ifndef DISCON_H
+#define DISCON_H
+
+/* Generic helper definitions for shared library support */
+#if defined _WIN32 || defined __CYGWIN__
+  #define DISCON_DLL_IMPORT __declspec(dllimport)
+  #define DISCON_DLL_EXPORT __declspec(dllexport)
+  #define DISCON_DLL_LOCAL
+#else
+  #if __GNUC__ >= 4
+    #define DISCON_DLL_IMPORT __attribute__ ((visibility ("default")))
+    #define DISCON_DLL_EXPORT __attribute__ ((visibility ("default")))
+    #define DISCON_DLL_LOCAL  __attribute__ ((visibility ("hidden")))
+  #else
+    #define DISCON_DLL_IMPORT
+    #define DISCON_DLL_EXPORT
+    #define DISCON_DLL_LOCAL
+  #endif
+#endif
+
+#define DISCON_API DISCON_DLL_EXPORT
+#define DISCON_LOCAL DISCON_DLL_LOCAL
+
+#ifdef __GNUC__
+#  define CDECL
+#else
+#  define CDECL __cdecl
+#endif
+
+#include <stddef.h>
+
+#include "discon_io.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Opaque per-turbine controller instance */
+typedef struct DISCON_Instance DISCON_Instance;
+
+/* Function: initiateController ===========================================
+ *      Create and initialize a new controller instance. Returns NULL and
+ *      fills errorMsg (at least 257 characters) when no instance could be
+ *      created.
+ */
+DISCON_API DISCON_Instance *initiateController(char *errorMsg);
+
+/* Function: performCleanup ===============================================
+ *      Terminate the model of an instance and release the instance. Returns
+ *      -1 with the message in errorMsg when the run ended with a model or
+ *      overrun error, 0 otherwise.
+ */
+DISCON_API int performCleanup(DISCON_Instance *inst, char *errorMsg);
+
+/* Function: DISCON_Reset =================================================
+ *      Restart an instance from the initial conditions of the model without
+ *      releasing it, e.g. between the cases of a batch of simulations. The
+ *      parameter file is looked up again, the log starts over and the
+ *      timing statistics are cleared. Must not be called while the instance
+ *      is being stepped. Returns 0, or -1 with errorMsg filled, in which
+ *      case the instance has been released. DISCON() resets the instance
+ *      of a buffer that is called with iStatus 0 again.
+ */
+DISCON_API int DISCON_Reset(DISCON_Instance *inst, char *errorMsg);
+
+/* Function: DISCON_GetInstance ===========================================
+ *      Return the instance bound to an avrSwap buffer by DISCON(), or NULL.
+ *      With the classic interface the one instance, whatever the buffer.
+ */
+DISCON_API DISCON_Instance *DISCON_GetInstance(const float *avrSwap);
+
+/* Function: DISCON_GetParameter =========================================
+ *      Look up a named entry of the parameter file (discon.in) that was read
+ *      when the instance was created. Sets *data to the rows x cols values,
+ *      stored column-major, and returns their number; returns 0 when the
+ *      entry does not exist. rows and cols may be NULL. The data remain
+ *      valid until the instance is cleaned up.
+ */
+DISCON_API int DISCON_GetParameter(const DISCON_Instance *inst, const char *name,
+                                   const double **data, int *rows, int *cols);
+
+/* Function: DISCON_StepBatch =============================================
+ *      Call n instances for one time step, spread over a pool of worker
+ *      threads. Instance i exchanges its data through avrSwap[i] exactly
+ *      like a DISCON call (iStatus in avrSwap[i][0]) and reports through
+ *      aviFail[i] and, when avcMsg is not NULL, avcMsg[i]. An instance
+ *      must appear only once per batch. Returns the number of failed
+ *      instances.
+ *
+ *      The pool has one worker per processor unless the environment
+ *      variable DISCON_NUM_THREADS sets the number of workers.
+ */
+DISCON_API int DISCON_StepBatch(DISCON_Instance **inst, float **avrSwap,
+                                int *aviFail, char **avcMsg, int n);
+
+/* Function: calcOutputController =========================================
+ *      Step an instance once. u[k*uStride] is input k (DISCON_IN_xxx) and
+ *      y[k*yStride] receives output k (DISCON_OUT_xxx); pass strides of 1
+ *      for packed vectors. The outputs are left untouched when the step
+ *      fails. Returns 0 on success and -1 on failure.
+ */
+DISCON_API int calcOutputController(DISCON_Instance *inst,
+                                    const float *u, size_t uStride,
+                                    float *y, size_t yStride);
+
+/* Function: DISCON_StepSoA ===============================================
+ *      Step n instances once, on the worker pool of DISCON_StepBatch. The
+ *      buffers are struct-of-arrays: in holds DISCON_NUM_INPUTS arrays of
+ *      n values, in[k*n + i] being input k of instance i, and out holds
+ *      DISCON_NUM_OUTPUTS arrays of n values laid out the same way.
+ *      aviFail[i] receives the status of instance i. Returns the number of
+ *      failed instances.
+ */
+DISCON_API int DISCON_StepSoA(DISCON_Instance **inst, const float *in,
+                              float *out, int *aviFail, int n);
+
+/* Function: DISCON_RunSoA ================================================
+ *      Step one instance through nSteps consecutive time steps. in[k*nSteps
+ *      + t] is input k at step t and out is laid out the same way. Stops at
+ *      the first failed step and returns the number of completed steps.
+ */
+DISCON_API int DISCON_RunSoA(DISCON_Instance *inst, const float *in,
+                             float *out, int nSteps);
+
+/* Function: DISCON_StopWorkers ===========================================
+ *      Join the worker threads of DISCON_StepBatch and DISCON_StepSoA,
+ *      e.g. before the host unloads the library.
+ */
+DISCON_API void DISCON_StopWorkers(void);
+
+/* Phases of one DISCON call, see DISCON_GetPhaseTimes */
+enum {
+    DISCON_PHASE_SETPARAMS,     /* SetParams: parameter file to avrSwap    */
+    DISCON_PHASE_INPUTS,        /* avrSwap to the model inputs             */
+    DISCON_PHASE_OUTPUTS,       /* MdlOutputs, including the step checks   */
+    DISCON_PHASE_UPDATE,        /* MdlUpdate and the model timing          */
+    DISCON_PHASE_LOG,           /* streaming log                           */
+    DISCON_PHASE_SCATTER,       /* model outputs and logging to avrSwap    */
+    DISCON_NUM_PHASES
+};
+
+/* Function: DISCON_GetPhaseTimes =========================================
+ *      Copy the time in nanoseconds spent in each phase of the last DISCON
+ *      call of an instance to ns[DISCON_PHASE_xxx], for at most n phases.
+ *      Returns the number of phases copied, or 0 when the library was built
+ *      without DISCON_PROFILE. With a single-step function (ONESTEPFCN)
+ *      the update is counted in DISCON_PHASE_OUTPUTS.
+ */
+DISCON_API int DISCON_GetPhaseTimes(const DISCON_Instance *inst, double *ns, int n);
+
+/* Timing statistics of an instance, see DISCON_GetTiming */
+#define DISCON_TIMING_TASKS 8
+
+typedef struct {
+    double calls;               /* timed step calls (iStatus > 0)          */
+    double deadlineNs;          /* step size of the model                  */
+    double deadlineMisses;      /* calls that took longer than the step    */
+    double meanNs;              /* call latency                            */
+    double p50Ns;
+    double p99Ns;
+    double p999Ns;
+    double maxNs;               /* worst-case execution time of a call     */
+    int    nTasks;              /* sample-time tasks below                 */
+    double wcetOutputsNs[DISCON_TIMING_TASKS];  /* MdlOutputs(tid)         */
+    double wcetUpdateNs[DISCON_TIMING_TASKS];   /* MdlUpdate(tid)          */
+} DISCON_Timing;
+
+/* Function: DISCON_GetTiming =============================================
+ *      Copy the timing statistics of an instance since it was created or
+ *      last reset, and reset them when reset is nonzero. Single-tasking
+ *      builds time all rates as task 0. Must not be called while the
+ *      instance is being stepped. Returns 0, or -1 when the library was
+ *      built without DISCON_PROFILE.
+ *
+ *      The same build appends the logging channels DISCON_Call_ns,
+ *      DISCON_WCET_ns and DISCON_Deadline_Misses to those of the model.
+ */
+DISCON_API int DISCON_GetTiming(DISCON_Instance *inst, DISCON_Timing *timing,
+                                int reset);
+
+/* Budget statistics of an instance, see DISCON_GetBudget */
+typedef struct {
+    double budgetNs;            /* time allowed for a step                 */
+    double steps;               /* step calls                              */
+    double overBudget;          /* steps that took longer than the budget  */
+    double skippedLog;          /* log rows left out                       */
+    int    nTasks;              /* sample-time tasks below                 */
+    double deferredTasks[DISCON_TIMING_TASKS];  /* runs not done by the    */
+                                                /*   next base step        */
+    double skippedTasks[DISCON_TIMING_TASKS];   /* sample hits dropped     */
+} DISCON_Budget;
+
+/* Function: DISCON_GetBudget =============================================
+ *      Copy the budget statistics of an instance since it was created or
+ *      last reset, and reset them when reset is nonzero. In a DISCON_BUDGET
+ *      build every step may take DISCON_BUDGET_PERCENT of the step size of
+ *      the model. A step that is over budget once its demands are computed
+ *      writes no log row. In a multitasking build the sub-rate tasks run
+ *      on a worker thread; deferredTasks counts their runs that are still
+ *      going at a later base step, and a sub-rate hit that finds the task
+ *      still released or running is dropped instead of stopping the run.
+ *      Must not be called while the instance is being
+ *      stepped. Returns 0, or -1 when the library was built without
+ *      DISCON_BUDGET.
+ *
+ *      The same build appends the logging channels DISCON_Over_Budget and
+ *      DISCON_Skipped to those of the model.
+ */
+DISCON_API int DISCON_GetBudget(DISCON_Instance *inst, DISCON_Budget *budget,
+                                int reset);
+
+/* Start-up of an instance, see DISCON_GetStartup */
+typedef struct {
+    double startNs;             /* last start or reset, parameter file to  */
+                                /* log, capture and telemetry opened       */
+    int    fromTemplate;        /* 1 when it copied the start template     */
+} DISCON_Startup;
+
+/* Function: DISCON_GetStartup ============================================
+ *      Copy how long the last start (the iStatus 0 call that created the
+ *      instance) or reset of an instance took. The first instance with a
+ *      parameter set of a reusable-code library is initialized in full,
+ *      and so is the second, which checks that its initial state is the
+ *      same as that of the first; from then on a start copies that state,
+ *      the start template, instead of running the initialize function of
+ *      the model (fromTemplate). The environment variable
+ *      DISCON_START_TEMPLATE=0 initializes every instance in full. Returns
+ *      0.
+ */
+DISCON_API int DISCON_GetStartup(const DISCON_Instance *inst, DISCON_Startup *startup);
+
+/* Host-time schedule of an instance, see DISCON_GetSchedule */
+typedef struct {
+    double calls;               /* DISCON calls after the initialization   */
+    double steps;               /* model steps they made                   */
+    double heldCalls;           /* calls between two sample hits           */
+    double catchUpSteps;        /* steps after the first of a call         */
+    double resyncs;             /* calls more than DISCON_MAX_CATCHUP late */
+    double nextHit;             /* host time of the next model step, s     */
+} DISCON_Schedule;
+
+/* Function: DISCON_GetSchedule ===========================================
+ *      Copy the statistics of the host-time schedule of an instance since
+ *      its initialization, and reset them when reset is nonzero. In a
+ *      DISCON_HOST_TIME build (not the default) a DISCON call steps the
+ *      model only on the sample hits of the model in the host time rTime
+ *      (avrSwap[1]): a host that calls more often than the step size of
+ *      the model gets the outputs of the latest step between hits, held
+ *      or, with the environment variable DISCON_INTERPOLATE=1, ramped to
+ *      them over one step; a call that passes several hits makes all their
+ *      steps with the inputs of the call. A host that passes no rSample
+ *      (avrSwap[2]) is stepped on every call. calcOutputController and the
+ *      struct-of-arrays calls always make one step. Must not be called
+ *      while the instance is being stepped. Returns 0, or -1 when the
+ *      library was built without DISCON_HOST_TIME.
+ */
+DISCON_API int DISCON_GetSchedule(DISCON_Instance *inst, DISCON_Schedule *schedule,
+                                  int reset);
+
+/* Function: DISCON_Snapshot ==============================================
+ *      Copy the complete state of an instance to buf, which holds size
+ *      bytes (at least DISCON_SnapshotSize): the timing of the rtModel and,
+ *      for the classic interface, of the timing engine, the model inputs,
+ *      outputs, block I/O, DWork and continuous and zero-crossing states,
+ *      and the overrun counters. It holds no pointers: the rtModel and the
+ *      work vectors of the parameter blocks keep those of the instance.
+ *      Returns the size of the snapshot, or 0 with errorMsg filled.
+ *
+ *      DISCON_Restore copies a snapshot into an instance of the same
+ *      library, which then continues bit-exactly where the snapshotted
+ *      instance was: one start-up transient can be forked into any number
+ *      of runs. The instance keeps its own parameter set, log and timing
+ *      statistics. Returns 0, or -1 with errorMsg filled and the instance
+ *      untouched when the snapshot does not fit the model.
+ *
+ *      DISCON_SaveSnapshot and DISCON_LoadSnapshot do the same through a
+ *      file, e.g. to checkpoint a long run and resume it in a new process;
+ *      a checkpoint file is replaced only once the new one is complete.
+ *
+ *      None of these may be called while the instance is being stepped.
+ */
+DISCON_API size_t DISCON_SnapshotSize(DISCON_Instance *inst);
+DISCON_API size_t DISCON_Snapshot(DISCON_Instance *inst, void *buf, size_t size,
+                                  char *errorMsg);
+DISCON_API int DISCON_Restore(DISCON_Instance *inst, const void *buf, size_t size,
+                              char *errorMsg);
+DISCON_API int DISCON_SaveSnapshot(DISCON_Instance *inst, const char *path,
+                                   char *errorMsg);
+DISCON_API int DISCON_LoadSnapshot(DISCON_Instance *inst, const char *path,
+                                   char *errorMsg);
+
+/* Bladed style entry point (see the Bladed user manual, Appendix A) */
+DISCON_API void CDECL DISCON(float *avrSwap, int *aviFail, char *accInfile,
+                             char *avcOutname, char *avcMsg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DISCON_H */
+
+/* EOF: discon.h */
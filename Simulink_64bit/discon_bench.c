@@ -0,0 +1,545 @@
+/*
+ * File    : discon_bench.c
+ *
+ * Abstract:
+ *      Micro-benchmark of the DISCON entry point. Loads a controller library
+ *      (DISCON.so) with dlopen, drives DISCON with a synthetic avrSwap
+ *      trace or with the inputs recorded in a controller log (.dlog) for
+ *      any number of steps, and reports the distribution of the time per
+ *      call. When the library was built with DISCON_PROFILE the time of
+ *      every call is also broken down into its phases (DISCON_PHASE_xxx),
+ *      and the report adds the library's own statistics (DISCON_GetTiming):
+ *      deadline misses and the worst case of each sample-time task.
+ *
+ *      With -instances n the benchmark first starts n instances, each with
+ *      its own avrSwap buffer, and reports the distribution of the time of
+ *      their initialization calls and how many copied the start template
+ *      (DISCON_GetStartup); the first instance is then timed as usual. A
+ *      library with the classic interface has one instance, which is reset
+ *      instead.
+ *
+ *      The report is a JSON document on stdout (or the file given with -o),
+ *      so the results of controller revisions can be compared by scripts;
+ *      a readable summary goes to stderr.
+ *
+ *      usage: discon_bench [-n steps] [-w warmup] [-dt stepSize]
+ *                          [-instances n] [-trace log.dlog] [-label text]
+ *                          [-o report.json] [library]
+ *
+ *      A library built with DISCON_LOG writes its log to discon_bench.dlog
+ *      unless DISCON_LOG_FILE is set, so a replayed log is not overwritten;
+ *      DISCON_LOG=0 leaves the log out of a start-up benchmark.
+ *
+ *      Built with the library by the Linux template makefile (discon.tmf).
+ *      Pin the process to one core (taskset -c 2 ./discon_bench) for
+ *      repeatable percentiles.
+ */
+
+#ifndef _POSIX_C_SOURCE
+# define _POSIX_C_SOURCE 200112L        /* setenv with -std=c99 */
+#endif
+
+#include <dlfcn.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "discon.h"
+#include "discon_log.h"
+#include "discon_profile.h"
+
+/*=========*
+ * Defines *
+ *=========*/
+
+#define SWAP_SIZE       2048        /* records of the avrSwap array          */
+#define FIRST_LOG       1000        /* avrSwap[62], record of logging output */
+#define MAX_LOG         1000        /* avrSwap[63]                           */
+#define OUTNAME_SIZE    32768       /* avrSwap[50]                           */
+#define MSG_SIZE        1024        /* avrSwap[48]                           */
+#define PI              3.14159265358979323846
+
+typedef void (CDECL *DisconFcn)(float *avrSwap, int *aviFail, char *accInfile,
+                                char *avcOutname, char *avcMsg);
+typedef DISCON_Instance *(*GetInstanceFcn)(const float *avrSwap);
+typedef int (*GetPhaseTimesFcn)(const DISCON_Instance *inst, double *ns, int n);
+typedef int (*GetTimingFcn)(DISCON_Instance *inst, DISCON_Timing *timing, int reset);
+typedef int (*GetStartupFcn)(const DISCON_Instance *inst, DISCON_Startup *startup);
+
+/* Model inputs and their avrSwap records, for replaying a log */
+typedef struct {
+    const char *name;
+    int        swap;
+} InputRecord;
+
+#define BENCH_INPUT(name, i) { #name, i },
+static const InputRecord Inputs[] = {
+    DISCON_INPUTS(BENCH_INPUT) { NULL, -1 }
+};
+
+/* An input trace held in memory: time and the avrSwap record of each column */
+typedef struct {
+    int    nRows;
+    int    nCols;
+    double stepSize;
+    double *time;
+    int    *swap;               /* avrSwap index of column k               */
+    float  *data;               /* column k at data[k*nRows]               */
+} Trace;
+
+static const char *const PhaseNames[DISCON_NUM_PHASES + 1] = {
+    "SetParams", "Inputs", "MdlOutputs", "MdlUpdate", "Logging", "Scatter",
+    "Overhead"                  /* call time not in any phase              */
+};
+
+/*=================*
+ * Local functions *
+ *=================*/
+
+/* Function: fail =========================================================
+ *
+ * Abstract:
+ *      Report a fatal error and exit.
+ */
+static void fail(const char *what, const char *detail) {
+    (void)fprintf(stderr, "discon_bench: %s%s%s\n", what,
+                  detail != NULL ? ": " : "", detail != NULL ? detail : "");
+    exit(EXIT_FAILURE);
+}  /* end fail */
+
+/* Function: loadTrace ====================================================
+ *
+ * Abstract:
+ *      Read the model inputs recorded in a controller log. Channels that
+ *      are not model inputs of this build are ignored, as is the iStatus
+ *      record (Init), which the benchmark drives itself.
+ */
+static void loadTrace(const char *path, Trace *trace) {
+    FILE                 *file = fopen(path, "rb");
+    disconLogFileHeader  header;
+    disconLogChunkHeader chunk;
+    char                 name[DISCON_LOG_NAME_LEN];
+    int                  *column, k, i, n, maxRows;
+    long                 dataStart, fileSize;
+    float                *buffer;
+
+    if (file == NULL) fail("unable to open", path);
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, DISCON_LOG_MAGIC, sizeof(DISCON_LOG_MAGIC)) != 0 ||
+        header.version != DISCON_LOG_VERSION) {
+        fail("not a DISCON log file", path);
+    }
+
+    /* Map the log channels to avrSwap records */
+    column = (int *)malloc(header.nChannels*sizeof(int));
+    trace->swap = (int *)malloc(header.nChannels*sizeof(int));
+    if (column == NULL || trace->swap == NULL) fail("out of memory", NULL);
+    trace->nCols = 0;
+    for (k=0; k<(int)header.nChannels; k++) {
+        if (fread(name, sizeof(name), 1, file) != 1) fail("truncated header", path);
+        name[sizeof(name)-1] = '\0';
+        column[k] = -1;
+        for (i=0; Inputs[i].name != NULL; i++) {
+            if (Inputs[i].swap > 0 && strcmp(Inputs[i].name, name) == 0) {
+                column[k] = trace->nCols;
+                trace->swap[trace->nCols++] = Inputs[i].swap;
+                break;
+            }
+        }
+    }
+    if (trace->nCols == 0) fail("the log has no inputs of this model", path);
+
+    /* The file size bounds the number of rows */
+    dataStart = ftell(file);
+    (void)fseek(file, 0, SEEK_END);
+    fileSize = ftell(file);
+    (void)fseek(file, dataStart, SEEK_SET);
+    maxRows = (int)((fileSize - dataStart)/(8 + 4*(long)header.nChannels));
+
+    trace->stepSize = header.stepSize;
+    trace->time = (double *)malloc((size_t)maxRows*sizeof(double) + 1);
+    trace->data = (float *)malloc((size_t)maxRows*trace->nCols*sizeof(float) + 1);
+    buffer = (float *)malloc(header.chunkRows*sizeof(float));
+    if (trace->time == NULL || trace->data == NULL || buffer == NULL) {
+        fail("out of memory", NULL);
+    }
+
+    n = 0;
+    while (fread(&chunk, sizeof(chunk), 1, file) == 1) {
+        int rows = (int)chunk.rows;
+
+        if (chunk.magic != DISCON_LOG_CHUNK_MAGIC || rows > (int)header.chunkRows ||
+            n + rows > maxRows ||
+            fread(trace->time + n, sizeof(double), rows, file) != (size_t)rows) {
+            break;
+        }
+        for (k=0; k<(int)header.nChannels; k++) {
+            if (fread(buffer, sizeof(float), rows, file) != (size_t)rows) break;
+            if (column[k] >= 0) {
+                (void)memcpy(trace->data + (size_t)column[k]*maxRows + n, buffer,
+                             rows*sizeof(float));
+            }
+        }
+        if (k < (int)header.nChannels) break;   /* incomplete last chunk */
+        n += rows;
+    }
+    (void)fclose(file);
+    free(buffer);
+    free(column);
+    if (n == 0) fail("the log has no complete chunk", path);
+
+    /* Pack the columns to the rows actually read */
+    for (k=1; k<trace->nCols; k++) {
+        (void)memmove(trace->data + (size_t)k*n, trace->data + (size_t)k*maxRows,
+                      n*sizeof(float));
+    }
+    trace->nRows = n;
+}  /* end loadTrace */
+
+/* Function: setInputs ====================================================
+ *
+ * Abstract:
+ *      Set the avrSwap inputs of step k: row k of the trace (repeated from
+ *      the start when the steps outnumber the rows), or else a synthetic
+ *      above-rated operating point of a 5 MW turbine with gusts, rotor
+ *      harmonics and measurement noise.
+ */
+static void setInputs(float *avrSwap, const Trace *trace, long k, double dt) {
+    double t = k*dt;
+
+    if (trace->nRows > 0) {
+        int row = (int)(k % trace->nRows);
+        int c;
+
+        for (c=0; c<trace->nCols; c++) {
+            avrSwap[trace->swap[c]] = trace->data[(size_t)c*trace->nRows + row];
+        }
+    } else {
+        double gust   = sin(2*PI*0.05*t) + 0.3*sin(2*PI*0.31*t);
+        double noise  = (double)rand()/RAND_MAX - 0.5;
+        double azim   = fmod(2*PI*0.2*t, 2*PI);
+        double pitch  = 0.15 + 0.05*gust;
+        double speed  = 122.9 + 4.0*gust + 0.5*noise;
+
+        avrSwap[3]  = (float)pitch;                 /* blade 1 pitch         */
+        avrSwap[32] = (float)pitch;
+        avrSwap[33] = (float)pitch;
+        avrSwap[14] = (float)(5.0e6 + 2.0e5*gust);  /* electrical power      */
+        avrSwap[18] = 122.9f;                       /* rated speed           */
+        avrSwap[19] = (float)speed;                 /* generator speed       */
+        avrSwap[20] = (float)(speed/97.0);          /* rotor speed           */
+        avrSwap[22] = 43093.55f;                    /* measured torque       */
+        avrSwap[23] = (float)(0.05*gust);           /* yaw error             */
+        avrSwap[26] = (float)(16.0 + 3.0*gust);     /* hub wind speed        */
+        avrSwap[29] = (float)(6.0e6 + 1.0e6*cos(azim));          /* OP roots */
+        avrSwap[30] = (float)(6.0e6 + 1.0e6*cos(azim + 2*PI/3));
+        avrSwap[31] = (float)(6.0e6 + 1.0e6*cos(azim + 4*PI/3));
+        avrSwap[52] = (float)(0.2*sin(2*PI*0.32*t) + 0.02*noise);  /* tower */
+        avrSwap[53] = (float)(0.1*sin(2*PI*0.31*t));
+        avrSwap[59] = (float)azim;                  /* rotor azimuth         */
+    }
+    avrSwap[1] = (float)t;
+    avrSwap[2] = (float)dt;
+}  /* end setInputs */
+
+/* Function: writeStats ===================================================
+ *
+ * Abstract:
+ *      Write the summary of a histogram as a JSON object.
+ */
+static void writeStats(FILE *out, const disconHist *h) {
+    (void)fprintf(out, "{\"count\": %lu, \"mean\": %.1f, \"min\": %lu, "
+                  "\"p50\": %lu, \"p90\": %lu, \"p99\": %lu, \"p99.9\": %lu, "
+                  "\"p99.99\": %lu, \"max\": %lu}",
+                  (unsigned long)h->count,
+                  h->count > 0 ? h->sum/(double)h->count : 0.0,
+                  (unsigned long)h->min,
+                  (unsigned long)disconHistPercentile(h, 50.0),
+                  (unsigned long)disconHistPercentile(h, 90.0),
+                  (unsigned long)disconHistPercentile(h, 99.0),
+                  (unsigned long)disconHistPercentile(h, 99.9),
+                  (unsigned long)disconHistPercentile(h, 99.99),
+                  (unsigned long)h->max);
+}  /* end writeStats */
+
+/* Function: writeString ==================================================
+ *
+ * Abstract:
+ *      Write a JSON string.
+ */
+static void writeString(FILE *out, const char *s) {
+    (void)fputc('"', out);
+    for (; *s != '\0'; s++) {
+        if (*s == '"' || *s == '\\') {
+            (void)fprintf(out, "\\%c", *s);
+        } else if ((unsigned char)*s < 0x20) {
+            (void)fprintf(out, "\\u%04x", (unsigned)(unsigned char)*s);
+        } else {
+            (void)fputc(*s, out);
+        }
+    }
+    (void)fputc('"', out);
+}  /* end writeString */
+
+/* Function: writeArray ===================================================
+ *
+ * Abstract:
+ *      Write n values as a JSON array.
+ */
+static void writeArray(FILE *out, const double *x, int n) {
+    int i;
+
+    (void)fputc('[', out);
+    for (i=0; i<n; i++) {
+        (void)fprintf(out, "%s%.0f", i > 0 ? ", " : "", x[i]);
+    }
+    (void)fputc(']', out);
+}  /* end writeArray */
+
+/* Function: summary ======================================================
+ *
+ * Abstract:
+ *      One readable line of a histogram on stderr.
+ */
+static void summary(const char *name, const disconHist *h) {
+    (void)fprintf(stderr, "  %-12s %9.1f %9lu %9lu %9lu %9lu\n", name,
+                  h->count > 0 ? h->sum/(double)h->count : 0.0,
+                  (unsigned long)disconHistPercentile(h, 50.0),
+                  (unsigned long)disconHistPercentile(h, 99.0),
+                  (unsigned long)disconHistPercentile(h, 99.9),
+                  (unsigned long)h->max);
+}  /* end summary */
+
+/*===================*
+ * Visible functions *
+ *===================*/
+
+int main(int argc, char *argv[]) {
+    const char       *library = "./DISCON.so";
+    const char       *tracePath = NULL, *label = "", *outPath = NULL;
+    long             nSteps = 1000000, nWarmup = 1000, nInstances = 1, k, j;
+    double           dt = 0.0, phaseNs[DISCON_NUM_PHASES], elapsed;
+    Trace            trace;
+    void             *handle;
+    DisconFcn        discon;
+    GetInstanceFcn   getInstance;
+    GetPhaseTimesFcn getPhaseTimes;
+    GetTimingFcn     getTiming;
+    GetStartupFcn    getStartup;
+    DISCON_Timing    timing;
+    DISCON_Startup   startup;
+    DISCON_Instance  *inst;
+    disconHist       *calls, *phases, *starts;
+    float            *avrSwap, **swaps;
+    char             *outName, msg[MSG_SIZE + 1], inFile[1] = {'\0'};
+    int              aviFail = 0, profiled, timed, fromTemplate = 0, i;
+    uint64_t         start, t0, t1;
+    FILE             *out = stdout;
+
+    for (i=1; i<argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i+1 < argc) {
+            nSteps = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-w") == 0 && i+1 < argc) {
+            nWarmup = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-dt") == 0 && i+1 < argc) {
+            dt = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-instances") == 0 && i+1 < argc) {
+            nInstances = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-trace") == 0 && i+1 < argc) {
+            tracePath = argv[++i];
+        } else if (strcmp(argv[i], "-label") == 0 && i+1 < argc) {
+            label = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && i+1 < argc) {
+            outPath = argv[++i];
+        } else if (argv[i][0] != '-') {
+            library = argv[i];
+        } else {
+            (void)fprintf(stderr, "usage: %s [-n steps] [-w warmup] [-dt stepSize] "
+                          "[-instances n] [-trace log.dlog] [-label text] "
+                          "[-o report.json] [library]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (nSteps < 1 || nWarmup < 0) fail("invalid number of steps", NULL);
+    if (nInstances < 1) fail("invalid number of instances", NULL);
+
+    (void)memset(&trace, 0, sizeof(trace));
+    if (tracePath != NULL) {
+        loadTrace(tracePath, &trace);
+        if (dt <= 0.0) dt = trace.stepSize;
+    }
+    if (dt <= 0.0) dt = 0.01;
+
+    if (getenv("DISCON_LOG_FILE") == NULL) {
+        (void)setenv("DISCON_LOG_FILE", "discon_bench.dlog", 1);
+    }
+    handle = dlopen(library, RTLD_NOW | RTLD_LOCAL);
+    if (handle == NULL) fail("unable to load the controller", dlerror());
+    *(void **)&discon        = dlsym(handle, "DISCON");
+    *(void **)&getInstance   = dlsym(handle, "DISCON_GetInstance");
+    *(void **)&getPhaseTimes = dlsym(handle, "DISCON_GetPhaseTimes");
+    *(void **)&getTiming     = dlsym(handle, "DISCON_GetTiming");
+    *(void **)&getStartup    = dlsym(handle, "DISCON_GetStartup");
+    if (discon == NULL) fail("no DISCON entry point in", library);
+
+    swaps   = (float **)calloc((size_t)nInstances, sizeof(float *));
+    outName = (char *)calloc(OUTNAME_SIZE + 1, 1);
+    calls   = (disconHist *)malloc(sizeof(disconHist));
+    phases  = (disconHist *)malloc((DISCON_NUM_PHASES + 1)*sizeof(disconHist));
+    starts  = (disconHist *)malloc(sizeof(disconHist));
+    if (swaps == NULL || outName == NULL || calls == NULL || phases == NULL ||
+        starts == NULL) {
+        fail("out of memory", NULL);
+    }
+    for (j=0; j<nInstances; j++) {
+        if ((swaps[j] = (float *)calloc(SWAP_SIZE, sizeof(float))) == NULL) {
+            fail("out of memory", NULL);
+        }
+    }
+    avrSwap = swaps[0];
+    disconHistReset(calls);
+    disconHistReset(starts);
+    for (i=0; i<=DISCON_NUM_PHASES; i++) disconHistReset(&phases[i]);
+
+    /* Initialization calls */
+    for (j=0; j<nInstances; j++) {
+        swaps[j][48] = MSG_SIZE;
+        swaps[j][49] = 0;
+        swaps[j][50] = OUTNAME_SIZE;
+        swaps[j][62] = FIRST_LOG;
+        swaps[j][63] = MAX_LOG;
+        setInputs(swaps[j], &trace, 0, dt);
+        swaps[j][0] = 0;
+        (void)memset(msg, 0, sizeof(msg));
+        t0 = disconClockNs();
+        discon(swaps[j], &aviFail, inFile, outName, msg);
+        t1 = disconClockNs();
+        if (aviFail < 0) fail("initialization failed", msg);
+
+        disconHistAdd(starts, t1 - t0);
+        inst = getInstance != NULL ? getInstance(swaps[j]) : NULL;
+        if (inst != NULL && getStartup != NULL && getStartup(inst, &startup) == 0) {
+            fromTemplate += startup.fromTemplate;
+        }
+    }
+
+    inst = getInstance != NULL ? getInstance(avrSwap) : NULL;
+    profiled = inst != NULL && getPhaseTimes != NULL &&
+               getPhaseTimes(inst, phaseNs, DISCON_NUM_PHASES) == DISCON_NUM_PHASES;
+
+    /* Warm-up and timed steps */
+    avrSwap[0] = 1;
+    start = disconClockNs();
+    for (k=1; k<=nWarmup+nSteps; k++) {
+        setInputs(avrSwap, &trace, k, dt);
+        t0 = disconClockNs();
+        discon(avrSwap, &aviFail, inFile, outName, msg);
+        t1 = disconClockNs();
+        if (aviFail < 0) fail("step failed", msg);
+        if (k == nWarmup) {
+            start = t1;
+            if (inst != NULL && getTiming != NULL) {
+                (void)getTiming(inst, &timing, 1);  /* drop the warm-up */
+            }
+        }
+        if (k <= nWarmup) continue;
+
+        disconHistAdd(calls, t1 - t0);
+        if (profiled) {
+            double inPhases = 0.0;
+
+            (void)getPhaseTimes(inst, phaseNs, DISCON_NUM_PHASES);
+            for (i=0; i<DISCON_NUM_PHASES; i++) {
+                disconHistAdd(&phases[i], (uint64_t)phaseNs[i]);
+                inPhases += phaseNs[i];
+            }
+            disconHistAdd(&phases[DISCON_NUM_PHASES],
+                          (double)(t1 - t0) > inPhases ?
+                          (uint64_t)((double)(t1 - t0) - inPhases) : 0);
+        }
+    }
+    elapsed = (double)(disconClockNs() - start)*1e-9;
+    timed = inst != NULL && getTiming != NULL &&
+            getTiming(inst, &timing, 0) == 0;
+
+    /* Final calls; with the classic interface only the first succeeds */
+    for (j=0; j<nInstances; j++) {
+        setInputs(swaps[j], &trace, k, dt);
+        swaps[j][0] = -1;
+        discon(swaps[j], &aviFail, inFile, outName, msg);
+    }
+
+    /* Report */
+    if (outPath != NULL && (out = fopen(outPath, "w")) == NULL) {
+        fail("unable to create", outPath);
+    }
+    (void)fprintf(out, "{\n  \"tool\": \"discon_bench\",\n  \"library\": ");
+    writeString(out, library);
+    (void)fprintf(out, ",\n  \"label\": ");
+    writeString(out, label);
+    (void)fprintf(out, ",\n  \"trace\": ");
+    writeString(out, tracePath != NULL ? tracePath : "synthetic");
+    (void)fprintf(out, ",\n  \"steps\": %ld,\n  \"warmup\": %ld,\n"
+                  "  \"step_size\": %g,\n  \"elapsed_s\": %.6f,\n"
+                  "  \"steps_per_s\": %.1f,\n  \"profiled\": %s,\n"
+                  "  \"call_ns\": ", nSteps, nWarmup, dt, elapsed,
+                  nSteps/elapsed, profiled ? "true" : "false");
+    writeStats(out, calls);
+    (void)fprintf(out, ",\n  \"startup\": {\"instances\": %ld, "
+                  "\"from_template\": %d, \"start_ns\": ", nInstances, fromTemplate);
+    writeStats(out, starts);
+    (void)fprintf(out, "}");
+    (void)fprintf(out, ",\n  \"phase_ns\": {");
+    for (i=0; profiled && i<=DISCON_NUM_PHASES; i++) {
+        (void)fprintf(out, "%s\n    \"%s\": ", i > 0 ? "," : "", PhaseNames[i]);
+        writeStats(out, &phases[i]);
+    }
+    (void)fprintf(out, "%s}", profiled ? "\n  " : "");
+    if (timed) {
+        (void)fprintf(out, ",\n  \"library_timing\": {\"calls\": %.0f, "
+                      "\"deadline_ns\": %.0f, \"deadline_misses\": %.0f, "
+                      "\"p99_ns\": %.0f, \"max_ns\": %.0f,\n"
+                      "    \"wcet_outputs_ns\": ", timing.calls,
+                      timing.deadlineNs, timing.deadlineMisses, timing.p99Ns,
+                      timing.maxNs);
+        writeArray(out, timing.wcetOutputsNs, timing.nTasks);
+        (void)fprintf(out, ", \"wcet_update_ns\": ");
+        writeArray(out, timing.wcetUpdateNs, timing.nTasks);
+        (void)fprintf(out, "}");
+    }
+    (void)fprintf(out, "\n}\n");
+    if (out != stdout) (void)fclose(out);
+
+    (void)fprintf(stderr, "%s: %ld steps, %.0f steps/s\n"
+                  "  %-12s %9s %9s %9s %9s %9s\n", library, nSteps,
+                  nSteps/elapsed, "ns/call", "mean", "p50", "p99", "p99.9", "max");
+    summary("DISCON", calls);
+    for (i=0; profiled && i<=DISCON_NUM_PHASES; i++) {
+        summary(PhaseNames[i], &phases[i]);
+    }
+    summary("Start-up", starts);
+    if (nInstances > 1) {
+        (void)fprintf(stderr, "  %d of %ld instances started from the template\n",
+                      fromTemplate, nInstances);
+    }
+    if (timed) {
+        (void)fprintf(stderr, "  %.0f of %.0f calls over the %.0f ns deadline\n",
+                      timing.deadlineMisses, timing.calls, timing.deadlineNs);
+    }
+    if (!profiled) {
+        (void)fprintf(stderr, "  (build the library with DISCON_PROFILE = 1 "
+                      "for the phases)\n");
+    }
+
+    free(starts);
+    free(phases);
+    free(calls);
+    free(outName);
+    for (j=0; j<nInstances; j++) free(swaps[j]);
+    free(swaps);
+    (void)dlclose(handle);
+    return EXIT_SUCCESS;
+}  /* end main */
+
+/* EOF: discon_bench.c */
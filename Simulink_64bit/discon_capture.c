@@ -0,0 +1,294 @@
+/*
+ * File    : discon_capture.c
+ *
+ * Abstract:
+ *      Ring-buffer capture of avrSwap traces with a background encoder and
+ *      writer thread, see discon_capture.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "discon_capture.h"
+#include "discon_threads.h"
+
+/*==================================*
+ * Global data local to this module *
+ *==================================*/
+
+typedef struct Chunk {
+    struct Chunk  *next;        /* writer queue                         */
+    disconCapture *cap;
+    int           calls;        /* records filled                       */
+    int           queued;       /* owned by the writer until written    */
+    float         *records;     /* DISCON_CAPTURE_CHUNK_CALLS records   */
+} Chunk;
+
+struct disconCapture {
+    FILE          *file;
+    char          *path;
+    size_t        nWords;       /* floats per record                    */
+    int           error;        /* set by the writer on a write error   */
+    int           failed;       /* error seen by the producer           */
+    int           current;      /* chunk being filled                   */
+    float         *memory;      /* all chunk buffers                    */
+    float         *prev;        /* writer: previous record of the chunk */
+    unsigned char *encoded;     /* writer: encoded chunk                */
+    Chunk         chunks[DISCON_CAPTURE_CHUNKS];
+};
+
+/* The writer thread shared by all open captures */
+static struct {
+    disconMutex  openLock;      /* serializes opening and closing       */
+    disconMutex  lock;          /* protects everything below            */
+    disconCond   work;          /* a chunk was queued, or stop          */
+    disconCond   done;          /* a chunk was written                  */
+    Chunk        *head;
+    Chunk        *tail;
+    int          nCaptures;
+    int          stop;
+    disconThread thread;
+} Writer = { DISCON_MUTEX_INITIALIZER, DISCON_MUTEX_INITIALIZER,
+             DISCON_COND_INITIALIZER,  DISCON_COND_INITIALIZER,
+             NULL, NULL, 0, 0, 0 };
+
+/*=================*
+ * Local functions *
+ *=================*/
+
+/* Function: writeChunk ===================================================
+ *
+ * Abstract:
+ *      Encode one chunk, append it to its file and flush it, so that it
+ *      survives a crash of the host. Called by the writer without the
+ *      lock.
+ */
+static int writeChunk(const Chunk *c) {
+    disconCapture          *cap = c->cap;
+    disconTraceChunkHeader header;
+    size_t                 size = 0;
+    int                    k;
+
+    (void)memset(cap->prev, 0, cap->nWords*sizeof(float));
+    for (k=0; k<c->calls; k++) {
+        size += disconTraceEncode(c->records + k*cap->nWords, cap->prev, cap->nWords,
+                                  cap->encoded + size);
+    }
+    header.magic    = DISCON_TRACE_CHUNK_MAGIC;
+    header.calls    = (uint32_t)c->calls;
+    header.size     = (uint32_t)size;
+    header.reserved = 0;
+    if (fwrite(&header, sizeof(header), 1, cap->file) != 1 ||
+        fwrite(cap->encoded, 1, size, cap->file) != size) {
+        return -1;
+    }
+    return fflush(cap->file) == 0 ? 0 : -1;
+}  /* end writeChunk */
+
+/* Function: writerThread =================================================
+ *
+ * Abstract:
+ *      Write queued chunks in order until asked to stop.
+ */
+static void writerThread(void *arg) {
+    Chunk *c;
+    int   status;
+
+    (void)arg;
+    disconMutexLock(&Writer.lock);
+    for (;;) {
+        while (Writer.head == NULL && !Writer.stop) {
+            disconCondWait(&Writer.work, &Writer.lock);
+        }
+        if (Writer.head == NULL) break;
+
+        c = Writer.head;
+        Writer.head = c->next;
+        if (Writer.head == NULL) Writer.tail = NULL;
+
+        disconMutexUnlock(&Writer.lock);
+        status = c->cap->error ? 0 : writeChunk(c);
+        disconMutexLock(&Writer.lock);
+
+        if (status != 0) {
+            (void)fprintf(stderr, "Error writing %s, capture stopped\n",
+                          c->cap->path);
+            c->cap->error = 1;
+        }
+        c->calls  = 0;
+        c->queued = 0;
+        disconCondBroadcast(&Writer.done);
+    }
+    disconMutexUnlock(&Writer.lock);
+}  /* end writerThread */
+
+/* Function: queueChunk ===================================================
+ *
+ * Abstract:
+ *      Hand a chunk to the writer. Called with the lock held.
+ */
+static void queueChunk(Chunk *c) {
+    c->queued = 1;
+    c->next   = NULL;
+    if (Writer.tail != NULL) {
+        Writer.tail->next = c;
+    } else {
+        Writer.head = c;
+    }
+    Writer.tail = c;
+    disconCondBroadcast(&Writer.work);
+}  /* end queueChunk */
+
+/* Function: freeCapture ==================================================
+ *
+ * Abstract:
+ *      Free a capture that is not (or no longer) known to the writer.
+ */
+static void freeCapture(disconCapture *cap) {
+    free(cap->memory);
+    free(cap->prev);
+    free(cap->encoded);
+    free(cap->path);
+    free(cap);
+}  /* end freeCapture */
+
+/*===================*
+ * Visible functions *
+ *===================*/
+
+/* Function: disconCaptureOpen ============================================
+ *
+ * Abstract:
+ *      Create a trace file and its ring of chunks; start the writer with
+ *      the first open capture.
+ */
+disconCapture *disconCaptureOpen(const char *path, int nSwap, int nOut,
+                                 double stepSize, char *errorMsg) {
+    disconCapture     *cap;
+    disconTraceHeader header;
+    size_t            nWords = (size_t)nSwap + (size_t)nOut;
+    size_t            chunkWords = DISCON_CAPTURE_CHUNK_CALLS*nWords;
+    int               i;
+
+    cap = (disconCapture *)calloc(1, sizeof(*cap));
+    if (cap == NULL ||
+        (cap->memory = (float *)malloc(DISCON_CAPTURE_CHUNKS*chunkWords*sizeof(float))) == NULL ||
+        (cap->prev = (float *)malloc(nWords*sizeof(float))) == NULL ||
+        (cap->encoded = (unsigned char *)malloc(DISCON_CAPTURE_CHUNK_CALLS*
+                                                DISCON_TRACE_MAX_ENCODED(nWords))) == NULL ||
+        (cap->path = (char *)malloc(strlen(path)+1)) == NULL) {
+        sprintf(errorMsg, "%.100s: out of memory", path);
+        if (cap != NULL) freeCapture(cap);
+        return NULL;
+    }
+    strcpy(cap->path, path);
+    cap->nWords = nWords;
+    for (i=0; i<DISCON_CAPTURE_CHUNKS; i++) {
+        cap->chunks[i].cap     = cap;
+        cap->chunks[i].records = cap->memory + i*chunkWords;
+    }
+
+    cap->file = fopen(path, "wb");
+    if (cap->file == NULL) {
+        sprintf(errorMsg, "%.100s: unable to create the trace file", path);
+        freeCapture(cap);
+        return NULL;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DISCON_TRACE_MAGIC, sizeof(DISCON_TRACE_MAGIC));
+    header.version  = DISCON_TRACE_VERSION;
+    header.nSwap    = (uint32_t)nSwap;
+    header.nOut     = (uint32_t)nOut;
+    header.flags    = DISCON_TRACE_XOR;
+    header.stepSize = stepSize;
+    if (fwrite(&header, sizeof(header), 1, cap->file) != 1 || fflush(cap->file) != 0) {
+        sprintf(errorMsg, "%.100s: unable to write the trace file", path);
+        fclose(cap->file);
+        freeCapture(cap);
+        return NULL;
+    }
+
+    disconMutexLock(&Writer.openLock);
+    if (Writer.nCaptures == 0) {
+        Writer.stop = 0;
+        if (disconThreadCreate(&Writer.thread, writerThread, NULL) != 0) {
+            disconMutexUnlock(&Writer.openLock);
+            sprintf(errorMsg, "%.100s: unable to start the trace writer", path);
+            fclose(cap->file);
+            freeCapture(cap);
+            return NULL;
+        }
+    }
+    Writer.nCaptures++;
+    disconMutexUnlock(&Writer.openLock);
+    return cap;
+}  /* end disconCaptureOpen */
+
+/* Function: disconCaptureRecord ==========================================
+ *
+ * Abstract:
+ *      Reserve the next record. When the current chunk is full it goes to
+ *      the writer and the next chunk of the ring is reused, after waiting
+ *      for the writer if that chunk has not been written yet.
+ */
+float *disconCaptureRecord(disconCapture *cap) {
+    Chunk *c = &cap->chunks[cap->current];
+
+    if (cap->failed) return NULL;
+    if (c->calls == DISCON_CAPTURE_CHUNK_CALLS) {
+        disconMutexLock(&Writer.lock);
+        queueChunk(c);
+        cap->current = (cap->current + 1) % DISCON_CAPTURE_CHUNKS;
+        c = &cap->chunks[cap->current];
+        while (c->queued) {
+            disconCondWait(&Writer.done, &Writer.lock);
+        }
+        cap->failed = cap->error;
+        disconMutexUnlock(&Writer.lock);
+        if (cap->failed) return NULL;
+    }
+    return c->records + (size_t)(c->calls++)*cap->nWords;
+}  /* end disconCaptureRecord */
+
+/* Function: disconCaptureClose ===========================================
+ *
+ * Abstract:
+ *      Write the partial chunk, wait for the writer and close the file.
+ *      The writer thread stops with the last open capture.
+ */
+int disconCaptureClose(disconCapture *cap) {
+    Chunk *c;
+    int   i, status, last;
+
+    if (cap == NULL) return 0;
+
+    disconMutexLock(&Writer.openLock);
+    disconMutexLock(&Writer.lock);
+    c = &cap->chunks[cap->current];
+    if (c->calls > 0 && !c->queued) {
+        queueChunk(c);
+    }
+    for (i=0; i<DISCON_CAPTURE_CHUNKS; i++) {
+        while (cap->chunks[i].queued) {
+            disconCondWait(&Writer.done, &Writer.lock);
+        }
+    }
+    status = cap->error ? -1 : 0;
+    last = (--Writer.nCaptures == 0);
+    if (last) {
+        Writer.stop = 1;
+        disconCondBroadcast(&Writer.work);
+    }
+    disconMutexUnlock(&Writer.lock);
+    if (last) {
+        disconThreadJoin(Writer.thread);
+    }
+    disconMutexUnlock(&Writer.openLock);
+
+    if (fclose(cap->file) != 0) status = -1;
+    freeCapture(cap);
+    return status;
+}  /* end disconCaptureClose */
+
+/* EOF: discon_capture.c */
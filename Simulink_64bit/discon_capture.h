@@ -0,0 +1,57 @@
+/*
+ * File    : discon_capture.h
+ *
+ * Abstract:
+ *      Capture of the DISCON calls of a simulation to an avrSwap trace
+ *      (discon_trace.h), for replay with discon_replay.
+ *
+ *      Every call copies its avrSwap inputs and then its outputs into the
+ *      next record of a preallocated ring of chunks; nothing else happens
+ *      on the calling thread. A full chunk is handed to a single background
+ *      writer thread, shared by all open captures, which XOR-delta encodes
+ *      it (DISCON_TRACE_XOR) and appends it to the file. A call only waits
+ *      when the writer is a whole ring behind.
+ */
+
+#ifndef DISCON_CAPTURE_H
+#define DISCON_CAPTURE_H
+
+#include <stddef.h>
+
+#include "discon.h"
+#include "discon_trace.h"
+
+/* Calls per chunk and chunks per ring */
+#ifndef DISCON_CAPTURE_CHUNK_CALLS
+# define DISCON_CAPTURE_CHUNK_CALLS 1024
+#endif
+#ifndef DISCON_CAPTURE_CHUNKS
+# define DISCON_CAPTURE_CHUNKS      4
+#endif
+
+typedef struct disconCapture disconCapture;
+
+/*
+ * Create the trace file path, write the header and allocate the ring.
+ * Returns NULL and fills errorMsg (at least 257 characters) on failure.
+ */
+DISCON_LOCAL disconCapture *disconCaptureOpen(const char *path, int nSwap, int nOut,
+                                              double stepSize, char *errorMsg);
+
+/*
+ * Append a call. Returns its record of nSwap inputs followed by nOut
+ * outputs, which may be filled until the next call. Returns NULL when the
+ * capture has failed (the first write error is reported on stderr and
+ * capturing stops).
+ */
+DISCON_LOCAL float *disconCaptureRecord(disconCapture *cap);
+
+/*
+ * Write the remaining calls, close the file and free the capture. Returns
+ * 0, or -1 when a write failed. NULL is ignored.
+ */
+DISCON_LOCAL int disconCaptureClose(disconCapture *cap);
+
+#endif /* DISCON_CAPTURE_H */
+
+/* EOF: discon_capture.h */
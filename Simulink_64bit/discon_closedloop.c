@@ -0,0 +1,416 @@
+/*
+ * File    : discon_closedloop.c
+ *
+ * Abstract:
+ *      Closed-loop simulation of a controller library (loaded with dlopen)
+ *      on the reduced-order turbine of a Bladed project (discon_plant.h),
+ *      without Bladed. Every communication interval, the plant fills the
+ *      avrSwap measurements, the controller is called as Bladed calls it,
+ *      and its pitch and torque demands drive the plant over the interval.
+ *      The run goes as fast as the controller and plant step, thousands
+ *      of times real time for a light controller, a quick check of
+ *      a controller change in closed loop, e.g. on a wind step or ramp,
+ *      before a full Bladed run.
+ *
+ *      The hub height wind is
+ *          -wind U         constant, m/s (default: WINDSEL UBAR of the
+ *                          project)
+ *          -wind U0:U1     a ramp from U0 at the start to U1 at the end
+ *          -wind file      linearly interpolated from the lines "time wind"
+ *                          of a text file; lines starting with # are
+ *                          comments
+ *          -wnd file       a Bladed turbulent wind file (discon_wind.h), at
+ *                          the mean wind of -wind U or else UBAR, with the
+ *                          intensities of the project (WINDSEL TI, else
+ *                          those of the file): the hub height wind from its
+ *                          centre, and the turbulence of every blade from
+ *                          the grid along the blade at its azimuth
+ *      and the turbine starts in steady operation at the wind of time 0.
+ *
+ *      With -set userVarN=value, the user variable rUserVarN
+ *      (avrSwap[118+N]) is overridden on every call after the first, which
+ *      takes the parameter file values. With -o, the time series of the
+ *      run is written, every n-th interval with -every n:
+ *          time wind rotor_speed gen_speed pitch1..3 gen_torque power
+ *          thrust tower_x flap1..3 edge1..3
+ *      A summary goes to stderr; the exit status is 0 unless the
+ *      controller reported an error.
+ *
+ *      usage: discon_closedloop [-lib library] [-wind U | U0:U1 | file]
+ *                               [-wnd file] [-time T] [-dt interval] [-step h]
+ *                               [-pitchtau tau] [-set userVarN=value]...
+ *                               [-o series] [-every n] project
+ *
+ *      -dt defaults to the DISCON SAMPLETIME of the project and -step, the
+ *      largest integration step of the plant, to 5 ms. Unless DISCON_LOG
+ *      is set, the controller does not log.
+ *
+ *      Built with the library by the Linux template makefile (discon.tmf).
+ */
+
+#ifndef _POSIX_C_SOURCE
+# define _POSIX_C_SOURCE 200112L        /* setenv with -std=c99 */
+#endif
+
+#include <dlfcn.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "discon.h"
+#include "discon_plant.h"
+#include "discon_profile.h"
+#include "discon_wind.h"
+
+/*=========*
+ * Defines *
+ *=========*/
+
+#define SWAP_SIZE       4096        /* records of the avrSwap array          */
+#define OUTNAME_SIZE    32768       /* avrSwap[50]                           */
+#define MSG_SIZE        1024        /* avrSwap[48]                           */
+#define FIRST_LOG       165         /* avrSwap[62], 1-based                  */
+#define NUM_USERVARS    20          /* rUserVar1..20, avrSwap[119..138]      */
+#define PI              3.14159265358979323846
+
+typedef void (CDECL *DisconFcn)(float *avrSwap, int *aviFail, char *accInfile,
+                                char *avcOutname, char *avcMsg);
+
+/* Hub height wind, constant, a ramp, from a file or a turbulent field */
+typedef struct {
+    double     u0, u1;              /* constant or ramp                     */
+    double     *t, *u;              /* file                                 */
+    long       n;
+    long       last;                /* interval of the previous lookup      */
+    disconWind *field;              /* -wnd                                 */
+} Wind;
+
+/* Statistics of a run */
+typedef struct {
+    long   n;
+    double power;                   /* sum                                  */
+    double speedErrorSq;            /* sum                                  */
+    double pitchTravel;             /* sum of |change| over the blades      */
+    double torqueMean, torqueM2;    /* Welford                              */
+    double maxFlap;
+    double maxTower;
+} Stats;
+
+/*=================*
+ * Local functions *
+ *=================*/
+
+/* Function: fail =========================================================
+ *
+ * Abstract:
+ *      Report a fatal error and exit.
+ */
+static void fail(const char *what, const char *detail) {
+    (void)fprintf(stderr, "discon_closedloop: %s%s%s\n", what,
+                  detail != NULL ? ": " : "", detail != NULL ? detail : "");
+    exit(EXIT_FAILURE);
+}  /* end fail */
+
+/* Function: readWind =====================================================
+ *
+ * Abstract:
+ *      Parse -wind: a speed, a ramp U0:U1, or else a file of "time wind"
+ *      lines in increasing time.
+ */
+static void readWind(Wind *w, const char *spec) {
+    FILE   *file;
+    char   line[1024], *end;
+    long   capacity = 0;
+    double t, u;
+
+    (void)memset(w, 0, sizeof(*w));
+    w->u0 = strtod(spec, &end);
+    if (end != spec && *end == '\0') {
+        w->u1 = w->u0;
+        return;
+    }
+    if (end != spec && *end == ':') {
+        char *end1;
+
+        w->u1 = strtod(end + 1, &end1);
+        if (end1 != end + 1 && *end1 == '\0') return;
+    }
+
+    if ((file = fopen(spec, "r")) == NULL) fail("unable to open the wind", spec);
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (line[0] == '#' || sscanf(line, "%lf %lf", &t, &u) != 2) continue;
+        if (w->n > 0 && t <= w->t[w->n - 1]) fail("wind times not increasing in", spec);
+        if (w->n == capacity) {
+            capacity = capacity > 0 ? 2*capacity : 1024;
+            w->t = (double *)realloc(w->t, capacity*sizeof(double));
+            w->u = (double *)realloc(w->u, capacity*sizeof(double));
+            if (w->t == NULL || w->u == NULL) fail("out of memory", NULL);
+        }
+        w->t[w->n]   = t;
+        w->u[w->n++] = u;
+    }
+    (void)fclose(file);
+    if (w->n == 0) fail("no wind in", spec);
+}  /* end readWind */
+
+/* Function: windAt =======================================================
+ *
+ * Abstract:
+ *      The wind at time t of a run of duration T; held constant outside a
+ *      wind file. Lookups are expected in increasing time.
+ */
+static double windAt(Wind *w, double t, double T) {
+    long i;
+
+    if (w->field != NULL) return disconWindHub(w->field, t);
+    if (w->n == 0) return T > 0.0 ? w->u0 + (w->u1 - w->u0)*t/T : w->u0;
+    if (t <= w->t[0]) return w->u[0];
+    if (t >= w->t[w->n - 1]) return w->u[w->n - 1];
+    if (w->t[w->last] > t) w->last = 0;
+    for (i=w->last; w->t[i + 1] < t; i++);
+    w->last = i;
+    return w->u[i] + (w->u[i + 1] - w->u[i])*(t - w->t[i])/(w->t[i + 1] - w->t[i]);
+}  /* end windAt */
+
+/* Function: bladeWind ==================================================
+ *
+ * Abstract:
+ *      The turbulence of the blades in a wind field, for the plant.
+ */
+static void bladeWind(void *context, double t, double azimuth, int nBlades,
+                      double *deviation) {
+    disconWind *field = (disconWind *)context;
+    double     hub = disconWindHub(field, t);
+    int        b;
+
+    for (b=0; b<nBlades; b++) {
+        deviation[b] = disconWindBlade(field, t, azimuth + 2.0*PI*b/nBlades) - hub;
+    }
+}  /* end bladeWind */
+
+/* Function: writeHeader ==================================================
+ *
+ * Abstract:
+ *      The column names of the time series.
+ */
+static void writeHeader(FILE *out) {
+    (void)fprintf(out, "time\twind\trotor_speed\tgen_speed\tpitch1\tpitch2\tpitch3\t"
+                  "gen_torque\tpower\tthrust\ttower_x\tflap1\tflap2\tflap3\t"
+                  "edge1\tedge2\tedge3\n");
+}  /* end writeHeader */
+
+/* Function: writeSample ==================================================
+ *
+ * Abstract:
+ *      One line of the time series; blades the plant lacks repeat blade 1.
+ */
+static void writeSample(FILE *out, const disconPlantParams *p, const disconPlantState *s) {
+    int b;
+
+    (void)fprintf(out, "%.4f\t%.6g\t%.6g\t%.6g", s->time, s->wind, s->rotorSpeed,
+                  s->rotorSpeed*p->gearRatio);
+    for (b=0; b<3; b++) (void)fprintf(out, "\t%.6g", s->pitch[b < p->nBlades ? b : 0]);
+    (void)fprintf(out, "\t%.6g\t%.6g\t%.6g\t%.6g", s->genTorque, s->power, s->thrust,
+                  s->towerX);
+    for (b=0; b<3; b++) (void)fprintf(out, "\t%.6g", s->flap[b < p->nBlades ? b : 0]);
+    for (b=0; b<3; b++) (void)fprintf(out, "\t%.6g", s->edge[b < p->nBlades ? b : 0]);
+    (void)fprintf(out, "\n");
+}  /* end writeSample */
+
+/* Function: addStats =====================================================
+ *
+ * Abstract:
+ *      Accumulate an interval; pitch holds the blade pitch before it.
+ */
+static void addStats(Stats *st, const disconPlantParams *p, const disconPlantState *s,
+                     const double *pitch) {
+    double d = s->rotorSpeed*p->gearRatio - p->ratedGenSpeed;
+    int    b;
+
+    st->n++;
+    st->power        += s->power;
+    st->speedErrorSq += d*d;
+    for (b=0; b<p->nBlades; b++) {
+        st->pitchTravel += fabs(s->pitch[b] - pitch[b]);
+        if (fabs(s->flap[b]) > st->maxFlap) st->maxFlap = fabs(s->flap[b]);
+    }
+    d = s->genTorque - st->torqueMean;
+    st->torqueMean += d/st->n;
+    st->torqueM2   += d*(s->genTorque - st->torqueMean);
+    if (fabs(s->towerX) > st->maxTower) st->maxTower = fabs(s->towerX);
+}  /* end addStats */
+
+/*===================*
+ * Visible functions *
+ *===================*/
+
+int main(int argc, char *argv[]) {
+    const char              *library = "./DISCON.so", *project = NULL, *windSpec = NULL;
+    const char              *outPath = NULL, *fieldPath = NULL;
+    double                  T = 60.0, dt = 0.0, step = 0.0, pitchTau = 0.0, t, elapsed;
+    double                  userValue[NUM_USERVARS], pitch[DISCON_PLANT_MAX_BLADES];
+    int                     userVar[NUM_USERVARS], nSet = 0, every = 1, aviFail = 0, i;
+    long                    nSteps, k;
+    char                    errorMsg[257], inFile[1] = {'\0'};
+    char                    *outName, msg[MSG_SIZE + 1];
+    float                   *avrSwap;
+    void                    *handle;
+    DisconFcn               discon;
+    disconPlant             *plant;
+    disconPlantParams       *p;
+    const disconPlantState  *s;
+    Wind                    wind;
+    Stats                   st;
+    FILE                    *out = NULL;
+    uint64_t                start;
+
+    for (i=1; i<argc; i++) {
+        if (strcmp(argv[i], "-lib") == 0 && i+1 < argc) {
+            library = argv[++i];
+        } else if (strcmp(argv[i], "-wind") == 0 && i+1 < argc) {
+            windSpec = argv[++i];
+        } else if (strcmp(argv[i], "-wnd") == 0 && i+1 < argc) {
+            fieldPath = argv[++i];
+        } else if (strcmp(argv[i], "-time") == 0 && i+1 < argc) {
+            T = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-dt") == 0 && i+1 < argc) {
+            dt = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-step") == 0 && i+1 < argc) {
+            step = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-pitchtau") == 0 && i+1 < argc) {
+            pitchTau = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i+1 < argc) {
+            outPath = argv[++i];
+        } else if (strcmp(argv[i], "-every") == 0 && i+1 < argc) {
+            every = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-set") == 0 && i+1 < argc && nSet < NUM_USERVARS) {
+            const char *spec = argv[++i];
+
+            if (sscanf(spec, "userVar%d=%lf", &userVar[nSet], &userValue[nSet]) != 2 ||
+                userVar[nSet] < 1 || userVar[nSet] > NUM_USERVARS) {
+                fail("expected -set userVarN=value, found", spec);
+            }
+            nSet++;
+        } else if (argv[i][0] != '-' && project == NULL) {
+            project = argv[i];
+        } else {
+            (void)fprintf(stderr, "usage: %s [-lib library] [-wind U | U0:U1 | file] "
+                          "[-wnd file] [-time T] [-dt interval] [-step h] [-pitchtau tau] "
+                          "[-set userVarN=value]... [-o series] [-every n] project\n",
+                          argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (project == NULL) fail("no project of the turbine", NULL);
+    if (T <= 0.0) fail("the run needs a positive -time", NULL);
+    if (every < 1) every = 1;
+
+    start = disconClockNs();
+    if ((plant = disconPlantOpen(project, errorMsg)) == NULL) fail(errorMsg, NULL);
+    p = disconPlantParameters(plant);
+    s = disconPlantGetState(plant);
+    if (dt <= 0.0) dt = p->sampleTime;
+    if (step > 0.0) p->step = step;
+    if (pitchTau > 0.0) p->pitchTau = pitchTau;
+    if (windSpec != NULL) {
+        readWind(&wind, windSpec);
+    } else {
+        (void)memset(&wind, 0, sizeof(wind));
+        wind.u0 = wind.u1 = p->meanWind;
+    }
+    if (fieldPath != NULL) {
+        const disconWindInfo *info;
+
+        if (wind.n > 0 || wind.u1 != wind.u0) fail("-wnd takes a constant -wind", NULL);
+        wind.field = disconWindOpen(fieldPath, p->radius, wind.u0, p->turbulence, errorMsg);
+        if (wind.field == NULL) fail(errorMsg, NULL);
+        info = disconWindGetInfo(wind.field);
+        (void)fprintf(stderr, "%s: %d x %d grid of %ld planes, %.1f s at %.2f m/s, "
+                      "turbulence %.1f%%\n", fieldPath, info->nY, info->nZ, info->nSteps,
+                      info->duration, info->meanWind, 100.0*info->ti[0]);
+        disconPlantSetBladeWind(plant, bladeWind, wind.field);
+    }
+    nSteps = (long)floor(T/dt + 0.5);
+    (void)fprintf(stderr, "%s: turbine of %.1f m diameter loaded in %.3f s\n", project,
+                  2.0*p->radius, (double)(disconClockNs() - start)*1e-9);
+
+    if (getenv("DISCON_LOG") == NULL) (void)setenv("DISCON_LOG", "0", 1);
+    handle = dlopen(library, RTLD_NOW | RTLD_LOCAL);
+    if (handle == NULL) fail("unable to load the controller", dlerror());
+    *(void **)&discon = dlsym(handle, "DISCON");
+    if (discon == NULL) fail("no DISCON entry point in", library);
+    avrSwap = (float *)calloc(SWAP_SIZE, sizeof(float));
+    outName = (char *)calloc(OUTNAME_SIZE + 1, 1);
+    if (avrSwap == NULL || outName == NULL) fail("out of memory", NULL);
+
+    if (outPath != NULL) {
+        if ((out = fopen(outPath, "w")) == NULL) fail("unable to create", outPath);
+        writeHeader(out);
+    }
+
+    disconPlantStart(plant, windAt(&wind, 0.0, T));
+    if (out != NULL) writeSample(out, p, s);
+    (void)memset(&st, 0, sizeof(st));
+
+    /* Calls at 0, dt, ..., nSteps*dt, the last one being the final call */
+    start = disconClockNs();
+    for (k=0; k<=nSteps; k++) {
+        t = k*dt;
+        avrSwap[0]  = k == 0 ? 0.0f : k < nSteps ? 1.0f : -1.0f;
+        avrSwap[1]  = (float)t;
+        avrSwap[2]  = (float)dt;
+        avrSwap[48] = (float)MSG_SIZE;
+        avrSwap[49] = 0.0f;
+        avrSwap[50] = (float)OUTNAME_SIZE;
+        avrSwap[62] = (float)FIRST_LOG;
+        avrSwap[63] = (float)(SWAP_SIZE - FIRST_LOG + 1);
+        disconPlantMeasure(plant, avrSwap);
+        if (k > 0) {
+            for (i=0; i<nSet; i++) avrSwap[118 + userVar[i]] = (float)userValue[i];
+        }
+        msg[0] = '\0';
+        discon(avrSwap, &aviFail, inFile, outName, msg);
+        msg[MSG_SIZE] = '\0';
+        if (aviFail < 0) break;
+        if (k == nSteps) break;
+
+        (void)memcpy(pitch, s->pitch, sizeof(pitch));
+        disconPlantDemand(plant, avrSwap);
+        disconPlantAdvance(plant, windAt(&wind, t + dt, T), dt);
+        addStats(&st, p, s, pitch);
+        if (out != NULL && (k + 1) % every == 0) writeSample(out, p, s);
+    }
+    elapsed = (double)(disconClockNs() - start)*1e-9;
+    if (out != NULL) (void)fclose(out);
+
+    if (aviFail < 0) {
+        (void)fprintf(stderr, "%s: error at %.3f s: %s\n", library, k*dt, msg);
+    }
+    if (wind.field != NULL && disconWindError(wind.field) != NULL) {
+        (void)fprintf(stderr, "%s: %s\n", fieldPath, disconWindError(wind.field));
+        aviFail = -1;
+    }
+    if (st.n > 0) {
+        double simulated = st.n*dt;
+
+        (void)fprintf(stderr, "%s: %.1f s simulated in %.3f s, %.0f times real time\n"
+                      "  mean power %.1f kW, speed error RMS %.2f rad/s, "
+                      "pitch activity %.3g rad/s, torque std %.1f Nm\n"
+                      "  max flap moment %.1f kNm, max tower deflection %.3f m\n",
+                      library, simulated, elapsed, elapsed > 0.0 ? simulated/elapsed : 0.0,
+                      st.power/st.n*1e-3, sqrt(st.speedErrorSq/st.n),
+                      st.pitchTravel/(p->nBlades*simulated),
+                      st.n > 1 ? sqrt(st.torqueM2/(st.n - 1)) : 0.0,
+                      st.maxFlap*1e-3, st.maxTower);
+    }
+
+    free(avrSwap);
+    free(outName);
+    disconPlantClose(plant);
+    disconWindClose(wind.field);
+    (void)dlclose(handle);
+    return aviFail < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}  /* end main */
+
+/* EOF: discon_closedloop.c */
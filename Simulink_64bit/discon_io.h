@@ -0,0 +1,120 @@
+/*
+ * File    : discon_io.h
+ *
+ * Abstract:
+ *      Root-level inports and outports of the model DISCON_NREL5MW and their
+ *      location in the Bladed avrSwap array.
+ *
+ *      Generated by DISCON_GenerateIOMap.m -- do not edit, regenerate
+ *      the file after changing the root ports of the model.
+ *
+ *      The lists are X-macros in port order, but for the LOG entries:
+ *        IN(port, i)      inport read from avrSwap[i]
+ *        OUT(port, i)     outport written to avrSwap[i]
+ *        LOG(port, unit)  logging outport: its elements are the logging
+ *                         channels, avrSwap[iFirstLog] on; LogN in order
+ *                         of N, then Log_<name> in port order
+ *        C(i, value)      constant written to avrSwap[i] on every call
+ *      They also define the signal numbers of the struct-of-arrays
+ *      interface in discon.h.
+ */
+
+#ifndef DISCON_IO_H
+#define DISCON_IO_H
+
+#define DISCON_INPUTS(IN) \
+    IN(Rated_Speed,                18) \
+    IN(Mode_Gain,                  15) \
+    IN(Blade1_OP_Root_Moment,      29) \
+    IN(Blade2_OP_Root_Moment,      30) \
+    IN(Blade3_OP_Root_Moment,      31) \
+    IN(Rotor_Azimuth_Angle,        59) \
+    IN(Init,                        0) \
+    IN(userVar1,                  119) \
+    IN(userVar3,                  121) \
+    IN(userVar4,                  122) \
+    IN(userVar5,                  123) \
+    IN(userVar6,                  124) \
+    IN(userVar10,                 128) \
+    IN(userVar19,                 137) \
+    IN(userVar20,                 138) \
+    IN(Shaft_Torque,              108) \
+    IN(userVar7,                  125) \
+    IN(userVar8,                  126) \
+    IN(userVar9,                  127) \
+    IN(userVar11,                 129) \
+    IN(userVar12,                 130) \
+    IN(userVar13,                 131) \
+    IN(userVar14,                 132) \
+    IN(userVar15,                 133) \
+    IN(userVar16,                 134) \
+    IN(userVar17,                 135) \
+    IN(userVar18,                 136) \
+    IN(Blade1_IP_Root_Moment,      68) \
+    IN(Blade2_IP_Root_Moment,      69) \
+    IN(Blade3_IP_Root_Moment,      70) \
+    IN(userVar2,                  120) \
+    IN(YawError,                   23) \
+    IN(YawBearingRate,            162) \
+    IN(ElectricalPower,            14) \
+    IN(Fore_Aft_Tower_Accel,       52) \
+    IN(Generator_Speed,            19) \
+    IN(Measured_Torque,            22) \
+    IN(Measured_Pitch,              3) \
+    IN(Sidewards_Tower_Accel,      53) \
+    IN(Below_Rated_Pitch_Angle,     4) \
+    /* end */
+
+#define DISCON_OUTPUTS(OUT, LOG) \
+    LOG(Log1,                     "-") \
+    LOG(Log2,                     "-") \
+    LOG(Log3,                     "-") \
+    LOG(Log4,                     "-") \
+    LOG(Log5,                     "-") \
+    LOG(Log6,                     "-") \
+    LOG(Log7,                     "-") \
+    LOG(Log8,                     "-") \
+    LOG(Log9,                     "-") \
+    LOG(Log10,                    "-") \
+    LOG(Log11,                    "-") \
+    LOG(Log12,                    "-") \
+    LOG(Log13,                    "-") \
+    LOG(Log14,                    "-") \
+    LOG(Log15,                    "-") \
+    LOG(Log16,                    "-") \
+    LOG(Log17,                    "-") \
+    LOG(Log18,                    "-") \
+    LOG(Log19,                    "-") \
+    LOG(Log20,                    "-") \
+    OUT(Yaw_Rate,                  47) \
+    OUT(Generator_Torque,          46) \
+    OUT(Blade1_Pitch_Angle,        41) \
+    OUT(Blade2_Pitch_Angle,        42) \
+    OUT(Blade3_Pitch_Angle,        43) \
+    OUT(Collective_Pitch_Angle,    44) \
+    /* end */
+
+#define DISCON_SWAP_CONSTANTS(C) \
+    C( 9, 0)  /* Pitch angle                    */ \
+    C(27, 1)  /* Individual Pitch control       */ \
+    C(34, 1)  /* Generator contactor status     */ \
+    C(35, 0)  /* Shaft brake status: 0=off      */ \
+    C(40, 0)  /* Demanded yaw actuator torque   */ \
+    C(54, 0)  /* Pitch override                 */ \
+    C(55, 0)  /* Torque override                */ \
+    C(71, 0)  /* Generator start-up resistance  */ \
+    C(78, 1)  /* Request for loads: 0=none      */ \
+    C(79, 0)  /* Variable slip current status   */ \
+    C(80, 0)  /* Variable slip current demand   */ \
+    /* end */
+
+/* Signal numbers, e.g. DISCON_IN_Generator_Speed, DISCON_OUT_Log1 */
+#define DISCON_IO_ENUM_IN(name, i)  DISCON_IN_##name,
+#define DISCON_IO_ENUM_OUT(name, i) DISCON_OUT_##name,
+
+enum { DISCON_INPUTS(DISCON_IO_ENUM_IN) DISCON_NUM_INPUTS };
+enum { DISCON_OUTPUTS(DISCON_IO_ENUM_OUT, DISCON_IO_ENUM_OUT) DISCON_NUM_OUTPUTS };
+
+#endif /* DISCON_IO_H */
+
+/* EOF: discon_io.h */
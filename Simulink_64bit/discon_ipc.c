@@ -0,0 +1,101 @@
+/*
+ * File    : discon_ipc.c
+ *
+ * Abstract:
+ *      Spin-then-futex wait and wake of the shared-memory channel, see
+ *      discon_ipc.h.
+ */
+
+#ifndef _DEFAULT_SOURCE
+# define _DEFAULT_SOURCE                /* syscall with -std=c99 */
+#endif
+
+#include <errno.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "discon_ipc.h"
+
+/*=========*
+ * Defines *
+ *=========*/
+
+#define SPIN_COUNT 20000                /* about 10..50 us before sleeping */
+
+#if defined(__i386__) || defined(__x86_64__)
+# define CPU_RELAX() __builtin_ia32_pause()
+#else
+# define CPU_RELAX() __sync_synchronize()
+#endif
+
+/* The layout must not depend on the word size of the compiler */
+typedef char checkHeaderSize[sizeof(disconIpcHeader) == 512 ? 1 : -1];
+typedef char checkSlotSize[sizeof(disconIpcSlot) % 64 == 0 ? 1 : -1];
+
+/*==================================*
+ * Global data local to this module *
+ *==================================*/
+
+/* Spins before sleeping; none on a single processor, where it only delays
+ * the other side */
+static int SpinCount = -1;
+
+/*===================*
+ * Visible functions *
+ *===================*/
+
+/* Function: disconIpcWait ================================================
+ *
+ * Abstract:
+ *      Spin, then announce the waiter, check once more and sleep. The
+ *      futex is not process private: the word is in a shared mapping.
+ */
+int disconIpcWait(volatile uint32_t *word, uint32_t value,
+                  volatile uint32_t *waiting, int timeoutMs) {
+    struct timespec timeout;
+    int             k, rc;
+
+    if (SpinCount < 0) {
+        SpinCount = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SPIN_COUNT : 0;
+    }
+    for (k=0; k<SpinCount; k++) {
+        if (*word != value) {
+            __sync_synchronize();
+            return 0;
+        }
+        CPU_RELAX();
+    }
+    timeout.tv_sec  = timeoutMs/1000;
+    timeout.tv_nsec = (long)(timeoutMs%1000)*1000000L;
+
+    (void)__sync_add_and_fetch(waiting, 1);
+    rc = 0;
+    while (*word == value) {
+        if (syscall(SYS_futex, word, FUTEX_WAIT, value,
+                    timeoutMs > 0 ? &timeout : NULL, NULL, 0) != 0 &&
+            errno == ETIMEDOUT) {
+            rc = *word != value ? 0 : -1;
+            break;
+        }
+    }
+    (void)__sync_sub_and_fetch(waiting, 1);
+    __sync_synchronize();
+    return rc;
+}  /* end disconIpcWait */
+
+/* Function: disconIpcWake ================================================
+ *
+ * Abstract:
+ *      The full barrier orders the change of the word before the read of
+ *      the waiter count, against the reverse order in disconIpcWait.
+ */
+void disconIpcWake(volatile uint32_t *word, volatile uint32_t *waiting) {
+    __sync_synchronize();
+    if (*waiting != 0) {
+        (void)syscall(SYS_futex, word, FUTEX_WAKE, 0x7fffffff, NULL, NULL, 0);
+    }
+}  /* end disconIpcWake */
+
+/* EOF: discon_ipc.c */
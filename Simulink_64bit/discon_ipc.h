@@ -0,0 +1,103 @@
+/*
+ * File    : discon_ipc.h
+ *
+ * Abstract:
+ *      Shared-memory channel between the DISCON shim library
+ *      (discon_shim.c), loaded by the host, and the controller server
+ *      (discon_server.c), a separate process that loads the controller.
+ *
+ *      The channel is one shared mapping: a disconIpcHeader followed by
+ *      DISCON_IPC_SLOTS call slots. The slots form a bounded lock-free ring
+ *      in which every slot carries a sequence number (after Vyukov): the
+ *      host threads claim slot pos by advancing head, fill it with the
+ *      inputs of a DISCON call and publish it by setting its sequence to
+ *      pos + 1; the server serves the slots in order, writes the outputs
+ *      back into the slot and sets its reply word; the host copies the
+ *      outputs out and frees the slot for the next round with sequence
+ *      pos + DISCON_IPC_SLOTS.
+ *
+ *      Both sides wait by spinning for a few microseconds, which covers a
+ *      call answered straight away, then sleeping on a futex. A sleeper
+ *      announces itself in a waiter word before its last check, so the
+ *      other side only makes the wake-up system call when someone sleeps.
+ *
+ *      The layout only has fixed-size members at the same offsets for
+ *      32-bit and 64-bit code, so a 32-bit host can drive a 64-bit
+ *      server. Linux only (futex).
+ */
+
+#ifndef DISCON_IPC_H
+#define DISCON_IPC_H
+
+#include <stdint.h>
+
+#include "discon.h"
+
+#define DISCON_IPC_MAGIC    0x43504944u     /* "DIPC"                        */
+#define DISCON_IPC_VERSION  1
+#define DISCON_IPC_SLOTS    8               /* calls in flight, a power of 2 */
+#define DISCON_IPC_SWAP     4096            /* avrSwap records per call      */
+#define DISCON_IPC_INFILE   1024            /* accInfile, avrSwap[49]        */
+#define DISCON_IPC_OUTNAME  32768           /* avcOutname, avrSwap[50]       */
+#define DISCON_IPC_MSG      1024            /* avcMsg, avrSwap[48]           */
+
+/* Server states, disconIpcHeader.state */
+enum {
+    DISCON_IPC_STARTING,
+    DISCON_IPC_READY,                       /* controller loaded             */
+    DISCON_IPC_FAILED,                      /* see disconIpcHeader.error     */
+    DISCON_IPC_STOP                         /* set by the host: exit         */
+};
+
+typedef struct {
+    uint32_t          magic;                /* DISCON_IPC_MAGIC              */
+    uint32_t          version;              /* DISCON_IPC_VERSION            */
+    uint32_t          slotSize;             /* sizeof(disconIpcSlot)         */
+    volatile uint32_t state;                /* DISCON_IPC_xxx, futex word    */
+    volatile uint32_t head;                 /* next slot to claim            */
+    volatile uint32_t doorbell;             /* +1 per published slot, futex  */
+    volatile uint32_t serverWaiting;        /* server sleeps on doorbell     */
+    volatile uint32_t hostWaiting;          /* host sleeps on state          */
+    int32_t           serverPid;
+    char              error[256];           /* why the server failed         */
+    char              reserved[220];
+} disconIpcHeader;                          /* 512 bytes */
+
+typedef struct {
+    volatile uint32_t seq;                  /* ring sequence, see above      */
+    volatile uint32_t reply;                /* 1 when the outputs are back   */
+    volatile uint32_t hostWaiting;          /* host sleeps on reply          */
+    int32_t           aviFail;
+    uint32_t          keyLo;                /* host avrSwap address: the     */
+    uint32_t          keyHi;                /* controller instance           */
+    int32_t           nSwap;                /* avrSwap records passed        */
+    int32_t           reserved[9];          /* 64 bytes so far               */
+    char              inFile[DISCON_IPC_INFILE];
+    char              outName[DISCON_IPC_OUTNAME];
+    char              msg[DISCON_IPC_MSG];
+    float             avrSwap[DISCON_IPC_SWAP];
+} disconIpcSlot;
+
+typedef struct {
+    disconIpcHeader header;
+    disconIpcSlot   slot[DISCON_IPC_SLOTS];
+} disconIpcChannel;
+
+/*
+ * Wait until *word differs from value, spinning first. *waiting is set
+ * while asleep, for disconIpcWake. Returns 0 when the word changed, or -1
+ * after timeoutMs milliseconds (0 for no limit) so the caller can check
+ * that the other process is still alive.
+ */
+DISCON_LOCAL int disconIpcWait(volatile uint32_t *word, uint32_t value,
+                               volatile uint32_t *waiting, int timeoutMs);
+
+/*
+ * Wake the process sleeping on word, if *waiting says there is one. Call
+ * after changing *word.
+ */
+DISCON_LOCAL void disconIpcWake(volatile uint32_t *word, volatile uint32_t *waiting);
+
+#endif /* DISCON_IPC_H */
+
+/* EOF: discon_ipc.h */
@@ -0,0 +1,215 @@
+/*
+ * File    : discon_kernels.c
+ *
+ * Abstract:
+ *      Coleman transform, biquad bank and PI kernels, see discon_kernels.h.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "discon_kernels.h"
+
+/*=========*
+ * Defines *
+ *=========*/
+
+#define TWO_OVER_PI  6.36619772367581382433e-01
+#define PIO2_HI      1.57079632673412561417e+00   /* first 33 bits of pi/2 */
+#define PIO2_LO      6.07710050650619224932e-11   /* pi/2 - PIO2_HI        */
+#define SINCOS_MAX   1e8                          /* |x| reduced exactly    */
+
+#define COS_120      (-0.5)
+#define SIN_120      8.66025403784438646764e-01   /* sqrt(3)/2              */
+
+/* Minimax polynomials of sin and cos on [-pi/4, pi/4] (fdlibm) */
+#define S1  -1.66666666666666324348e-01
+#define S2   8.33333333332248946124e-03
+#define S3  -1.98412698298579493134e-04
+#define S4   2.75573137070700676789e-06
+#define S5  -2.50507602534068634195e-08
+#define S6   1.58969099521155010221e-10
+#define C1   4.16666666666666019037e-02
+#define C2  -1.38888888888741095749e-03
+#define C3   2.48015872894767294178e-05
+#define C4  -2.75573143513906633035e-07
+#define C5   2.08757232129817482790e-09
+#define C6  -1.13596475577881948265e-11
+
+/*=================*
+ * Local functions *
+ *=================*/
+
+/* Function: bladeSinCos ==================================================
+ *
+ * Abstract:
+ *      Sine and cosine of the azimuth of every blade, from one sincos of
+ *      blade 1 rotated by +-120 degrees.
+ */
+static void bladeSinCos(double psi, double *s, double *c) {
+    disconSinCos(psi, &s[0], &c[0]);
+    s[1] = s[0]*COS_120 + c[0]*SIN_120;
+    c[1] = c[0]*COS_120 - s[0]*SIN_120;
+    s[2] = s[0]*COS_120 - c[0]*SIN_120;
+    c[2] = c[0]*COS_120 + s[0]*SIN_120;
+}  /* end bladeSinCos */
+
+/*===================*
+ * Visible functions *
+ *===================*/
+
+/* Function: disconSinCos =================================================
+ *
+ * Abstract:
+ *      Reduce x to r in [-pi/4, pi/4] and quadrant k (Cody-Waite, two
+ *      constants), evaluate both polynomials and map them to the quadrant.
+ */
+void disconSinCos(double x, double *s, double *c) {
+    double k, r, z, sr, cr;
+    int    q;
+
+    if (!(fabs(x) < SINCOS_MAX)) {
+        *s = sin(x);
+        *c = cos(x);
+        return;
+    }
+    k = floor(x*TWO_OVER_PI + 0.5);
+    r = (x - k*PIO2_HI) - k*PIO2_LO;
+    z = r*r;
+    sr = r + r*z*(S1 + z*(S2 + z*(S3 + z*(S4 + z*(S5 + z*S6)))));
+    cr = 1.0 - 0.5*z + z*z*(C1 + z*(C2 + z*(C3 + z*(C4 + z*(C5 + z*C6)))));
+
+    q = (int)((long)k & 3);
+    if (q & 1) {
+        double t = sr;
+
+        sr = cr;
+        cr = -t;
+    }
+    if (q & 2) {
+        sr = -sr;
+        cr = -cr;
+    }
+    *s = sr;
+    *c = cr;
+}  /* end disconSinCos */
+
+/* Function: DISCON_ColemanForward ========================================
+ *
+ * Abstract:
+ *      y = [mean(m), 2/3*sum(m.*cos(psi_k)), 2/3*sum(m.*sin(psi_k))].
+ */
+void DISCON_ColemanForward(const double *m, double psi, double *y) {
+    double s[DISCON_NUM_BLADES], c[DISCON_NUM_BLADES];
+
+    bladeSinCos(psi, s, c);
+    y[0] = (m[0] + m[1] + m[2])*(1.0/3.0);
+    y[1] = (m[0]*c[0] + m[1]*c[1] + m[2]*c[2])*(2.0/3.0);
+    y[2] = (m[0]*s[0] + m[1]*s[1] + m[2]*s[2])*(2.0/3.0);
+}  /* end DISCON_ColemanForward */
+
+/* Function: DISCON_ColemanInverse ========================================
+ *
+ * Abstract:
+ *      y_k = u[0] + u[1]*cos(psi_k + phase) + u[2]*sin(psi_k + phase).
+ */
+void DISCON_ColemanInverse(const double *u, double psi, double phase, double *y) {
+    double s[DISCON_NUM_BLADES], c[DISCON_NUM_BLADES];
+    double d = u[1], q = u[2];
+    int    k;
+
+    bladeSinCos(psi + phase, s, c);
+    for (k=0; k<DISCON_NUM_BLADES; k++) {
+        y[k] = u[0] + d*c[k] + q*s[k];
+    }
+}  /* end DISCON_ColemanInverse */
+
+/* Function: DISCON_BiquadBankInit ========================================
+ *
+ * Abstract:
+ *      Clear the states of a biquad bank.
+ */
+void DISCON_BiquadBankInit(double *state, int nSections) {
+    (void)memset(state, 0, (size_t)nSections*DISCON_BIQUAD_STATES*sizeof(double));
+}  /* end DISCON_BiquadBankInit */
+
+/* Function: DISCON_BiquadBank ============================================
+ *
+ * Abstract:
+ *      Run the blade signals through the sections in turn. The states of
+ *      section j are s1 of the blades at state[6*j..6*j+2] and s2 at
+ *      state[6*j+3..6*j+5], so every section is one pass over the blades
+ *      with the coefficients in registers.
+ */
+void DISCON_BiquadBank(const double *u, double *y, double *state,
+                       const double *coef, int nSections) {
+    double x[DISCON_NUM_BLADES];
+    int    j, k;
+
+    for (k=0; k<DISCON_NUM_BLADES; k++) {
+        x[k] = u[k];
+    }
+    for (j=0; j<nSections; j++) {
+        const double b0 = coef[0], b1 = coef[1], b2 = coef[2];
+        const double a1 = coef[3], a2 = coef[4];
+        double       *s1 = state;
+        double       *s2 = state + DISCON_NUM_BLADES;
+
+        for (k=0; k<DISCON_NUM_BLADES; k++) {
+            double in  = x[k];
+            double out = b0*in + s1[k];
+
+            s1[k] = b1*in - a1*out + s2[k];
+            s2[k] = b2*in - a2*out;
+            x[k]  = out;
+        }
+        coef  += DISCON_BIQUAD_COEFS;
+        state += DISCON_BIQUAD_STATES;
+    }
+    for (k=0; k<DISCON_NUM_BLADES; k++) {
+        y[k] = x[k];
+    }
+}  /* end DISCON_BiquadBank */
+
+/* Function: DISCON_PIInit ================================================
+ *
+ * Abstract:
+ *      Start the integrator at its initial value, within the limits.
+ */
+void DISCON_PIInit(double *work, const double *p) {
+    double i = p[DISCON_PI_INIT];
+
+    if (i < p[DISCON_PI_MIN]) i = p[DISCON_PI_MIN];
+    if (i > p[DISCON_PI_MAX]) i = p[DISCON_PI_MAX];
+    work[0] = work[1] = i;
+}  /* end DISCON_PIInit */
+
+/* Function: DISCON_PIOutput ==============================================
+ *
+ * Abstract:
+ *      Demand of the step: proportional part plus the integrator after the
+ *      step, held within the limits, saturated. The new integrator value
+ *      waits in work[1] for the update.
+ */
+double DISCON_PIOutput(double *work, double e, double sched, const double *p) {
+    double lo = p[DISCON_PI_MIN], hi = p[DISCON_PI_MAX];
+    double ge = p[DISCON_PI_SCHED] > 0.0 ? e/(1.0 + sched/p[DISCON_PI_SCHED]) : e;
+    double i  = work[0] + p[DISCON_PI_KI]*p[DISCON_PI_DT]*ge;
+    double y;
+
+    i = i < lo ? lo : (i > hi ? hi : i);
+    y = i + p[DISCON_PI_KP]*ge;
+    work[1] = i;
+    return y < lo ? lo : (y > hi ? hi : y);
+}  /* end DISCON_PIOutput */
+
+/* Function: DISCON_PIUpdate ==============================================
+ *
+ * Abstract:
+ *      Advance the integrator by the step.
+ */
+void DISCON_PIUpdate(double *work) {
+    work[0] = work[1];
+}  /* end DISCON_PIUpdate */
+
+/* EOF: discon_kernels.c */
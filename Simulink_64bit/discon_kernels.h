@@ -0,0 +1,109 @@
+/*
+ * File    : discon_kernels.h
+ *
+ * Abstract:
+ *      Hand-written kernels for the blocks every pitch controller built
+ *      with this library uses, in place of the same function assembled from
+ *      generic Simulink blocks:
+ *
+ *        - the forward and inverse Coleman (multi-blade coordinate)
+ *          transform of the three blade signals, with a fast sincos and one
+ *          sincos per call for all three blades;
+ *        - a cascade of biquad sections applied to the three blades at
+ *          once, with the states of one section for all blades adjacent so
+ *          the blade loop vectorizes;
+ *        - a gain-scheduled PI controller with anti-windup.
+ *
+ *      The model uses them through Legacy Code Tool blocks, see
+ *      DISCON_KernelBlocks.m; discon_kernels_bench compares them with the
+ *      code Simulink Coder generates for the equivalent generic blocks.
+ *
+ *      Blade k (1..3) is at azimuth psi + (k-1)*2*pi/3, psi being the
+ *      azimuth of blade 1 (avrSwap[59]).
+ */
+
+#ifndef DISCON_KERNELS_H
+#define DISCON_KERNELS_H
+
+#include "discon.h"
+
+#define DISCON_NUM_BLADES 3
+
+/* Coefficients per biquad section: b0 b1 b2 a1 a2 (a0 = 1) */
+#define DISCON_BIQUAD_COEFS  5
+/* States per biquad section: two for each blade */
+#define DISCON_BIQUAD_STATES (2*DISCON_NUM_BLADES)
+
+/* PI parameters, the elements of p in DISCON_PIxxx */
+enum {
+    DISCON_PI_KP,               /* proportional gain at zero schedule      */
+    DISCON_PI_KI,               /* integral gain at zero schedule          */
+    DISCON_PI_SCHED,            /* schedule value halving the gains, or 0  */
+                                /* for fixed gains                         */
+    DISCON_PI_MIN,              /* output and integrator limits            */
+    DISCON_PI_MAX,
+    DISCON_PI_DT,               /* sample time                             */
+    DISCON_PI_INIT,             /* initial integrator value                */
+    DISCON_PI_NUM_PARAMS
+};
+
+/*
+ * sin(x) and cos(x) to within a few ulp for |x| < 1e8 (the library
+ * functions beyond), without a call or a table.
+ */
+DISCON_LOCAL void disconSinCos(double x, double *s, double *c);
+
+/*
+ * Model access (Legacy Code Tool specs, see DISCON_KernelBlocks.m):
+ *   output  void DISCON_ColemanForward(double u1[3], double u2, double y1[3])
+ *   output  void DISCON_ColemanInverse(double u1[3], double u2, double p1,
+ *                                      double y1[3])
+ *   init    void DISCON_BiquadBankInit(double work1[6][size(p1,2)],
+ *                                      int32 size(p1,2))
+ *   output  void DISCON_BiquadBank(double u1[3], double y1[3],
+ *                                  double work1[6][size(p1,2)], double p1[],
+ *                                  int32 size(p1,2))
+ *   init    void DISCON_PIInit(double work1[2], double p1[7])
+ *   output  double y1 = DISCON_PIOutput(double work1[2], double u1,
+ *                                       double u2, double p1[7])
+ *   update  void DISCON_PIUpdate(double work1[2])
+ */
+
+/*
+ * Blade signals m[3] at blade 1 azimuth psi to the collective (mean),
+ * direct (cosine) and quadrature (sine) components y[0..2].
+ */
+DISCON_LOCAL void DISCON_ColemanForward(const double *m, double psi, double *y);
+
+/*
+ * Collective, direct and quadrature demands u[0..2] back to the blades at
+ * blade 1 azimuth psi plus phase, the azimuth lead of the demand.
+ */
+DISCON_LOCAL void DISCON_ColemanInverse(const double *u, double psi, double phase,
+                                        double *y);
+
+/*
+ * Cascade of nSections biquads (transposed direct form II) on the three
+ * blade signals. coef holds DISCON_BIQUAD_COEFS values per section and
+ * state DISCON_BIQUAD_STATES per section; u and y may be the same array.
+ */
+DISCON_LOCAL void DISCON_BiquadBankInit(double *state, int nSections);
+DISCON_LOCAL void DISCON_BiquadBank(const double *u, double *y, double *state,
+                                    const double *coef, int nSections);
+
+/*
+ * PI control of the error e with both gains divided by 1 + sched/p[SCHED]
+ * (e.g. sched the pitch angle, for the sensitivity of aerodynamic torque to
+ * pitch). The integrator is held within the output limits, so it does not
+ * wind up while the output saturates. work holds the integrator and its
+ * value after the step: Output returns the demand of the step, Update
+ * commits the integrator.
+ */
+DISCON_LOCAL void   DISCON_PIInit(double *work, const double *p);
+DISCON_LOCAL double DISCON_PIOutput(double *work, double e, double sched,
+                                    const double *p);
+DISCON_LOCAL void   DISCON_PIUpdate(double *work);
+
+#endif /* DISCON_KERNELS_H */
+
+/* EOF: discon_kernels.h */
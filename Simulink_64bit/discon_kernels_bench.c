@@ -0,0 +1,447 @@
+/*
+ * File    : discon_kernels_bench.c
+ *
+ * Abstract:
+ *      Benchmark of the kernels of discon_kernels.c against the code
+ *      Simulink Coder generates for the same function built from generic
+ *      blocks: the Coleman transform from Trigonometric Function, Product
+ *      and Sum blocks (one sin and one cos per blade), the filter bank from
+ *      one Discrete Filter block (direct form II) per blade and section,
+ *      and the PI controller from Gain, Discrete-Time Integrator with
+ *      limits, Divide and Saturation blocks.
+ *
+ *      Both versions are driven with the same synthetic blade moments,
+ *      azimuth and errors. The report gives the time per call of each and
+ *      the largest difference between their outputs, so a kernel change
+ *      is checked for speed and for equivalence in one run.
+ *
+ *      usage: discon_kernels_bench [-n calls] [-sections n]
+ *
+ *      Built by the Linux template makefile (discon.tmf) with DISCON_BENCH.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "discon_kernels.h"
+#include "discon_profile.h"
+
+/*=========*
+ * Defines *
+ *=========*/
+
+#define PI            3.14159265358979323846
+#define MAX_SECTIONS  16
+#define DT            0.01
+
+/* Inputs of one call, precomputed so that both versions see the same data */
+typedef struct {
+    double m[DISCON_NUM_BLADES];    /* blade root moments                  */
+    double psi;                     /* azimuth of blade 1                  */
+    double e;                       /* speed error                         */
+    double sched;                   /* pitch angle                         */
+} Input;
+
+typedef struct {
+    const char *name;
+    double     refNs;               /* per call, generated block code       */
+    double     kernelNs;            /* per call, discon_kernels.c           */
+    double     maxDiff;             /* largest output difference            */
+} Result;
+
+/* Results are accumulated here so that no call can be optimized away */
+static volatile double Sink;
+
+/*=================================*
+ * Generated block code (reference) *
+ *=================================*/
+
+/* Function: refColemanForward ============================================
+ *
+ * Abstract:
+ *      Forward transform as generated: the azimuth of each blade from a
+ *      Sum block, then a sin and a cos block per blade.
+ */
+static void refColemanForward(const double *m, double psi, double *y) {
+    double rtb_Sum[3], rtb_Cos[3], rtb_Sin[3];
+    int    i;
+
+    rtb_Sum[0] = psi;
+    rtb_Sum[1] = psi + 2.0943951023931953;
+    rtb_Sum[2] = psi + 4.1887902047863905;
+    for (i = 0; i < 3; i++) {
+        rtb_Cos[i] = cos(rtb_Sum[i]);
+        rtb_Sin[i] = sin(rtb_Sum[i]);
+    }
+    y[0] = ((m[0] + m[1]) + m[2]) / 3.0;
+    y[1] = ((m[0] * rtb_Cos[0] + m[1] * rtb_Cos[1]) + m[2] * rtb_Cos[2]) *
+      0.66666666666666663;
+    y[2] = ((m[0] * rtb_Sin[0] + m[1] * rtb_Sin[1]) + m[2] * rtb_Sin[2]) *
+      0.66666666666666663;
+}  /* end refColemanForward */
+
+/* Function: refColemanInverse ============================================
+ *
+ * Abstract:
+ *      Inverse transform as generated, with the phase added per blade.
+ */
+static void refColemanInverse(const double *u, double psi, double phase, double *y) {
+    double rtb_Sum;
+    int    i;
+
+    for (i = 0; i < 3; i++) {
+        rtb_Sum = (psi + 2.0943951023931953 * (double)i) + phase;
+        y[i] = (cos(rtb_Sum) * u[1] + sin(rtb_Sum) * u[2]) + u[0];
+    }
+}  /* end refColemanInverse */
+
+/* Function: refFilterBank ================================================
+ *
+ * Abstract:
+ *      Discrete Filter blocks in direct form II, one per blade and section;
+ *      the states of a block are its own pair, dw[(blade*n + j)*2].
+ */
+static void refFilterBank(const double *u, double *y, double *dw,
+                          const double *coef, int n) {
+    double rtb_x, denAccum;
+    int    i, j;
+
+    for (i = 0; i < 3; i++) {
+        rtb_x = u[i];
+        for (j = 0; j < n; j++) {
+            double       *states = &dw[(i * n + j) * 2];
+            const double *c      = &coef[j * 5];
+
+            denAccum = (rtb_x - c[3] * states[0]) - c[4] * states[1];
+            rtb_x = (c[0] * denAccum + c[1] * states[0]) + c[2] * states[1];
+            states[1] = states[0];
+            states[0] = denAccum;
+        }
+        y[i] = rtb_x;
+    }
+}  /* end refFilterBank */
+
+/* Function: refPI ========================================================
+ *
+ * Abstract:
+ *      Gain-scheduled PI as generated from generic blocks: the schedule
+ *      from a Divide block, a limited Discrete-Time Integrator (forward
+ *      Euler, output after the update) and a Saturation block.
+ */
+static double refPI(double *DiscreteTimeIntegrator_DSTATE, double e, double sched,
+                    const double *p) {
+    double rtb_Divide, rtb_Product, rtb_Sat;
+
+    rtb_Divide = 1.0 / (sched / p[DISCON_PI_SCHED] + 1.0);
+    rtb_Product = rtb_Divide * e;
+    *DiscreteTimeIntegrator_DSTATE += p[DISCON_PI_KI] * rtb_Product * p[DISCON_PI_DT];
+    if (*DiscreteTimeIntegrator_DSTATE >= p[DISCON_PI_MAX]) {
+        *DiscreteTimeIntegrator_DSTATE = p[DISCON_PI_MAX];
+    } else {
+        if (*DiscreteTimeIntegrator_DSTATE <= p[DISCON_PI_MIN]) {
+            *DiscreteTimeIntegrator_DSTATE = p[DISCON_PI_MIN];
+        }
+    }
+    rtb_Sat = p[DISCON_PI_KP] * rtb_Product + *DiscreteTimeIntegrator_DSTATE;
+    if (rtb_Sat > p[DISCON_PI_MAX]) {
+        rtb_Sat = p[DISCON_PI_MAX];
+    } else {
+        if (rtb_Sat < p[DISCON_PI_MIN]) {
+            rtb_Sat = p[DISCON_PI_MIN];
+        }
+    }
+    return rtb_Sat;
+}  /* end refPI */
+
+/*=================*
+ * Local functions *
+ *=================*/
+
+/* Function: makeInputs ===================================================
+ *
+ * Abstract:
+ *      Synthetic rotor at 12 rpm: 1P and 3P blade moments on a mean load,
+ *      a wrapped azimuth and a slowly varying speed error and pitch.
+ */
+static void makeInputs(Input *in, int n) {
+    double omega = 12.0*2.0*PI/60.0;
+    int    t, k;
+
+    for (t=0; t<n; t++) {
+        double time = t*DT;
+        double psi  = fmod(omega*time, 2.0*PI);
+
+        for (k=0; k<DISCON_NUM_BLADES; k++) {
+            double psiK = psi + k*2.0*PI/3.0;
+
+            in[t].m[k] = 8e6 + 1.5e6*cos(psiK) + 0.4e6*sin(3.0*psiK + 0.3)
+                         + 1e5*sin(0.37*time + k);
+        }
+        in[t].psi   = psi;
+        in[t].e     = 0.2*sin(0.5*time) + 0.05*sin(7.1*time);
+        in[t].sched = 0.1 + 0.05*sin(0.05*time);
+    }
+}  /* end makeInputs */
+
+/* Function: lowPassSections ==============================================
+ *
+ * Abstract:
+ *      Coefficients of n second order low-pass sections (bilinear, cutoff
+ *      spread from 0.5 to 2 Hz, damping 0.7) as the model would pass them.
+ */
+static void lowPassSections(double *coef, int n) {
+    int j;
+
+    for (j=0; j<n; j++) {
+        double f  = 0.5 + 1.5*j/(n > 1 ? n-1 : 1);
+        double w  = 2.0/DT*tan(PI*f*DT);
+        double z  = 0.7;
+        double k2 = 4.0/(DT*DT), k1 = 2.0/DT*2.0*z*w, w2 = w*w;
+        double a0 = k2 + k1 + w2;
+
+        coef[5*j+0] = w2/a0;
+        coef[5*j+1] = 2.0*w2/a0;
+        coef[5*j+2] = w2/a0;
+        coef[5*j+3] = (2.0*w2 - 2.0*k2)/a0;
+        coef[5*j+4] = (k2 - k1 + w2)/a0;
+    }
+}  /* end lowPassSections */
+
+/* Function: maxAbsDiff ===================================================
+ *
+ * Abstract:
+ *      Largest absolute difference between two vectors.
+ */
+static double maxAbsDiff(const double *a, const double *b, int n) {
+    double d = 0.0;
+    int    i;
+
+    for (i=0; i<n; i++) {
+        if (fabs(a[i] - b[i]) > d) d = fabs(a[i] - b[i]);
+    }
+    return d;
+}  /* end maxAbsDiff */
+
+/* Function: benchColeman =================================================
+ *
+ * Abstract:
+ *      Forward transform of the moments, inverse transform of the result.
+ */
+static void benchColeman(const Input *in, int n, Result *r) {
+    double   yRef[3], yKer[3], bRef[3], bKer[3], sum = 0.0;
+    uint64_t start;
+    int      t;
+
+    r->name = "coleman fwd+inv";
+    start = disconClockNs();
+    for (t=0; t<n; t++) {
+        refColemanForward(in[t].m, in[t].psi, yRef);
+        refColemanInverse(yRef, in[t].psi, 0.1, bRef);
+        sum += bRef[0] + bRef[1] + bRef[2];
+    }
+    r->refNs = (double)(disconClockNs() - start)/n;
+
+    start = disconClockNs();
+    for (t=0; t<n; t++) {
+        DISCON_ColemanForward(in[t].m, in[t].psi, yKer);
+        DISCON_ColemanInverse(yKer, in[t].psi, 0.1, bKer);
+        sum += bKer[0] + bKer[1] + bKer[2];
+    }
+    r->kernelNs = (double)(disconClockNs() - start)/n;
+
+    r->maxDiff = 0.0;
+    for (t=0; t<n; t++) {
+        refColemanForward(in[t].m, in[t].psi, yRef);
+        DISCON_ColemanForward(in[t].m, in[t].psi, yKer);
+        refColemanInverse(yRef, in[t].psi, 0.1, bRef);
+        DISCON_ColemanInverse(yRef, in[t].psi, 0.1, bKer);
+        r->maxDiff = fmax(r->maxDiff, fmax(maxAbsDiff(yRef, yKer, 3)/1e6,
+                                           maxAbsDiff(bRef, bKer, 3)/1e6));
+    }
+    Sink = sum;
+}  /* end benchColeman */
+
+/* Function: benchFilters =================================================
+ *
+ * Abstract:
+ *      Filter bank of nSections on the blade moments.
+ */
+static void benchFilters(const Input *in, int n, int nSections, Result *r) {
+    double   coef[MAX_SECTIONS*DISCON_BIQUAD_COEFS];
+    double   dwRef[MAX_SECTIONS*DISCON_BIQUAD_STATES];
+    double   dwKer[MAX_SECTIONS*DISCON_BIQUAD_STATES];
+    double   yRef[3], yKer[3], sum = 0.0;
+    uint64_t start;
+    int      t;
+    static char name[32];
+
+    sprintf(name, "biquad bank x%d", nSections);
+    r->name = name;
+    lowPassSections(coef, nSections);
+
+    (void)memset(dwRef, 0, sizeof(dwRef));
+    start = disconClockNs();
+    for (t=0; t<n; t++) {
+        refFilterBank(in[t].m, yRef, dwRef, coef, nSections);
+        sum += yRef[0] + yRef[1] + yRef[2];
+    }
+    r->refNs = (double)(disconClockNs() - start)/n;
+
+    DISCON_BiquadBankInit(dwKer, nSections);
+    start = disconClockNs();
+    for (t=0; t<n; t++) {
+        DISCON_BiquadBank(in[t].m, yKer, dwKer, coef, nSections);
+        sum += yKer[0] + yKer[1] + yKer[2];
+    }
+    r->kernelNs = (double)(disconClockNs() - start)/n;
+
+    (void)memset(dwRef, 0, sizeof(dwRef));
+    DISCON_BiquadBankInit(dwKer, nSections);
+    r->maxDiff = 0.0;
+    for (t=0; t<n; t++) {
+        refFilterBank(in[t].m, yRef, dwRef, coef, nSections);
+        DISCON_BiquadBank(in[t].m, yKer, dwKer, coef, nSections);
+        r->maxDiff = fmax(r->maxDiff, maxAbsDiff(yRef, yKer, 3)/1e6);
+    }
+    Sink = sum;
+}  /* end benchFilters */
+
+/* Function: benchPI ======================================================
+ *
+ * Abstract:
+ *      Gain-scheduled PI pitch control of the speed error.
+ */
+static void benchPI(const Input *in, int n, Result *r) {
+    static const double p[DISCON_PI_NUM_PARAMS] = {
+        0.0188, 0.0081, 0.1099, 0.0, 1.5708, DT, 0.05
+    };
+    double   iRef[2], iKer[2], yRef, yKer, sum = 0.0;
+    uint64_t start;
+    int      t;
+
+    r->name = "gain-scheduled PI";
+    DISCON_PIInit(iRef, p);
+    start = disconClockNs();
+    for (t=0; t<n; t++) {
+        sum += refPI(iRef, in[t].e, in[t].sched, p);
+    }
+    r->refNs = (double)(disconClockNs() - start)/n;
+
+    DISCON_PIInit(iKer, p);
+    start = disconClockNs();
+    for (t=0; t<n; t++) {
+        sum += DISCON_PIOutput(iKer, in[t].e, in[t].sched, p);
+        DISCON_PIUpdate(iKer);
+    }
+    r->kernelNs = (double)(disconClockNs() - start)/n;
+
+    DISCON_PIInit(iRef, p);
+    DISCON_PIInit(iKer, p);
+    r->maxDiff = 0.0;
+    for (t=0; t<n; t++) {
+        yRef = refPI(iRef, in[t].e, in[t].sched, p);
+        yKer = DISCON_PIOutput(iKer, in[t].e, in[t].sched, p);
+        DISCON_PIUpdate(iKer);
+        r->maxDiff = fmax(r->maxDiff, fabs(yRef - yKer));
+    }
+    Sink = sum;
+}  /* end benchPI */
+
+/* Function: benchSinCos ==================================================
+ *
+ * Abstract:
+ *      disconSinCos against the library sin and cos over the azimuths.
+ */
+static void benchSinCos(const Input *in, int n, Result *r) {
+    double   s, c, sum = 0.0;
+    uint64_t start;
+    int      t;
+
+    r->name = "sincos";
+    start = disconClockNs();
+    for (t=0; t<n; t++) {
+        sum += sin(in[t].psi) + cos(in[t].psi);
+    }
+    r->refNs = (double)(disconClockNs() - start)/n;
+
+    start = disconClockNs();
+    for (t=0; t<n; t++) {
+        disconSinCos(in[t].psi, &s, &c);
+        sum += s + c;
+    }
+    r->kernelNs = (double)(disconClockNs() - start)/n;
+
+    r->maxDiff = 0.0;
+    for (t=0; t<n; t++) {
+        disconSinCos(in[t].psi, &s, &c);
+        r->maxDiff = fmax(r->maxDiff, fmax(fabs(s - sin(in[t].psi)),
+                                           fabs(c - cos(in[t].psi))));
+    }
+    Sink = sum;
+}  /* end benchSinCos */
+
+/* Function: displayUsage =================================================
+ *
+ * Abstract:
+ *      Print the command line options.
+ */
+static void displayUsage(void) {
+    (void)fprintf(stderr, "usage: discon_kernels_bench [-n calls] [-sections n]\n");
+}  /* end displayUsage */
+
+/*===================*
+ * Visible functions *
+ *===================*/
+
+/* Function: main =========================================================
+ *
+ * Abstract:
+ *      Run every benchmark and print the comparison table.
+ */
+int main(int argc, char *argv[]) {
+    int    n = 1000000, nSections = 4, i;
+    Input  *in;
+    Result r[4];
+
+    for (i=1; i<argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i+1 < argc) {
+            n = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-sections") == 0 && i+1 < argc) {
+            nSections = atoi(argv[++i]);
+        } else {
+            displayUsage();
+            return 1;
+        }
+    }
+    if (n < 1 || nSections < 1 || nSections > MAX_SECTIONS) {
+        (void)fprintf(stderr, "calls must be positive and sections 1..%d\n",
+                      MAX_SECTIONS);
+        return 1;
+    }
+
+    in = (Input *)malloc((size_t)n*sizeof(Input));
+    if (in == NULL) {
+        (void)fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    makeInputs(in, n);
+
+    benchSinCos(in, n, &r[0]);
+    benchColeman(in, n, &r[1]);
+    benchFilters(in, n, nSections, &r[2]);
+    benchPI(in, n, &r[3]);
+
+    (void)printf("%-20s %12s %12s %8s %12s\n", "kernel", "blocks ns", "kernel ns",
+                 "speedup", "max diff");
+    for (i=0; i<4; i++) {
+        (void)printf("%-20s %12.1f %12.1f %7.2fx %12.3g\n", r[i].name, r[i].refNs,
+                     r[i].kernelNs, r[i].refNs/r[i].kernelNs, r[i].maxDiff);
+    }
+    (void)printf("(%d calls; differences of moments in MNm)\n", n);
+    free(in);
+    return 0;
+}  /* end main */
+
+/* EOF: discon_kernels_bench.c */
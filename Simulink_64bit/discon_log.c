@@ -0,0 +1,298 @@
+/*
+ * File    : discon_log.c
+ *
+ * Abstract:
+ *      Ring-buffer logger with a background writer thread, see
+ *      discon_log.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "discon_log.h"
+#include "discon_threads.h"
+
+/*==================================*
+ * Global data local to this module *
+ *==================================*/
+
+typedef struct Chunk {
+    struct Chunk *next;         /* writer queue                         */
+    disconLog    *log;
+    int          rows;          /* rows filled                          */
+    int          queued;        /* owned by the writer until written    */
+    double       *time;         /* DISCON_LOG_CHUNK_ROWS times          */
+    float        *data;         /* nChannels columns of chunk rows      */
+} Chunk;
+
+struct disconLog {
+    FILE   *file;
+    char   *path;
+    int    nChannels;
+    int    error;               /* set by the writer on a write error   */
+    int    failed;              /* error seen by the producer           */
+    int    current;             /* chunk being filled                   */
+    char   *memory;             /* all chunk buffers                    */
+    Chunk  chunks[DISCON_LOG_CHUNKS];
+};
+
+/* The writer thread shared by all open logs */
+static struct {
+    disconMutex  openLock;      /* serializes opening and closing logs  */
+    disconMutex  lock;          /* protects everything below            */
+    disconCond   work;          /* a chunk was queued, or stop          */
+    disconCond   done;          /* a chunk was written                  */
+    Chunk        *head;
+    Chunk        *tail;
+    int          nLogs;
+    int          stop;
+    disconThread thread;
+} Writer = { DISCON_MUTEX_INITIALIZER, DISCON_MUTEX_INITIALIZER,
+             DISCON_COND_INITIALIZER,  DISCON_COND_INITIALIZER,
+             NULL, NULL, 0, 0, 0 };
+
+/*=================*
+ * Local functions *
+ *=================*/
+
+/* Function: writeChunk ===================================================
+ *
+ * Abstract:
+ *      Append one chunk to its file and flush it, so that it survives a
+ *      crash of the host. Called by the writer without the lock.
+ */
+static int writeChunk(const Chunk *c) {
+    disconLog            *log = c->log;
+    disconLogChunkHeader header;
+    size_t               rows = (size_t)c->rows;
+    int                  k;
+
+    header.magic = DISCON_LOG_CHUNK_MAGIC;
+    header.rows  = (uint32_t)c->rows;
+    if (fwrite(&header, sizeof(header), 1, log->file) != 1 ||
+        fwrite(c->time, sizeof(double), rows, log->file) != rows) {
+        return -1;
+    }
+    for (k=0; k<log->nChannels; k++) {
+        if (fwrite(c->data + (size_t)k*DISCON_LOG_CHUNK_ROWS, sizeof(float),
+                   rows, log->file) != rows) {
+            return -1;
+        }
+    }
+    return fflush(log->file) == 0 ? 0 : -1;
+}  /* end writeChunk */
+
+/* Function: writerThread =================================================
+ *
+ * Abstract:
+ *      Write queued chunks in order until asked to stop.
+ */
+static void writerThread(void *arg) {
+    Chunk *c;
+    int   status;
+
+    (void)arg;
+    disconMutexLock(&Writer.lock);
+    for (;;) {
+        while (Writer.head == NULL && !Writer.stop) {
+            disconCondWait(&Writer.work, &Writer.lock);
+        }
+        if (Writer.head == NULL) break;
+
+        c = Writer.head;
+        Writer.head = c->next;
+        if (Writer.head == NULL) Writer.tail = NULL;
+
+        disconMutexUnlock(&Writer.lock);
+        status = c->log->error ? 0 : writeChunk(c);
+        disconMutexLock(&Writer.lock);
+
+        if (status != 0) {
+            (void)fprintf(stderr, "Error writing %s, logging stopped\n",
+                          c->log->path);
+            c->log->error = 1;
+        }
+        c->rows   = 0;
+        c->queued = 0;
+        disconCondBroadcast(&Writer.done);
+    }
+    disconMutexUnlock(&Writer.lock);
+}  /* end writerThread */
+
+/* Function: queueChunk ===================================================
+ *
+ * Abstract:
+ *      Hand a chunk to the writer. Called with the lock held.
+ */
+static void queueChunk(Chunk *c) {
+    c->queued = 1;
+    c->next   = NULL;
+    if (Writer.tail != NULL) {
+        Writer.tail->next = c;
+    } else {
+        Writer.head = c;
+    }
+    Writer.tail = c;
+    disconCondBroadcast(&Writer.work);
+}  /* end queueChunk */
+
+/* Function: freeLog ======================================================
+ *
+ * Abstract:
+ *      Free a log that is not (or no longer) known to the writer.
+ */
+static void freeLog(disconLog *log) {
+    free(log->memory);
+    free(log->path);
+    free(log);
+}  /* end freeLog */
+
+/*===================*
+ * Visible functions *
+ *===================*/
+
+/* Function: disconLogOpen ================================================
+ *
+ * Abstract:
+ *      Create a log file and its ring of chunks; start the writer with the
+ *      first open log.
+ */
+disconLog *disconLogOpen(const char *path, int nChannels,
+                         const char *const *names, double stepSize,
+                         char *errorMsg) {
+    disconLog           *log;
+    disconLogFileHeader header;
+    char                name[DISCON_LOG_NAME_LEN];
+    size_t              chunkBytes;
+    int                 i, ok;
+
+    chunkBytes = DISCON_LOG_CHUNK_ROWS*(sizeof(double) + nChannels*sizeof(float));
+    log = (disconLog *)calloc(1, sizeof(*log));
+    if (log == NULL ||
+        (log->memory = (char *)malloc(DISCON_LOG_CHUNKS*chunkBytes)) == NULL ||
+        (log->path = (char *)malloc(strlen(path)+1)) == NULL) {
+        sprintf(errorMsg, "%.100s: out of memory", path);
+        if (log != NULL) freeLog(log);
+        return NULL;
+    }
+    strcpy(log->path, path);
+    log->nChannels = nChannels;
+    for (i=0; i<DISCON_LOG_CHUNKS; i++) {
+        Chunk *c = &log->chunks[i];
+
+        c->log  = log;
+        c->time = (double *)(log->memory + i*chunkBytes);
+        c->data = (float *)(c->time + DISCON_LOG_CHUNK_ROWS);
+    }
+
+    log->file = fopen(path, "wb");
+    if (log->file == NULL) {
+        sprintf(errorMsg, "%.100s: unable to create the log file", path);
+        freeLog(log);
+        return NULL;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DISCON_LOG_MAGIC, sizeof(DISCON_LOG_MAGIC));
+    header.version   = DISCON_LOG_VERSION;
+    header.nChannels = (uint32_t)nChannels;
+    header.chunkRows = DISCON_LOG_CHUNK_ROWS;
+    header.stepSize  = stepSize;
+    ok = fwrite(&header, sizeof(header), 1, log->file) == 1;
+    for (i=0; ok && i<nChannels; i++) {
+        memset(name, 0, sizeof(name));
+        strncpy(name, names[i], sizeof(name)-1);
+        ok = fwrite(name, sizeof(name), 1, log->file) == 1;
+    }
+    if (!ok || fflush(log->file) != 0) {
+        sprintf(errorMsg, "%.100s: unable to write the log file", path);
+        fclose(log->file);
+        freeLog(log);
+        return NULL;
+    }
+
+    disconMutexLock(&Writer.openLock);
+    if (Writer.nLogs == 0) {
+        Writer.stop = 0;
+        if (disconThreadCreate(&Writer.thread, writerThread, NULL) != 0) {
+            disconMutexUnlock(&Writer.openLock);
+            sprintf(errorMsg, "%.100s: unable to start the log writer", path);
+            fclose(log->file);
+            freeLog(log);
+            return NULL;
+        }
+    }
+    Writer.nLogs++;
+    disconMutexUnlock(&Writer.openLock);
+    return log;
+}  /* end disconLogOpen */
+
+/* Function: disconLogRow =================================================
+ *
+ * Abstract:
+ *      Reserve the next row. When the current chunk is full it goes to the
+ *      writer and the next chunk of the ring is reused, after waiting for
+ *      the writer if that chunk has not been written yet.
+ */
+float *disconLogRow(disconLog *log, double t, size_t *stride) {
+    Chunk *c = &log->chunks[log->current];
+
+    if (log->failed) return NULL;
+    if (c->rows == DISCON_LOG_CHUNK_ROWS) {
+        disconMutexLock(&Writer.lock);
+        queueChunk(c);
+        log->current = (log->current + 1) % DISCON_LOG_CHUNKS;
+        c = &log->chunks[log->current];
+        while (c->queued) {
+            disconCondWait(&Writer.done, &Writer.lock);
+        }
+        log->failed = log->error;
+        disconMutexUnlock(&Writer.lock);
+        if (log->failed) return NULL;
+    }
+    c->time[c->rows] = t;
+    *stride = DISCON_LOG_CHUNK_ROWS;
+    return c->data + c->rows++;
+}  /* end disconLogRow */
+
+/* Function: disconLogClose ===============================================
+ *
+ * Abstract:
+ *      Write the partial chunk, wait for the writer and close the file.
+ *      The writer thread stops with the last open log.
+ */
+int disconLogClose(disconLog *log) {
+    Chunk *c;
+    int   i, status, last;
+
+    if (log == NULL) return 0;
+
+    disconMutexLock(&Writer.openLock);
+    disconMutexLock(&Writer.lock);
+    c = &log->chunks[log->current];
+    if (c->rows > 0 && !c->queued) {
+        queueChunk(c);
+    }
+    for (i=0; i<DISCON_LOG_CHUNKS; i++) {
+        while (log->chunks[i].queued) {
+            disconCondWait(&Writer.done, &Writer.lock);
+        }
+    }
+    status = log->error ? -1 : 0;
+    last = (--Writer.nLogs == 0);
+    if (last) {
+        Writer.stop = 1;
+        disconCondBroadcast(&Writer.work);
+    }
+    disconMutexUnlock(&Writer.lock);
+    if (last) {
+        disconThreadJoin(Writer.thread);
+    }
+    disconMutexUnlock(&Writer.openLock);
+
+    if (fclose(log->file) != 0) status = -1;
+    freeLog(log);
+    return status;
+}  /* end disconLogClose */
+
+/* EOF: discon_log.c */
@@ -0,0 +1,85 @@
+/*
+ * File    : discon_log.h
+ *
+ * Abstract:
+ *      Streaming binary logger of the DISCON library.
+ *
+ *      Every step appends one row (time and a fixed set of float channels)
+ *      to a preallocated ring of chunks. A full chunk is handed to a single
+ *      background writer thread, shared by all open logs, which appends it
+ *      to the file and flushes it. Memory use is fixed when the log is
+ *      opened; a step only waits when the writer is a whole ring behind.
+ *
+ *      File layout (native byte order):
+ *          disconLogFileHeader
+ *          nChannels names of DISCON_LOG_NAME_LEN characters, NUL padded
+ *          chunks, each a disconLogChunkHeader followed by
+ *              double time[rows]
+ *              float  channel[nChannels][rows]     (columnar)
+ *      Every chunk is complete in itself, so the file of an aborted run
+ *      can be read up to its last complete chunk. DISCON_ReadLog.m reads
+ *      the format.
+ */
+
+#ifndef DISCON_LOG_H
+#define DISCON_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "discon.h"
+
+#define DISCON_LOG_MAGIC       "DISCONL"
+#define DISCON_LOG_VERSION     1
+#define DISCON_LOG_NAME_LEN    48
+#define DISCON_LOG_CHUNK_MAGIC 0x4b4e4843u     /* "CHNK" */
+
+/* Rows per chunk and chunks per ring; a log holds chunkRows*chunks rows */
+#ifndef DISCON_LOG_CHUNK_ROWS
+# define DISCON_LOG_CHUNK_ROWS 1024
+#endif
+#ifndef DISCON_LOG_CHUNKS
+# define DISCON_LOG_CHUNKS     4
+#endif
+
+typedef struct {
+    char     magic[8];              /* DISCON_LOG_MAGIC, NUL padded        */
+    uint32_t version;               /* DISCON_LOG_VERSION                  */
+    uint32_t nChannels;             /* channels, not counting the time     */
+    uint32_t chunkRows;             /* maximum rows per chunk              */
+    uint32_t reserved;
+    double   stepSize;              /* nominal time between rows           */
+} disconLogFileHeader;              /* 32 bytes */
+
+typedef struct {
+    uint32_t magic;                 /* DISCON_LOG_CHUNK_MAGIC              */
+    uint32_t rows;                  /* rows in this chunk                  */
+} disconLogChunkHeader;             /* 8 bytes */
+
+typedef struct disconLog disconLog;
+
+/*
+ * Create the file path, write the header and allocate the ring. Returns
+ * NULL and fills errorMsg (at least 257 characters) on failure.
+ */
+DISCON_LOCAL disconLog *disconLogOpen(const char *path, int nChannels,
+                                      const char *const *names, double stepSize,
+                                      char *errorMsg);
+
+/*
+ * Append a row at time t. Returns a pointer to channel 0 of the new row;
+ * channel k is at row[k*(*stride)]. The row may be filled until the next
+ * call. Returns NULL when the log has failed (the first write error is
+ * reported on stderr and logging stops).
+ */
+DISCON_LOCAL float *disconLogRow(disconLog *log, double t, size_t *stride);
+
+/*
+ * Write the remaining rows, close the file and free the log. Returns 0, or
+ * -1 when a write failed. NULL is ignored.
+ */
+DISCON_LOCAL int disconLogClose(disconLog *log);
+
+#endif /* DISCON_LOG_H */
+
+/* EOF: discon_log.h */
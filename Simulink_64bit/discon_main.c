@@ -19,24 +19,78 @@
  *	NCSTATES=#      - Required. Number of continuous states.
  *      TID01EQ=1 or 0  - Optional. Only define to 1 if sample time task
  *                        id's 0 and 1 have equal rates.
- *      MULTITASKING    - Optional. (use MT for a synonym).
- *	SAVEFILE        - Optional (non-quoted) name of .mat file to create.
- *			  Default is <MODEL>.mat
+ *      MULTITASKING    - Optional. (use MT for a synonym). Each DISCON call
+ *                        runs the base rate; the slower sample-time tasks
+ *                        run on a background thread (classic interface).
+ *      DISCON_LOG      - Optional. 1 to stream the model inputs and outputs
+ *                        to a binary log (discon_log.h); defaults to
+ *                        MAT_FILE, the MAT-file logging it replaces.
+ *      DISCON_LOG_FILE - Optional quoted log file name. Default is
+ *                        "<MODEL>.dlog"; instance n > 1 adds "_n".
+ *      DISCON_PROFILE  - Optional. 1 to time every call: phase times,
+ *                        latency histogram, worst-case execution time per
+ *                        task and deadline misses (DISCON_GetPhaseTimes,
+ *                        DISCON_GetTiming, discon_bench).
+ *      DISCON_CAPTURE  - Optional. 1 (the default) to support capturing
+ *                        every call to an avrSwap trace (discon_capture.h)
+ *                        when the environment variable DISCON_CAPTURE_FILE
+ *                        names the file; instance n > 1 adds "_n".
+ *      DISCON_TELEMETRY- Optional. 1 (the default) to support streaming
+ *                        selected signals to a telemetry receiver
+ *                        (discon_telemetry.h) when the environment
+ *                        variable DISCON_TELEMETRY names it.
+ *      DISCON_BUDGET   - Optional. 1 to give every step a time budget of
+ *                        DISCON_BUDGET_PERCENT (default 100) percent of the
+ *                        step size and skip or defer the non-critical work
+ *                        of a step that exceeds it, instead of stopping on
+ *                        an overrun (DISCON_GetBudget).
+ *      DISCON_HOST_TIME- Optional. 1 to step the model only on its sample
+ *                        hits in the host time rTime (avrSwap[1]): the
+ *                        outputs are held (or ramped, $DISCON_INTERPOLATE)
+ *                        between hits, and a call that passes several hits
+ *                        steps through all of them, at most
+ *                        DISCON_MAX_CATCHUP (default 1000)
+ *                        (DISCON_GetSchedule). Default is 0, one step per
+ *                        call.
+ *      DISCON_SINGLE   - Optional. 1 when the model is built in single
+ *                        precision (DISCON_SetPrecision.m): its root ports
+ *                        are real32_T instead of real_T. Checked against
+ *                        the model at compile time; defaults to 0.
+ *      MODEL_HAS_BLOCKIO, MODEL_HAS_DWORK
+ *                      - Optional. 0 when the generated model has no block
+ *                        I/O (<MODEL>_B) or DWork (<MODEL>_DW) structure;
+ *                        both default to 1.
+ *      MODEL_HAS_PREVZC- Optional. 1 when the generated model has
+ *                        zero-crossing state (<MODEL>_PrevZCX); defaults
+ *                        to 0. These select the model data of a state
+ *                        snapshot (DISCON_Snapshot).
+ *      MODEL_CLOCK_TICKS(X)
+ *                      - Optional. The clock tick counters of the rtModel
+ *                        timing (Timing.clockTick<i>, and clockTickH<i>
+ *                        when the model counts absolute time in two
+ *                        words), as X(clockTick0) X(clockTick1) ...; saved
+ *                        with the state. Defaults to X(clockTick0); define
+ *                        it empty for a model without.
  */
 
 #include <float.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-FILE *pFile; //Added by JW to read the init file
 
+#include "discon.h"
+#include "discon_capture.h"
+#include "discon_log.h"
+#include "discon_params.h"
+#include "discon_profile.h"
+#include "discon_snapshot.h"
+#include "discon_telemetry.h"
+#include "discon_threads.h"
 #include "rtwtypes.h"
 # include "rtmodel.h"
 #include "rt_sim.h"
 #include "rt_logging.h"
-#ifdef UseMMIDataLogging
-#include "rt_logging_mmi.h"
-#endif
 
 #include "ext_work.h"
 
@@ -77,26 +131,123 @@ FILE *pFile; //Added by JW to read the init file
 # error "must define NCSTATES"
 #endif
 
-#ifndef SAVEFILE
-# define MATFILE2(file) #file ".mat"
-# define MATFILE1(file) MATFILE2(file)
-# define MATFILE MATFILE1(MODEL)
-#else
-# define MATFILE QUOTE(SAVEFILE)
+#ifndef DISCON_LOG
+# if defined(MAT_FILE) && MAT_FILE == 1
+#  define DISCON_LOG 1
+# else
+#  define DISCON_LOG 0
+# endif
+#endif
+
+#ifndef DISCON_LOG_FILE
+# define DISCON_LOG_FILE QUOTE(MODEL) ".dlog"
+#endif
+
+#ifndef DISCON_CAPTURE
+# define DISCON_CAPTURE 1
+#endif
+
+#ifndef DISCON_TELEMETRY
+# define DISCON_TELEMETRY 1
+#endif
+
+#ifndef DISCON_BUDGET
+# define DISCON_BUDGET 0
+#endif
+#ifndef DISCON_BUDGET_PERCENT
+# define DISCON_BUDGET_PERCENT 100
+#endif
+
+#ifndef DISCON_HOST_TIME
+# define DISCON_HOST_TIME 0
+#endif
+#ifndef DISCON_MAX_CATCHUP
+# define DISCON_MAX_CATCHUP 1000
+#endif
+
+#ifndef DISCON_SINGLE
+# define DISCON_SINGLE 0
 #endif
 
 #define RUN_FOREVER -1.0
 
 #define EXPAND_CONCAT(name1,name2) name1 ## name2
 #define CONCAT(name1,name2) EXPAND_CONCAT(name1,name2)
-#define RT_MODEL            CONCAT(MODEL,_rtModel)
 
-#define EXPAND_CONCAT3(name1,name2,name3) name1 ## _ ## name2 ## . ## name3
-#define CONCAT3(name1,name2,name3) EXPAND_CONCAT3(name1,name2,name3)
-#define SIG_MODEL(suffix,name)     CONCAT3(MODEL,suffix,name)
+/*
+ * Access to the model data. The classic interface keeps a single copy of
+ * the model data in globals (<MODEL>_U, <MODEL>_Y, ...); reusable code
+ * (MULTI_INSTANCE_CODE) allocates it per instance with MODEL() and reaches
+ * it through the rtModel.
+ */
+#if MULTI_INSTANCE_CODE == 1
+# define RT_MODEL            CONCAT(RT_MODEL_,CONCAT(MODEL,_T))
+# define MODEL_U(S)          rtmGetU(S)
+# define MODEL_Y(S)          rtmGetY(S)
+# define MODEL_B(S)          rtmGetBlockIO(S)
+# define MODEL_DW(S)         rtmGetRootDWork(S)
+# define MODEL_X(S)          rtmGetContStates(S)
+# define MODEL_ZC(S)         rtmGetPrevZCSigState(S)
+# define MODEL_INITIALIZE(S) CONCAT(MODEL,_initialize)(S)
+# define MODEL_TERMINATE(S)  CONCAT(MODEL,_terminate)(S)
+# if ONESTEPFCN == 1
+#  define MODEL_STEP(S)      CONCAT(MODEL,_step)(S)
+# else
+#  define MODEL_OUTPUT(S)    CONCAT(MODEL,_output)(S)
+#  define MODEL_UPDATE(S)    CONCAT(MODEL,_update)(S)
+# endif
+#else
+# define RT_MODEL            CONCAT(MODEL,_rtModel)
+# define MODEL_U(S)          (&CONCAT(MODEL,_U))
+# define MODEL_Y(S)          (&CONCAT(MODEL,_Y))
+# define MODEL_B(S)          (&CONCAT(MODEL,_B))
+# define MODEL_DW(S)         (&CONCAT(MODEL,_DW))
+# define MODEL_X(S)          (&CONCAT(MODEL,_X))
+# define MODEL_ZC(S)         (&CONCAT(MODEL,_PrevZCX))
+#endif
+
+#ifndef MODEL_HAS_BLOCKIO
+# define MODEL_HAS_BLOCKIO 1
+#endif
+#ifndef MODEL_HAS_DWORK
+# define MODEL_HAS_DWORK   1
+#endif
+#ifndef MODEL_HAS_PREVZC
+# define MODEL_HAS_PREVZC  0
+#endif
+#ifndef MODEL_CLOCK_TICKS
+# define MODEL_CLOCK_TICKS(X) X(clockTick0)
+#endif
+
+#if MULTI_INSTANCE_CODE == 1
+# if ALLOCATIONFCN != 1
+#  error "MULTI_INSTANCE_CODE requires the model allocation function (GenerateAllocFcn)"
+# endif
+# if defined(MULTITASKING)
+#  error "MULTI_INSTANCE_CODE is only supported for single-tasking models"
+# endif
+# ifdef EXT_MODE
+#  error "External mode is not supported with MULTI_INSTANCE_CODE"
+# endif
+#endif
+
+/* Number of controller instances that can be alive at the same time */
+#ifndef DISCON_MAX_INSTANCES
+# if MULTI_INSTANCE_CODE == 1
+#  define DISCON_MAX_INSTANCES 256
+# else
+#  define DISCON_MAX_INSTANCES 1
+# endif
+#endif
+
+/* Parameter blocks (work vectors) of the model that snapshots track */
+#ifndef DISCON_MAX_WORK_POINTERS
+# define DISCON_MAX_WORK_POINTERS 256
+#endif
 
 #define NINT(a) ((a) >= 0.0 ? (int)((a)+0.5) : (int)((a)-0.5))
 #define MIN(a,b) ((a)>(b)?(b):(a))
+#define MAX(a,b) ((a)<(b)?(b):(a))
 
 /*====================*
  * External functions *
@@ -109,14 +260,14 @@ extern "C" {
 
 extern RT_MODEL *MODEL(void);
 
+#if MULTI_INSTANCE_CODE != 1
 extern void MdlInitializeSizes(void);
 extern void MdlInitializeSampleTimes(void);
 extern void MdlStart(void);
 extern void MdlOutputs(int_T tid);
 extern void MdlUpdate(int_T tid);
 extern void MdlTerminate(void);
-
-extern void __declspec(dllexport) __cdecl DISCON(float *avrSwap, int *aviFail, char *accInfile, char *avcOutname, char *avcMsg); 
+#endif
 
 #ifdef __cplusplus
 
@@ -151,13 +302,156 @@ extern "C" {
  * Global data local to this module *
  *==================================*/
 
+struct DISCON_Instance {
+    RT_MODEL    *S;
+    const float *avrSwap;    /* host buffer bound to this instance by DISCON */
+    int_T       inUse;
+    disconParamSet *params;  /* parsed parameter file, NULL if there is none */
+    disconLog   *log;        /* streaming log, NULL when logging is off      */
+    disconCapture *capture;  /* avrSwap trace, NULL unless capturing         */
+    disconTelemetry *telemetry;  /* signal stream, NULL unless streaming     */
+    uint64_t    startNs;     /* duration of the last start or reset          */
+    int_T       fromTemplate;  /* that start copied the start template       */
+#if defined(MULTITASKING)
+    int_T       subRatesStarted;  /* the sub-rate worker is running          */
+#endif
+#if DISCON_PROFILE == 1
+    uint64_t    callStart;   /* start of the current call                    */
+    uint64_t    phaseStart;  /* end of the previous phase                    */
+    double      phaseNs[DISCON_NUM_PHASES];  /* phases of the last call      */
+    uint64_t    lastCallNs;  /* duration of the last timed call              */
+    uint64_t    deadlineNs;  /* step size of the model                       */
+    uint64_t    deadlineMisses;
+    double      wcetOutputsNs[NUMST];        /* per sample-time task         */
+    double      wcetUpdateNs[NUMST];
+    disconHist  *latency;    /* duration of every timed call                 */
+#endif
+#if DISCON_BUDGET == 1
+    uint64_t    budgetNs;    /* time allowed for a step                      */
+    uint64_t    stepStart;   /* start of the current step                    */
+    uint64_t    steps;       /* steps since the statistics were cleared      */
+    uint64_t    overBudget;  /* steps that exceeded the budget               */
+    uint64_t    skippedLog;  /* log rows not written                         */
+    uint64_t    deferredTasks[NUMST];        /* sub-rate runs still going at */
+                                             /*   a later step              */
+    uint64_t    skippedTasks[NUMST];         /* sub-rate sample hits dropped */
+#endif
+#if DISCON_HOST_TIME == 1
+    struct {
+      real_T   nextHit;      /* host time of the next sample hit             */
+      real_T   lastHit;      /* host time of the latest model step           */
+      real32_T prevOut[DISCON_NUM_OUTPUTS];  /* avrSwap outputs before it    */
+      int_T    started;      /* stepped since the initialization call        */
+    } schedule;              /* saved with the model state                   */
+    int_T       ramp;        /* ramp the outputs between sample hits         */
+    uint64_t    hostCalls;   /* calls since the statistics were cleared      */
+    uint64_t    modelSteps;
+    uint64_t    heldCalls;   /* calls between two sample hits                */
+    uint64_t    catchUpSteps;  /* steps after the first of a call            */
+    uint64_t    resyncs;     /* calls more than DISCON_MAX_CATCHUP hits late */
+#endif
+    struct {
+      int_T    stopExecutionFlag;
+      int_T    isrOverrun;
+      int_T    overrunFlags[NUMST];
+      int_T    eventFlags[NUMST];
+      const    char_T *errmsg;
+    } GBLbuf;
+};
+
+static DISCON_Instance Instances[DISCON_MAX_INSTANCES];
+
+/* Protects the instance table and model (de)registration */
+static disconMutex InstanceLock = DISCON_MUTEX_INITIALIZER;
+
+/* Instance that DISCON found last on this thread, see swapInstance */
+static THREAD_LOCAL DISCON_Instance *LastInstance = NULL;
+
+#if MULTI_INSTANCE_CODE == 1
+/*
+ * Start template of reusable code: the snapshot of an instance right after
+ * its model was initialized with a parameter set. Once a second instance
+ * has confirmed that its own initial state is the same, further instances
+ * with that parameter set copy the template instead of running the
+ * initialize function. Protected by InstanceLock.
+ */
+enum {
+    TEMPLATE_NONE,                  /* nothing taken yet                   */
+    TEMPLATE_TAKEN,                 /* taken, not yet confirmed            */
+    TEMPLATE_READY,                 /* confirmed, in use                   */
+    TEMPLATE_OFF                    /* disabled, or the initial state      */
+};                                  /* depends on the instance             */
+
 static struct {
-  int_T    stopExecutionFlag;
-  int_T    isrOverrun;
-  int_T    overrunFlags[NUMST];
-  int_T    eventFlags[NUMST];
-  const    char_T *errmsg;
-} GBLbuf;
+    int_T          state;           /* TEMPLATE_xxx                        */
+    disconParamSet *params;         /* set it was taken with, a reference  */
+    void           *buf;
+    size_t         size;
+    void           *work[DISCON_MAX_WORK_POINTERS];  /* at WorkPointers   */
+} StartTemplate;
+#endif
+
+#if MULTI_INSTANCE_CODE != 1
+/*
+ * Layout of the timing engine data of rt_sim.c (TimingData), which does not
+ * export its type. A snapshot saves it with the model data.
+ */
+typedef struct {
+    real_T period[NUMST];
+    real_T offset[NUMST];
+    real_T clockTick[NUMST];
+    int_T  taskTick[NUMST];
+    int_T  nTaskTicks[NUMST];
+    int_T  firstDiscIdx;
+} SimTimingData;
+#endif
+
+/*
+ * The scalars of an instance that a snapshot saves one by one, rather than
+ * with the structures that hold them, which also hold pointers of the
+ * instance (to its own timing arrays, the solver, logging, the timing
+ * engine, error messages): the timing of the rtModel and the overrun and
+ * event counters of GBLbuf.
+ */
+#define COUNT_CLOCK_TICK(field) +1
+enum { NUM_CLOCK_TICKS = 0 MODEL_CLOCK_TICKS(COUNT_CLOCK_TICK) };
+
+typedef struct {
+    real_T   t[NUMST];                  /* task times                      */
+    int_T    sampleHits[NUMST];
+#if defined(MULTITASKING)
+    int_T    perTaskSampleHits[NUMST*NUMST];
+#endif
+    uint32_T clockTicks[NUM_CLOCK_TICKS+1];   /* MODEL_CLOCK_TICKS         */
+    int_T    stopExecutionFlag;         /* GBLbuf                          */
+    int_T    isrOverrun;
+    int_T    overrunFlags[NUMST];
+    int_T    eventFlags[NUMST];
+} SnapshotScalars;
+
+/*
+ * Work vectors in the DWork through which the parameter blocks point at
+ * entries of the parameter set of the instance, as offsets from the DWork
+ * in ascending order. Recorded when the first model starts, the same for
+ * every instance; a snapshot leaves them out. Protected by InstanceLock.
+ */
+#if MODEL_HAS_DWORK == 1
+static size_t WorkPointers[DISCON_MAX_WORK_POINTERS];
+static int    NumWorkPointers = -1;     /* not recorded yet               */
+#endif
+
+/* Sections of a state snapshot */
+enum {
+    SNAPSHOT_RTMODEL = 1,           /* SnapshotScalars                     */
+    SNAPSHOT_TIMING,                /* timing engine of rt_sim.c           */
+    SNAPSHOT_INPUTS,
+    SNAPSHOT_OUTPUTS,
+    SNAPSHOT_BLOCKIO,
+    SNAPSHOT_DWORK,
+    SNAPSHOT_CSTATES,
+    SNAPSHOT_PREVZC,
+    SNAPSHOT_SCHEDULE               /* host-time schedule                  */
+};
 
 
 #ifdef EXT_MODE
@@ -175,34 +469,502 @@ static struct {
 #  define rtExtModeSingleTaskUpload(S) /* Do nothing */
 #endif
 
+/*
+ * Call timing: PROFILE_START starts a call, PROFILE_PHASE charges the time
+ * since the previous mark to a phase (DISCON_PHASE_xxx), PROFILE_TASK also
+ * tracks the worst case of the outputs or update of sample-time task tid,
+ * and PROFILE_END closes a step call and adds it to the statistics.
+ */
+#if DISCON_PROFILE == 1
+# define PROFILE_START(inst)        profileStart(inst)
+# define PROFILE_PHASE(inst, phase) profilePhase(inst, CONCAT(DISCON_PHASE_,phase), 0)
+# define PROFILE_TASK(inst, phase, tid) \
+                                    profilePhase(inst, CONCAT(DISCON_PHASE_,phase), tid)
+# define PROFILE_END(inst)          profileEnd(inst)
+#else
+# define PROFILE_START(inst)        ((void)0)  /* Do nothing */
+# define PROFILE_PHASE(inst, phase) ((void)0)  /* Do nothing */
+# define PROFILE_TASK(inst, phase, tid) ((void)0)
+# define PROFILE_END(inst)          ((void)0)
+#endif
+
 /*=================*
  * Local functions *
  *=================*/
 
-/* Function: initiateController ===========================================
+#if DISCON_PROFILE == 1
+/* Function: profileStart =================================================
  *
  * Abstract:
- *      Initialize the controller of the compiled Matlab Simulink block.
+ *      Clear the phase times of an instance at the start of a call.
  */
-static RT_MODEL *S;
-int initiateController(char *errorMsg) {
-    const char *status;
-	
-    /****************************
-     * Initialize global memory *
-     ****************************/
-    (void)memset(&GBLbuf, 0, sizeof(GBLbuf));
+static void profileStart(DISCON_Instance *inst) {
+    (void)memset(inst->phaseNs, 0, sizeof(inst->phaseNs));
+    inst->callStart = inst->phaseStart = disconClockNs();
+}  /* end profileStart */
 
-    /************************
-     * Initialize the model *
-     ************************/
+/* Function: profilePhase =================================================
+ *
+ * Abstract:
+ *      Charge the time since the previous mark to a phase; for the outputs
+ *      and update of task tid, also keep the worst case.
+ */
+static void profilePhase(DISCON_Instance *inst, int_T phase, int_T tid) {
+    uint64_t now = disconClockNs();
+    double   ns  = (double)(now - inst->phaseStart);
+
+    inst->phaseNs[phase] += ns;
+    inst->phaseStart = now;
+    if (phase == DISCON_PHASE_OUTPUTS && ns > inst->wcetOutputsNs[tid]) {
+        inst->wcetOutputsNs[tid] = ns;
+    } else if (phase == DISCON_PHASE_UPDATE && ns > inst->wcetUpdateNs[tid]) {
+        inst->wcetUpdateNs[tid] = ns;
+    }
+}  /* end profilePhase */
+
+/* Function: profileEnd ===================================================
+ *
+ * Abstract:
+ *      Close a step call: charge the rest to the output scatter, add the
+ *      call to the latency histogram and count it as a deadline miss when
+ *      it took longer than the step size of the model.
+ */
+static void profileEnd(DISCON_Instance *inst) {
+    profilePhase(inst, DISCON_PHASE_SCATTER, 0);
+    inst->lastCallNs = inst->phaseStart - inst->callStart;
+    disconHistAdd(inst->latency, inst->lastCallNs);
+    if (inst->lastCallNs > inst->deadlineNs) inst->deadlineMisses++;
+}  /* end profileEnd */
+#endif
+
+/*
+ * Step budget: BUDGET_START marks the start of a step, OVER_BUDGET tells
+ * whether the step has used up its budget, so that the work that can be
+ * left out is skipped, and BUDGET_END counts the steps that exceeded it.
+ * The base-rate outputs and update, which produce the demands, always run.
+ */
+#if DISCON_BUDGET == 1
+# define BUDGET_START(inst) ((inst)->stepStart = disconClockNs(), (void)(inst)->steps++)
+# define OVER_BUDGET(inst)  (disconClockNs() - (inst)->stepStart > (inst)->budgetNs)
+# define BUDGET_END(inst)   ((void)(OVER_BUDGET(inst) && (inst)->overBudget++))
+
+/* Function: clearBudget ==================================================
+ *
+ * Abstract:
+ *      Derive the step budget of an instance from the step size of its
+ *      model and clear the budget statistics.
+ */
+static void clearBudget(DISCON_Instance *inst) {
+    inst->budgetNs   = (uint64_t)(rtmGetStepSize(inst->S)*1e9*
+                                  DISCON_BUDGET_PERCENT/100.0);
+    inst->steps      = 0;
+    inst->overBudget = 0;
+    inst->skippedLog = 0;
+    (void)memset(inst->deferredTasks, 0, sizeof(inst->deferredTasks));
+    (void)memset(inst->skippedTasks, 0, sizeof(inst->skippedTasks));
+}  /* end clearBudget */
+
+/* Function: budgetSkips ==================================================
+ *
+ * Abstract:
+ *      Total of the log rows and sub-rate sample hits skipped.
+ */
+static uint64_t budgetSkips(const DISCON_Instance *inst) {
+    uint64_t n = inst->skippedLog;
+    int_T    i;
+
+    for (i=0; i<NUMST; i++) {
+        n += inst->skippedTasks[i];
+    }
+    return n;
+}  /* end budgetSkips */
+
+/* Function: reportBudget =================================================
+ *
+ * Abstract:
+ *      Tell the user how much of a run was degraded, before its budget
+ *      statistics are cleared.
+ */
+static void reportBudget(const DISCON_Instance *inst) {
+    uint64_t deferred = 0;
+    int_T    i;
+
+    if (inst->overBudget == 0 && budgetSkips(inst) == 0) return;
+    for (i=0; i<NUMST; i++) {
+        deferred += inst->deferredTasks[i];
+    }
+    (void)fprintf(stderr, "%s: %.0f of %.0f steps exceeded the budget of %.0f us; "
+                  "skipped %.0f log rows and %.0f sub-rate task hits; %.0f "
+                  "sub-rate runs overran a base step\n", QUOTE(MODEL),
+                  (double)inst->overBudget, (double)inst->steps,
+                  (double)inst->budgetNs/1e3, (double)inst->skippedLog,
+                  (double)(budgetSkips(inst) - inst->skippedLog), (double)deferred);
+}  /* end reportBudget */
+#else
+# define BUDGET_START(inst) ((void)0)  /* Do nothing */
+# define OVER_BUDGET(inst)  0
+# define BUDGET_END(inst)   ((void)0)
+# define clearBudget(inst)  ((void)0)
+# define reportBudget(inst) ((void)0)
+#endif
+
+/* Function: allocInstance ================================================
+ *
+ * Abstract:
+ *      Reserve a free instance slot. Called with InstanceLock held.
+ */
+static DISCON_Instance *allocInstance(void) {
+    int_T i;
+
+    for (i=0; i<DISCON_MAX_INSTANCES; i++) {
+        if (!Instances[i].inUse) {
+            (void)memset(&Instances[i], 0, sizeof(Instances[i]));
+            Instances[i].inUse = 1;
+            return &Instances[i];
+        }
+    }
+    return NULL;
+}  /* end allocInstance */
+
+/* Function: releaseInstance ==============================================
+ *
+ * Abstract:
+ *      Give an instance slot back, with the resources still held by an
+ *      instance whose model has been stopped. Called with InstanceLock held.
+ */
+static void releaseInstance(DISCON_Instance *inst) {
+    disconParamsRelease(inst->params);
+    inst->params = NULL;
+#if DISCON_PROFILE == 1
+    free(inst->latency);
+    inst->latency = NULL;
+#endif
+    inst->S = NULL;
+    inst->avrSwap = NULL;
+    inst->inUse = 0;
+}  /* end releaseInstance */
+
+/* Defined with the model input/output tables below */
+static void initLogChannels(void);
+#if DISCON_LOG == 1
+static disconLog *openStreamLog(const char *path, double stepSize, char *errorMsg);
+#endif
+#if DISCON_CAPTURE == 1
+static disconCapture *openCapture(const char *path, double stepSize, char *errorMsg);
+#endif
+#if MULTI_INSTANCE_CODE == 1
+/* Defined with the state snapshots below */
+static int  copyStartTemplate(DISCON_Instance *inst);
+static void keepStartTemplate(DISCON_Instance *inst);
+#else
+# define copyStartTemplate(inst) (-1)
+# define keepStartTemplate(inst) /* Do nothing */
+#endif
+#if DISCON_TELEMETRY == 1
+static disconTelemetry *openTelemetry(const char *target, int instance, double stepSize,
+                                      char *errorMsg);
+#endif
+
+#if DISCON_LOG == 1 || DISCON_CAPTURE == 1
+/* Function: instanceFileName =============================================
+ *
+ * Abstract:
+ *      Log or trace file of an instance: name, with "_<n>" inserted before
+ *      the extension for instance slot n > 1. path must hold 260
+ *      characters.
+ */
+static void instanceFileName(const DISCON_Instance *inst, const char *name, char *path) {
+    const char *ext;
+    int        n = (int)(inst - Instances) + 1;
 
-    S = MODEL();
+    ext = strrchr(name, '.');
+    if (n == 1 || ext == NULL || strpbrk(ext, "/\\") != NULL) {
+        ext = name + strlen(name);
+    }
+    if (n == 1) {
+        sprintf(path, "%.240s", name);
+    } else {
+        sprintf(path, "%.*s_%d%.16s", (int)MIN(ext - name, 200), name, n, ext);
+    }
+}  /* end instanceFileName */
+#endif
+
+#if defined(MULTITASKING)
+# if TID01EQ == 1
+#  define FIRST_TID 1
+# else
+#  define FIRST_TID 0
+# endif
+
+/*
+ * Sub-rate tasks. The base rate runs in the DISCON call; the slower
+ * sample-time tasks run on a background worker thread, so that a slow task
+ * never adds to the time of a base-rate call. At a sample hit of task i
+ * the base rate raises eventFlags[i] and, after its own step, releases
+ * the task; the worker runs released tasks in rate-monotonic order
+ * (fastest first) and lowers eventFlags[i] when task i completes. A
+ * sample hit that finds task i still released or running is an overrun:
+ * it sets overrunFlags[i] and stops the run, or with DISCON_BUDGET the hit
+ * is dropped (skipped) and the task time caught up once the task is done.
+ *
+ * The timing engine is only updated under lock: the discrete events by
+ * the base rate, the task time of task i by the worker. The engine writes
+ * the sample hits of every tick into hits, which only the base rate uses;
+ * the hit of task i is copied to the sample hits of the rtModel while the
+ * worker runs task i. Signals between rates must pass through Rate
+ * Transition blocks set for data integrity without determinism, so that
+ * the generated code double buffers them (DISCON_SetMultitasking.m); the
+ * lock taken at every release and completion orders the buffer writes of
+ * one thread before the reads of the other.
+ */
+static struct {
+    disconMutex     lock;       /* protects everything below, the timing */
+                                /* engine, eventFlags and overrunFlags   */
+    disconCond      work;       /* a task was released, or stop          */
+    disconCond      idle;       /* no task released or running           */
+    int_T           hits[NUMST];        /* sample hits of the last tick  */
+    int_T           released[NUMST];    /* released, not yet started     */
+    int_T           skipped[NUMST];     /* hits dropped while it ran     */
+    int_T           late[NUMST];        /* still busy at a later step    */
+    int_T           running;            /* task being run, or -1         */
+    int_T           stop;
+    disconThread    thread;
+} SubRates = { DISCON_MUTEX_INITIALIZER, DISCON_COND_INITIALIZER,
+               DISCON_COND_INITIALIZER, { 0 }, { 0 }, { 0 }, { 0 }, -1, 0,
+               0 };
+
+/* Function: runSubRate ===================================================
+ *
+ * Abstract:
+ *      Run the outputs and update of sub-rate task i on the worker, with
+ *      its sample hit set, and keep their worst-case times.
+ */
+static void runSubRate(DISCON_Instance *inst, int_T i) {
+    RT_MODEL *S = inst->S;
+    int_T    *sampleHit = rtmGetSampleHitPtr(S);
+#if DISCON_PROFILE == 1
+    uint64_t start, mid, end;
+
+    start = disconClockNs();
+#endif
+    sampleHit[i] = 1;
+    MdlOutputs(i);
+#if DISCON_PROFILE == 1
+    mid = disconClockNs();
+#endif
+
+    rtExtModeUpload(i, rtmGetTaskTime(S,i));
+
+    MdlUpdate(i);
+    sampleHit[i] = 0;
+#if DISCON_PROFILE == 1
+    end = disconClockNs();
+    if ((double)(mid - start) > inst->wcetOutputsNs[i]) {
+        inst->wcetOutputsNs[i] = (double)(mid - start);
+    }
+    if ((double)(end - mid) > inst->wcetUpdateNs[i]) {
+        inst->wcetUpdateNs[i] = (double)(end - mid);
+    }
+#endif
+}  /* end runSubRate */
+
+/* Function: subRateWorker ================================================
+ *
+ * Abstract:
+ *      Run the released sub-rate tasks until asked to stop, then finish
+ *      those already released.
+ */
+static void subRateWorker(void *arg) {
+    DISCON_Instance *inst = (DISCON_Instance *)arg;
+    RT_MODEL        *S = inst->S;
+    int_T           i;
+
+    disconParamsSetCurrent(inst->params);
+    disconMutexLock(&SubRates.lock);
+    for (;;) {
+        for (i=FIRST_TID+1; i<NUMST && !SubRates.released[i]; i++);
+        if (i == NUMST) {
+            disconCondBroadcast(&SubRates.idle);
+            if (SubRates.stop) break;
+            disconCondWait(&SubRates.work, &SubRates.lock);
+            continue;
+        }
+        SubRates.released[i] = 0;
+        SubRates.running = i;
+        disconMutexUnlock(&SubRates.lock);
+
+        runSubRate(inst, i);
+
+        /* Indicate task complete for sample time "i" */
+        disconMutexLock(&SubRates.lock);
+        rt_SimUpdateDiscreteTaskTime(rtmGetTPtr(S),
+                                     rtmGetTimingData(S),i);
+        for (; SubRates.skipped[i] > 0; SubRates.skipped[i]--) {
+            rt_SimUpdateDiscreteTaskTime(rtmGetTPtr(S),
+                                         rtmGetTimingData(S),i);
+        }
+        SubRates.running = -1;
+        inst->GBLbuf.eventFlags[i]--;
+    }
+    disconMutexUnlock(&SubRates.lock);
+}  /* end subRateWorker */
+
+/* Function: startSubRates ================================================
+ *
+ * Abstract:
+ *      Start the sub-rate worker of a started model. Returns 0, or -1 with
+ *      errorMsg filled.
+ */
+static int startSubRates(DISCON_Instance *inst, char *errorMsg) {
+    (void)memset(SubRates.hits, 0, sizeof(SubRates.hits));
+    (void)memset(SubRates.released, 0, sizeof(SubRates.released));
+    (void)memset(SubRates.skipped, 0, sizeof(SubRates.skipped));
+    (void)memset(SubRates.late, 0, sizeof(SubRates.late));
+    SubRates.running = -1;
+    SubRates.stop    = 0;
+    if (disconThreadCreate(&SubRates.thread, subRateWorker, inst) != 0) {
+        sprintf(errorMsg, "Unable to start the sub-rate task thread");
+        return -1;
+    }
+    return 0;
+}  /* end startSubRates */
+
+/* Function: stopSubRates =================================================
+ *
+ * Abstract:
+ *      Let the worker finish the released tasks and join it.
+ */
+static void stopSubRates(void) {
+    disconMutexLock(&SubRates.lock);
+    SubRates.stop = 1;
+    disconCondBroadcast(&SubRates.work);
+    disconMutexUnlock(&SubRates.lock);
+    disconThreadJoin(SubRates.thread);
+}  /* end stopSubRates */
+
+/* Function: waitSubRates =================================================
+ *
+ * Abstract:
+ *      Wait until no sub-rate task is released or running, so that the
+ *      model data is consistent (snapshots).
+ */
+static void waitSubRates(void) {
+    int_T i, busy;
+
+    disconMutexLock(&SubRates.lock);
+    do {
+        busy = SubRates.running >= 0;
+        for (i=FIRST_TID+1; i<NUMST; i++) busy |= SubRates.released[i];
+        if (busy) disconCondWait(&SubRates.idle, &SubRates.lock);
+    } while (busy);
+    disconMutexUnlock(&SubRates.lock);
+}  /* end waitSubRates */
+#else
+# define waitSubRates() ((void)0)  /* Do nothing */
+#endif
+
+/* Function: stopModel ====================================================
+ *
+ * Abstract:
+ *      Terminate the model of an instance, freeing the data of reusable
+ *      code. Called with InstanceLock held.
+ */
+static void stopModel(DISCON_Instance *inst) {
+#if MULTI_INSTANCE_CODE == 1
+    MODEL_TERMINATE(inst->S);
+#else
+# if defined(MULTITASKING)
+    if (inst->subRatesStarted) stopSubRates();
+    inst->subRatesStarted = 0;
+# endif
+    MdlTerminate();
+#endif
+    inst->S = NULL;
+}  /* end stopModel */
+
+/* Function: recordWorkPointers ==========================================
+ *
+ * Abstract:
+ *      Keep the work vectors in the DWork that the parameter blocks pointed
+ *      at their entries while the first model started (slots, n of them)
+ *      as WorkPointers. Called with InstanceLock held.
+ */
+static void recordWorkPointers(DISCON_Instance *inst, void ***slots, int n) {
+#if MODEL_HAS_DWORK == 1
+    uintptr_t dw = (uintptr_t)MODEL_DW(inst->S);
+    int       i, k;
+
+    if (NumWorkPointers >= 0) return;
+    NumWorkPointers = 0;
+    for (i=0; i<n; i++) {
+        uintptr_t slot = (uintptr_t)slots[i];
+        size_t    offset;
+
+        if (slot < dw || slot - dw + sizeof(void *) > sizeof(*MODEL_DW(inst->S))) {
+            continue;                       /* not in the DWork */
+        }
+        offset = (size_t)(slot - dw);
+        for (k=NumWorkPointers; k>0 && WorkPointers[k-1] > offset; k--) {
+            WorkPointers[k] = WorkPointers[k-1];
+        }
+        WorkPointers[k] = offset;
+        NumWorkPointers++;
+    }
+#else
+    (void)inst;
+    (void)slots;
+    (void)n;
+#endif
+}  /* end recordWorkPointers */
+
+/* Function: startModel ===================================================
+ *
+ * Abstract:
+ *      Register and start the model of an instance: allocate (reusable code)
+ *      or reinitialize (classic interface) its data, set up the timing
+ *      engine and run the start and initial-condition functions. Called
+ *      with InstanceLock held and the parameter set of the instance
+ *      selected. Returns 0, or -1 with errorMsg filled and nothing left to
+ *      stop.
+ *
+ *      Reusable code copies the start template instead of initializing the
+ *      model when there is one for the parameter set of the instance, and
+ *      otherwise offers its initial state as the template.
+ */
+static int startModel(DISCON_Instance *inst, int_T first, char *errorMsg) {
+    RT_MODEL *S;
+    void     **work[DISCON_MAX_WORK_POINTERS];
+    int      nWork = 0;
+#if MULTI_INSTANCE_CODE != 1
+    const char *status;
+#endif
+
+    inst->fromTemplate = 0;
+    inst->S = S = MODEL();
+    if (S == NULL) {
+        sprintf(errorMsg, "Unable to allocate the model data");
+        return -1;
+    }
     if (rtmGetErrorStatus(S) != NULL) {
-        (void)fprintf(stderr,"Error during model registration: %s\n",
-                      rtmGetErrorStatus(S));
-        exit(EXIT_FAILURE);
+        sprintf(errorMsg, "Error during model registration: %.200s",
+                rtmGetErrorStatus(S));
+#if MULTI_INSTANCE_CODE == 1
+        MODEL_TERMINATE(S);
+#endif
+        inst->S = NULL;
+        return -1;
+    }
+
+#if MULTI_INSTANCE_CODE == 1
+    if (copyStartTemplate(inst) == 0) {
+        rtmSetTFinal(S,RUN_FOREVER);
+        return 0;
     }
+    disconParamsRecordWork(work, DISCON_MAX_WORK_POINTERS, &nWork);
+    MODEL_INITIALIZE(S);
+    disconParamsRecordWork(NULL, 0, NULL);
+    rtmSetTFinal(S,RUN_FOREVER);
+#else
     rtmSetTFinal(S,RUN_FOREVER);
 
     MdlInitializeSizes();
@@ -219,129 +981,806 @@ int initiateController(char *errorMsg) {
                                     &rtmGetTimingData(S));
 
     if (status != NULL) {
-        (void)fprintf(stderr,
-                "Failed to initialize sample time engine: %s\n", status);
-        exit(EXIT_FAILURE);
+        sprintf(errorMsg, "Failed to initialize sample time engine: %.200s",
+                status);
+        inst->S = NULL;
+        return -1;
     }
     rt_CreateIntegrationData(S);
 
-#ifdef UseMMIDataLogging
-    rt_FillStateSigInfoFromMMI(rtmGetRTWLogInfo(S),&rtmGetErrorStatus(S));
-#endif
-    GBLbuf.errmsg = rt_StartDataLogging(rtmGetRTWLogInfo(S),
-                                        rtmGetTFinal(S),
-                                        rtmGetStepSize(S),
-                                        &rtmGetErrorStatus(S));
-    if (GBLbuf.errmsg != NULL) {
-        (void)fprintf(stderr,"Error starting data logging: %s\n",GBLbuf.errmsg);
-        return(EXIT_FAILURE);
-    }
-
-    rtExtModeCheckInit(rtmGetNumSampleTimes(S));
-    rtExtModeWaitForStartPkt(rtmGetRTWExtModeInfo(S),
-                             rtmGetNumSampleTimes(S),
-                             (boolean_T *)&rtmGetStopRequested(S));
+    if (first) {
+        rtExtModeCheckInit(rtmGetNumSampleTimes(S));
+        rtExtModeWaitForStartPkt(rtmGetRTWExtModeInfo(S),
+                                 rtmGetNumSampleTimes(S),
+                                 (boolean_T *)&rtmGetStopRequested(S));
 
-    (void)printf("\n** Starting the controller **\n");
+        (void)printf("\n** Starting the controller **\n");
+    }
 
+    disconParamsRecordWork(work, DISCON_MAX_WORK_POINTERS, &nWork);
     MdlStart();
+    disconParamsRecordWork(NULL, 0, NULL);
+#endif
+    recordWorkPointers(inst, work, nWork);
     if (rtmGetErrorStatus(S) != NULL) {
-      GBLbuf.stopExecutionFlag = 1;
+        sprintf(errorMsg, "Error during model start: %.200s",
+                rtmGetErrorStatus(S));
+        stopModel(inst);
+        return -1;
     }
-    
-    return 0;
-}  /* end initiateController */
-
-#if !defined(MULTITASKING)  /* SINGLETASKING */
-int calcOutputController(float rUserVar1, float rUserVar2, float rUserVar3, float rUserVar4, float rUserVar5,float rUserVar6, float rUserVar7, float rUserVar8, float rUserVar9, float rUserVar10,
-						 float rUserVar11,float rUserVar12,float rUserVar13,float rUserVar14,float rUserVar15,float rUserVar16,float rUserVar17,float rUserVar18,float rUserVar19,float rUserVar20,
-		float rInit, float rGeneratorSpeed, float rRatedSpeed,
-        float rBelowRatedPitch, float rForeAftTower, float rSideTower,
-        float rRotorAzimuth, float rOP1RootMoment, float rOP2RootMoment,
-        float rOP3RootMoment,float rIP1RootMoment, float rIP2RootMoment,
-        float rIP3RootMoment, float rMeasuredPitch, float rMeasuredTorque, float rShaftTorque,
-        float rModeGain, float rYawError, float rYawBearingRate, float rElectricalPower, float *rTorqueDemand, float *rBlade1Pitch, 
-        float *rBlade2Pitch, float *rBlade3Pitch, float *rPitchDemand, char *errorMsg, float* rYawRate,
-        float* rLog1, float* rLog2,  float* rLog3,  float* rLog4,  float* rLog5,  float* rLog6,  float* rLog7,  float* rLog8,  float* rLog9,  float* rLog10,
-		float* rLog11, float* rLog12,  float* rLog13,  float* rLog14,  float* rLog15,  float* rLog16,  float* rLog17,  float* rLog18,  float* rLog19,  float* rLog20) {
-    real_T tnext;
-    
-    SIG_MODEL(U,Generator_Speed) = rGeneratorSpeed;
-    SIG_MODEL(U,Rated_Speed) = rRatedSpeed;
-    SIG_MODEL(U,Below_Rated_Pitch_Angle) = rBelowRatedPitch;
-    SIG_MODEL(U,Fore_Aft_Tower_Accel) = rForeAftTower;
-    SIG_MODEL(U,Sidewards_Tower_Accel) = rSideTower;
-    SIG_MODEL(U,Measured_Pitch) = rMeasuredPitch;
-    SIG_MODEL(U,Measured_Torque) = rMeasuredTorque;
-	SIG_MODEL(U,Shaft_Torque) = rShaftTorque;
-    SIG_MODEL(U,Mode_Gain) = rModeGain;
-    SIG_MODEL(U,Rotor_Azimuth_Angle) = rRotorAzimuth;
-    SIG_MODEL(U,Blade1_OP_Root_Moment) = rOP1RootMoment;
-    SIG_MODEL(U,Blade2_OP_Root_Moment) = rOP2RootMoment;
-    SIG_MODEL(U,Blade3_OP_Root_Moment) = rOP3RootMoment;
-    SIG_MODEL(U,Blade1_IP_Root_Moment) = rIP1RootMoment;
-    SIG_MODEL(U,Blade2_IP_Root_Moment) = rIP2RootMoment;
-    SIG_MODEL(U,Blade3_IP_Root_Moment) = rIP3RootMoment;
-	
-	SIG_MODEL(U,Init) = rInit;
-	SIG_MODEL(U,userVar1) = rUserVar1;
-	SIG_MODEL(U,userVar2) = rUserVar2;
-	SIG_MODEL(U,userVar3) = rUserVar3;
-	SIG_MODEL(U,userVar4) = rUserVar4;
-	SIG_MODEL(U,userVar5) = rUserVar5;
-	SIG_MODEL(U,userVar6) = rUserVar6;
-	SIG_MODEL(U,userVar7) = rUserVar7;
-	SIG_MODEL(U,userVar8) = rUserVar8;
-	SIG_MODEL(U,userVar9) = rUserVar9;
-	SIG_MODEL(U,userVar10) = rUserVar10;
-	SIG_MODEL(U,userVar11) = rUserVar11;
-	SIG_MODEL(U,userVar12) = rUserVar12;
-	SIG_MODEL(U,userVar13) = rUserVar13;
-	SIG_MODEL(U,userVar14) = rUserVar14;
-	SIG_MODEL(U,userVar15) = rUserVar15;
-	SIG_MODEL(U,userVar16) = rUserVar16;
-	SIG_MODEL(U,userVar17) = rUserVar17;
-	SIG_MODEL(U,userVar18) = rUserVar18;
-	SIG_MODEL(U,userVar19) = rUserVar19;
-	SIG_MODEL(U,userVar20) = rUserVar20;
-	SIG_MODEL(U,YawError) = rYawError;
-	SIG_MODEL(U,YawBearingRate) = rYawBearingRate;
-	SIG_MODEL(U,ElectricalPower) = rElectricalPower;
-	/***********************************************
-     * Check and see if base step time is too fast *
-     ***********************************************/
-    if (GBLbuf.isrOverrun++) {
-        GBLbuf.stopExecutionFlag = 1;
-        return;
+#if defined(MULTITASKING)
+    if (startSubRates(inst, errorMsg) != 0) {
+        stopModel(inst);
+        return -1;
     }
+    inst->subRatesStarted = 1;
+#endif
+    keepStartTemplate(inst);
+    return 0;
+}  /* end startModel */
 
-    /***********************************************
-     * Check and see if error status has been set  *
-     ***********************************************/
-    if (rtmGetErrorStatus(S) != NULL) {
-        GBLbuf.stopExecutionFlag = 1;
-        return;
-    }
-    
-    /* enable interrupts here */
-    
-    
-    tnext = rt_SimGetNextSampleHit();
-    rtsiSetSolverStopTime(rtmGetRTWSolverInfo(S),tnext);
+#if DISCON_LOG == 1
+/* Function: openInstanceLog ==============================================
+ *
+ * Abstract:
+ *      Create (or truncate) the streaming log of an instance,
+ *      $DISCON_LOG_FILE or DISCON_LOG_FILE, unless $DISCON_LOG is 0: then
+ *      the instance has no log, and neither its buffers nor its writer
+ *      thread are allocated.
+ */
+static int openInstanceLog(DISCON_Instance *inst, char *errorMsg) {
+    const char *name = getenv("DISCON_LOG_FILE");
+    const char *enable = getenv("DISCON_LOG");
+    char       path[260];
+
+    if (enable != NULL && strcmp(enable, "0") == 0) return 0;
+    if (name == NULL || name[0] == '\0') name = DISCON_LOG_FILE;
+    instanceFileName(inst, name, path);
+    inst->log = openStreamLog(path, rtmGetStepSize(inst->S), errorMsg);
+    return inst->log != NULL ? 0 : -1;
+}  /* end openInstanceLog */
+#else
+# define openInstanceLog(inst, errorMsg) 0
+#endif
 
-    MdlOutputs(0);
+#if DISCON_CAPTURE == 1
+/* Function: openInstanceCapture ==========================================
+ *
+ * Abstract:
+ *      Start capturing the calls of an instance when $DISCON_CAPTURE_FILE
+ *      is set.
+ */
+static int openInstanceCapture(DISCON_Instance *inst, char *errorMsg) {
+    const char *name = getenv("DISCON_CAPTURE_FILE");
+    char       path[260];
 
-    rtExtModeSingleTaskUpload(S);
+    if (name == NULL || name[0] == '\0') return 0;
+    instanceFileName(inst, name, path);
+    inst->capture = openCapture(path, rtmGetStepSize(inst->S), errorMsg);
+    return inst->capture != NULL ? 0 : -1;
+}  /* end openInstanceCapture */
 
-    GBLbuf.errmsg = rt_UpdateTXYLogVars(rtmGetRTWLogInfo(S),
-                                        rtmGetTPtr(S));
-    if (GBLbuf.errmsg != NULL) {
-        GBLbuf.stopExecutionFlag = 1;
-        return;
+/* Function: closeInstanceCapture =========================================
+ *
+ * Abstract:
+ *      Write the rest of the trace of an instance and close it.
+ */
+static void closeInstanceCapture(DISCON_Instance *inst) {
+    if (disconCaptureClose(inst->capture) != 0) {
+        (void)fprintf(stderr, "%s: the trace file is incomplete\n", QUOTE(MODEL));
     }
+    inst->capture = NULL;
+}  /* end closeInstanceCapture */
+#else
+# define openInstanceCapture(inst, errorMsg) 0
+# define closeInstanceCapture(inst)          /* Do nothing */
+#endif
 
-    MdlUpdate(0);
-    rt_SimUpdateDiscreteTaskSampleHits(rtmGetNumSampleTimes(S),
+#if DISCON_TELEMETRY == 1
+/* Function: openInstanceTelemetry ========================================
+ *
+ * Abstract:
+ *      Start streaming the signals of an instance when $DISCON_TELEMETRY
+ *      names a receiver. Telemetry is for watching only: a stream that
+ *      cannot be opened is reported on stderr and the controller runs
+ *      without it.
+ */
+static void openInstanceTelemetry(DISCON_Instance *inst) {
+    const char *target = getenv("DISCON_TELEMETRY");
+    char       msg[257];
+
+    if (target == NULL || target[0] == '\0') return;
+    inst->telemetry = openTelemetry(target, (int)(inst - Instances) + 1,
+                                    rtmGetStepSize(inst->S), msg);
+    if (inst->telemetry == NULL) {
+        (void)fprintf(stderr, "%s: %s; running without telemetry\n", QUOTE(MODEL), msg);
+    }
+}  /* end openInstanceTelemetry */
+
+/* Function: closeInstanceTelemetry =======================================
+ *
+ * Abstract:
+ *      End the telemetry stream of an instance and tell how much of it was
+ *      dropped.
+ */
+static void closeInstanceTelemetry(DISCON_Instance *inst) {
+    uint32_t dropped = disconTelemetryClose(inst->telemetry);
+
+    if (dropped > 0) {
+        (void)fprintf(stderr, "%s: telemetry dropped %lu records\n", QUOTE(MODEL),
+                      (unsigned long)dropped);
+    }
+    inst->telemetry = NULL;
+}  /* end closeInstanceTelemetry */
+#else
+# define openInstanceTelemetry(inst)  /* Do nothing */
+# define closeInstanceTelemetry(inst) /* Do nothing */
+#endif
+
+/* Function: initiateController ===========================================
+ *
+ * Abstract:
+ *      Initialize the controller of the compiled Matlab Simulink block.
+ *      The time it takes is kept for DISCON_GetStartup.
+ */
+DISCON_Instance *initiateController(char *errorMsg) {
+    DISCON_Instance *inst;
+    disconParamSet  *params;
+    uint64_t        start = disconClockNs();
+
+    /* Parsed once per process, unless the file changes */
+    if (disconParamsAcquire(disconParamsPath(), &params, errorMsg) != 0) {
+        return NULL;
+    }
+
+    disconMutexLock(&InstanceLock);
+    inst = allocInstance();
+    if (inst == NULL) {
+        disconMutexUnlock(&InstanceLock);
+        disconParamsRelease(params);
+        sprintf(errorMsg, "No free controller instance (maximum is %d)",
+                DISCON_MAX_INSTANCES);
+        return NULL;
+    }
+    inst->params = params;
+    disconParamsSetCurrent(params);     /* for the model's start functions */
+    initLogChannels();
+
+    /************************
+     * Initialize the model *
+     ************************/
+
+    if (startModel(inst, 1, errorMsg) != 0) {
+        releaseInstance(inst);
+        disconMutexUnlock(&InstanceLock);
+        return NULL;
+    }
+    disconMutexUnlock(&InstanceLock);
+
+    clearBudget(inst);
+#if DISCON_PROFILE == 1
+    inst->deadlineNs = (uint64_t)(rtmGetStepSize(inst->S)*1e9);
+    inst->latency = (disconHist *)malloc(sizeof(disconHist));
+    if (inst->latency == NULL) {
+        char msg[257];
+
+        sprintf(errorMsg, "Unable to allocate the timing statistics");
+        (void)performCleanup(inst, msg);
+        return NULL;
+    }
+    disconHistReset(inst->latency);
+#endif
+
+    if (openInstanceLog(inst, errorMsg) != 0 ||
+        openInstanceCapture(inst, errorMsg) != 0) {
+        char msg[257];
+
+        (void)performCleanup(inst, msg);
+        return NULL;
+    }
+    openInstanceTelemetry(inst);
+    inst->startNs = disconClockNs() - start;
+    
+    return inst;
+}  /* end initiateController */
+
+/*
+ * Model root I/O. Every port listed in discon_io.h is a ModelSignal member
+ * of the external input/output structure: real_T, or real32_T in a
+ * DISCON_SINGLE build. The tables below pair the member
+ * offset with the avrSwap location of the port, so that data moves
+ * between avrSwap (or a struct-of-arrays buffer) and the model in one
+ * loop, without intermediate copies. The tables with a {0, -1} sentinel
+ * may otherwise be empty for some models.
+ */
+#define MODEL_EXTU CONCAT(ExtU_,CONCAT(MODEL,_T))
+#define MODEL_EXTY CONCAT(ExtY_,CONCAT(MODEL,_T))
+
+#if DISCON_SINGLE == 1
+typedef real32_T ModelSignal;
+#else
+typedef real_T   ModelSignal;
+#endif
+
+/*
+ * A scalar port of another type than ModelSignal, i.e. a model built in
+ * the other precision, stops the compilation at the array of its name.
+ */
+#define DISCON_IO_CHECK_U(name, i) typedef char CONCAT(ModelSignal_,name) \
+    [sizeof(((MODEL_EXTU *)0)->name) == sizeof(ModelSignal) ? 1 : -1];
+#define DISCON_IO_CHECK_Y(name, i) typedef char CONCAT(ModelSignal_,name) \
+    [sizeof(((MODEL_EXTY *)0)->name) == sizeof(ModelSignal) ? 1 : -1];
+#define DISCON_IO_SKIP(name, i)
+
+DISCON_INPUTS(DISCON_IO_CHECK_U)
+DISCON_OUTPUTS(DISCON_IO_CHECK_Y, DISCON_IO_SKIP)
+
+typedef struct {
+    size_t offset;    /* member offset in the model input/output structure */
+    int_T  swap;      /* avrSwap index, or logging channel                 */
+} IOMap;
+
+typedef struct {
+    int_T  swap;
+    float  value;
+} IOConstant;
+
+#define DISCON_IO_MAP_U(name, i)   { offsetof(MODEL_EXTU, name), i },
+#define DISCON_IO_MAP_Y(name, i)   { offsetof(MODEL_EXTY, name), i },
+#define DISCON_IO_MAP_LOG(name, u) { offsetof(MODEL_EXTY, name), -1 },
+#define DISCON_IO_CONST(i, value)  { i, value },
+
+#define NUM_MAPPED(table) ((int_T)(sizeof(table)/sizeof((table)[0])) - 1)
+
+/* All ports, indexed by signal number */
+static const IOMap InputMap[DISCON_NUM_INPUTS] = {
+    DISCON_INPUTS(DISCON_IO_MAP_U)
+};
+static const IOMap OutputMap[DISCON_NUM_OUTPUTS] = {
+    DISCON_OUTPUTS(DISCON_IO_MAP_Y, DISCON_IO_MAP_LOG)
+};
+
+/* Outports returned in avrSwap (the logging outports are below) */
+static const IOMap SwapOutputs[] = {
+    DISCON_OUTPUTS(DISCON_IO_MAP_Y, DISCON_IO_SKIP) { 0, -1 }
+};
+
+#if DISCON_LOG == 1 || DISCON_TELEMETRY == 1
+/* Port names for the streaming log and telemetry */
+#define DISCON_IO_NAME(name, i)    #name,
+
+static const char *const InputNames[] = {
+    DISCON_INPUTS(DISCON_IO_NAME) NULL
+};
+static const char *const SwapOutputNames[] = {
+    DISCON_OUTPUTS(DISCON_IO_NAME, DISCON_IO_SKIP) NULL
+};
+#endif
+static const IOConstant SwapConstants[] = {
+    DISCON_SWAP_CONSTANTS(DISCON_IO_CONST) { -1, 0 }
+};
+
+/*
+ * Logging channels are the elements of the logging outports (LOG entries),
+ * scalar or vector, in the order of discon_io.h (LogN by N, then Log_<name>
+ * in port order). initLogChannels merges outports that
+ * are adjacent in the model outputs into runs, normally a single one, and
+ * builds the OUTNAME string "name:unit;..." once for all calls. A vector
+ * outport Foo of width n gives the channels Foo_1 .. Foo_n.
+ */
+typedef struct {
+    size_t     offset;    /* first element in the model output structure */
+    int_T      width;     /* number of elements                          */
+    const char *name;
+    const char *unit;
+} LogPort;
+
+#define LOG_WIDTH(name) ((int_T)(sizeof(((MODEL_EXTY *)0)->name)/sizeof(ModelSignal)))
+#define DISCON_IO_LOG_PORT(name, unit)  { offsetof(MODEL_EXTY, name), \
+                                          LOG_WIDTH(name), #name, unit },
+#define DISCON_IO_LOG_COUNT(name, unit) + LOG_WIDTH(name)
+#define DISCON_IO_LOG_CHARS(name, unit) \
+    + LOG_WIDTH(name)*(int_T)(sizeof(#name) + sizeof(unit) + 12)
+
+static const LogPort LogPorts[] = {
+    DISCON_OUTPUTS(DISCON_IO_SKIP, DISCON_IO_LOG_PORT) { 0, 0, NULL, NULL }
+};
+
+/*
+ * Reserved logging channels after those of the model: the call timing of
+ * a DISCON_PROFILE build and the budget statistics of a DISCON_BUDGET
+ * build, each reporting the calls before the current one.
+ */
+#if DISCON_PROFILE == 1
+# define DISCON_TIMING_CHANNELS(CH) \
+    CH(DISCON_Call_ns,          "ns")  /* duration of the last call      */ \
+    CH(DISCON_WCET_ns,          "ns")  /* longest call                   */ \
+    CH(DISCON_Deadline_Misses,  "-")   /* calls longer than the step     */
+#else
+# define DISCON_TIMING_CHANNELS(CH)
+#endif
+#if DISCON_BUDGET == 1
+# define DISCON_BUDGET_CHANNELS(CH) \
+    CH(DISCON_Over_Budget,      "-")   /* steps over the budget          */ \
+    CH(DISCON_Skipped,          "-")   /* log rows and sub-rate hits     */
+#else
+# define DISCON_BUDGET_CHANNELS(CH)
+#endif
+#define DISCON_TIMING_NAME(name, unit)  { 0, 1, #name, unit },
+#define DISCON_TIMING_CHARS(name, unit) + (int_T)(sizeof(#name) + sizeof(unit) + 1)
+
+static const LogPort TimingChannels[] = {
+    DISCON_TIMING_CHANNELS(DISCON_TIMING_NAME)
+    DISCON_BUDGET_CHANNELS(DISCON_TIMING_NAME) { 0, 0, NULL, NULL }
+};
+
+enum {
+    NUM_MODEL_LOG_CHANNELS = 0 DISCON_OUTPUTS(DISCON_IO_SKIP, DISCON_IO_LOG_COUNT),
+    NUM_LOG_CHANNELS = NUM_MODEL_LOG_CHANNELS + NUM_MAPPED(TimingChannels),
+    LOG_NAMES_SIZE   = 1 DISCON_OUTPUTS(DISCON_IO_SKIP, DISCON_IO_LOG_CHARS)
+                         DISCON_TIMING_CHANNELS(DISCON_TIMING_CHARS)
+                         DISCON_BUDGET_CHANNELS(DISCON_TIMING_CHARS)
+};
+
+/* Channels of the streaming log and telemetry: inputs, outputs, logging */
+#define NUM_STREAM_CHANNELS (DISCON_NUM_INPUTS + NUM_MAPPED(SwapOutputs) + \
+                             NUM_LOG_CHANNELS)
+
+static struct {
+    int_T  ready;
+    int_T  nRuns;
+    struct {
+        size_t offset;    /* first element in the model output structure */
+        int_T  first;     /* first channel                               */
+        int_T  width;
+    } runs[NUM_MAPPED(LogPorts) + 1];
+    int_T  nameEnd[NUM_LOG_CHANNELS + 1];  /* length of outName through channel k */
+    char   outName[LOG_NAMES_SIZE];        /* "name:unit;" of every channel      */
+#if DISCON_LOG == 1 || DISCON_TELEMETRY == 1
+    char   names[LOG_NAMES_SIZE];          /* NUL terminated channel names       */
+    int_T  namesLen;
+    const char *streamNames[NUM_STREAM_CHANNELS];
+#endif
+} LogChannels;
+
+/* Function: addLogName ===================================================
+ *
+ * Abstract:
+ *      Append the name of logging channel n, "name" or, for element index
+ *      of a vector port, "name_index", to OUTNAME and the stream log names.
+ */
+static void addLogName(int_T n, const char *name, int_T index, const char *unit) {
+    int_T len   = n > 0 ? LogChannels.nameEnd[n-1] : 0;
+    char  *dest = LogChannels.outName + len;
+
+    if (index > 0) {
+        len += sprintf(dest, "%s_%d", name, (int)index);
+    } else {
+        len += sprintf(dest, "%s", name);
+    }
+#if DISCON_LOG == 1 || DISCON_TELEMETRY == 1
+    LogChannels.streamNames[DISCON_NUM_INPUTS + NUM_MAPPED(SwapOutputs) + n] =
+        LogChannels.names + LogChannels.namesLen;
+    (void)memcpy(LogChannels.names + LogChannels.namesLen, dest, strlen(dest)+1);
+    LogChannels.namesLen += (int_T)strlen(dest)+1;
+#endif
+    len += sprintf(LogChannels.outName + len, ":%s;", unit);
+    LogChannels.nameEnd[n] = len;
+}  /* end addLogName */
+
+/* Function: initLogChannels ==============================================
+ *
+ * Abstract:
+ *      Discover the logging channels of the model and build their names.
+ *      Runs once per process, with InstanceLock held.
+ */
+static void initLogChannels(void) {
+    int_T k, i, n = 0;
+
+    if (LogChannels.ready) return;
+#if DISCON_LOG == 1 || DISCON_TELEMETRY == 1
+    for (k=0; k<DISCON_NUM_INPUTS; k++) {
+        LogChannels.streamNames[k] = InputNames[k];
+    }
+    for (k=0; k<NUM_MAPPED(SwapOutputs); k++) {
+        LogChannels.streamNames[DISCON_NUM_INPUTS + k] = SwapOutputNames[k];
+    }
+#endif
+    for (k=0; k<NUM_MAPPED(LogPorts); k++) {
+        const LogPort *port = &LogPorts[k];
+        int_T         r     = LogChannels.nRuns - 1;
+
+        if (r >= 0 && LogChannels.runs[r].offset +
+            LogChannels.runs[r].width*sizeof(ModelSignal) == port->offset) {
+            LogChannels.runs[r].width += port->width;
+        } else {
+            r = LogChannels.nRuns++;
+            LogChannels.runs[r].offset = port->offset;
+            LogChannels.runs[r].first  = n;
+            LogChannels.runs[r].width  = port->width;
+        }
+        for (i=0; i<port->width; i++, n++) {
+            addLogName(n, port->name, port->width > 1 ? i+1 : 0, port->unit);
+        }
+    }
+    for (k=0; k<NUM_MAPPED(TimingChannels); k++, n++) {
+        addLogName(n, TimingChannels[k].name, 0, TimingChannels[k].unit);
+    }
+    LogChannels.ready = 1;
+}  /* end initLogChannels */
+
+/* Function: numLogChannels ===============================================
+ *
+ * Abstract:
+ *      Number of logging channels returned to the host: all of them, unless
+ *      avrSwap limits the number of values (avrSwap[63]) or the length of
+ *      OUTNAME (avrSwap[50]), or has no logging record (avrSwap[62]).
+ */
+static int_T numLogChannels(const float *avrSwap) {
+    int_T n        = MIN(NUM_LOG_CHANNELS, NINT(avrSwap[63]));
+    int_T maxChars = NINT(avrSwap[50]) - 1;     /* room for the NUL */
+
+    if (!LogChannels.ready || NINT(avrSwap[62]) < 1) return 0;
+    while (n > 0 && LogChannels.nameEnd[n-1] > maxChars) n--;
+    return n;
+}  /* end numLogChannels */
+
+/* Function: storeLogChannels =============================================
+ *
+ * Abstract:
+ *      Copy the first n logging channels to y[k*stride], one loop per run
+ *      of adjacent logging outports, followed by the timing channels.
+ */
+static void storeLogChannels(const DISCON_Instance *inst, float *y, size_t stride,
+                             int_T n) {
+    const char_T *Y = (const char_T *)MODEL_Y(inst->S);
+    int_T        r, i;
+
+    for (r=0; r<LogChannels.nRuns && LogChannels.runs[r].first < n; r++) {
+        const ModelSignal *src  = (const ModelSignal *)(Y + LogChannels.runs[r].offset);
+        float             *dst  = y + LogChannels.runs[r].first*stride;
+        int_T             width = MIN(LogChannels.runs[r].width,
+                                      n - LogChannels.runs[r].first);
+
+        for (i=0; i<width; i++) {
+            dst[i*stride] = (float)src[i];
+        }
+    }
+#if DISCON_PROFILE == 1 || DISCON_BUDGET == 1
+    if (n > NUM_MODEL_LOG_CHANNELS) {
+        float timing[NUM_MAPPED(TimingChannels)];
+        int_T m = 0;
+
+# if DISCON_PROFILE == 1
+        timing[m++] = (float)inst->lastCallNs;
+        timing[m++] = (float)inst->latency->max;
+        timing[m++] = (float)inst->deadlineMisses;
+# endif
+# if DISCON_BUDGET == 1
+        timing[m++] = (float)inst->overBudget;
+        timing[m++] = (float)budgetSkips(inst);
+# endif
+        for (i=NUM_MODEL_LOG_CHANNELS; i<n; i++) {
+            y[i*stride] = timing[i - NUM_MODEL_LOG_CHANNELS];
+        }
+    }
+#endif
+}  /* end storeLogChannels */
+
+/* Function: loadInputs ===================================================
+ *
+ * Abstract:
+ *      Copy one input vector into the model inputs. Input k is read from
+ *      u[k*stride], so the same loop serves a packed vector (stride 1) and
+ *      one row of a struct-of-arrays buffer.
+ */
+static void loadInputs(RT_MODEL *S, const float *u, size_t stride) {
+    char_T *U = (char_T *)MODEL_U(S);
+    int_T  k;
+
+    for (k=0; k<DISCON_NUM_INPUTS; k++) {
+        *(ModelSignal *)(U + InputMap[k].offset) = u[k*stride];
+    }
+}  /* end loadInputs */
+
+/* Function: storeOutputs =================================================
+ *
+ * Abstract:
+ *      Copy the model outputs to y[k*stride], see loadInputs.
+ */
+static void storeOutputs(RT_MODEL *S, float *y, size_t stride) {
+    const char_T *Y = (const char_T *)MODEL_Y(S);
+    int_T        k;
+
+    for (k=0; k<DISCON_NUM_OUTPUTS; k++) {
+        y[k*stride] = (float)*(const ModelSignal *)(Y + OutputMap[k].offset);
+    }
+}  /* end storeOutputs */
+
+/* Function: loadSwapInputs ===============================================
+ *
+ * Abstract:
+ *      Gather the model inputs straight from avrSwap.
+ */
+static void loadSwapInputs(RT_MODEL *S, const float *avrSwap) {
+    char_T *U = (char_T *)MODEL_U(S);
+    int_T  k;
+
+    for (k=0; k<DISCON_NUM_INPUTS; k++) {
+        *(ModelSignal *)(U + InputMap[k].offset) = avrSwap[InputMap[k].swap];
+    }
+}  /* end loadSwapInputs */
+
+/* Function: storeSwapOutputs =============================================
+ *
+ * Abstract:
+ *      Scatter the model outputs straight into avrSwap, and the logging
+ *      channels into avrSwap[iFirstLog] on.
+ */
+static void storeSwapOutputs(const DISCON_Instance *inst, float *avrSwap) {
+    const char_T *Y = (const char_T *)MODEL_Y(inst->S);
+    int_T        k;
+
+    for (k=0; k<NUM_MAPPED(SwapOutputs); k++) {
+        avrSwap[SwapOutputs[k].swap] =
+            (float)*(const ModelSignal *)(Y + SwapOutputs[k].offset);
+    }
+    storeLogChannels(inst, avrSwap + NINT(avrSwap[62])-1, 1,
+                     numLogChannels(avrSwap));
+}  /* end storeSwapOutputs */
+
+#if DISCON_LOG == 1 || DISCON_TELEMETRY == 1
+/* Function: storeInputs ==================================================
+ *
+ * Abstract:
+ *      Copy the model inputs to u[k*stride], the reverse of loadInputs.
+ */
+static void storeInputs(RT_MODEL *S, float *u, size_t stride) {
+    const char_T *U = (const char_T *)MODEL_U(S);
+    int_T        k;
+
+    for (k=0; k<DISCON_NUM_INPUTS; k++) {
+        u[k*stride] = (float)*(const ModelSignal *)(U + InputMap[k].offset);
+    }
+}  /* end storeInputs */
+
+/* Function: storeStreamRow ===============================================
+ *
+ * Abstract:
+ *      Copy the stream channels of a step to row[k*stride]: the inputs, the
+ *      outputs returned in avrSwap and the logging channels.
+ */
+static void storeStreamRow(const DISCON_Instance *inst, float *row, size_t stride) {
+    const char_T *Y = (const char_T *)MODEL_Y(inst->S);
+    int_T        k;
+
+    storeInputs(inst->S, row, stride);
+    row += DISCON_NUM_INPUTS*stride;
+    for (k=0; k<NUM_MAPPED(SwapOutputs); k++) {
+        row[k*stride] = (float)*(const ModelSignal *)(Y + SwapOutputs[k].offset);
+    }
+    row += NUM_MAPPED(SwapOutputs)*stride;
+    storeLogChannels(inst, row, stride, NUM_LOG_CHANNELS);
+}  /* end storeStreamRow */
+#endif
+
+#if DISCON_LOG == 1
+/* Function: logStep ======================================================
+ *
+ * Abstract:
+ *      Append the inputs and outputs of the step at time t to the log of
+ *      the instance. The row is written straight into the columns of the
+ *      ring buffer; the file is written by the log's background thread.
+ *      A step over its budget is not logged.
+ */
+static void logStep(DISCON_Instance *inst, real_T t) {
+    float  *row;
+    size_t stride;
+
+    if (inst->log == NULL) return;
+#if DISCON_BUDGET == 1
+    if (OVER_BUDGET(inst)) {
+        inst->skippedLog++;
+        return;
+    }
+#endif
+    row = disconLogRow(inst->log, t, &stride);
+    if (row != NULL) {
+        storeStreamRow(inst, row, stride);
+    }
+}  /* end logStep */
+
+/* Function: openStreamLog ================================================
+ *
+ * Abstract:
+ *      Open the streaming log of an instance. Its channels are the model
+ *      inputs, the outputs returned in avrSwap and the logging channels.
+ */
+static disconLog *openStreamLog(const char *path, double stepSize, char *errorMsg) {
+    return disconLogOpen(path, NUM_STREAM_CHANNELS, LogChannels.streamNames,
+                         stepSize, errorMsg);
+}  /* end openStreamLog */
+#else
+# define logStep(inst, t) ((void)(t))  /* Do nothing */
+#endif
+
+#if DISCON_TELEMETRY == 1
+/* Function: telemetryStep ================================================
+ *
+ * Abstract:
+ *      Queue the step at time t for the telemetry sender, when it is due
+ *      and the ring has room. The channels are gathered on the stack and
+ *      the selected ones copied to the ring; nothing here waits.
+ */
+static void telemetryStep(DISCON_Instance *inst, real_T t) {
+    float row[NUM_STREAM_CHANNELS];
+
+    if (inst->telemetry == NULL || !disconTelemetryDue(inst->telemetry)) return;
+    storeStreamRow(inst, row, 1);
+    disconTelemetryPut(inst->telemetry, t, row);
+}  /* end telemetryStep */
+
+/* Function: openTelemetry ================================================
+ *
+ * Abstract:
+ *      Open the telemetry stream of an instance over the channels of the
+ *      streaming log: those of $DISCON_TELEMETRY_SIGNALS (all by default),
+ *      every $DISCON_TELEMETRY_DECIMATION-th step.
+ */
+static disconTelemetry *openTelemetry(const char *target, int instance, double stepSize,
+                                      char *errorMsg) {
+    const char *decimation = getenv("DISCON_TELEMETRY_DECIMATION");
+
+    return disconTelemetryOpen(target, NUM_STREAM_CHANNELS, LogChannels.streamNames,
+                               getenv("DISCON_TELEMETRY_SIGNALS"),
+                               decimation != NULL ? atoi(decimation) : 1,
+                               instance, stepSize, errorMsg);
+}  /* end openTelemetry */
+#else
+# define telemetryStep(inst, t) ((void)(t))  /* Do nothing */
+#endif
+
+#if DISCON_CAPTURE == 1
+/*
+ * A captured call is the avrSwap array up to the last record the
+ * controller reads or writes, followed by its outputs in the layout of
+ * discon_trace.h: aviFail, avrSwap[41..47], avrSwap[64] and the logging
+ * channels.
+ */
+#define CAPTURE_FIRST_DEMAND 41
+#define CAPTURE_NUM_DEMANDS  7
+#define CAPTURE_NUM_OUTPUTS  (DISCON_TRACE_OUT_LOG + NUM_LOG_CHANNELS)
+
+static int_T CaptureSwap;           /* avrSwap records per call */
+
+/* Function: openCapture ==================================================
+ *
+ * Abstract:
+ *      Open the avrSwap trace of an instance, after finding the highest
+ *      avrSwap record in the port tables, the user variables of SetParams
+ *      (avrSwap[119..138]) and the logging records.
+ */
+static disconCapture *openCapture(const char *path, double stepSize, char *errorMsg) {
+    int_T k, last = 138;
+
+    for (k=0; k<DISCON_NUM_INPUTS; k++) {
+        last = MAX(last, InputMap[k].swap);
+    }
+    for (k=0; k<NUM_MAPPED(SwapOutputs); k++) {
+        last = MAX(last, SwapOutputs[k].swap);
+    }
+    for (k=0; k<NUM_MAPPED(SwapConstants); k++) {
+        last = MAX(last, SwapConstants[k].swap);
+    }
+    CaptureSwap = last + 1;
+    return disconCaptureOpen(path, CaptureSwap, CAPTURE_NUM_OUTPUTS, stepSize, errorMsg);
+}  /* end openCapture */
+
+/* Function: captureInputs ================================================
+ *
+ * Abstract:
+ *      Copy the avrSwap array of a call, as the host passed it, to the next
+ *      record of the trace. Returns the record, or NULL when the instance
+ *      is not capturing.
+ */
+static float *captureInputs(const DISCON_Instance *inst, const float *avrSwap) {
+    float *record;
+
+    if (inst == NULL || inst->capture == NULL) return NULL;
+    record = disconCaptureRecord(inst->capture);
+    if (record != NULL) {
+        (void)memcpy(record, avrSwap, CaptureSwap*sizeof(float));
+    }
+    return record;
+}  /* end captureInputs */
+
+/* Function: captureOutputs ===============================================
+ *
+ * Abstract:
+ *      Complete the record of a call with what it returned.
+ */
+static void captureOutputs(float *record, const float *avrSwap, int aviFail, int_T nLog) {
+    float *out = record + CaptureSwap;
+
+    out[DISCON_TRACE_OUT_FAIL] = (float)aviFail;
+    (void)memcpy(out + DISCON_TRACE_OUT_DEMANDS, avrSwap + CAPTURE_FIRST_DEMAND,
+                 CAPTURE_NUM_DEMANDS*sizeof(float));
+    out[DISCON_TRACE_OUT_NLOG] = avrSwap[64];
+    if (nLog > 0) {
+        (void)memcpy(out + DISCON_TRACE_OUT_LOG, avrSwap + NINT(avrSwap[62])-1,
+                     nLog*sizeof(float));
+    }
+    (void)memset(out + DISCON_TRACE_OUT_LOG + nLog, 0,
+                 (NUM_LOG_CHANNELS - nLog)*sizeof(float));
+}  /* end captureOutputs */
+#endif
+
+#if !defined(MULTITASKING)  /* SINGLETASKING */
+
+/* Function: stepModel ====================================================
+ *
+ * Abstract:
+ *      Execute one base rate step of the model with the inputs already
+ *      loaded.
+ */
+static int stepModel(DISCON_Instance *inst) {
+    RT_MODEL *S = inst->S;
+#if MULTI_INSTANCE_CODE == 1
+    real_T t;
+#else
+    real_T tnext;
+#endif
+
+	/***********************************************
+     * Check and see if base step time is too fast *
+     ***********************************************/
+    if (inst->GBLbuf.isrOverrun++) {
+        inst->GBLbuf.stopExecutionFlag = 1;
+        return -1;
+    }
+    disconParamsSetCurrent(inst->params);
+
+    /***********************************************
+     * Check and see if error status has been set  *
+     ***********************************************/
+    if (rtmGetErrorStatus(S) != NULL) {
+        inst->GBLbuf.stopExecutionFlag = 1;
+        return -1;
+    }
+    BUDGET_START(inst);
+    
+    /* enable interrupts here */
+    
+#if MULTI_INSTANCE_CODE == 1
+    /* Reusable code keeps its own timing in the step function */
+    t = rtmGetT(S);
+# if ONESTEPFCN == 1
+    MODEL_STEP(S);
+    PROFILE_TASK(inst, OUTPUTS, 0);
+# else
+    MODEL_OUTPUT(S);
+    PROFILE_TASK(inst, OUTPUTS, 0);
+    MODEL_UPDATE(S);
+    PROFILE_TASK(inst, UPDATE, 0);
+# endif
+    logStep(inst, t);
+    telemetryStep(inst, t);
+    PROFILE_PHASE(inst, LOG);
+#else
+    tnext = rt_SimGetNextSampleHit();
+    rtsiSetSolverStopTime(rtmGetRTWSolverInfo(S),tnext);
+
+    MdlOutputs(0);
+    PROFILE_TASK(inst, OUTPUTS, 0);
+
+    rtExtModeSingleTaskUpload(S);
+
+    logStep(inst, rtmGetT(S));
+    telemetryStep(inst, rtmGetT(S));
+    PROFILE_PHASE(inst, LOG);
+
+    MdlUpdate(0);
+    rt_SimUpdateDiscreteTaskSampleHits(rtmGetNumSampleTimes(S),
                                        rtmGetTimingData(S),
                                        rtmGetSampleHitPtr(S),
                                        rtmGetTPtr(S));
@@ -349,157 +1788,108 @@ int calcOutputController(float rUserVar1, float rUserVar2, float rUserVar3, floa
     if (rtmGetSampleTime(S,0) == CONTINUOUS_SAMPLE_TIME) {
         rt_UpdateContinuousStates(S);
     }
+    PROFILE_TASK(inst, UPDATE, 0);
+#endif
 
-    GBLbuf.isrOverrun--;
+    inst->GBLbuf.isrOverrun--;
+    BUDGET_END(inst);
 
     rtExtModeCheckEndTrigger();
 
-    
-    rTorqueDemand[0] = SIG_MODEL(Y,Generator_Torque);
-    rBlade1Pitch[0] = SIG_MODEL(Y,Blade1_Pitch_Angle);
-    rBlade2Pitch[0] = SIG_MODEL(Y,Blade2_Pitch_Angle);
-    rBlade3Pitch[0] = SIG_MODEL(Y,Blade3_Pitch_Angle);
-	rPitchDemand[0] = SIG_MODEL(Y, Collective_Pitch_Angle);
-	rYawRate[0] = SIG_MODEL(Y,Yaw_Rate);
-    rLog1[0] = SIG_MODEL(Y,Log1);
-    rLog2[0] = SIG_MODEL(Y,Log2);
-    rLog3[0] = SIG_MODEL(Y,Log3);
-    rLog4[0] = SIG_MODEL(Y,Log4);
-    rLog5[0] = SIG_MODEL(Y,Log5);
-    rLog6[0] = SIG_MODEL(Y,Log6);
-    rLog7[0] = SIG_MODEL(Y,Log7);
-    rLog8[0] = SIG_MODEL(Y,Log8);
-    rLog9[0] = SIG_MODEL(Y,Log9);
-    rLog10[0] = SIG_MODEL(Y,Log10);
-	rLog11[0] = SIG_MODEL(Y,Log11);
-	rLog12[0] = SIG_MODEL(Y,Log12);
-	rLog13[0] = SIG_MODEL(Y,Log13);
-	rLog14[0] = SIG_MODEL(Y,Log14);
-	rLog15[0] = SIG_MODEL(Y,Log15);
-	rLog16[0] = SIG_MODEL(Y,Log16);
-	rLog17[0] = SIG_MODEL(Y,Log17);
-	rLog18[0] = SIG_MODEL(Y,Log18);
-	rLog19[0] = SIG_MODEL(Y,Log19);
-	rLog20[0] = SIG_MODEL(Y,Log20);
-
-
     return 0;
-}  /* end calcOutputController */
+}  /* end stepModel */
 
 #else /* MULTITASKING */
 
-# if TID01EQ == 1
-#  define FIRST_TID 1
-# else
-#  define FIRST_TID 0
-# endif
-
-int calcOutputController(float rUserVar1, float rUserVar2, float rUserVar3, float rUserVar4, float rUserVar5,float rUserVar6, float rUserVar7, float rUserVar8, float rUserVar9, float rUserVar10,
-						 float rUserVar11,float rUserVar12,float rUserVar13,float rUserVar14,float rUserVar15,float rUserVar16,float rUserVar17,float rUserVar18,float rUserVar19,float rUserVar20,
-		float rInit, float rGeneratorSpeed, float rRatedSpeed,
-        float rBelowRatedPitch, float rForeAftTower, float rSideTower,
-        float rRotorAzimuth, float rOP1RootMoment, float rOP2RootMoment,
-        float rOP3RootMoment,float rIP1RootMoment, float rIP2RootMoment,
-        float rIP3RootMoment, float rMeasuredPitch, float rMeasuredTorque, float rShaftTorque,
-        float rModeGain, float rYawError, float rYawBearingRate, float rElectricalPower, float *rTorqueDemand, float *rBlade1Pitch, 
-        float *rBlade2Pitch, float *rBlade3Pitch, float *rPitchDemand, char *errorMsg, float* rYawRate,
-        float* rLog1, float* rLog2,  float* rLog3,  float* rLog4,  float* rLog5,  float* rLog6,  float* rLog7,  float* rLog8,  float* rLog9,  float* rLog10,
-		float* rLog11, float* rLog12,  float* rLog13,  float* rLog14,  float* rLog15,  float* rLog16,  float* rLog17,  float* rLog18,  float* rLog19,  float* rLog20) {
-    int_T  i;
+/* Function: stepModel ====================================================
+ *
+ * Abstract:
+ *      Execute one base rate step of the model with the inputs already
+ *      loaded and release the sub-rate tasks that have a sample hit. The
+ *      base rate never waits for a sub-rate task.
+ */
+static int stepModel(DISCON_Instance *inst) {
+    RT_MODEL *S = inst->S;
+    int_T  i, overrun = 0;
     real_T tnext;
     int_T  *sampleHit = rtmGetSampleHitPtr(S);
     
-    SIG_MODEL(U,Generator_Speed) = rGeneratorSpeed;
-    SIG_MODEL(U,Rated_Speed) = rRatedSpeed;
-    SIG_MODEL(U,Below_Rated_Pitch_Angle) = rBelowRatedPitch;
-    SIG_MODEL(U,Fore_Aft_Tower_Accel) = rForeAftTower;
-    SIG_MODEL(U,Sidewards_Tower_Accel) = rSideTower;
-    SIG_MODEL(U,Measured_Pitch) = rMeasuredPitch;
-    SIG_MODEL(U,Measured_Torque) = rMeasuredTorque;
-	SIG_MODEL(U,Shaft_Torque) = rShaftTorque;
-    SIG_MODEL(U,Mode_Gain) = rModeGain;
-    SIG_MODEL(U,Rotor_Azimuth_Angle) = rRotorAzimuth;
-    SIG_MODEL(U,Blade1_OP_Root_Moment) = rOP1RootMoment;
-    SIG_MODEL(U,Blade2_OP_Root_Moment) = rOP2RootMoment;
-    SIG_MODEL(U,Blade3_OP_Root_Moment) = rOP3RootMoment;
-    SIG_MODEL(U,Blade1_IP_Root_Moment) = rIP1RootMoment;
-    SIG_MODEL(U,Blade2_IP_Root_Moment) = rIP2RootMoment;
-    SIG_MODEL(U,Blade3_IP_Root_Moment) = rIP3RootMoment;
-	
-	SIG_MODEL(U,Init) = rInit;
-	SIG_MODEL(U,userVar1) = rUserVar1;
-	SIG_MODEL(U,userVar2) = rUserVar2;
-	SIG_MODEL(U,userVar3) = rUserVar3;
-	SIG_MODEL(U,userVar4) = rUserVar4;
-	SIG_MODEL(U,userVar5) = rUserVar5;
-	SIG_MODEL(U,userVar6) = rUserVar6;
-	SIG_MODEL(U,userVar7) = rUserVar7;
-	SIG_MODEL(U,userVar8) = rUserVar8;
-	SIG_MODEL(U,userVar9) = rUserVar9;
-	SIG_MODEL(U,userVar10) = rUserVar10;
-	SIG_MODEL(U,userVar11) = rUserVar11;
-	SIG_MODEL(U,userVar12) = rUserVar12;
-	SIG_MODEL(U,userVar13) = rUserVar13;
-	SIG_MODEL(U,userVar14) = rUserVar14;
-	SIG_MODEL(U,userVar15) = rUserVar15;
-	SIG_MODEL(U,userVar16) = rUserVar16;
-	SIG_MODEL(U,userVar17) = rUserVar17;
-	SIG_MODEL(U,userVar18) = rUserVar18;
-	SIG_MODEL(U,userVar19) = rUserVar19;
-	SIG_MODEL(U,userVar20) = rUserVar20;
-	SIG_MODEL(U,YawError) = rYawError;
-	SIG_MODEL(U,YawBearingRate) = rYawBearingRate;
-	SIG_MODEL(U,ElectricalPower) = rElectricalPower;
 	/***********************************************
      * Check and see if base step time is too fast *
      ***********************************************/
-    if (GBLbuf.isrOverrun++) {
-        GBLbuf.stopExecutionFlag = 1;
-        return;
+    if (inst->GBLbuf.isrOverrun++) {
+        inst->GBLbuf.stopExecutionFlag = 1;
+        return -1;
     }
+    disconParamsSetCurrent(inst->params);
 
     /***********************************************
      * Check and see if error status has been set  *
      ***********************************************/
     if (rtmGetErrorStatus(S) != NULL) {
-        GBLbuf.stopExecutionFlag = 1;
-        return;
+        inst->GBLbuf.stopExecutionFlag = 1;
+        return -1;
     }
+    BUDGET_START(inst);
     /* enable interrupts here */
 
     /***********************************************
      * Update discrete events                      *
      ***********************************************/
+    disconMutexLock(&SubRates.lock);
     tnext = rt_SimUpdateDiscreteEvents(rtmGetNumSampleTimes(S),
                                        rtmGetTimingData(S),
-                                       rtmGetSampleHitPtr(S),
+                                       SubRates.hits,
                                        rtmGetPerTaskSampleHitsPtr(S));
     rtsiSetSolverStopTime(rtmGetRTWSolverInfo(S),tnext);
+    for (i=0; i<=FIRST_TID; i++) {
+        sampleHit[i] = SubRates.hits[i];
+    }
     for (i=FIRST_TID+1; i < NUMST; i++) {
-        if (sampleHit[i] && GBLbuf.eventFlags[i]++) {
-            GBLbuf.isrOverrun--; 
-            GBLbuf.overrunFlags[i]++;    /* Are we sampling too fast for */
-            GBLbuf.stopExecutionFlag=1;  /*   sample time "i"?           */
-            return;
+#if DISCON_BUDGET == 1
+        /* Released at an earlier step and not done yet */
+        if (!SubRates.late[i] &&
+            (SubRates.released[i] || SubRates.running == i)) {
+            SubRates.late[i] = 1;
+            inst->deferredTasks[i]++;
+        }
+#endif
+        if (SubRates.hits[i] && inst->GBLbuf.eventFlags[i]++) {
+#if DISCON_BUDGET == 1
+            /* Drop the hit, the task time catches up when it is done */
+            inst->GBLbuf.eventFlags[i]--;
+            SubRates.hits[i] = 0;
+            SubRates.skipped[i]++;
+            inst->skippedTasks[i]++;
+#else
+            inst->GBLbuf.overrunFlags[i]++;    /* Are we sampling too fast for */
+            overrun = 1;                       /*   sample time "i"?           */
+#endif
         }
     }
+    disconMutexUnlock(&SubRates.lock);
+    if (overrun) {
+        inst->GBLbuf.isrOverrun--; 
+        inst->GBLbuf.stopExecutionFlag=1;
+        return -1;
+    }
+
     /*******************************************
      * Step the model for the base sample time *
      *******************************************/
     MdlOutputs(FIRST_TID);
+    PROFILE_TASK(inst, OUTPUTS, FIRST_TID);
 
     rtExtModeUploadCheckTrigger(rtmGetNumSampleTimes(S));
     rtExtModeUpload(FIRST_TID,rtmGetTaskTime(S, FIRST_TID));
 
-    GBLbuf.errmsg = rt_UpdateTXYLogVars(rtmGetRTWLogInfo(S),
-                                        rtmGetTPtr(S));
-    if (GBLbuf.errmsg != NULL) {
-        GBLbuf.stopExecutionFlag = 1;
-        return;
-    }
+    logStep(inst, rtmGetT(S));
+    telemetryStep(inst, rtmGetT(S));
+    PROFILE_PHASE(inst, LOG);
 
     MdlUpdate(FIRST_TID);
 
+    disconMutexLock(&SubRates.lock);
     if (rtmGetSampleTime(S,0) == CONTINUOUS_SAMPLE_TIME) {
         rt_UpdateContinuousStates(S);
     }
@@ -512,6 +1902,7 @@ int calcOutputController(float rUserVar1, float rUserVar2, float rUserVar3, floa
     rt_SimUpdateDiscreteTaskTime(rtmGetTPtr(S), 
                                  rtmGetTimingData(S),1);
 #endif
+    PROFILE_TASK(inst, UPDATE, FIRST_TID);
 
 
     /************************************************************************
@@ -519,121 +1910,193 @@ int calcOutputController(float rUserVar1, float rUserVar2, float rUserVar3, floa
      * re-interrupt this ISR.                                               *
      ************************************************************************/
 
-    GBLbuf.isrOverrun--;
+    inst->GBLbuf.isrOverrun--;
 
 
-    /*********************************************
-     * Step the model for any other sample times *
-     *********************************************/
+    /***********************************************
+     * Release the tasks of the other sample times *
+     ***********************************************/
     for (i=FIRST_TID+1; i<NUMST; i++) {
-        /* If task "i" is running, don't run any lower priority task */
-        if (GBLbuf.overrunFlags[i]) return;
-
-        if (GBLbuf.eventFlags[i]) {
-            GBLbuf.overrunFlags[i]++;
-
-            MdlOutputs(i);
- 
-            rtExtModeUpload(i, rtmGetTaskTime(S,i));
-
-            MdlUpdate(i);
-
-            rt_SimUpdateDiscreteTaskTime(rtmGetTPtr(S), 
-                                         rtmGetTimingData(S),i);
-
-            /* Indicate task complete for sample time "i" */
-            GBLbuf.overrunFlags[i]--;
-            GBLbuf.eventFlags[i]--;
+        if (SubRates.hits[i]) {
+            SubRates.released[i] = 1;
+            SubRates.late[i]     = 0;
+            disconCondBroadcast(&SubRates.work);
         }
     }
+    disconMutexUnlock(&SubRates.lock);
+    BUDGET_END(inst);
 
     rtExtModeCheckEndTrigger();
 
-    
-    rTorqueDemand[0] = SIG_MODEL(Y,Generator_Torque);
-    rBlade1Pitch[0] = SIG_MODEL(Y,Blade1_Pitch_Angle);
-    rBlade2Pitch[0] = SIG_MODEL(Y,Blade2_Pitch_Angle);
-    rBlade3Pitch[0] = SIG_MODEL(Y,Blade3_Pitch_Angle);
-	rPitchDemand[0] = SIG_MODEL(Y, Collective_Pitch_Angle);
-	rYawRate[0] = SIG_MODEL(Y,Yaw_Rate);
-    rLog1[0] = SIG_MODEL(Y,Log1);
-    rLog2[0] = SIG_MODEL(Y,Log2);
-    rLog3[0] = SIG_MODEL(Y,Log3);
-    rLog4[0] = SIG_MODEL(Y,Log4);
-    rLog5[0] = SIG_MODEL(Y,Log5);
-    rLog6[0] = SIG_MODEL(Y,Log6);
-    rLog7[0] = SIG_MODEL(Y,Log7);
-    rLog8[0] = SIG_MODEL(Y,Log8);
-    rLog9[0] = SIG_MODEL(Y,Log9);
-    rLog10[0] = SIG_MODEL(Y,Log10);
-	rLog11[0] = SIG_MODEL(Y,Log11);
-	rLog12[0] = SIG_MODEL(Y,Log12);
-	rLog13[0] = SIG_MODEL(Y,Log13);
-	rLog14[0] = SIG_MODEL(Y,Log14);
-	rLog15[0] = SIG_MODEL(Y,Log15);
-	rLog16[0] = SIG_MODEL(Y,Log16);
-	rLog17[0] = SIG_MODEL(Y,Log17);
-	rLog18[0] = SIG_MODEL(Y,Log18);
-	rLog19[0] = SIG_MODEL(Y,Log19);
-	rLog20[0] = SIG_MODEL(Y,Log20);
-
-
     return 0;
-}  /* end calcOutputController */
+}  /* end stepModel */
 
 #endif /* MULTITASKING */
 
-/* Function: performCleanup ===============================================
+/* Function: calcOutputController =========================================
  *
  * Abstract:
- *      Execute model on a generic target such as a workstation.
+ *      Load one input vector, step the model and store the output vector.
+ *      u and y are indexed with the DISCON_IN_xxx and DISCON_OUT_xxx signal
+ *      numbers of discon_io.h, spaced uStride and yStride elements apart.
  */
-int performCleanup(char *errorMsg) {
-    
-	#ifdef UseMMIDataLogging
-		rt_CleanUpForStateLogWithMMI(rtmGetRTWLogInfo(S));
-	#endif
-    rt_StopDataLogging(MATFILE, rtmGetRTWLogInfo(S));
-    
-    rtExtModeShutdown(rtmGetNumSampleTimes(S));
-    
-    if (GBLbuf.errmsg) {
-        (void)fprintf(stderr,"%s\n",GBLbuf.errmsg);
-        exit(EXIT_FAILURE);
+int calcOutputController(DISCON_Instance *inst, const float *u, size_t uStride,
+                         float *y, size_t yStride) {
+    int status;
+
+    PROFILE_START(inst);
+    loadInputs(inst->S, u, uStride);
+    PROFILE_PHASE(inst, INPUTS);
+    status = stepModel(inst);
+    if (status == 0) {
+        storeOutputs(inst->S, y, yStride);
+    }
+    PROFILE_END(inst);
+    return status;
+}  /* end calcOutputController */
+
+/* Function: modelStatus ==================================================
+ *
+ * Abstract:
+ *      Check an instance for the errors of the model and its timing that
+ *      stop a run. Returns 0, or -1 with errorMsg filled.
+ */
+static int modelStatus(const DISCON_Instance *inst, char *errorMsg) {
+    RT_MODEL *S = inst->S;
+
+    if (inst->GBLbuf.errmsg) {
+        sprintf(errorMsg, "%.250s", inst->GBLbuf.errmsg);
+        return -1;
     }
     
     if (rtmGetErrorStatus(S) != NULL) {
-        (void)fprintf(stderr,"ErrorStatus set: \"%s\"\n", rtmGetErrorStatus(S));
-        exit(EXIT_FAILURE);
+        sprintf(errorMsg, "ErrorStatus set: \"%.230s\"", rtmGetErrorStatus(S));
+        return -1;
     }
     
-    if (GBLbuf.isrOverrun) {
-        (void)fprintf(stderr,
-                      "%s: ISR overrun - base sampling rate is too fast\n",
-                      QUOTE(MODEL));
-        exit(EXIT_FAILURE);
+    if (inst->GBLbuf.isrOverrun) {
+        sprintf(errorMsg, "%s: ISR overrun - base sampling rate is too fast",
+                QUOTE(MODEL));
+        return -1;
     }
 	
 	#ifdef MULTITASKING
     else {
         int_T i;
         for (i=1; i<NUMST; i++) {
-            if (GBLbuf.overrunFlags[i]) {
-                (void)fprintf(stderr,
-                        "%s ISR overrun - sampling rate is too fast for "
-                        "sample time index %d\n", QUOTE(MODEL), i);
-                exit(EXIT_FAILURE);
+            if (inst->GBLbuf.overrunFlags[i]) {
+                sprintf(errorMsg, "%s ISR overrun - sampling rate is too fast "
+                        "for sample time index %d", QUOTE(MODEL), i);
+                return -1;
             }
         }
     }
 	#endif
+    return 0;
+}  /* end modelStatus */
+
+/* Function: performCleanup ===============================================
+ *
+ * Abstract:
+ *      Terminate the model of an instance and release the instance. An
+ *      error of the run is returned as -1 with its message in errorMsg; the
+ *      instance is released all the same.
+ */
+int performCleanup(DISCON_Instance *inst, char *errorMsg) {
+    int status;
     
-    sprintf(errorMsg, "** Stopping the controller **");
-    MdlTerminate();
+    if (disconLogClose(inst->log) != 0) {
+        (void)fprintf(stderr, "%s: the log file is incomplete\n", QUOTE(MODEL));
+    }
+    inst->log = NULL;
+    closeInstanceCapture(inst);
+    closeInstanceTelemetry(inst);
+    reportBudget(inst);
     
-    return 0;
+    rtExtModeShutdown(rtmGetNumSampleTimes(inst->S));
+    
+    status = modelStatus(inst, errorMsg);
+    if (status == 0) {
+        sprintf(errorMsg, "** Stopping the controller **");
+    }
+
+    disconMutexLock(&InstanceLock);
+    stopModel(inst);
+    releaseInstance(inst);
+    disconMutexUnlock(&InstanceLock);
+    
+    return status;
 }  /* end performCleanup */
 
+/* Function: DISCON_Reset =================================================
+ *
+ * Abstract:
+ *      Restart the model of an instance from its initial conditions in
+ *      place: the instance slot, its avrSwap binding and, for the classic
+ *      interface, the model data are reused, and only the start functions
+ *      run again. The parameter file is looked up again, so a changed
+ *      discon.in takes effect; the log is started over and the timing
+ *      statistics are cleared. A capture carries on, so that its trace
+ *      replays the reset too, and so does a telemetry stream. On failure
+ *      the instance is released.
+ */
+int DISCON_Reset(DISCON_Instance *inst, char *errorMsg) {
+    disconParamSet *params;
+    char           msg[257];
+    int            status;
+    uint64_t       start = disconClockNs();
+
+    if (disconLogClose(inst->log) != 0) {
+        (void)fprintf(stderr, "%s: the log file is incomplete\n", QUOTE(MODEL));
+    }
+    inst->log = NULL;
+    reportBudget(inst);
+
+    if (disconParamsAcquire(disconParamsPath(), &params, errorMsg) != 0) {
+        (void)performCleanup(inst, msg);
+        return -1;
+    }
+
+    disconMutexLock(&InstanceLock);
+    stopModel(inst);
+    disconParamsRelease(inst->params);
+    inst->params = params;
+    (void)memset(&inst->GBLbuf, 0, sizeof(inst->GBLbuf));
+#if DISCON_HOST_TIME == 1
+    (void)memset(&inst->schedule, 0, sizeof(inst->schedule));
+#endif
+    disconParamsSetCurrent(params);     /* for the model's start functions */
+    status = startModel(inst, 0, errorMsg);
+    if (status != 0) {
+        closeInstanceCapture(inst);
+        closeInstanceTelemetry(inst);
+        releaseInstance(inst);
+    }
+    disconMutexUnlock(&InstanceLock);
+    if (status != 0) {
+        return -1;
+    }
+
+    clearBudget(inst);
+#if DISCON_PROFILE == 1
+    inst->deadlineNs = (uint64_t)(rtmGetStepSize(inst->S)*1e9);
+    inst->lastCallNs = 0;
+    inst->deadlineMisses = 0;
+    (void)memset(inst->phaseNs, 0, sizeof(inst->phaseNs));
+    (void)memset(inst->wcetOutputsNs, 0, sizeof(inst->wcetOutputsNs));
+    (void)memset(inst->wcetUpdateNs, 0, sizeof(inst->wcetUpdateNs));
+    disconHistReset(inst->latency);
+#endif
+
+    if (openInstanceLog(inst, errorMsg) != 0) {
+        (void)performCleanup(inst, msg);
+        return -1;
+    }
+    inst->startNs = disconClockNs() - start;
+    
+    return 0;
+}  /* end DISCON_Reset */
+
 static void displayUsage (void)
 {
     (void) printf("usage: %s -tf <finaltime> -w -port <TCPport>\n",QUOTE(MODEL));
@@ -646,86 +2109,781 @@ static void displayUsage (void)
                   "External Mode, valid range 256 to 65535.\n");
 }
 
-/* This function is added by JW to read the external inputs from Bladed */
-float* SetParams(float *avrSwap) 
+/* Function: SetParams ===================================================
+ *
+ * Abstract:
+ *      Added by JW to read the external inputs from Bladed: on the
+ *      initialization call, copy userVar1..20 of the parameter file of the
+ *      instance to avrSwap[119..138]. The file itself was parsed (once per
+ *      process) when the instance was created. Without a parameter file,
+ *      avrSwap[128] is set to 1.
+ */
+static void SetParams(const DISCON_Instance *inst, float *avrSwap) 
 {
-	char mystring [200];
-	int iStatus;
+	int k;
 
-	iStatus	=	NINT(avrSwap[0]);
+	if (inst == NULL || NINT(avrSwap[0]) != 0) return;
 
-	if (iStatus == 0)
-	{
-		pFile = fopen ("discon.in","r");
-		if (pFile == NULL) {avrSwap[128]=1;}
-		else {
-			fgets (mystring , 200 , pFile);
-			avrSwap[119]=atof(mystring);
-			fgets (mystring , 200 , pFile);
-			avrSwap[120]=atof(mystring);
-			fgets (mystring , 200 , pFile);
-			avrSwap[121]=atof(mystring);
-			fgets (mystring , 200 , pFile);
-			avrSwap[122]=atof(mystring);
-			fgets (mystring , 200 , pFile);
-			avrSwap[123]=atof(mystring);
-			fgets (mystring , 200 , pFile);
-			avrSwap[124]=atof(mystring);
-			fgets (mystring , 200 , pFile);
-			avrSwap[125]=atof(mystring);
-			fgets (mystring , 200 , pFile);
-			avrSwap[126]=atof(mystring);
-			fgets (mystring , 200 , pFile);
-			avrSwap[127]=atof(mystring);
-			fgets (mystring , 200 , pFile);
-			avrSwap[128]=atof(mystring);
-			fgets (mystring , 200 , pFile);
-			avrSwap[129]=atof(mystring);
-			fgets (mystring , 200 , pFile);
-			avrSwap[130]=atof(mystring);
-			fgets (mystring , 200 , pFile);
-			avrSwap[131]=atof(mystring);
-			fgets (mystring , 200 , pFile);
-			avrSwap[132]=atof(mystring);
-			fgets (mystring , 200 , pFile);
-			avrSwap[133]=atof(mystring);
-			fgets (mystring , 200 , pFile);
-			avrSwap[134]=atof(mystring);
-			fgets (mystring , 200 , pFile);
-			avrSwap[135]=atof(mystring);
-			fgets (mystring , 200 , pFile);
-			avrSwap[136]=atof(mystring);
-			fgets (mystring , 200 , pFile);
-			avrSwap[137]=atof(mystring);
-			fgets (mystring , 200 , pFile);
-			avrSwap[138]=atof(mystring);
-			fclose (pFile);
-			}
+	if (inst->params == NULL) {
+		avrSwap[128] = 1;
+		return;
 	}
-	return(avrSwap);
-}
+	for (k=0; k<DISCON_NUM_USERVARS; k++) {
+		avrSwap[119+k] = (float)disconParamsUserVar(inst->params, k);
+	}
+}  /* end SetParams */
 
 /*===================*
  * Visible functions *
  *===================*/
 
+/* Function: DISCON_GetInstance ===========================================
+ *
+ * Abstract:
+ *      Find the instance bound to an avrSwap buffer. With the classic
+ *      interface there is only one instance, which is returned for every
+ *      buffer; DISCON refuses the calls of any buffer but its own.
+ */
+DISCON_Instance *DISCON_GetInstance(const float *avrSwap) {
+    DISCON_Instance *inst = NULL;
+    int_T           i;
+
+    disconMutexLock(&InstanceLock);
+    for (i=0; i<DISCON_MAX_INSTANCES; i++) {
+#if MULTI_INSTANCE_CODE == 1
+        if (Instances[i].inUse && Instances[i].avrSwap == avrSwap) {
+#else
+        if (Instances[i].inUse) {
+#endif
+            inst = &Instances[i];
+            break;
+        }
+    }
+    disconMutexUnlock(&InstanceLock);
+    return inst;
+}  /* end DISCON_GetInstance */
 
-/* Function: main =============================================================
+/* Function: DISCON_GetParameter ==========================================
  *
  * Abstract:
- *      Execute model on a generic target such as a workstation.
+ *      Look up a named entry of the parameter file of an instance.
+ */
+int DISCON_GetParameter(const DISCON_Instance *inst, const char *name,
+                        const double **data, int *rows, int *cols) {
+    const disconParam *param = disconParamsFind(inst->params, name);
+
+    if (param == NULL) {
+        if (rows != NULL) *rows = 0;
+        if (cols != NULL) *cols = 0;
+        return 0;
+    }
+    *data = param->data;
+    if (rows != NULL) *rows = param->rows;
+    if (cols != NULL) *cols = param->cols;
+    return param->rows*param->cols;
+}  /* end DISCON_GetParameter */
+
+/* Function: DISCON_GetPhaseTimes ========================================
+ *
+ * Abstract:
+ *      Copy the phase times of the last call of an instance.
+ */
+int DISCON_GetPhaseTimes(const DISCON_Instance *inst, double *ns, int n) {
+#if DISCON_PROFILE == 1
+    n = MIN(n, DISCON_NUM_PHASES);
+    (void)memcpy(ns, inst->phaseNs, n*sizeof(double));
+    return n;
+#else
+    (void)inst;
+    (void)ns;
+    (void)n;
+    return 0;
+#endif
+}  /* end DISCON_GetPhaseTimes */
+
+/* Function: DISCON_GetTiming =============================================
+ *
+ * Abstract:
+ *      Copy and optionally reset the timing statistics of an instance.
+ */
+int DISCON_GetTiming(DISCON_Instance *inst, DISCON_Timing *timing, int reset) {
+#if DISCON_PROFILE == 1
+    const disconHist *h = inst->latency;
+    int_T            i;
+
+    (void)memset(timing, 0, sizeof(*timing));
+    timing->calls          = (double)h->count;
+    timing->deadlineNs     = (double)inst->deadlineNs;
+    timing->deadlineMisses = (double)inst->deadlineMisses;
+    timing->meanNs         = h->count > 0 ? h->sum/(double)h->count : 0.0;
+    timing->p50Ns          = (double)disconHistPercentile(h, 50.0);
+    timing->p99Ns          = (double)disconHistPercentile(h, 99.0);
+    timing->p999Ns         = (double)disconHistPercentile(h, 99.9);
+    timing->maxNs          = (double)h->max;
+    timing->nTasks         = MIN(NUMST, DISCON_TIMING_TASKS);
+    for (i=0; i<timing->nTasks; i++) {
+        timing->wcetOutputsNs[i] = inst->wcetOutputsNs[i];
+        timing->wcetUpdateNs[i]  = inst->wcetUpdateNs[i];
+    }
+    if (reset) {
+        disconHistReset(inst->latency);
+        inst->deadlineMisses = 0;
+        (void)memset(inst->wcetOutputsNs, 0, sizeof(inst->wcetOutputsNs));
+        (void)memset(inst->wcetUpdateNs, 0, sizeof(inst->wcetUpdateNs));
+    }
+    return 0;
+#else
+    (void)inst;
+    (void)timing;
+    (void)reset;
+    return -1;
+#endif
+}  /* end DISCON_GetTiming */
+
+/* Function: DISCON_GetBudget ============================================
+ *
+ * Abstract:
+ *      Copy and optionally reset the budget statistics of an instance.
+ */
+int DISCON_GetBudget(DISCON_Instance *inst, DISCON_Budget *budget, int reset) {
+#if DISCON_BUDGET == 1
+    int_T i;
+
+    (void)memset(budget, 0, sizeof(*budget));
+    budget->budgetNs   = (double)inst->budgetNs;
+    budget->steps      = (double)inst->steps;
+    budget->overBudget = (double)inst->overBudget;
+    budget->skippedLog = (double)inst->skippedLog;
+    budget->nTasks     = MIN(NUMST, DISCON_TIMING_TASKS);
+    for (i=0; i<budget->nTasks; i++) {
+        budget->deferredTasks[i] = (double)inst->deferredTasks[i];
+        budget->skippedTasks[i]  = (double)inst->skippedTasks[i];
+    }
+    if (reset) {
+        clearBudget(inst);
+    }
+    return 0;
+#else
+    (void)inst;
+    (void)budget;
+    (void)reset;
+    return -1;
+#endif
+}  /* end DISCON_GetBudget */
+
+/* Function: DISCON_GetStartup ============================================
+ *
+ * Abstract:
+ *      Copy the duration and kind of the last start or reset of an
+ *      instance.
+ */
+int DISCON_GetStartup(const DISCON_Instance *inst, DISCON_Startup *startup) {
+    startup->startNs      = (double)inst->startNs;
+    startup->fromTemplate = (int)inst->fromTemplate;
+    return 0;
+}  /* end DISCON_GetStartup */
+
+/* Function: DISCON_GetSchedule ===========================================
+ *
+ * Abstract:
+ *      Copy and optionally reset the host-time schedule statistics of an
+ *      instance.
+ */
+int DISCON_GetSchedule(DISCON_Instance *inst, DISCON_Schedule *schedule, int reset) {
+#if DISCON_HOST_TIME == 1
+    schedule->calls        = (double)inst->hostCalls;
+    schedule->steps        = (double)inst->modelSteps;
+    schedule->heldCalls    = (double)inst->heldCalls;
+    schedule->catchUpSteps = (double)inst->catchUpSteps;
+    schedule->resyncs      = (double)inst->resyncs;
+    schedule->nextHit      = inst->schedule.nextHit;
+    if (reset) {
+        inst->hostCalls    = 0;
+        inst->modelSteps   = 0;
+        inst->heldCalls    = 0;
+        inst->catchUpSteps = 0;
+        inst->resyncs      = 0;
+    }
+    return 0;
+#else
+    (void)inst;
+    (void)schedule;
+    (void)reset;
+    return -1;
+#endif
+}  /* end DISCON_GetSchedule */
+
+/* Function: saveScalars ==================================================
+ *
+ * Abstract:
+ *      Collect the SnapshotScalars of an instance.
+ */
+static void saveScalars(DISCON_Instance *inst, SnapshotScalars *sc) {
+    RT_MODEL *S = inst->S;
+    int_T    i, k = 0;
+
+    (void)memset(sc, 0, sizeof(*sc));
+    for (i=0; i<NUMST; i++) {
+        sc->t[i]            = rtmGetTPtr(S)[i];
+        sc->sampleHits[i]   = rtmGetSampleHitPtr(S)[i];
+        sc->overrunFlags[i] = inst->GBLbuf.overrunFlags[i];
+        sc->eventFlags[i]   = inst->GBLbuf.eventFlags[i];
+    }
+#if defined(MULTITASKING)
+    (void)memcpy(sc->perTaskSampleHits, rtmGetPerTaskSampleHitsPtr(S),
+                 sizeof(sc->perTaskSampleHits));
+#endif
+#define SAVE_CLOCK_TICK(field) sc->clockTicks[k++] = (uint32_T)S->Timing.field;
+    MODEL_CLOCK_TICKS(SAVE_CLOCK_TICK)
+#undef SAVE_CLOCK_TICK
+    (void)k;
+    sc->stopExecutionFlag = inst->GBLbuf.stopExecutionFlag;
+    sc->isrOverrun        = inst->GBLbuf.isrOverrun;
+}  /* end saveScalars */
+
+/* Function: loadScalars ==================================================
+ *
+ * Abstract:
+ *      Set the SnapshotScalars of an instance.
+ */
+static void loadScalars(DISCON_Instance *inst, const SnapshotScalars *sc) {
+    RT_MODEL *S = inst->S;
+    int_T    i, k = 0;
+
+    for (i=0; i<NUMST; i++) {
+        rtmGetTPtr(S)[i]              = sc->t[i];
+        rtmGetSampleHitPtr(S)[i]      = sc->sampleHits[i];
+        inst->GBLbuf.overrunFlags[i] = sc->overrunFlags[i];
+        inst->GBLbuf.eventFlags[i]   = sc->eventFlags[i];
+    }
+#if defined(MULTITASKING)
+    (void)memcpy(rtmGetPerTaskSampleHitsPtr(S), sc->perTaskSampleHits,
+                 sizeof(sc->perTaskSampleHits));
+#endif
+#define LOAD_CLOCK_TICK(field) S->Timing.field = sc->clockTicks[k++];
+    MODEL_CLOCK_TICKS(LOAD_CLOCK_TICK)
+#undef LOAD_CLOCK_TICK
+    (void)k;
+    inst->GBLbuf.stopExecutionFlag = sc->stopExecutionFlag;
+    inst->GBLbuf.isrOverrun        = sc->isrOverrun;
+}  /* end loadScalars */
+
+/* Function: snapshotSections =============================================
+ *
+ * Abstract:
+ *      List the memory that holds the state of an instance: the scalars in
+ *      sc, the timing engine and the model data selected by MODEL_HAS_xxx.
+ *      No section holds a pointer but the WorkPointers of the DWork, which
+ *      the instance keeps. Returns the number of sections.
+ */
+static int snapshotSections(DISCON_Instance *inst, disconSection *sec,
+                            SnapshotScalars *sc) {
+    RT_MODEL *S = inst->S;
+    int      n = 0;
+
+#define SECTION(secId, ptr, len) \
+    (sec[n].id = (secId), sec[n].data = (void *)(ptr), sec[n].size = (len), \
+     sec[n].keep = NULL, sec[n].nKeep = 0, n++)
+
+    SECTION(SNAPSHOT_RTMODEL, sc, sizeof(*sc));
+#if MULTI_INSTANCE_CODE != 1
+    SECTION(SNAPSHOT_TIMING,  rtmGetTimingData(S), sizeof(SimTimingData));
+#endif
+    SECTION(SNAPSHOT_INPUTS,  MODEL_U(S), sizeof(*MODEL_U(S)));
+    SECTION(SNAPSHOT_OUTPUTS, MODEL_Y(S), sizeof(*MODEL_Y(S)));
+#if MODEL_HAS_BLOCKIO == 1
+    SECTION(SNAPSHOT_BLOCKIO, MODEL_B(S), sizeof(*MODEL_B(S)));
+#endif
+#if MODEL_HAS_DWORK == 1
+    SECTION(SNAPSHOT_DWORK,   MODEL_DW(S), sizeof(*MODEL_DW(S)));
+    sec[n-1].keep  = WorkPointers;
+    sec[n-1].nKeep = MAX(NumWorkPointers, 0);
+#endif
+#if NCSTATES > 0
+    SECTION(SNAPSHOT_CSTATES, MODEL_X(S), NCSTATES*sizeof(real_T));
+#endif
+#if MODEL_HAS_PREVZC == 1
+    SECTION(SNAPSHOT_PREVZC,  MODEL_ZC(S), sizeof(*MODEL_ZC(S)));
+#endif
+#if DISCON_HOST_TIME == 1
+    SECTION(SNAPSHOT_SCHEDULE, &inst->schedule, sizeof(inst->schedule));
+#endif
+#undef SECTION
+    return n;
+}  /* end snapshotSections */
+
+/* Function: DISCON_SnapshotSize ==========================================
+ *
+ * Abstract:
+ *      Size of the snapshot of an instance, the same for every instance of
+ *      the library.
+ */
+size_t DISCON_SnapshotSize(DISCON_Instance *inst) {
+    disconSection   sec[DISCON_SNAPSHOT_SECTIONS];
+    SnapshotScalars sc;
+
+    return disconSnapshotSize(sec, snapshotSections(inst, sec, &sc));
+}  /* end DISCON_SnapshotSize */
+
+/* Function: DISCON_Snapshot ==============================================
+ *
+ * Abstract:
+ *      Copy the state of an instance to buf. A model that has stopped with
+ *      an error cannot be continued and is refused.
+ */
+size_t DISCON_Snapshot(DISCON_Instance *inst, void *buf, size_t size, char *errorMsg) {
+    disconSection   sec[DISCON_SNAPSHOT_SECTIONS];
+    SnapshotScalars sc;
+
+    waitSubRates();
+
+    if (rtmGetErrorStatus(inst->S) != NULL || inst->GBLbuf.errmsg != NULL ||
+        inst->GBLbuf.stopExecutionFlag) {
+        sprintf(errorMsg, "The controller has stopped with an error, no snapshot taken");
+        return 0;
+    }
+    saveScalars(inst, &sc);
+    return disconSnapshotWrite(QUOTE(MODEL), sec, snapshotSections(inst, sec, &sc),
+                               buf, size, errorMsg);
+}  /* end DISCON_Snapshot */
+
+/* Function: DISCON_Restore ===============================================
+ *
+ * Abstract:
+ *      Copy a snapshot into an instance. Only state is copied: the
+ *      rtModel, GBLbuf and the WorkPointers keep the pointers of the
+ *      instance.
+ */
+int DISCON_Restore(DISCON_Instance *inst, const void *buf, size_t size, char *errorMsg) {
+    disconSection   sec[DISCON_SNAPSHOT_SECTIONS];
+    SnapshotScalars sc;
+
+    waitSubRates();
+    if (disconSnapshotRead(QUOTE(MODEL), sec, snapshotSections(inst, sec, &sc),
+                           buf, size, errorMsg) != 0) {
+        return -1;
+    }
+    loadScalars(inst, &sc);
+    return 0;
+}  /* end DISCON_Restore */
+
+/* Function: DISCON_SaveSnapshot ==========================================
+ *
+ * Abstract:
+ *      Take a snapshot into a file.
+ */
+int DISCON_SaveSnapshot(DISCON_Instance *inst, const char *path, char *errorMsg) {
+    size_t size = DISCON_SnapshotSize(inst);
+    void   *buf = malloc(size);
+    int    status = -1;
+
+    if (buf == NULL) {
+        sprintf(errorMsg, "Unable to allocate the snapshot");
+        return -1;
+    }
+    if (DISCON_Snapshot(inst, buf, size, errorMsg) != 0) {
+        status = disconSnapshotSave(path, buf, size, errorMsg);
+    }
+    free(buf);
+    return status;
+}  /* end DISCON_SaveSnapshot */
+
+/* Function: DISCON_LoadSnapshot ==========================================
+ *
+ * Abstract:
+ *      Restore an instance from a snapshot file.
+ */
+int DISCON_LoadSnapshot(DISCON_Instance *inst, const char *path, char *errorMsg) {
+    size_t size;
+    void   *buf = disconSnapshotLoad(path, &size, errorMsg);
+    int    status;
+
+    if (buf == NULL) {
+        return -1;
+    }
+    status = DISCON_Restore(inst, buf, size, errorMsg);
+    free(buf);
+    return status;
+}  /* end DISCON_LoadSnapshot */
+
+#if MULTI_INSTANCE_CODE == 1
+/* Function: dropStartTemplate ============================================
+ *
+ * Abstract:
+ *      Free the start template. Called with InstanceLock held.
+ */
+static void dropStartTemplate(void) {
+    free(StartTemplate.buf);
+    disconParamsRelease(StartTemplate.params);
+    StartTemplate.buf    = NULL;
+    StartTemplate.params = NULL;
+    StartTemplate.size   = 0;
+}  /* end dropStartTemplate */
+
+/* Function: copyWorkPointers =============================================
+ *
+ * Abstract:
+ *      Copy the WorkPointers of an instance to work (toModel 0) or from
+ *      work to the instance (toModel 1).
+ */
+static void copyWorkPointers(DISCON_Instance *inst, void **work, int_T toModel) {
+#if MODEL_HAS_DWORK == 1
+    char *dw = (char *)MODEL_DW(inst->S);
+    int  i;
+
+    for (i=0; i<NumWorkPointers; i++) {
+        if (toModel) {
+            (void)memcpy(dw + WorkPointers[i], &work[i], sizeof(void *));
+        } else {
+            (void)memcpy(&work[i], dw + WorkPointers[i], sizeof(void *));
+        }
+    }
+#else
+    (void)inst;
+    (void)work;
+    (void)toModel;
+#endif
+}  /* end copyWorkPointers */
+
+/* Function: copyStartTemplate ============================================
+ *
+ * Abstract:
+ *      Copy the start template into the freshly allocated model of an
+ *      instance, when there is a confirmed one for its parameter set, with
+ *      the WorkPointers it was taken with: they point into that set.
+ *      Returns 0 when the instance has its initial state, -1 when it still
+ *      has to be initialized. Called with InstanceLock held.
+ */
+static int copyStartTemplate(DISCON_Instance *inst) {
+    char msg[257];
+
+    if (StartTemplate.state != TEMPLATE_READY || StartTemplate.params != inst->params ||
+        DISCON_Restore(inst, StartTemplate.buf, StartTemplate.size, msg) != 0) {
+        return -1;
+    }
+    copyWorkPointers(inst, StartTemplate.work, 1);
+    inst->fromTemplate = 1;
+    return 0;
+}  /* end copyStartTemplate */
+
+/* Function: stepOutputs ==================================================
+ *
+ * Abstract:
+ *      Run one step of the model of an instance from its current state and
+ *      copy its outputs to y.
+ */
+static void stepOutputs(DISCON_Instance *inst, MODEL_EXTY *y) {
+# if ONESTEPFCN == 1
+    MODEL_STEP(inst->S);
+# else
+    MODEL_OUTPUT(inst->S);
+    MODEL_UPDATE(inst->S);
+# endif
+    (void)memcpy(y, MODEL_Y(inst->S), sizeof(*y));
+}  /* end stepOutputs */
+
+/* Function: sameOutputs ==================================================
+ *
+ * Abstract:
+ *      Check that an instance started from the template reads back the
+ *      same outputs as one initialized in full: step the template copy an
+ *      instance holds, with the WorkPointers of the template, and then its
+ *      own initial state (own, size bytes), with its own WorkPointers
+ *      (ownWork), and compare. Leaves the instance in its own initial
+ *      state. Called with InstanceLock held.
+ */
+static int_T sameOutputs(DISCON_Instance *inst, const void *own, size_t size,
+                         void **ownWork) {
+    RT_MODEL   *S = inst->S;
+    const char *status = rtmGetErrorStatus(S);
+    MODEL_EXTY fromTemplate, initialized;
+    char       msg[257];
+    int_T      same;
+
+    copyWorkPointers(inst, StartTemplate.work, 1);
+    stepOutputs(inst, &fromTemplate);
+    copyWorkPointers(inst, ownWork, 1);
+    if (DISCON_Restore(inst, own, size, msg) != 0) {
+        return 0;
+    }
+    stepOutputs(inst, &initialized);
+    same = rtmGetErrorStatus(S) == status &&
+           memcmp(&fromTemplate, &initialized, sizeof(initialized)) == 0;
+    rtmSetErrorStatus(S, status);
+    return DISCON_Restore(inst, own, size, msg) == 0 && same;
+}  /* end sameOutputs */
+
+/* Function: keepStartTemplate ============================================
+ *
+ * Abstract:
+ *      Offer the initial state of an instance that was initialized in full
+ *      as the start template. The first instance with a parameter set
+ *      takes the template; the next one confirms it by copying it over its
+ *      own initial state and comparing the two, and the outputs of one step
+ *      from each: the initial state must not depend on the instance, e.g.
+ *      through memory allocated by a start function. The snapshots hold no
+ *      pointers, so only state is compared and copied. If it does depend
+ *      on the instance, the instance gets its own state back and
+ *      every instance is initialized in full from then on. Setting the
+ *      environment variable DISCON_START_TEMPLATE to 0 does the same from
+ *      the start. Called with InstanceLock held.
+ */
+static void keepStartTemplate(DISCON_Instance *inst) {
+    const char *enable = getenv("DISCON_START_TEMPLATE");
+    size_t     size;
+    void       *own, *copy;
+    void       *ownWork[DISCON_MAX_WORK_POINTERS];
+    char       msg[257];
+    int_T      same;
+
+    if (StartTemplate.state == TEMPLATE_NONE && enable != NULL &&
+        strcmp(enable, "0") == 0) {
+        StartTemplate.state = TEMPLATE_OFF;
+    }
+    if (StartTemplate.state == TEMPLATE_OFF) return;
+
+    size = DISCON_SnapshotSize(inst);
+    if (StartTemplate.state == TEMPLATE_NONE || StartTemplate.params != inst->params) {
+        /* First instance, or a changed parameter file */
+        dropStartTemplate();
+        StartTemplate.state = TEMPLATE_NONE;
+        if ((StartTemplate.buf = malloc(size)) == NULL) return;
+        if (DISCON_Snapshot(inst, StartTemplate.buf, size, msg) != size) {
+            free(StartTemplate.buf);
+            StartTemplate.buf = NULL;
+            return;
+        }
+        copyWorkPointers(inst, StartTemplate.work, 0);
+        StartTemplate.size   = size;
+        StartTemplate.params = disconParamsRetain(inst->params);
+        StartTemplate.state  = TEMPLATE_TAKEN;
+        return;
+    }
+    if (StartTemplate.state != TEMPLATE_TAKEN) return;
+
+    own  = malloc(size);
+    copy = malloc(size);
+    copyWorkPointers(inst, ownWork, 0);
+    same = own != NULL && copy != NULL &&
+           DISCON_Snapshot(inst, own, size, msg) == size &&
+           DISCON_Restore(inst, StartTemplate.buf, StartTemplate.size, msg) == 0 &&
+           DISCON_Snapshot(inst, copy, size, msg) == size &&
+           memcmp(own, copy, size) == 0 &&
+           sameOutputs(inst, own, size, ownWork);
+    if (same) {
+        StartTemplate.state = TEMPLATE_READY;
+    } else {
+        if (own != NULL) (void)DISCON_Restore(inst, own, size, msg);
+        (void)fprintf(stderr, "%s: the initial state of the model depends on the "
+                      "instance, every instance is initialized in full\n", QUOTE(MODEL));
+        dropStartTemplate();
+        StartTemplate.state = TEMPLATE_OFF;
+    }
+    free(copy);
+    free(own);
+}  /* end keepStartTemplate */
+#endif
+
+/* Function: bindInstance =================================================
+ *
+ * Abstract:
+ *      Bind an instance to the avrSwap buffer of its turbine.
+ */
+static void bindInstance(DISCON_Instance *inst, const float *avrSwap) {
+    disconMutexLock(&InstanceLock);
+    inst->avrSwap = avrSwap;
+    disconMutexUnlock(&InstanceLock);
+    LastInstance = inst;
+}  /* end bindInstance */
+
+/* Function: swapInstance =================================================
+ *
+ * Abstract:
+ *      Find the instance of the avrSwap buffer DISCON is called with. The
+ *      instance found last on the calling thread is tried first, so that
+ *      the calls of a turbine take InstanceLock only to start and stop it;
+ *      releasing an instance unbinds its buffer, which sends the next call
+ *      to DISCON_GetInstance.
+ */
+static DISCON_Instance *swapInstance(const float *avrSwap) {
+    DISCON_Instance *inst = LastInstance;
+
+    if (inst == NULL || !inst->inUse || inst->avrSwap != avrSwap) {
+        inst = DISCON_GetInstance(avrSwap);
+        if (inst != NULL && inst->avrSwap == avrSwap) {
+            LastInstance = inst;
+        }
+    }
+    return inst;
+}  /* end swapInstance */
+
+
+#if DISCON_HOST_TIME == 1
+/* Function: dueSteps =====================================================
+ *
+ * Abstract:
+ *      Number of model steps due in a DISCON call: the sample hits from the
+ *      next one up to the host time rTime (avrSwap[1]), so that a host
+ *      calling faster than the step size of the model gets steps on the
+ *      hits only, and one calling slower gets all the steps it passed. A
+ *      hit counts as reached within a thousandth of a step, and within the
+ *      precision of the float rTime. The initialization call steps once
+ *      and starts the schedule at its rTime. A host that passes no
+ *      communication interval (rSample, avrSwap[2] <= 0) is stepped on
+ *      every call. A call more than DISCON_MAX_CATCHUP hits late gets that
+ *      many steps, and the schedule starts over at its time.
+ */
+static int_T dueSteps(DISCON_Instance *inst, const float *avrSwap) {
+    real_T stepSize = rtmGetStepSize(inst->S);
+    real_T t = avrSwap[1];
+    real_T tol = 1e-3*stepSize + 4.0*FLT_EPSILON*(t < 0.0 ? -t : t);
+    real_T due;
+
+    if (NINT(avrSwap[0]) == 0) {
+        const char *ramp = getenv("DISCON_INTERPOLATE");
+
+        inst->ramp         = ramp != NULL && strcmp(ramp, "1") == 0;
+        inst->hostCalls    = 0;
+        inst->modelSteps   = 0;
+        inst->heldCalls    = 0;
+        inst->catchUpSteps = 0;
+        inst->resyncs      = 0;
+        inst->schedule.nextHit = t;
+        inst->schedule.started = 0;
+        return 1;
+    }
+    inst->hostCalls++;
+    if (avrSwap[2] <= 0.0f) {
+        inst->schedule.nextHit = t;
+        inst->schedule.started = 1;
+        inst->modelSteps++;
+        return 1;
+    }
+    if (t + tol < inst->schedule.nextHit) {
+        inst->heldCalls++;
+        return 0;
+    }
+    due = (real_T)(long)((t + tol - inst->schedule.nextHit)/stepSize) + 1.0;
+    if (due > DISCON_MAX_CATCHUP) {
+        inst->resyncs++;
+        inst->schedule.nextHit = t - (DISCON_MAX_CATCHUP - 1)*stepSize;
+        due = DISCON_MAX_CATCHUP;
+    }
+    inst->schedule.started = 1;
+    inst->modelSteps   += (uint64_t)due;
+    inst->catchUpSteps += (uint64_t)due - 1;
+    return (int_T)due;
+}  /* end dueSteps */
+
+/* Function: keepRampStart ===============================================
+ *
+ * Abstract:
+ *      Before the last step of a call, keep the avrSwap outputs of the
+ *      step before: the start of the ramp to the new outputs.
+ */
+static void keepRampStart(DISCON_Instance *inst) {
+    const char_T *Y = (const char_T *)MODEL_Y(inst->S);
+    int_T        k;
+
+    if (!inst->ramp) return;
+    for (k=0; k<NUM_MAPPED(SwapOutputs); k++) {
+        inst->schedule.prevOut[k] =
+            (real32_T)*(const ModelSignal *)(Y + SwapOutputs[k].offset);
+    }
+}  /* end keepRampStart */
+
+/* Function: advanceSchedule ==============================================
+ *
+ * Abstract:
+ *      Account for a model step at the next sample hit.
+ */
+static void advanceSchedule(DISCON_Instance *inst) {
+    inst->schedule.lastHit  = inst->schedule.nextHit;
+    inst->schedule.nextHit += rtmGetStepSize(inst->S);
+}  /* end advanceSchedule */
+
+/* Function: rampSwapOutputs ==============================================
+ *
+ * Abstract:
+ *      Ramp the avrSwap outputs from those before the latest step to those
+ *      after it over one step size, instead of holding them: smooth
+ *      demands between sample hits at the cost of one step of delay. Only
+ *      with $DISCON_INTERPOLATE = 1 and a host that passes rSample, and
+ *      not before the first step after the initialization.
+ */
+static void rampSwapOutputs(const DISCON_Instance *inst, float *avrSwap) {
+    real_T f;
+    int_T  k;
+
+    if (!inst->ramp || !inst->schedule.started || avrSwap[2] <= 0.0f) return;
+
+    f = (avrSwap[1] - inst->schedule.lastHit)/rtmGetStepSize(inst->S);
+    f = MAX(0.0, MIN(1.0, f));
+    for (k=0; k<NUM_MAPPED(SwapOutputs); k++) {
+        real32_T y0 = inst->schedule.prevOut[k];
+
+        avrSwap[SwapOutputs[k].swap] = (float)(y0 + (avrSwap[SwapOutputs[k].swap] - y0)*f);
+    }
+}  /* end rampSwapOutputs */
+#else
+# define dueSteps(inst, avrSwap)       1
+# define keepRampStart(inst)            ((void)0)  /* Do nothing */
+# define advanceSchedule(inst)          /* Do nothing */
+# define rampSwapOutputs(inst, avrSwap) /* Do nothing */
+#endif
+
+/* Before the first step after the initialization call, which a host faster
+ * than the model may call several times */
+#if DISCON_HOST_TIME == 1
+# define NOT_STARTED(inst) (!(inst)->schedule.started)
+#else
+# define NOT_STARTED(inst) 0
+#endif
+
+/* Function: swapStep =====================================================
+ *
+ * Abstract:
+ *      Step an instance through the steps due in this call with its inputs
+ *      taken from avrSwap and, unless a step fails, return its outputs in
+ *      avrSwap. A call between two sample hits returns the outputs of the
+ *      latest step. The sub-rate tasks released by a step run on the
+ *      worker while the following steps run.
  */
-void __declspec(dllexport) __cdecl DISCON(float *avrSwap, int *aviFail, char *accInfile, char *avcOutname, char *avcMsg) 
+static int swapStep(DISCON_Instance *inst, float *avrSwap) {
+    int_T n = dueSteps(inst, avrSwap);
+    int   status = 0;
+
+    loadSwapInputs(inst->S, avrSwap);
+    PROFILE_PHASE(inst, INPUTS);
+    for (; n > 0 && status == 0; n--) {
+        if (n == 1) keepRampStart(inst);
+        status = stepModel(inst);
+        advanceSchedule(inst);
+    }
+    if (status == 0) {
+        storeSwapOutputs(inst, avrSwap);
+        rampSwapOutputs(inst, avrSwap);
+    }
+    PROFILE_PHASE(inst, SCATTER);
+    return status;
+}  /* end swapStep */
+
+/* Function: callController ===============================================
+ *
+ * Abstract:
+ *      One DISCON call of an existing instance. Only touches the instance
+ *      and the buffers passed in, so different instances can be called
+ *      from different threads at the same time. avcOutname and avcMsg may
+ *      be NULL.
+ */
+static void callController(DISCON_Instance *inst, float *avrSwap, int *aviFail, char *avcOutname, char *avcMsg) 
 {
-	int iStatus, iFirstLog;
-	char errorMsg[257], OutName[1025];// inFile[257]; 
-	float rTime, rSample, rGeneratorSpeed, rRatedSpeed, rBelowRatedPitch, 
-			rRotorAzimuth, rOP1RootMoment, rOP2RootMoment, rOP3RootMoment, rIP1RootMoment, rIP2RootMoment, rIP3RootMoment,
-			rForeAftTower, rSideTower, rMeasuredPitch, rMeasuredTorque, rShaftTorque,
-			rModeGain, rInit, rUserVar1, rUserVar2, rUserVar3, rUserVar4, rUserVar5, rUserVar6, rUserVar7, rUserVar8, rUserVar9, rUserVar10,
-			rUserVar11,rUserVar12,rUserVar13,rUserVar14,rUserVar15,rUserVar16,rUserVar17,rUserVar18,rUserVar19,rUserVar20,rYawError,rYawBearingRate,rElectricalPower;
-	static float rTorqueDemand, rPitchDemand, rBlade1Pitch, rBlade2Pitch, 
-			rBlade3Pitch, rYawRate, rLog1,rLog2,rLog3,rLog4,rLog5,rLog6,rLog7,rLog8,rLog9,rLog10,rLog11,rLog12,rLog13,rLog14,rLog15,rLog16,rLog17,rLog18,rLog19,rLog20;
+	int iStatus, k, nLog;
+	char errorMsg[257];// inFile[257]; 
+#if DISCON_CAPTURE == 1
+	disconCapture *capture = NULL;   /* closed by this call */
+	float *captured;
+#endif
 	
 	/* Take local copies of strings */
 	//memcpy(inFile, accInfile, NINT(avrSwap[49]));
@@ -735,161 +2893,243 @@ void __declspec(dllexport) __cdecl DISCON(float *avrSwap, int *aviFail, char *ac
 	
 	/* Set message to blank */
 	memset(errorMsg, ' ', 257);
+	if (inst != NULL) PROFILE_START(inst);
+#if DISCON_CAPTURE == 1
+	captured = captureInputs(inst, avrSwap);
+#endif
 	
 	/* Set constants JW turned this on, see function just above this call*/ 
-	SetParams(avrSwap); /*PF disable this call for Labview's sake*/
+	SetParams(inst, avrSwap); /*PF disable this call for Labview's sake*/
+	if (inst != NULL) PROFILE_PHASE(inst, SETPARAMS);
 	
-	/* Load variables from Bladed (See Appendix A) */
-	iStatus          = NINT(avrSwap[0]);
-	rInit			= avrSwap[0];
-	rUserVar1		= avrSwap[119];
-	rUserVar2		= avrSwap[120];
-	rUserVar3		= avrSwap[121];
-	rUserVar4		= avrSwap[122];
-	rUserVar5		= avrSwap[123];
-	rUserVar6		= avrSwap[124];
-	rUserVar7		= avrSwap[125];
-	rUserVar8		= avrSwap[126];
-	rUserVar9		= avrSwap[127];
-	rUserVar10		= avrSwap[128];
-	rUserVar11		= avrSwap[129];
-	rUserVar12		= avrSwap[130];
-	rUserVar13		= avrSwap[131];
-	rUserVar14		= avrSwap[132];
-	rUserVar15		= avrSwap[133];
-	rUserVar16		= avrSwap[134];
-	rUserVar17		= avrSwap[135];
-	rUserVar18		= avrSwap[136];
-	rUserVar19		= avrSwap[137];
-	rUserVar20		= avrSwap[138];
-	rTime            = avrSwap[1];
-	rSample          = avrSwap[2];
-	rMeasuredPitch   = avrSwap[3];
-	rBelowRatedPitch = avrSwap[4];
-	rModeGain        = avrSwap[15];
-	rRatedSpeed      = avrSwap[18];
-	rGeneratorSpeed  = avrSwap[19];
-	rMeasuredTorque  = avrSwap[22]; /* this was number 22 but I believe it should be 108 but that is the LSS Torque */
-	rShaftTorque	 = avrSwap[108];
-	rOP1RootMoment   = avrSwap[29]; 
-	rOP2RootMoment   = avrSwap[30];
-	rOP3RootMoment   = avrSwap[31];
-	rIP1RootMoment   = avrSwap[68]; 
-	rIP2RootMoment   = avrSwap[69];
-	rIP3RootMoment   = avrSwap[70];
-	rForeAftTower    = avrSwap[52];
-	rSideTower       = avrSwap[53];
-	rRotorAzimuth    = avrSwap[59];
-	rYawError		 = avrSwap[23];
-	rYawBearingRate  = avrSwap[162];
-	rElectricalPower = avrSwap[14];
+	/* Inputs are read from and outputs written to Bladed (See Appendix A)
+	 * through the port tables of discon_io.h */
+	iStatus = NINT(avrSwap[0]);
 	
     /* determine iStatus */
     aviFail[0] = 0;
-    if (iStatus == 0) {
-        
-                /* Initialize Controller */
-        aviFail[0] = initiateController(errorMsg);
-        
-                aviFail[0] = calcOutputController(rUserVar1, rUserVar2, rUserVar3, rUserVar4, rUserVar5,rUserVar6, rUserVar7, rUserVar8, rUserVar9, rUserVar10,
-						rUserVar11,rUserVar12,rUserVar13,rUserVar14,rUserVar15,rUserVar16,rUserVar17,rUserVar18,rUserVar19,rUserVar20, rInit, rGeneratorSpeed, rRatedSpeed,
-                        rBelowRatedPitch, rForeAftTower, rSideTower,
-                        rRotorAzimuth, rOP1RootMoment, rOP2RootMoment,
-                        rOP3RootMoment, rIP1RootMoment, rIP2RootMoment,
-                        rIP3RootMoment, rMeasuredPitch, rMeasuredTorque, rShaftTorque,
-                        rModeGain, rYawError, rYawBearingRate, rElectricalPower, &rTorqueDemand, &rBlade1Pitch, 
-                        &rBlade2Pitch, &rBlade3Pitch, &rPitchDemand, &errorMsg, &rYawRate,
-                        &rLog1,&rLog2,&rLog3,&rLog4,&rLog5,&rLog6,&rLog7,&rLog8,&rLog9,&rLog10,&rLog11,&rLog12,&rLog13,&rLog14,&rLog15,&rLog16,&rLog17,&rLog18,&rLog19,&rLog20);
+    if (inst == NULL) {
+        aviFail[0] = -1;
+        sprintf(errorMsg, "No controller instance for this avrSwap buffer, call with iStatus 0 first");
+    }
+    else if (iStatus == 0) {
         
+        aviFail[0] = swapStep(inst, avrSwap);
 
-        rPitchDemand = rMeasuredPitch;    
-        rTorqueDemand = rMeasuredTorque;
+        /* Hold the measured pitch and torque until the first time step */
+        avrSwap[44] = avrSwap[3];     
+        avrSwap[46] = avrSwap[22];
 		sprintf(errorMsg, "Controller initialization complete");
     }
     else if (iStatus >= 0) {
         /* Main calculation */
-        aviFail[0] = calcOutputController(rUserVar1, rUserVar2, rUserVar3, rUserVar4, rUserVar5,rUserVar6, rUserVar7, rUserVar8, rUserVar9, rUserVar10,
-						rUserVar11,rUserVar12,rUserVar13,rUserVar14,rUserVar15,rUserVar16,rUserVar17,rUserVar18,rUserVar19,rUserVar20, rInit, rGeneratorSpeed, rRatedSpeed,
-                        rBelowRatedPitch, rForeAftTower, rSideTower,
-                        rRotorAzimuth, rOP1RootMoment, rOP2RootMoment,
-                        rOP3RootMoment, rIP1RootMoment, rIP2RootMoment,
-                        rIP3RootMoment, rMeasuredPitch, rMeasuredTorque, rShaftTorque,
-                        rModeGain, rYawError, rYawBearingRate, rElectricalPower, &rTorqueDemand, &rBlade1Pitch, 
-                        &rBlade2Pitch, &rBlade3Pitch, &rPitchDemand, &errorMsg, &rYawRate,
-                        &rLog1,&rLog2,&rLog3,&rLog4,&rLog5,&rLog6,&rLog7,&rLog8,&rLog9,&rLog10,&rLog11,&rLog12,&rLog13,&rLog14,&rLog15,&rLog16,&rLog17,&rLog18,&rLog19,&rLog20);
+        aviFail[0] = swapStep(inst, avrSwap);
+
+        if (NOT_STARTED(inst)) {
+            avrSwap[44] = avrSwap[3];
+            avrSwap[46] = avrSwap[22];
+        }
     }
     else if (iStatus == -1) {
         /* Main calculation */
-        aviFail[0] = calcOutputController(rUserVar1, rUserVar2, rUserVar3, rUserVar4, rUserVar5,rUserVar6, rUserVar7, rUserVar8, rUserVar9, rUserVar10,
-						rUserVar11,rUserVar12,rUserVar13,rUserVar14,rUserVar15,rUserVar16,rUserVar17,rUserVar18,rUserVar19,rUserVar20, rInit, rGeneratorSpeed, rRatedSpeed,
-                        rBelowRatedPitch, rForeAftTower, rSideTower,
-                        rRotorAzimuth, rOP1RootMoment, rOP2RootMoment,
-                        rOP3RootMoment, rIP1RootMoment, rIP2RootMoment,
-                        rIP3RootMoment, rMeasuredPitch, rMeasuredTorque, rShaftTorque,
-                        rModeGain, rYawError, rYawBearingRate, rElectricalPower, &rTorqueDemand, &rBlade1Pitch, 
-                        &rBlade2Pitch, &rBlade3Pitch, &rPitchDemand, &errorMsg, &rYawRate,
-                        &rLog1,&rLog2,&rLog3,&rLog4,&rLog5,&rLog6,&rLog7,&rLog8,&rLog9,&rLog10,&rLog11,&rLog12,&rLog13,&rLog14,&rLog15,&rLog16,&rLog17,&rLog18,&rLog19,&rLog20);
+        aviFail[0] = swapStep(inst, avrSwap);
         
+#if DISCON_CAPTURE == 1
+        /* The trace closes after the outputs of this call */
+        capture = inst->capture;
+        inst->capture = NULL;
+#endif
         /* Perform Cleanup */
-        aviFail[0] = performCleanup(errorMsg);
+        aviFail[0] = performCleanup(inst, errorMsg);
     }
     else {
         aviFail[0] = -1;
         sprintf(errorMsg, "iStatus is not recognized: %d", iStatus);
     }
     
-    /* Store variables to Bladed (See Appendix A) */
-    avrSwap[9] = 0; /* Pitch Angle */
-	avrSwap[27] = 1; /* Individual Pitch control */
-    avrSwap[34] = 1; /* Generator contactor status */
-    avrSwap[35] = 0; /* Shaft brake status: 0=off */
-    avrSwap[40] = 0; /* Demanded yaw actuator torque */
-    avrSwap[41] = rBlade1Pitch;  /* Blade 1 pitch angle demand */
-    avrSwap[42] = rBlade2Pitch;  /* Blade 2 pitch angle demand */
-    avrSwap[43] = rBlade3Pitch;  /* Blade 3 pitch angle demand */
-	avrSwap[44] = rPitchDemand;  /* Pitch angle demand CPC*/
-    avrSwap[46] = rTorqueDemand; /* Generator torque demand */
-    avrSwap[47] = rYawRate; /* Demanded nacelle yaw rate */
-    avrSwap[54] = 0; /* Pitch override */
-    avrSwap[55] = 0; /* Torque override */
-	avrSwap[71] = 0; /* Generator start-up resistance */
-    avrSwap[78] = 1; /* Request for loads: 0=none */
-    avrSwap[79] = 0; /* Variable slip current status */
-    avrSwap[80] = 0; /* Variable slip current demand */
+    /* Store constants to Bladed (See Appendix A) */
+    for (k=0; k<NUM_MAPPED(SwapConstants); k++) {
+        avrSwap[SwapConstants[k].swap] = SwapConstants[k].value;
+    }
 	
 	// To read the log variables in bladed (JW)
-	avrSwap[64] =0; /* Number of variables returned for logging */
-	iFirstLog = NINT(avrSwap[62])-1; //added also this iFirstLog as an integer
-	strcpy(OutName, "Log1:-;Log2:-;Log3:-;Log4:-;Log5:-;Log6:-;Log7:-;Log8:-;Log9:-;Log10:-;Log11:-;Log12:-;Log13:-;Log14:-;Log15:-;Log16:-;Log17:-;Log18:-;Log19:-;Log20:-;"); //Names and units
-    avrSwap[iFirstLog] =rLog1; /*avrSwap[144] = rLog1;*/
-	avrSwap[iFirstLog+1] =rLog2; /*avrSwap[144] = rLog2;*/
-	avrSwap[iFirstLog+2] =rLog3; /*avrSwap[144] = rLog3;*/
-	avrSwap[iFirstLog+3] =rLog4; /*avrSwap[144] = rLog4;*/
-	avrSwap[iFirstLog+4] =rLog5; /*avrSwap[144] = rLog5;*/
-	avrSwap[iFirstLog+5] =rLog6; /*avrSwap[144] = rLog6;*/
-	avrSwap[iFirstLog+6] =rLog7; /*avrSwap[144] = rLog7;*/
-	avrSwap[iFirstLog+7] =rLog8; /*avrSwap[144] = rLog8;*/
-	avrSwap[iFirstLog+8] =rLog9; /*avrSwap[144] = rLog9;*/
-	avrSwap[iFirstLog+9] =rLog10; /*avrSwap[144] = rLog10;*/
-	avrSwap[iFirstLog+10] =rLog11; /*avrSwap[144] = rLog11;*/
-	avrSwap[iFirstLog+11] =rLog12; /*avrSwap[144] = rLog12;*/
-	avrSwap[iFirstLog+12] =rLog13; /*avrSwap[144] = rLog13;*/
-	avrSwap[iFirstLog+13] =rLog14; /*avrSwap[144] = rLog14;*/
-	avrSwap[iFirstLog+14] =rLog15; /*avrSwap[144] = rLog15;*/
-	avrSwap[iFirstLog+15] =rLog16; /*avrSwap[144] = rLog16;*/
-	avrSwap[iFirstLog+16] =rLog17; /*avrSwap[144] = rLog17;*/
-	avrSwap[iFirstLog+17] =rLog18; /*avrSwap[144] = rLog18;*/
-	avrSwap[iFirstLog+18] =rLog19; /*avrSwap[144] = rLog19;*/
-	avrSwap[iFirstLog+19] =rLog20; /*avrSwap[144] = rLog20;*/
-
-    //Return strings
-	memcpy(avcOutname,OutName, NINT(avrSwap[63]));
-	memcpy(avcMsg,errorMsg,MIN(256,NINT(avrSwap[48])));
+	nLog = numLogChannels(avrSwap);
+	avrSwap[64] = (float)nLog; /* Number of variables returned for logging */
+
+    //Return strings; the names and units of the logging channels were built at initialization
+	if (avcOutname != NULL && NINT(avrSwap[50]) > 0) {
+		k = nLog > 0 ? LogChannels.nameEnd[nLog-1] : 0;
+		memcpy(avcOutname, LogChannels.outName, k);
+		avcOutname[k] = '\0';
+	}
+	if (avcMsg != NULL) memcpy(avcMsg,errorMsg,MIN(256,NINT(avrSwap[48])));
+#if DISCON_CAPTURE == 1
+	if (captured != NULL) captureOutputs(captured, avrSwap, aviFail[0], nLog);
+	if (capture != NULL && disconCaptureClose(capture) != 0) {
+		(void)fprintf(stderr, "%s: the trace file is incomplete\n", QUOTE(MODEL));
+	}
+#endif
+	if (inst != NULL && iStatus > 0) PROFILE_END(inst);
 	
   return;
+}  /* end callController */
+
+
+/* Function: main =============================================================
+ *
+ * Abstract:
+ *      Execute model on a generic target such as a workstation.
+ */
+void CDECL DISCON(float *avrSwap, int *aviFail, char *accInfile, char *avcOutname, char *avcMsg) 
+{
+	DISCON_Instance *inst;
+	char errorMsg[257];
+
+	/* Find the instance of this turbine */
+	inst = swapInstance(avrSwap);
+
+#if MULTI_INSTANCE_CODE != 1
+	/* The one model of the classic interface belongs to one buffer */
+	if (inst != NULL && inst->avrSwap != NULL && inst->avrSwap != avrSwap) {
+		sprintf(errorMsg, "%s: the classic interface runs one turbine per process, "
+		        "this controller is in use by another avrSwap buffer", QUOTE(MODEL));
+		aviFail[0] = -1;
+		memcpy(avcMsg,errorMsg,MIN(256,NINT(avrSwap[48])));
+		return;
+	}
+#endif
+
+	if (NINT(avrSwap[0]) == 0) {
+		/* A buffer that is initialized again restarts its instance */
+		if (inst != NULL) {
+			if (DISCON_Reset(inst, errorMsg) != 0) {
+				aviFail[0] = -1;
+				memcpy(avcMsg,errorMsg,MIN(256,NINT(avrSwap[48])));
+				return;
+			}
+		}
+		else {
+			/* Initialize Controller */
+			inst = initiateController(errorMsg);
+			if (inst == NULL) {
+				aviFail[0] = -1;
+				memcpy(avcMsg,errorMsg,MIN(256,NINT(avrSwap[48])));
+				return;
+			}
+			bindInstance(inst, avrSwap);
+		}
+	}
+
+	callController(inst, avrSwap, aviFail, avcOutname, avcMsg);
 }
 		  /* end DISON */
 
+typedef struct {
+	DISCON_Instance **inst;
+	float           **avrSwap;
+	int             *aviFail;
+	char            **avcMsg;
+} BatchStep;
+
+static void batchStepOne(void *ctx, int i) {
+	BatchStep *batch = (BatchStep *)ctx;
+
+	callController(batch->inst[i], batch->avrSwap[i], &batch->aviFail[i], NULL,
+	               batch->avcMsg != NULL ? batch->avcMsg[i] : NULL);
+}
+
+/* Function: DISCON_StepBatch =============================================
+ *
+ * Abstract:
+ *      Call n instances for one time step on the worker pool.
+ */
+int DISCON_StepBatch(DISCON_Instance **inst, float **avrSwap, int *aviFail, char **avcMsg, int n)
+{
+	BatchStep batch;
+	int       i, nFailed = 0;
+
+	batch.inst    = inst;
+	batch.avrSwap = avrSwap;
+	batch.aviFail = aviFail;
+	batch.avcMsg  = avcMsg;
+	disconPoolRun(batchStepOne, &batch, n);
+
+	for (i=0; i<n; i++) {
+		if (aviFail[i] < 0) nFailed++;
+	}
+	return nFailed;
+}  /* end DISCON_StepBatch */
+
+typedef struct {
+	DISCON_Instance **inst;
+	const float     *in;
+	float           *out;
+	int             *aviFail;
+	int             n;
+} BatchSoA;
+
+static void batchSoAOne(void *ctx, int i) {
+	BatchSoA *batch = (BatchSoA *)ctx;
+
+	batch->aviFail[i] = calcOutputController(batch->inst[i],
+	                                         batch->in + i, (size_t)batch->n,
+	                                         batch->out + i, (size_t)batch->n);
+}
+
+/* Function: DISCON_StepSoA ===============================================
+ *
+ * Abstract:
+ *      Step n instances once from struct-of-arrays buffers. Instance i
+ *      reads column i of the input arrays and writes column i of the
+ *      output arrays, so the workers never share a model.
+ */
+int DISCON_StepSoA(DISCON_Instance **inst, const float *in, float *out, int *aviFail, int n)
+{
+	BatchSoA batch;
+	int      i, nFailed = 0;
+
+	batch.inst    = inst;
+	batch.in      = in;
+	batch.out     = out;
+	batch.aviFail = aviFail;
+	batch.n       = n;
+	disconPoolRun(batchSoAOne, &batch, n);
+
+	for (i=0; i<n; i++) {
+		if (aviFail[i] < 0) nFailed++;
+	}
+	return nFailed;
+}  /* end DISCON_StepSoA */
+
+/* Function: DISCON_RunSoA ================================================
+ *
+ * Abstract:
+ *      Step one instance through nSteps time steps of struct-of-arrays
+ *      buffers.
+ */
+int DISCON_RunSoA(DISCON_Instance *inst, const float *in, float *out, int nSteps)
+{
+	int t;
+
+	for (t=0; t<nSteps; t++) {
+		if (calcOutputController(inst, in + t, (size_t)nSteps,
+		                         out + t, (size_t)nSteps) != 0) {
+			break;
+		}
+	}
+	return t;
+}  /* end DISCON_RunSoA */
+
+/* Function: DISCON_StopWorkers ===========================================
+ *
+ * Abstract:
+ *      Join the worker threads of DISCON_StepBatch and DISCON_StepSoA.
+ */
+void DISCON_StopWorkers(void)
+{
+	disconPoolShutdown();
+}
+
 
 
 /* EOF: discon_main.c */
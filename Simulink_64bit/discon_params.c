@@ -0,0 +1,704 @@
+/*
+ * File    : discon_params.c
+ *
+ * Abstract:
+ *      Parser and process-wide cache of the run-time controller parameter
+ *      file, see discon_params.h.
+ */
+
+#if !defined _WIN32 && (!defined _POSIX_C_SOURCE || _POSIX_C_SOURCE < 200809L)
+# undef _POSIX_C_SOURCE
+# define _POSIX_C_SOURCE 200809L        /* st_mtim with -std=c99 */
+#endif
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#if !defined _WIN32
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+#include "discon_params.h"
+#include "discon_threads.h"
+
+/*=========*
+ * Defines *
+ *=========*/
+
+#if defined(__linux__)
+# define STAT_MTIME_NSEC(st) ((long)(st).st_mtim.tv_nsec)
+#else
+# define STAT_MTIME_NSEC(st) 0L
+#endif
+
+/*==================================*
+ * Global data local to this module *
+ *==================================*/
+
+struct disconParamSet {
+    disconParamSet *next;           /* next cached file                     */
+    char           *path;
+    time_t         mtime;           /* identify the parsed file version     */
+    long           mtimeNsec;
+    double         size;
+    int            refs;            /* users, plus one while in the cache   */
+    int            count;
+    disconParam    *params;
+    double         *values;         /* text file: all parsed values         */
+    const char     *map;            /* binary file: read-only mapping       */
+    size_t         mapSize;
+    double         userVar[DISCON_NUM_USERVARS];
+};
+
+/* Parsed files, most recently loaded first */
+static disconParamSet *Cache = NULL;
+static disconMutex     CacheLock = DISCON_MUTEX_INITIALIZER;
+
+/* Set selected for the model code running on this thread */
+static THREAD_LOCAL const disconParamSet *Current    = NULL;
+static THREAD_LOCAL int                  HasCurrent = 0;
+
+/* Work vectors filled in on this thread, see disconParamsRecordWork */
+static THREAD_LOCAL void                 ***WorkSlots = NULL;
+static THREAD_LOCAL int                  WorkMax    = 0;
+static THREAD_LOCAL int                  *WorkCount = NULL;
+
+/* Set of the process default file, for model code run outside an instance */
+static disconParamSet *Default = NULL;
+static int            DefaultLoaded = 0;
+static disconMutex    DefaultLock = DISCON_MUTEX_INITIALIZER;
+
+/*=================*
+ * Local functions *
+ *=================*/
+
+#if defined _WIN32
+
+/* Function: mapFile ======================================================
+ *
+ * Abstract:
+ *      Map a file read-only. Pages are read on first access, so mapping a
+ *      large file costs next to nothing until its data is used.
+ */
+static const char *mapFile(const char *path, size_t size) {
+    HANDLE     file, mapping;
+    const char *view;
+
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) return NULL;
+    view = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+    CloseHandle(mapping);   /* the view keeps the mapping alive */
+    return view;
+}  /* end mapFile */
+
+static void unmapFile(const char *view, size_t size) {
+    (void)size;
+    UnmapViewOfFile(view);
+}  /* end unmapFile */
+
+#else
+
+/* Function: mapFile ======================================================
+ *
+ * Abstract:
+ *      Map a file read-only. Pages are read on first access, so mapping a
+ *      large file costs next to nothing until its data is used.
+ */
+static const char *mapFile(const char *path, size_t size) {
+    void *view;
+    int  fd = open(path, O_RDONLY);
+
+    if (fd < 0) return NULL;
+    view = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);              /* the mapping keeps the file open */
+    return view == MAP_FAILED ? NULL : (const char *)view;
+}  /* end mapFile */
+
+static void unmapFile(const char *view, size_t size) {
+    munmap((void *)view, size);
+}  /* end unmapFile */
+
+#endif
+
+/* Function: freeSet ======================================================
+ *
+ * Abstract:
+ *      Free a parameter set that is no longer referenced.
+ */
+static void freeSet(disconParamSet *set) {
+    free(set->path);
+    free(set->params);
+    free(set->values);
+    if (set->map != NULL) unmapFile(set->map, set->mapSize);
+    free(set);
+}  /* end freeSet */
+
+/* Function: addParam =====================================================
+ *
+ * Abstract:
+ *      Append an entry to the set, rejecting duplicate names. The entries
+ *      array grows by doubling; *capacity tracks its size.
+ */
+static disconParam *addParam(disconParamSet *set, int *capacity,
+                             const char *name, size_t nameLen,
+                             const char *file, int lineNo, char *errorMsg) {
+    disconParam *param;
+    int         i;
+
+    if (nameLen == 0 || nameLen >= DISCON_PARAM_NAME_LEN) {
+        sprintf(errorMsg, "%.100s:%d: parameter names must have 1 to %d characters",
+                file, lineNo, DISCON_PARAM_NAME_LEN-1);
+        return NULL;
+    }
+    for (i=0; i<set->count; i++) {
+        if (strlen(set->params[i].name) == nameLen &&
+            strncmp(set->params[i].name, name, nameLen) == 0) {
+            sprintf(errorMsg, "%.100s:%d: parameter %.*s is defined twice",
+                    file, lineNo, (int)nameLen, name);
+            return NULL;
+        }
+    }
+    if (set->count == *capacity) {
+        int         newCapacity = *capacity > 0 ? 2*(*capacity) : 64;
+        disconParam *params = (disconParam *)realloc(set->params,
+                                       newCapacity*sizeof(disconParam));
+        if (params == NULL) {
+            sprintf(errorMsg, "%.100s: out of memory", file);
+            return NULL;
+        }
+        set->params = params;
+        *capacity   = newCapacity;
+    }
+    param = &set->params[set->count++];
+    memset(param, 0, sizeof(*param));
+    memcpy(param->name, name, nameLen);
+    return param;
+}  /* end addParam */
+
+/* Function: isNameChar ===================================================
+ *
+ * Abstract:
+ *      Characters allowed in a parameter name.
+ */
+static int isNameChar(int c) {
+    return isalnum(c) || c == '_' || c == '.';
+}  /* end isNameChar */
+
+/* Function: parseText ====================================================
+ *
+ * Abstract:
+ *      Parse the text format. buffer holds the NUL terminated file and is
+ *      modified. All values go into one array, sized for the worst case
+ *      of one value per two characters.
+ */
+static int parseText(disconParamSet *set, char *buffer, size_t size,
+                     const char *file, char *errorMsg) {
+    char        *line, *next, *p, *end;
+    disconParam *param;
+    size_t      nValues = 0, maxValues = size/2 + 1;
+    int         capacity = 0, lineNo, i;
+
+    set->values = (double *)malloc(maxValues*sizeof(double));
+    if (set->values == NULL) {
+        sprintf(errorMsg, "%.100s: out of memory", file);
+        return -1;
+    }
+
+    for (line=buffer, lineNo=1; *line != '\0'; line=next, lineNo++) {
+        char   *eq;
+        size_t first = nValues;
+        int    rows = 0, cols = -1, inRow = 0;
+
+        next = strchr(line, '\n');
+        if (next != NULL) {
+            *next++ = '\0';
+        } else {
+            next = line + strlen(line);
+        }
+        line[strcspn(line, "#%!")] = '\0';
+        while (isspace((unsigned char)*line)) line++;
+        if (*line == '\0') continue;
+
+        eq = strchr(line, '=');
+        if (eq == NULL) {
+            /*
+             * Original discon.in: line N holds userVarN. Blank and comment
+             * lines keep their slot (and leave it 0), as the 20 fgets of
+             * the original reader did.
+             */
+            char   name[DISCON_PARAM_NAME_LEN];
+            double value = strtod(line, &end);
+
+            if (end == line) {
+                sprintf(errorMsg, "%.100s:%d: expected \"name = value\" or a number, found \"%.40s\"",
+                        file, lineNo, line);
+                return -1;
+            }
+            if (lineNo > DISCON_NUM_USERVARS) {
+                sprintf(errorMsg, "%.100s:%d: a bare number sets userVar<line> and must be on lines 1 to %d",
+                        file, lineNo, DISCON_NUM_USERVARS);
+                return -1;
+            }
+            sprintf(name, "userVar%d", lineNo);
+            param = addParam(set, &capacity, name, strlen(name), file, lineNo, errorMsg);
+            if (param == NULL) return -1;
+            set->values[nValues++] = value;
+            param->rows = param->cols = 1;
+            param->data = set->values + first;
+            continue;
+        }
+
+        /* name = values */
+        for (end=eq; end>line && isspace((unsigned char)end[-1]); end--);
+        for (p=line; p<end; p++) {
+            if (!isNameChar((unsigned char)*p)) {
+                sprintf(errorMsg, "%.100s:%d: invalid parameter name \"%.*s\"",
+                        file, lineNo, (int)(end-line > 40 ? 40 : end-line), line);
+                return -1;
+            }
+        }
+        param = addParam(set, &capacity, line, (size_t)(end-line), file, lineNo, errorMsg);
+        if (param == NULL) return -1;
+
+        for (p=eq+1; ; ) {
+            while (isspace((unsigned char)*p) || *p == ',' || *p == '[' || *p == ']') p++;
+            if (*p == ';' || *p == '\0') {
+                if (inRow > 0) {
+                    if (cols < 0) {
+                        cols = inRow;
+                    } else if (inRow != cols) {
+                        sprintf(errorMsg, "%.100s:%d: rows of %s have different lengths",
+                                file, lineNo, param->name);
+                        return -1;
+                    }
+                    rows++;
+                    inRow = 0;
+                }
+                if (*p == '\0') break;
+                p++;
+                continue;
+            }
+            set->values[nValues] = strtod(p, &end);
+            if (end == p || !(isspace((unsigned char)*end) || *end == '\0' ||
+                              strchr(",;[]", *end) != NULL)) {
+                sprintf(errorMsg, "%.100s:%d: invalid value \"%.20s\" for %s",
+                        file, lineNo, p, param->name);
+                return -1;
+            }
+            nValues++;
+            inRow++;
+            p = end;
+        }
+        if (rows == 0) {
+            sprintf(errorMsg, "%.100s:%d: no value for %s", file, lineNo, param->name);
+            return -1;
+        }
+        param->rows = rows;
+        param->cols = cols;
+        param->data = set->values + first;
+    }
+
+    /* Values were stored row by row */
+    for (i=0; i<set->count; i++) {
+        param = &set->params[i];
+        if (param->rows > 1 && param->cols > 1) {
+            /* transpose to column-major, like the binary format */
+            int    r, c, n = param->rows*param->cols;
+            double *tmp = (double *)malloc(n*sizeof(double));
+            double *data = (double *)param->data;
+
+            if (tmp == NULL) {
+                sprintf(errorMsg, "%.100s: out of memory", file);
+                return -1;
+            }
+            for (r=0; r<param->rows; r++) {
+                for (c=0; c<param->cols; c++) {
+                    tmp[c*param->rows + r] = data[r*param->cols + c];
+                }
+            }
+            memcpy(data, tmp, n*sizeof(double));
+            free(tmp);
+        }
+    }
+    return 0;
+}  /* end parseText */
+
+/* Function: parseBinary ==================================================
+ *
+ * Abstract:
+ *      Check the binary format and point the entries at the data, which
+ *      stays in the file mapping.
+ */
+static int parseBinary(disconParamSet *set, const char *buffer, size_t size,
+                       const char *file, char *errorMsg) {
+    const disconParamFileHeader *header = (const disconParamFileHeader *)buffer;
+    const disconParamFileEntry  *entry;
+    uint32_t                    i;
+    int                         capacity = 0;
+
+    if (size < sizeof(*header)) {
+        sprintf(errorMsg, "%.100s: truncated header", file);
+        return -1;
+    }
+    if (header->version != DISCON_PARAM_VERSION) {
+        sprintf(errorMsg, "%.100s: unsupported parameter file version %u (expected %d)",
+                file, (unsigned)header->version, DISCON_PARAM_VERSION);
+        return -1;
+    }
+    if (header->count > (size - sizeof(*header))/sizeof(*entry)) {
+        sprintf(errorMsg, "%.100s: truncated entry table", file);
+        return -1;
+    }
+
+    entry = (const disconParamFileEntry *)(buffer + sizeof(*header));
+    for (i=0; i<header->count; i++, entry++) {
+        disconParam *param;
+        uint64_t    n = (uint64_t)entry->rows * entry->cols;
+        size_t      nameLen = strlen(entry->name);
+
+        if (memchr(entry->name, '\0', DISCON_PARAM_NAME_LEN) == NULL) {
+            sprintf(errorMsg, "%.100s: entry %u has no valid name", file, (unsigned)i);
+            return -1;
+        }
+        param = addParam(set, &capacity, entry->name, nameLen, file, 0, errorMsg);
+        if (param == NULL) return -1;
+        if (n == 0 || n > 0x7fffffff || entry->offset % sizeof(double) != 0 ||
+            entry->offset > size || n > (size - entry->offset)/sizeof(double)) {
+            sprintf(errorMsg, "%.100s: data of %s is outside the file", file, param->name);
+            return -1;
+        }
+        param->rows = (int)entry->rows;
+        param->cols = (int)entry->cols;
+        param->data = (const double *)(buffer + entry->offset);
+    }
+    return 0;
+}  /* end parseBinary */
+
+/* Function: loadFile =====================================================
+ *
+ * Abstract:
+ *      Parse a parameter file into a new set with no references. Binary
+ *      files are mapped rather than read; the entries point into the
+ *      mapping, so only the pages the model actually uses are ever loaded.
+ */
+static int loadFile(const char *path, const struct stat *st,
+                    disconParamSet **result, char *errorMsg) {
+    disconParamSet *set;
+    FILE           *pFile;
+    size_t         size = (size_t)st->st_size;
+    int            status, k;
+    char           name[DISCON_PARAM_NAME_LEN];
+    char           magic[sizeof(DISCON_PARAM_MAGIC)];
+    char           *buffer;
+
+    set = (disconParamSet *)calloc(1, sizeof(*set));
+    if (set == NULL) {
+        sprintf(errorMsg, "%.100s: out of memory", path);
+        return -1;
+    }
+    set->path = (char *)malloc(strlen(path)+1);
+    if (set->path == NULL) {
+        sprintf(errorMsg, "%.100s: out of memory", path);
+        freeSet(set);
+        return -1;
+    }
+    strcpy(set->path, path);
+    set->mtime     = st->st_mtime;
+    set->mtimeNsec = STAT_MTIME_NSEC(*st);
+    set->size      = (double)st->st_size;
+
+    pFile = fopen(path, "rb");
+    if (pFile == NULL) {
+        sprintf(errorMsg, "%.100s: read error", path);
+        freeSet(set);
+        return -1;
+    }
+
+    if (size >= sizeof(disconParamFileHeader) &&
+        fread(magic, 1, sizeof(magic), pFile) == sizeof(magic) &&
+        memcmp(magic, DISCON_PARAM_MAGIC, sizeof(magic)) == 0) {
+        fclose(pFile);
+        set->map = mapFile(path, size);
+        if (set->map == NULL) {
+            sprintf(errorMsg, "%.100s: unable to map the file", path);
+            freeSet(set);
+            return -1;
+        }
+        set->mapSize = size;
+        status = parseBinary(set, set->map, size, path, errorMsg);
+    } else {
+        buffer = (char *)malloc(size+1);
+        if (buffer == NULL) {
+            sprintf(errorMsg, "%.100s: out of memory", path);
+            fclose(pFile);
+            freeSet(set);
+            return -1;
+        }
+        rewind(pFile);
+        if (fread(buffer, 1, size, pFile) != size) {
+            sprintf(errorMsg, "%.100s: read error", path);
+            free(buffer);
+            fclose(pFile);
+            freeSet(set);
+            return -1;
+        }
+        fclose(pFile);
+        buffer[size] = '\0';
+        status = parseText(set, buffer, size, path, errorMsg);
+        free(buffer);
+    }
+
+    for (k=0; status == 0 && k<DISCON_NUM_USERVARS; k++) {
+        const disconParam *param;
+
+        sprintf(name, "userVar%d", k+1);
+        param = disconParamsFind(set, name);
+        if (param == NULL) continue;
+        if (param->rows*param->cols != 1) {
+            sprintf(errorMsg, "%.100s: %s must be a scalar", path, name);
+            status = -1;
+        } else {
+            set->userVar[k] = param->data[0];
+        }
+    }
+
+    if (status != 0) {
+        freeSet(set);
+        return -1;
+    }
+    *result = set;
+    return 0;
+}  /* end loadFile */
+
+/* Function: currentSet ===================================================
+ *
+ * Abstract:
+ *      Parameter set for model code on this thread: the one selected with
+ *      disconParamsSetCurrent or, outside a controller instance (e.g. when
+ *      the model is simulated in Simulink), the process default file.
+ */
+static const disconParamSet *currentSet(void) {
+    if (HasCurrent) return Current;
+
+    disconMutexLock(&DefaultLock);
+    if (!DefaultLoaded) {
+        char errorMsg[257];
+
+        if (disconParamsAcquire(disconParamsPath(), &Default, errorMsg) != 0) {
+            (void)fprintf(stderr, "%s\n", errorMsg);
+        }
+        DefaultLoaded = 1;
+    }
+    disconMutexUnlock(&DefaultLock);
+    return Default;
+}  /* end currentSet */
+
+/*===================*
+ * Visible functions *
+ *===================*/
+
+/* Function: disconParamsPath =============================================
+ *
+ * Abstract:
+ *      Parameter file of the process. The environment variable
+ *      DISCON_PARAMETER_FILE selects another file, so one controller
+ *      binary can run any number of tuning variants.
+ */
+const char *disconParamsPath(void) {
+    const char *env = getenv("DISCON_PARAMETER_FILE");
+
+    return (env != NULL && env[0] != '\0') ? env : DISCON_PARAMETER_FILE;
+}  /* end disconParamsPath */
+
+/* Function: disconParamsAcquire ==========================================
+ *
+ * Abstract:
+ *      Return the cached set of a file, or parse the file when it is new or
+ *      its modification time or size changed. A changed file replaces the
+ *      cached set; instances still using the old set keep it until they
+ *      release it.
+ */
+int disconParamsAcquire(const char *path, disconParamSet **set, char *errorMsg) {
+    struct stat    st;
+    disconParamSet *p, **pp;
+    int            status;
+
+    *set = NULL;
+    if (stat(path, &st) != 0) {
+        return 0;   /* no parameter file */
+    }
+
+    disconMutexLock(&CacheLock);
+    for (pp=&Cache; (p = *pp) != NULL; pp=&p->next) {
+        if (strcmp(p->path, path) != 0) continue;
+
+        if (p->mtime == st.st_mtime && p->mtimeNsec == STAT_MTIME_NSEC(st) &&
+            p->size == (double)st.st_size) {
+            p->refs++;
+            *set = p;
+            disconMutexUnlock(&CacheLock);
+            return 0;
+        }
+        *pp = p->next;
+        if (--p->refs == 0) freeSet(p);
+        break;
+    }
+
+    status = loadFile(path, &st, &p, errorMsg);
+    if (status == 0) {
+        p->refs = 2;    /* the cache and the caller */
+        p->next = Cache;
+        Cache   = p;
+        *set    = p;
+    }
+    disconMutexUnlock(&CacheLock);
+    return status;
+}  /* end disconParamsAcquire */
+
+/* Function: disconParamsRelease ==========================================
+ *
+ * Abstract:
+ *      Drop a reference to a parameter set.
+ */
+void disconParamsRelease(disconParamSet *set) {
+    if (set == NULL) return;
+
+    disconMutexLock(&CacheLock);
+    if (--set->refs == 0) freeSet(set);
+    disconMutexUnlock(&CacheLock);
+}  /* end disconParamsRelease */
+
+/* Function: disconParamsRetain ===========================================
+ *
+ * Abstract:
+ *      Take another reference to a set held by the caller.
+ */
+disconParamSet *disconParamsRetain(disconParamSet *set) {
+    if (set == NULL) return NULL;
+
+    disconMutexLock(&CacheLock);
+    set->refs++;
+    disconMutexUnlock(&CacheLock);
+    return set;
+}  /* end disconParamsRetain */
+
+/* Function: disconParamsFind =============================================
+ *
+ * Abstract:
+ *      Look up a parameter by name.
+ */
+const disconParam *disconParamsFind(const disconParamSet *set, const char *name) {
+    int i;
+
+    if (set == NULL) return NULL;
+    for (i=0; i<set->count; i++) {
+        if (strcmp(set->params[i].name, name) == 0) {
+            return &set->params[i];
+        }
+    }
+    return NULL;
+}  /* end disconParamsFind */
+
+/* Function: disconParamsUserVar ==========================================
+ *
+ * Abstract:
+ *      Value of userVar<k+1>.
+ */
+double disconParamsUserVar(const disconParamSet *set, int k) {
+    return set->userVar[k];
+}  /* end disconParamsUserVar */
+
+/* Function: disconParamsSetCurrent ======================================
+ *
+ * Abstract:
+ *      Select the parameter set seen by the model code on this thread.
+ */
+void disconParamsSetCurrent(const disconParamSet *set) {
+    Current    = set;
+    HasCurrent = 1;
+}  /* end disconParamsSetCurrent */
+
+/* Function: disconParamsRecordWork =======================================
+ *
+ * Abstract:
+ *      Start or stop recording the work vectors of the parameter blocks
+ *      started on this thread.
+ */
+void disconParamsRecordWork(void ***slots, int max, int *count) {
+    WorkSlots = slots;
+    WorkMax   = max;
+    WorkCount = count;
+}  /* end disconParamsRecordWork */
+
+/* Function: DISCON_ParamStart ============================================
+ *
+ * Abstract:
+ *      Start function of the parameter blocks: find the entry named by the
+ *      NUL terminated block parameter and keep a pointer to it in the
+ *      block's work vector. A missing entry reads as 0.
+ */
+void DISCON_ParamStart(void **work, const signed char *name) {
+    const disconParamSet *set = currentSet();
+
+    *work = (void *)disconParamsFind(set, (const char *)name);
+    if (WorkSlots != NULL && *WorkCount < WorkMax) {
+        WorkSlots[(*WorkCount)++] = work;
+    }
+    if (*work == NULL && set != NULL) {
+        (void)fprintf(stderr, "DISCON: parameter %.*s not found, using 0\n",
+                      DISCON_PARAM_NAME_LEN, (const char *)name);
+    }
+}  /* end DISCON_ParamStart */
+
+/* Function: DISCON_ParamLookup ===========================================
+ *
+ * Abstract:
+ *      Linear interpolation in a 2xN table whose first row holds the
+ *      increasing breakpoints, clamped to the end values. Any other entry
+ *      returns its first element.
+ */
+double DISCON_ParamLookup(void *work, double u) {
+    const disconParam *param = (const disconParam *)work;
+    const double      *t;
+    int               lo, hi, mid;
+
+    if (param == NULL) return 0.0;
+    t = param->data;                /* column-major: t[2*j] x, t[2*j+1] y */
+    if (param->rows != 2 || param->cols < 2) return t[0];
+
+    hi = param->cols-1;
+    if (u <= t[0])    return t[1];
+    if (u >= t[2*hi]) return t[2*hi+1];
+    lo = 0;
+    while (hi - lo > 1) {
+        mid = (lo + hi)/2;
+        if (u < t[2*mid]) hi = mid; else lo = mid;
+    }
+    return t[2*lo+1] + (t[2*hi+1] - t[2*lo+1])*(u - t[2*lo])/(t[2*hi] - t[2*lo]);
+}  /* end DISCON_ParamLookup */
+
+/* Function: DISCON_ParamElement ==========================================
+ *
+ * Abstract:
+ *      Element index (1-based, column-major as in MATLAB) of an entry, 0
+ *      when the index is out of range.
+ */
+double DISCON_ParamElement(void *work, int index) {
+    const disconParam *param = (const disconParam *)work;
+
+    if (param == NULL || index < 1 || index > param->rows*param->cols) {
+        return 0.0;
+    }
+    return param->data[index-1];
+}  /* end DISCON_ParamElement */
+
+/* EOF: discon_params.c */
@@ -0,0 +1,133 @@
+/*
+ * File    : discon_params.h
+ *
+ * Abstract:
+ *      Run-time controller parameters (discon.in).
+ *
+ *      A parameter file is parsed once per process and cached by path,
+ *      modification time and size; every controller instance created while
+ *      the file is unchanged shares the same parsed parameter set. Two
+ *      formats are accepted:
+ *
+ *      Text    One parameter per line, either "name = values" or, as in the
+ *              original discon.in, a bare number on line N (1 to 20)
+ *              that sets userVarN; blank and comment lines keep their
+ *              line's slot. Values are separated by blanks or commas, ';'
+ *              starts a new row and brackets are ignored, so
+ *                  Kp_sched = [0.1 0.2 0.3; 1.0 1.1 1.2]
+ *              is a 2x3 table. '#', '%' and '!' start a comment.
+ *
+ *      Binary  A disconParamFileHeader, count disconParamFileEntry records
+ *              and the data: rows*cols doubles per entry, column-major as
+ *              in MATLAB, each array 8-byte aligned. Written by
+ *              DISCON_WriteParams.m; recognized by its magic. The file is
+ *              memory mapped and never copied: entries point into the
+ *              mapping and pages are loaded as the model touches them.
+ *              Replace a mapped file by writing a new one and renaming it
+ *              over the old, never by rewriting it in place.
+ *
+ *      The scalars userVar1..userVar20 feed the model inputs of the same
+ *      names; all other entries are available by name, to the host through
+ *      DISCON_GetParameter and to the model through the blocks built by
+ *      DISCON_ParamBlocks.m (DISCON_ParamStart/Lookup/Element below).
+ */
+
+#ifndef DISCON_PARAMS_H
+#define DISCON_PARAMS_H
+
+#include <stdint.h>
+
+#include "discon.h"
+
+/* Default parameter file, relative to the working directory of the host */
+#ifndef DISCON_PARAMETER_FILE
+# define DISCON_PARAMETER_FILE "discon.in"
+#endif
+
+#define DISCON_NUM_USERVARS    20
+#define DISCON_PARAM_NAME_LEN  48
+
+/* Binary parameter file layout (native byte order) */
+#define DISCON_PARAM_MAGIC     "DISCONP"
+#define DISCON_PARAM_VERSION   1
+
+typedef struct {
+    char     magic[8];              /* DISCON_PARAM_MAGIC, NUL padded      */
+    uint32_t version;               /* DISCON_PARAM_VERSION                */
+    uint32_t count;                 /* number of entries                   */
+} disconParamFileHeader;            /* 16 bytes */
+
+typedef struct {
+    char     name[DISCON_PARAM_NAME_LEN];  /* NUL terminated               */
+    uint32_t rows;
+    uint32_t cols;
+    uint64_t offset;                /* byte offset of the data in the file */
+} disconParamFileEntry;             /* 64 bytes */
+
+/* One named parameter, a rows x cols column-major array */
+typedef struct {
+    char         name[DISCON_PARAM_NAME_LEN];
+    int          rows;
+    int          cols;
+    const double *data;
+} disconParam;
+
+/* A parsed parameter file, shared and reference counted */
+typedef struct disconParamSet disconParamSet;
+
+/*
+ * Get a reference to the parameters in path, parsing the file only if it
+ * is not cached or has changed. Returns 0 and sets *set, which is NULL
+ * when the file does not exist. Returns -1 and fills errorMsg (at least
+ * 257 characters) when the file is invalid.
+ */
+DISCON_LOCAL int  disconParamsAcquire(const char *path, disconParamSet **set,
+                                      char *errorMsg);
+
+/* Drop a reference obtained from disconParamsAcquire (NULL is ignored) */
+DISCON_LOCAL void disconParamsRelease(disconParamSet *set);
+
+/* Take another reference to a set the caller holds; returns set */
+DISCON_LOCAL disconParamSet *disconParamsRetain(disconParamSet *set);
+
+/* Look up a parameter by name; NULL when the set has no such entry */
+DISCON_LOCAL const disconParam *disconParamsFind(const disconParamSet *set,
+                                                 const char *name);
+
+/* Value of userVar<k+1>, 0 when the file does not set it */
+DISCON_LOCAL double disconParamsUserVar(const disconParamSet *set, int k);
+
+/* Parameter file of the process: $DISCON_PARAMETER_FILE or the default */
+DISCON_LOCAL const char *disconParamsPath(void);
+
+/*
+ * Select the set seen by the model code on the calling thread. The library
+ * selects the set of an instance before it initializes or steps its model;
+ * model code on a thread without a selection sees the process default file.
+ */
+DISCON_LOCAL void disconParamsSetCurrent(const disconParamSet *set);
+
+/*
+ * Record the addresses of the work vectors that the parameter blocks
+ * started on the calling thread point at their entries: up to max of them
+ * go into slots, counted in *count. NULL slots stops recording. The
+ * library keeps these pointers out of state snapshots.
+ */
+DISCON_LOCAL void disconParamsRecordWork(void ***slots, int max, int *count);
+
+/*
+ * Model access (Legacy Code Tool specs, see DISCON_ParamBlocks.m):
+ *   start   DISCON_ParamStart(void **work1, int8 p1[])
+ *   output  double y1 = DISCON_ParamLookup(void *work1, double u1)
+ *   output  double y1 = DISCON_ParamElement(void *work1, int32 u1)
+ * The start function resolves the name p1 once; the outputs read the data
+ * in place. Lookup interpolates a 2xN table (breakpoints in the first row);
+ * Element returns a 1-based column-major element.
+ */
+DISCON_LOCAL void   DISCON_ParamStart(void **work, const signed char *name);
+DISCON_LOCAL double DISCON_ParamLookup(void *work, double u);
+DISCON_LOCAL double DISCON_ParamElement(void *work, int index);
+
+#endif /* DISCON_PARAMS_H */
+
+/* EOF: discon_params.h */
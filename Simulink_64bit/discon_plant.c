@@ -0,0 +1,1001 @@
+/*
+ * File    : discon_plant.c
+ *
+ * Abstract:
+ *      Reduced-order turbine plant, see discon_plant.h.
+ *
+ *      The rotor is tabulated once, when the project is loaded: for every
+ *      tip speed ratio and pitch of the grid below, a BEM solution of the
+ *      blade (Prandtl tip loss, Buhl's high induction correction, solved
+ *      for the inflow angle as in Ning, "A simple solution method for the
+ *      blade element momentum equations with guaranteed convergence", Wind
+ *      Energy 17, 2014) gives the thrust, torque and blade root moments in
+ *      coefficient form. A step of the plant then only interpolates the
+ *      tables, once per blade.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "discon_plant.h"
+
+/*=========*
+ * Defines *
+ *=========*/
+
+#define PI              3.14159265358979323846
+
+#define MAX_STATIONS    256         /* blade and tower stations              */
+#define MAX_ALPHA       1024        /* points of an aerofoil table           */
+#define MAX_FOILS       32
+
+/* Aerofoil tables, resampled to a uniform angle of attack, deg */
+#define ALPHA_STEP      0.5
+#define N_ALPHA         721         /* -180..180                             */
+
+/* Rotor coefficient grid: tip speed ratio, and pitch in deg, finer up to
+ * PITCH_KNEE where the controller spends its time */
+#define LAMBDA_STEP     0.25
+#define N_LAMBDA        81          /* 0..20                                 */
+#define PITCH_FIRST     -5.0
+#define PITCH_FINE      0.5
+#define PITCH_KNEE      30.0
+#define PITCH_COARSE    2.5
+#define N_PITCH_FINE    70          /* steps from PITCH_FIRST to PITCH_KNEE  */
+#define N_PITCH         (N_PITCH_FINE + 25)     /* up to 92.5                */
+
+/* Coefficients per grid point */
+enum { COEF_CT, COEF_CQ, COEF_FLAP, COEF_EDGE, NUM_COEF };
+
+/* Defaults of what the project does not give */
+#define DEFAULT_PITCH_TAU   0.1     /* s                                     */
+#define DEFAULT_STEP        0.005   /* s                                     */
+#define SHEAR_RADIUS        0.7     /* of the tip radius                     */
+#define MIN_INFLOW          0.1     /* m/s, rotor inflow used at least       */
+
+/* BEM section of the blade */
+typedef struct {
+    int    n;
+    double r[MAX_STATIONS];         /* from the rotor axis                  */
+    double chord[MAX_STATIONS];
+    double twist[MAX_STATIONS];
+    int    foil[MAX_STATIONS];      /* 0-based                              */
+} Blade;
+
+/* A blade element being solved */
+typedef struct {
+    const double *foil;             /* cl, cd pairs at ALPHA_STEP           */
+    double       lr;                /* local speed ratio                    */
+    double       sigma;             /* local solidity B c/(2 pi r)          */
+    double       theta;             /* twist and pitch                      */
+    double       tipF;              /* B/2 (R - r)/r, 0 without tip loss    */
+    /* at the last evaluation */
+    double       a, ap, cn, ct;
+} Element;
+
+struct disconPlant {
+    disconPlantParams       params;
+    disconPlantState        state;
+    double                  coef[N_LAMBDA*N_PITCH*NUM_COEF];
+    double                  acceleration;   /* of the rotor, last step      */
+    disconPlantBladeWindFcn bladeWind;      /* turbulence, or NULL          */
+    void                    *bladeWindContext;
+};
+
+/* Location of a missing entry */
+typedef struct {
+    const char *text;
+    const char *path;
+    char       *errorMsg;
+    int        failed;
+} Project;
+
+/*=================*
+ * Local functions *
+ *=================*/
+
+/* Function: readProject ==================================================
+ *
+ * Abstract:
+ *      Read a project file and return the Bladed data in it: the CDATA
+ *      section of a project in XML, else the whole file.
+ */
+static char *readProject(const char *path, char *errorMsg) {
+    FILE   *file = fopen(path, "rb");
+    char   *text, *begin, *end;
+    long   size;
+
+    if (file == NULL) {
+        (void)sprintf(errorMsg, "unable to open the project %.200s", path);
+        return NULL;
+    }
+    (void)fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    (void)fseek(file, 0, SEEK_SET);
+    text = size > 0 ? (char *)malloc((size_t)size + 1) : NULL;
+    if (text == NULL || fread(text, 1, (size_t)size, file) != (size_t)size) {
+        (void)sprintf(errorMsg, "unable to read the project %.200s", path);
+        (void)fclose(file);
+        free(text);
+        return NULL;
+    }
+    (void)fclose(file);
+    text[size] = '\0';
+
+    begin = strstr(text, "<![CDATA[");
+    if (begin != NULL) {
+        begin += 9;
+        end = strstr(begin, "]]>");
+        if (end != NULL) *end = '\0';
+        (void)memmove(text, begin, strlen(begin) + 1);
+    }
+    return text;
+}  /* end readProject */
+
+/* Function: nextLine =====================================================
+ *
+ * Abstract:
+ *      Start of the line after p, or NULL.
+ */
+static const char *nextLine(const char *p) {
+    p = strchr(p, '\n');
+    return p != NULL ? p + 1 : NULL;
+}  /* end nextLine */
+
+/* Function: keyAt ========================================================
+ *
+ * Abstract:
+ *      The values after key when the line at p starts with it, else NULL.
+ */
+static const char *keyAt(const char *p, const char *key) {
+    size_t n = strlen(key);
+
+    if (strncmp(p, key, n) != 0 || (p[n] != ' ' && p[n] != '\t')) return NULL;
+    return p + n;
+}  /* end keyAt */
+
+/* Function: findModule ===================================================
+ *
+ * Abstract:
+ *      The first line of a module (after MSTART name), and in *end the
+ *      start of its MEND line; NULL when the project has no such module.
+ */
+static const char *findModule(const char *text, const char *name, const char **end) {
+    const char *p, *q;
+
+    for (p=text; p != NULL; p=nextLine(p)) {
+        if ((q = keyAt(p, "MSTART")) == NULL) continue;
+        q += strspn(q, " \t");
+        if (strncmp(q, name, strlen(name)) != 0 ||
+            strchr(" \t\r\n", q[strlen(name)]) == NULL) {
+            continue;
+        }
+        p = nextLine(q);
+        for (q=p; q != NULL && strncmp(q, "MEND", 4) != 0; q=nextLine(q));
+        *end = q != NULL ? q : text + strlen(text);
+        return p;
+    }
+    return NULL;
+}  /* end findModule */
+
+/* Function: findKey ======================================================
+ *
+ * Abstract:
+ *      The values of the first line from p up to end that starts with key,
+ *      or NULL.
+ */
+static const char *findKey(const char *p, const char *end, const char *key) {
+    const char *values;
+
+    for (; p != NULL && p < end; p=nextLine(p)) {
+        if ((values = keyAt(p, key)) != NULL) return values;
+    }
+    return NULL;
+}  /* end findKey */
+
+/* Function: readNumbers ==================================================
+ *
+ * Abstract:
+ *      Parse the numbers of a line, separated by blanks or commas, into at
+ *      most max values. Returns how many there are.
+ */
+static int readNumbers(const char *p, double *values, int max) {
+    int n = 0;
+
+    for (;;) {
+        char   *end;
+        double v;
+
+        p += strspn(p, " \t,");
+        if (*p == '\0' || *p == '\r' || *p == '\n') break;
+        v = strtod(p, &end);
+        if (end == p) break;
+        if (n < max) values[n] = v;
+        n++;
+        p = end;
+    }
+    return n;
+}  /* end readNumbers */
+
+/* Function: missing ======================================================
+ *
+ * Abstract:
+ *      Report the first missing or invalid entry of a project.
+ */
+static void missing(Project *prj, const char *module, const char *key) {
+    if (prj->failed) return;
+    prj->failed = 1;
+    (void)sprintf(prj->errorMsg, "%.180s: no valid %.20s in module %.20s",
+                  prj->path, key, module);
+}  /* end missing */
+
+/* Function: getArray =====================================================
+ *
+ * Abstract:
+ *      The values of a key of a module, at most max; reports an error and
+ *      returns 0 when there are none or too many.
+ */
+static int getArray(Project *prj, const char *module, const char *key,
+                    double *values, int max) {
+    const char *end, *p = findModule(prj->text, module, &end);
+    int        n = 0;
+
+    if (p != NULL && (p = findKey(p, end, key)) != NULL) {
+        n = readNumbers(p, values, max);
+    }
+    if (n < 1 || n > max) {
+        missing(prj, module, key);
+        return 0;
+    }
+    return n;
+}  /* end getArray */
+
+/* Function: getScalar ====================================================
+ *
+ * Abstract:
+ *      The first value of a key of a module; the default when the project
+ *      has none, or an error when the default is NaN.
+ */
+static double getScalar(Project *prj, const char *module, const char *key, double def) {
+    const char *end, *p = findModule(prj->text, module, &end);
+    double     value;
+
+    if (p != NULL && (p = findKey(p, end, key)) != NULL && readNumbers(p, &value, 1) > 0) {
+        return value;
+    }
+    if (def != def) missing(prj, module, key);
+    return def;
+}  /* end getScalar */
+
+/* Function: loadFoils ====================================================
+ *
+ * Abstract:
+ *      Resample the aerofoil table of every foil of the project (ADAT) to a
+ *      uniform angle of attack. Foil k uses the data set listed after its
+ *      NFOIL entry.
+ */
+static int loadFoils(Project *prj, double *foils, int maxFoils) {
+    static double alpha[MAX_ALPHA], cl[MAX_ALPHA], cd[MAX_ALPHA];
+    const char    *end, *module = findModule(prj->text, "ADAT", &end);
+    const char    *p, *set;
+    double        value;
+    int           nFoils, k, n, i, g;
+
+    if (module == NULL) {
+        missing(prj, "ADAT", "NFOILS");
+        return 0;
+    }
+    p = findKey(module, end, "NFOILS");
+    nFoils = p != NULL && readNumbers(p, &value, 1) == 1 ? (int)value : 0;
+    if (nFoils < 1 || nFoils > maxFoils) {
+        missing(prj, "ADAT", "NFOILS");
+        return 0;
+    }
+
+    for (k=0; k<nFoils; k++) {
+        double *foil = foils + k*2*N_ALPHA;
+        int    setNo = k + 1;
+
+        /* The data set of the foil: the number on the line after NREYN */
+        for (p=module; (p = findKey(p, end, "NFOIL")) != NULL; p=nextLine(p)) {
+            if (readNumbers(p, &value, 1) == 1 && (int)value == k + 1) break;
+        }
+        if (p != NULL && (p = findKey(p, end, "NREYN")) != NULL &&
+            (p = nextLine(p)) != NULL && readNumbers(p, &value, 1) == 1) {
+            setNo = (int)value;
+        }
+        for (set=module; (set = findKey(set, end, "SETNB")) != NULL; set=nextLine(set)) {
+            if (readNumbers(set, &value, 1) == 1 && (int)value == setNo) break;
+        }
+        n = 0;
+        if (set != NULL) {
+            const char *a = findKey(set, end, "ALPHA");
+            const char *l = findKey(set, end, "CL");
+            const char *d = findKey(set, end, "CD");
+
+            if (a != NULL && l != NULL && d != NULL) {
+                n = readNumbers(a, alpha, MAX_ALPHA);
+                if (n > MAX_ALPHA || readNumbers(l, cl, MAX_ALPHA) != n ||
+                    readNumbers(d, cd, MAX_ALPHA) != n) {
+                    n = 0;
+                }
+            }
+        }
+        if (n < 2) {
+            missing(prj, "ADAT", "ALPHA, CL, CD");
+            return 0;
+        }
+
+        for (g=0, i=0; g<N_ALPHA; g++) {
+            double x = -180.0 + g*ALPHA_STEP, f;
+
+            while (i < n - 2 && alpha[i + 1] < x) i++;
+            f = (x - alpha[i])/(alpha[i + 1] - alpha[i]);
+            if (f < 0.0) f = 0.0;
+            if (f > 1.0) f = 1.0;
+            foil[2*g]     = cl[i] + f*(cl[i + 1] - cl[i]);
+            foil[2*g + 1] = cd[i] + f*(cd[i + 1] - cd[i]);
+        }
+    }
+    return nFoils;
+}  /* end loadFoils */
+
+/* Function: trapezoid ====================================================
+ *
+ * Abstract:
+ *      Integral of f over x, both sampled at n stations; stations at the
+ *      same x (steps of f) add nothing.
+ */
+static double trapezoid(const double *x, const double *f, int n) {
+    double sum = 0.0;
+    int    i;
+
+    for (i=0; i<n-1; i++) sum += 0.5*(f[i] + f[i + 1])*(x[i + 1] - x[i]);
+    return sum;
+}  /* end trapezoid */
+
+/* Function: loadTurbine ==================================================
+ *
+ * Abstract:
+ *      The parameters of the plant and the blade sections, from the
+ *      project.
+ */
+static void loadTurbine(Project *prj, disconPlantParams *p, Blade *blade) {
+    static double rj[MAX_STATIONS], chord[MAX_STATIONS], twist[MAX_STATIONS];
+    static double foil[MAX_STATIONS], mass[MAX_STATIONS], f[MAX_STATIONS];
+    static double tj[MAX_STATIONS], towm[MAX_STATIONS], ei[MAX_STATIONS];
+    const double  nan = NAN;
+    double        damping[2], length, k, m, topMass;
+    int           n, i;
+
+    (void)memset(p, 0, sizeof(*p));
+    p->nBlades       = (int)getScalar(prj, "RCON", "NB", nan);
+    p->radius        = 0.5*getScalar(prj, "RCON", "DIAM", nan);
+    p->hubRadius     = getScalar(prj, "RCON", "ROOT", 0.0);
+    p->hubHeight     = getScalar(prj, "RCON", "HEIGHT", nan);
+    p->tilt          = getScalar(prj, "RCON", "TILT", 0.0);
+    p->gearRatio     = getScalar(prj, "DTRAIN", "GRATIO", 1.0);
+    p->genInertia    = getScalar(prj, "DTRAIN", "GINERT", 0.0);
+    p->efficiency    = 0.01*getScalar(prj, "LOSS", "EFFICY", 100.0);
+    p->genTorqueMax  = getScalar(prj, "GENER", "GTMAX", 1e30);
+    p->genTau        = getScalar(prj, "GENER", "GTAU", 0.0);
+    p->pitchMin      = getScalar(prj, "CONTROL", "PITMIN", 0.0);
+    p->pitchMax      = getScalar(prj, "CONTROL", "PITMAX", 0.5*PI);
+    p->pitchRateMin  = getScalar(prj, "CONTROL", "PITRMIN", -1e30);
+    p->pitchRateMax  = getScalar(prj, "CONTROL", "PITRMAX", 1e30);
+    p->pitchTau      = DEFAULT_PITCH_TAU;
+    p->airDensity    = getScalar(prj, "CONSTANTS", "RHO", 1.225);
+    p->gravity       = getScalar(prj, "CONSTANTS", "GRAVITY", 9.81);
+    p->shear         = getScalar(prj, "WINDV", "WSHEAR", 0.0);
+    p->meanWind      = getScalar(prj, "WINDSEL", "UBAR", 10.0);
+    p->turbulence[0] = getScalar(prj, "WINDSEL", "TI", 0.0);
+    p->turbulence[1] = getScalar(prj, "WINDSEL", "TI_V", 0.0);
+    p->turbulence[2] = getScalar(prj, "WINDSEL", "TI_W", 0.0);
+    p->sampleTime    = getScalar(prj, "DISCON", "SAMPLETIME", 0.01);
+    p->step          = DEFAULT_STEP;
+    p->minGenSpeed   = getScalar(prj, "CONTROL", "OMMIN", 0.0);
+    p->maxGenSpeed   = getScalar(prj, "CONTROL", "OMMAX", nan);
+    p->ratedGenSpeed = getScalar(prj, "CONTROL", "OMDEM_PS", nan);
+    p->ratedTorque   = getScalar(prj, "CONTROL", "GTORREF", nan);
+    p->modeGain      = getScalar(prj, "CONTROL", "GAIN_TSR", nan);
+    p->shearRadius   = SHEAR_RADIUS*p->radius;
+    if (p->genTorqueMax <= 0.0) p->genTorqueMax = 1e30;
+    if (p->efficiency <= 0.0) p->efficiency = 1.0;
+    if (!prj->failed && (p->nBlades < 1 || p->nBlades > DISCON_PLANT_MAX_BLADES)) {
+        missing(prj, "RCON", "NB");
+    }
+
+    /* Blade: sections at the distinct stations, mass over all of them */
+    n = getArray(prj, "BGEOMMB", "RJ", rj, MAX_STATIONS);
+    if (n > 0 && (getArray(prj, "BGEOMMB", "CHORD", chord, MAX_STATIONS) != n ||
+                  getArray(prj, "BGEOMMB", "TWIST", twist, MAX_STATIONS) != n ||
+                  getArray(prj, "BGEOMMB", "FOIL", foil, MAX_STATIONS) != n ||
+                  getArray(prj, "BMASSMB", "MASS", mass, MAX_STATIONS) != n)) {
+        missing(prj, "BGEOMMB", "blade stations");
+    }
+    if (prj->failed) return;
+    for (i=0, blade->n=0; i<n; i++) {
+        if (i > 0 && rj[i] == rj[i - 1]) continue;
+        blade->r[blade->n]     = p->hubRadius + rj[i];
+        blade->chord[blade->n] = chord[i];
+        blade->twist[blade->n] = twist[i];
+        blade->foil[blade->n]  = (int)foil[i] - 1;
+        blade->n++;
+    }
+    for (i=0; i<n; i++) f[i] = mass[i];
+    p->bladeMass = trapezoid(rj, f, n);
+    for (i=0; i<n; i++) f[i] = mass[i]*rj[i];
+    p->bladeMoment = trapezoid(rj, f, n);
+    for (i=0; i<n; i++) f[i] = mass[i]*(p->hubRadius + rj[i])*(p->hubRadius + rj[i]);
+    p->rotorInertia = p->nBlades*trapezoid(rj, f, n) +
+                      getScalar(prj, "RMASS", "HUBINE", 0.0);
+
+    /* Tower: first fore-aft mode of a cantilever with the nacelle and rotor
+     * on top, shape 1 - cos(pi z/2L) */
+    n = getArray(prj, "TGEOM", "TJ", tj, MAX_STATIONS);
+    if (n > 1 && (getArray(prj, "TMASS", "TOWM", towm, MAX_STATIONS) != n ||
+                  getArray(prj, "TSTIFF", "EITOW", ei, MAX_STATIONS) != n)) {
+        missing(prj, "TGEOM", "tower stations");
+    }
+    if (prj->failed) return;
+    length = tj[n - 1] - tj[0];
+    for (i=0; i<n; i++) {
+        double c = cos(0.5*PI*(tj[i] - tj[0])/length);
+
+        f[i] = ei[i]*pow(0.5*PI/length, 4)*c*c;
+    }
+    k = trapezoid(tj, f, n);
+    for (i=0; i<n; i++) {
+        double s = 1.0 - cos(0.5*PI*(tj[i] - tj[0])/length);
+
+        f[i] = towm[i]*s*s;
+    }
+    topMass = getScalar(prj, "NMASS", "NACMAS", 0.0) + getScalar(prj, "RMASS", "HUBMAS", 0.0) +
+              p->nBlades*p->bladeMass;
+    m = trapezoid(tj, f, n) + topMass;
+    p->towerMass = m;
+    p->towerFreq = sqrt(k/m)/(2.0*PI);
+    damping[0] = 0.01;
+    {
+        const char *end, *q = findModule(prj->text, "EIGENT", &end);
+
+        if (q != NULL && (q = findKey(q, end, "DTOWF")) != NULL) {
+            (void)readNumbers(q, damping, 2);
+        }
+    }
+    p->towerDamping = damping[0];
+}  /* end loadTurbine */
+
+/* Function: foilCoefficients =============================================
+ *
+ * Abstract:
+ *      Lift and drag of a resampled aerofoil at an angle of attack (rad).
+ */
+static void foilCoefficients(const double *foil, double alpha, double *cl, double *cd) {
+    double x = alpha*(180.0/PI);
+    int    i;
+
+    x -= 360.0*floor((x + 180.0)/360.0);
+    x  = (x + 180.0)/ALPHA_STEP;
+    i  = (int)x;
+    if (i >= N_ALPHA - 1) i = N_ALPHA - 2;
+    x -= i;
+    *cl = foil[2*i] + x*(foil[2*i + 2] - foil[2*i]);
+    *cd = foil[2*i + 1] + x*(foil[2*i + 3] - foil[2*i + 1]);
+}  /* end foilCoefficients */
+
+/* Function: residual =====================================================
+ *
+ * Abstract:
+ *      Residual of the BEM equations of an element at an inflow angle, in
+ *      Ning's form; also leaves the induction and force coefficients in
+ *      the element.
+ */
+static double residual(Element *e, double phi) {
+    double s = sin(phi), c = cos(phi), cl, cd, F = 1.0, k, kp, a;
+
+    foilCoefficients(e->foil, phi - e->theta, &cl, &cd);
+    e->cn = cl*c + cd*s;
+    e->ct = cl*s - cd*c;
+    if (e->tipF > 0.0) {
+        F = 2.0/PI*acos(exp(-e->tipF/fabs(s)));
+        if (F < 1e-6) F = 1e-6;
+    }
+    k  = e->sigma*e->cn/(4.0*F*s*s);
+    kp = e->sigma*e->ct/(4.0*F*s*c);
+    if (phi > 0.0) {
+        if (k <= 2.0/3.0) {
+            a = k/(1.0 + k);
+        } else {
+            /* Buhl's empirical thrust above a = 0.4 */
+            double g1 = 2.0*F*k - (10.0/9.0 - F);
+            double g2 = 2.0*F*k - F*(4.0/3.0 - F);
+            double g3 = 2.0*F*k - (25.0/9.0 - 2.0*F);
+
+            a = fabs(g3) < 1e-6 ? 1.0 - 0.5/sqrt(g2) : (g1 - sqrt(g2))/g3;
+        }
+    } else {
+        a = k > 1.0 ? k/(k - 1.0) : 0.0;    /* propeller brake */
+    }
+    e->a  = a;
+    e->ap = kp/(1.0 - kp);
+    if (phi > 0.0) return s/(1.0 - a) - c/e->lr*(1.0 - kp);
+    return s*(1.0 - k) - c/e->lr*(1.0 - kp);
+}  /* end residual */
+
+/* Function: solveElement =================================================
+ *
+ * Abstract:
+ *      Solve an element for its inflow angle, bracketed in the momentum,
+ *      propeller brake and then windmill regions, by the Illinois method.
+ *      Returns 0, or -1 without a solution, the element left without
+ *      induction.
+ */
+static int solveElement(Element *e) {
+    static const double bracket[3][2] = {
+        { 1e-6, 0.5*PI }, { -0.25*PI, -1e-6 }, { 0.5*PI, PI - 1e-6 }
+    };
+    int k, it;
+
+    for (k=0; k<3; k++) {
+        double lo = bracket[k][0], hi = bracket[k][1];
+        double flo = residual(e, lo), fhi = residual(e, hi), x = hi, fx;
+
+        if (flo*fhi > 0.0) continue;
+        for (it=0; it<60; it++) {
+            x  = (lo*fhi - hi*flo)/(fhi - flo);
+            fx = residual(e, x);
+            if (fabs(fx) < 1e-10 || fabs(hi - lo) < 1e-10) break;
+            if (fx*fhi < 0.0) {
+                lo  = hi;
+                flo = fhi;
+            } else {
+                flo *= 0.5;
+            }
+            hi  = x;
+            fhi = fx;
+        }
+        (void)residual(e, x);
+        return 0;
+    }
+    (void)residual(e, atan2(1.0, e->lr));
+    e->a  = 0.0;
+    e->ap = 0.0;
+    return -1;
+}  /* end solveElement */
+
+/* Function: pitchOf ======================================================
+ *
+ * Abstract:
+ *      Pitch (deg) of a column of the coefficient grid.
+ */
+static double pitchOf(int j) {
+    if (j <= N_PITCH_FINE) return PITCH_FIRST + j*PITCH_FINE;
+    return PITCH_KNEE + (j - N_PITCH_FINE)*PITCH_COARSE;
+}  /* end pitchOf */
+
+/* Function: tabulate =====================================================
+ *
+ * Abstract:
+ *      Solve the blade at every tip speed ratio and pitch of the grid and
+ *      store the rotor thrust and torque and the root moments of a blade
+ *      as coefficients: T = q Ct, Q = q R Cq, M = q R Cm, q = rho/2 pi R^2
+ *      U^2.
+ */
+static void tabulate(disconPlant *plant, const Blade *blade, const double *foils,
+                     int tipLoss) {
+    const disconPlantParams *p = &plant->params;
+    double                  fn[MAX_STATIONS], ft[MAX_STATIONS], x[MAX_STATIONS];
+    double                  qn[MAX_STATIONS], qt[MAX_STATIONS], arm[MAX_STATIONS];
+    double                  R = p->radius, area = 0.5*PI*R*R;
+    int                     B = p->nBlades, i, j, n;
+
+    for (n=0; n<blade->n; n++) {
+        x[n]   = blade->r[n];
+        arm[n] = blade->r[n] - p->hubRadius;
+    }
+    for (i=0; i<N_LAMBDA; i++) {
+        double lambda = i > 0 ? i*LAMBDA_STEP : 1e-3;
+
+        for (j=0; j<N_PITCH; j++) {
+            double *c = plant->coef + (i*N_PITCH + j)*NUM_COEF;
+
+            for (n=0; n<blade->n; n++) {
+                Element e;
+                double  r = blade->r[n], w2;
+
+                fn[n] = ft[n] = 0.0;
+                if (r >= R || r <= 0.0) continue;
+                e.foil  = foils + blade->foil[n]*2*N_ALPHA;
+                e.lr    = lambda*r/R;
+                e.sigma = B*blade->chord[n]/(2.0*PI*r);
+                e.theta = blade->twist[n] + pitchOf(j)*(PI/180.0);
+                e.tipF  = tipLoss ? 0.5*B*(R - r)/r : 0.0;
+                (void)solveElement(&e);
+                w2 = (1.0 - e.a)*(1.0 - e.a) + e.lr*(1.0 + e.ap)*e.lr*(1.0 + e.ap);
+                fn[n] = 0.5*w2*blade->chord[n]*e.cn;
+                ft[n] = 0.5*w2*blade->chord[n]*e.ct;
+            }
+            for (n=0; n<blade->n; n++) {
+                qt[n] = ft[n]*x[n];
+            }
+            c[COEF_CT] = B*trapezoid(x, fn, blade->n)/area;
+            c[COEF_CQ] = B*trapezoid(x, qt, blade->n)/(area*R);
+            for (n=0; n<blade->n; n++) {
+                qn[n] = fn[n]*arm[n];
+                qt[n] = ft[n]*arm[n];
+            }
+            c[COEF_FLAP] = trapezoid(x, qn, blade->n)/(area*R);
+            c[COEF_EDGE] = trapezoid(x, qt, blade->n)/(area*R);
+        }
+    }
+}  /* end tabulate */
+
+/* Function: lookup =======================================================
+ *
+ * Abstract:
+ *      Interpolate the coefficients at a tip speed ratio and pitch (rad).
+ */
+static void lookup(const disconPlant *plant, double lambda, double pitch, double *c) {
+    double       x = lambda/LAMBDA_STEP, y = pitch*(180.0/PI);
+    const double *c00, *c01, *c10, *c11;
+    int          i, j, k;
+
+    y = y <= PITCH_KNEE ? (y - PITCH_FIRST)/PITCH_FINE
+                        : N_PITCH_FINE + (y - PITCH_KNEE)/PITCH_COARSE;
+    if (x < 0.0) x = 0.0;
+    if (x > N_LAMBDA - 1) x = N_LAMBDA - 1;
+    if (y < 0.0) y = 0.0;
+    if (y > N_PITCH - 1) y = N_PITCH - 1;
+    i = (int)x;
+    j = (int)y;
+    if (i > N_LAMBDA - 2) i = N_LAMBDA - 2;
+    if (j > N_PITCH - 2) j = N_PITCH - 2;
+    x -= i;
+    y -= j;
+    c00 = plant->coef + (i*N_PITCH + j)*NUM_COEF;
+    c01 = c00 + NUM_COEF;
+    c10 = c00 + N_PITCH*NUM_COEF;
+    c11 = c10 + NUM_COEF;
+    for (k=0; k<NUM_COEF; k++) {
+        c[k] = (1.0 - x)*((1.0 - y)*c00[k] + y*c01[k]) + x*((1.0 - y)*c10[k] + y*c11[k]);
+    }
+}  /* end lookup */
+
+/* Function: aeroLoads ====================================================
+ *
+ * Abstract:
+ *      Rotor thrust and torque and blade root moments at the state of the
+ *      plant. Every blade sees the hub wind sheared to the height of its
+ *      azimuth, plus its turbulence, less the nacelle velocity, at its own
+ *      pitch, and carries a 1/B share of the rotor.
+ */
+static void aeroLoads(disconPlant *plant) {
+    const disconPlantParams *p = &plant->params;
+    disconPlantState        *s = &plant->state;
+    double                  R = p->radius, c[NUM_COEF];
+    double                  deviation[DISCON_PLANT_MAX_BLADES] = {0.0};
+    int                     B = p->nBlades, b;
+
+    if (plant->bladeWind != NULL) {
+        plant->bladeWind(plant->bladeWindContext, s->time, s->azimuth, B, deviation);
+    }
+    s->thrust = s->aeroTorque = 0.0;
+    for (b=0; b<B; b++) {
+        double psi = s->azimuth + 2.0*PI*b/B;
+        double z   = 1.0 + p->shearRadius*cos(psi)*cos(p->tilt)/p->hubHeight;
+        double u   = s->wind*(p->shear != 0.0 && z > 0.0 ? pow(z, p->shear) : 1.0) +
+                     deviation[b];
+        double un  = u*cos(p->tilt) - s->towerV;
+        double q;
+
+        if (un < MIN_INFLOW) un = MIN_INFLOW;
+        lookup(plant, s->rotorSpeed > 0.0 ? s->rotorSpeed*R/un : 0.0, s->pitch[b], c);
+        q = 0.5*p->airDensity*PI*R*R*un*un;
+        s->thrust     += q*c[COEF_CT]/B;
+        s->aeroTorque += q*R*c[COEF_CQ]/B;
+        s->flap[b] = q*R*c[COEF_FLAP];
+        s->edge[b] = q*R*c[COEF_EDGE] + p->gravity*p->bladeMoment*sin(psi);
+    }
+}  /* end aeroLoads */
+
+/* Function: steadyTorque =================================================
+ *
+ * Abstract:
+ *      Aerodynamic torque in a steady uniform wind.
+ */
+static double steadyTorque(const disconPlant *plant, double wind, double speed,
+                           double pitch) {
+    const disconPlantParams *p = &plant->params;
+    double                  R = p->radius, un = wind*cos(p->tilt), c[NUM_COEF];
+
+    if (un < MIN_INFLOW) un = MIN_INFLOW;
+    lookup(plant, speed*R/un, pitch, c);
+    return 0.5*p->airDensity*PI*R*R*R*un*un*c[COEF_CQ];
+}  /* end steadyTorque */
+
+/* Function: genTorque ====================================================
+ *
+ * Abstract:
+ *      Generator torque of the steady operating curve: the optimal mode
+ *      below rated speed, the rated torque at it.
+ */
+static double genTorque(const disconPlantParams *p, double genSpeed) {
+    double torque = p->modeGain*genSpeed*genSpeed;
+
+    if (genSpeed >= p->ratedGenSpeed || torque > p->ratedTorque) torque = p->ratedTorque;
+    return torque;
+}  /* end genTorque */
+
+/*===================*
+ * Visible functions *
+ *===================*/
+
+/* Function: disconPlantOpen ==============================================
+ *
+ * Abstract:
+ *      Read the project, then tabulate the rotor.
+ */
+disconPlant *disconPlantOpen(const char *project, char *errorMsg) {
+    static double foils[MAX_FOILS*2*N_ALPHA];
+    static Blade  blade;
+    disconPlant   *plant;
+    Project       prj;
+    const char    *end, *p;
+    int           nFoils, tipLoss = 1, n;
+
+    prj.text = readProject(project, errorMsg);
+    if (prj.text == NULL) return NULL;
+    prj.path     = project;
+    prj.errorMsg = errorMsg;
+    prj.failed   = 0;
+    plant = (disconPlant *)calloc(1, sizeof(disconPlant));
+    if (plant == NULL) {
+        (void)sprintf(errorMsg, "out of memory");
+        free((void *)prj.text);
+        return NULL;
+    }
+
+    loadTurbine(&prj, &plant->params, &blade);
+    nFoils = prj.failed ? 0 : loadFoils(&prj, foils, MAX_FOILS);
+    for (n=0; !prj.failed && n<blade.n; n++) {
+        if (blade.foil[n] < 0 || blade.foil[n] >= nFoils) missing(&prj, "BGEOMMB", "FOIL");
+    }
+    if ((p = findModule(prj.text, "AERO", &end)) != NULL &&
+        (p = findKey(p, end, "TIPLOS")) != NULL) {
+        tipLoss = p[strspn(p, " \t")] != 'N';
+    }
+    free((void *)prj.text);
+    if (prj.failed) {
+        free(plant);
+        return NULL;
+    }
+
+    tabulate(plant, &blade, foils, tipLoss);
+    disconPlantStart(plant, plant->params.meanWind);
+    return plant;
+}  /* end disconPlantOpen */
+
+/* Function: disconPlantParameters ========================================
+ *
+ * Abstract:
+ *      Parameters of a plant.
+ */
+disconPlantParams *disconPlantParameters(disconPlant *plant) {
+    return &plant->params;
+}  /* end disconPlantParameters */
+
+/* Function: disconPlantGetState ==========================================
+ *
+ * Abstract:
+ *      State of a plant.
+ */
+const disconPlantState *disconPlantGetState(const disconPlant *plant) {
+    return &plant->state;
+}  /* end disconPlantGetState */
+
+/* Function: disconPlantStart =============================================
+ *
+ * Abstract:
+ *      Solve for the steady operating point: above rated, the pitch that
+ *      balances the rated torque at rated speed; below, the rotor speed at
+ *      which the optimal mode torque balances the rotor, at least the
+ *      minimum speed.
+ */
+void disconPlantStart(disconPlant *plant, double wind) {
+    const disconPlantParams *p = &plant->params;
+    disconPlantState        *s = &plant->state;
+    double                  N = p->gearRatio, speed, pitch = p->pitchMin, torque;
+    double                  lo, hi, R = p->radius, un, c[NUM_COEF];
+    int                     it, b;
+
+    (void)memset(s, 0, sizeof(*s));
+    s->wind = wind;
+
+    speed = p->ratedGenSpeed/N;
+    if (steadyTorque(plant, wind, speed, pitch) >= N*genTorque(p, p->ratedGenSpeed)) {
+        torque = genTorque(p, p->ratedGenSpeed);
+        for (lo=p->pitchMin, hi=p->pitchMax, it=0; it<60; it++) {
+            pitch = 0.5*(lo + hi);
+            if (steadyTorque(plant, wind, speed, pitch) > N*torque) lo = pitch;
+            else hi = pitch;
+        }
+    } else {
+        lo = p->minGenSpeed/N;
+        hi = speed;
+        speed = lo;
+        if (steadyTorque(plant, wind, lo, pitch) > N*genTorque(p, N*lo)) {
+            for (it=0; it<60; it++) {
+                speed = 0.5*(lo + hi);
+                if (steadyTorque(plant, wind, speed, pitch) > N*genTorque(p, N*speed)) lo = speed;
+                else hi = speed;
+            }
+        }
+        torque = genTorque(p, N*speed);
+    }
+
+    s->rotorSpeed = speed;
+    for (b=0; b<p->nBlades; b++) s->pitch[b] = s->pitchDemand[b] = pitch;
+    s->genTorque = s->torqueDemand = torque;
+
+    un = wind*cos(p->tilt);
+    if (un < MIN_INFLOW) un = MIN_INFLOW;
+    lookup(plant, speed*R/un, pitch, c);
+    s->towerX = 0.5*p->airDensity*PI*R*R*un*un*c[COEF_CT]/
+                (p->towerMass*pow(2.0*PI*p->towerFreq, 2));
+    aeroLoads(plant);
+    plant->acceleration = 0.0;
+    s->shaftTorque = s->aeroTorque;
+    s->power       = s->genTorque*N*s->rotorSpeed*p->efficiency;
+}  /* end disconPlantStart */
+
+/* Function: disconPlantMeasure ===========================================
+ *
+ * Abstract:
+ *      The records of avrSwap (0-based) that Bladed fills for the
+ *      controller.
+ */
+void disconPlantMeasure(const disconPlant *plant, float *avrSwap) {
+    const disconPlantParams *p = &plant->params;
+    const disconPlantState  *s = &plant->state;
+    int                     b;
+
+    avrSwap[3]   = (float)s->pitch[0];
+    avrSwap[4]   = (float)p->pitchMin;
+    avrSwap[5]   = (float)p->pitchMin;
+    avrSwap[6]   = (float)p->pitchMax;
+    avrSwap[7]   = (float)p->pitchRateMin;
+    avrSwap[8]   = (float)p->pitchRateMax;
+    avrSwap[14]  = (float)s->power;
+    avrSwap[15]  = (float)p->modeGain;
+    avrSwap[16]  = (float)p->minGenSpeed;
+    avrSwap[17]  = (float)p->maxGenSpeed;
+    avrSwap[18]  = (float)p->ratedGenSpeed;
+    avrSwap[19]  = (float)(s->rotorSpeed*p->gearRatio);
+    avrSwap[20]  = (float)s->rotorSpeed;
+    avrSwap[21]  = (float)p->ratedTorque;
+    avrSwap[22]  = (float)s->genTorque;
+    avrSwap[23]  = 0.0f;                /* yaw error                        */
+    avrSwap[26]  = (float)s->wind;
+    avrSwap[32]  = (float)s->pitch[p->nBlades > 1 ? 1 : 0];
+    avrSwap[33]  = (float)s->pitch[p->nBlades > 2 ? 2 : 0];
+    avrSwap[52]  = (float)s->towerA;
+    avrSwap[53]  = 0.0f;                /* side-side acceleration           */
+    avrSwap[59]  = (float)s->azimuth;
+    avrSwap[60]  = (float)p->nBlades;
+    avrSwap[108] = (float)s->shaftTorque;
+    avrSwap[162] = 0.0f;                /* yaw bearing rate                 */
+    for (b=0; b<3; b++) {
+        int k = b < p->nBlades ? b : 0;
+
+        avrSwap[29 + b] = (float)s->flap[k];
+        avrSwap[68 + b] = (float)s->edge[k];
+    }
+}  /* end disconPlantMeasure */
+
+/* Function: disconPlantDemand ============================================
+ *
+ * Abstract:
+ *      Pitch and torque demands, within the limits of the actuators.
+ */
+void disconPlantDemand(disconPlant *plant, const float *avrSwap) {
+    const disconPlantParams *p = &plant->params;
+    disconPlantState        *s = &plant->state;
+    int                     individual = avrSwap[27] > 0.5f, b;
+
+    for (b=0; b<p->nBlades; b++) {
+        double pitch = individual && b < 3 ? avrSwap[41 + b] : avrSwap[44];
+
+        if (pitch < p->pitchMin) pitch = p->pitchMin;
+        if (pitch > p->pitchMax) pitch = p->pitchMax;
+        s->pitchDemand[b] = pitch;
+    }
+    s->torqueDemand = avrSwap[46];
+    if (s->torqueDemand < 0.0) s->torqueDemand = 0.0;
+    if (s->torqueDemand > p->genTorqueMax) s->torqueDemand = p->genTorqueMax;
+}  /* end disconPlantDemand */
+
+/* Function: disconPlantSetBladeWind =====================================
+ *
+ * Abstract:
+ *      Set the source of the blade turbulence.
+ */
+void disconPlantSetBladeWind(disconPlant *plant, disconPlantBladeWindFcn fcn,
+                             void *context) {
+    plant->bladeWind        = fcn;
+    plant->bladeWindContext = context;
+}  /* end disconPlantSetBladeWind */
+
+/* Function: disconPlantAdvance ===========================================
+ *
+ * Abstract:
+ *      Semi-implicit Euler steps: the rotor speed, tower velocity and
+ *      actuators are updated from the loads at the start of a step, the
+ *      positions from the new velocities.
+ */
+void disconPlantAdvance(disconPlant *plant, double wind, double dt) {
+    const disconPlantParams *p = &plant->params;
+    disconPlantState        *s = &plant->state;
+    double                  N = p->gearRatio, J = p->rotorInertia + N*N*p->genInertia;
+    double                  w = 2.0*PI*p->towerFreq, k = p->towerMass*w*w;
+    double                  damp = 2.0*p->towerDamping*p->towerMass*w, h, lag;
+    int                     n = (int)ceil(dt/p->step - 1e-9), i, b;
+
+    if (n < 1) n = 1;
+    h   = dt/n;
+    lag = p->genTau > 0.0 ? 1.0 - exp(-h/p->genTau) : 1.0;
+    s->wind = wind;
+    for (i=0; i<n; i++) {
+        plant->acceleration = (s->aeroTorque - N*s->genTorque)/J;
+        s->rotorSpeed += h*plant->acceleration;
+        if (s->rotorSpeed < 0.0) s->rotorSpeed = 0.0;
+        s->azimuth = fmod(s->azimuth + h*s->rotorSpeed, 2.0*PI);
+
+        s->towerA  = (s->thrust - damp*s->towerV - k*s->towerX)/p->towerMass;
+        s->towerV += h*s->towerA;
+        s->towerX += h*s->towerV;
+
+        for (b=0; b<p->nBlades; b++) {
+            double rate = (s->pitchDemand[b] - s->pitch[b])/(p->pitchTau > h ? p->pitchTau : h);
+
+            if (rate < p->pitchRateMin) rate = p->pitchRateMin;
+            if (rate > p->pitchRateMax) rate = p->pitchRateMax;
+            s->pitch[b] += h*rate;
+            if (s->pitch[b] < p->pitchMin) s->pitch[b] = p->pitchMin;
+            if (s->pitch[b] > p->pitchMax) s->pitch[b] = p->pitchMax;
+        }
+        s->genTorque += lag*(s->torqueDemand - s->genTorque);
+        s->time += h;
+        aeroLoads(plant);
+    }
+    s->towerA      = (s->thrust - damp*s->towerV - k*s->towerX)/p->towerMass;
+    s->shaftTorque = s->aeroTorque - p->rotorInertia*plant->acceleration;
+    s->power       = s->genTorque*N*s->rotorSpeed*p->efficiency;
+}  /* end disconPlantAdvance */
+
+/* Function: disconPlantCoefficients ======================================
+ *
+ * Abstract:
+ *      Power and thrust coefficients from the tables.
+ */
+void disconPlantCoefficients(const disconPlant *plant, double lambda, double pitch,
+                             double *cp, double *ct) {
+    double c[NUM_COEF];
+
+    lookup(plant, lambda, pitch, c);
+    if (cp != NULL) *cp = lambda*c[COEF_CQ];
+    if (ct != NULL) *ct = c[COEF_CT];
+}  /* end disconPlantCoefficients */
+
+/* Function: disconPlantClose =============================================
+ *
+ * Abstract:
+ *      Free a plant.
+ */
+void disconPlantClose(disconPlant *plant) {
+    free(plant);
+}  /* end disconPlantClose */
+
+/* EOF: discon_plant.c */
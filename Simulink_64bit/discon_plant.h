@@ -0,0 +1,160 @@
+/*
+ * File    : discon_plant.h
+ *
+ * Abstract:
+ *      Reduced-order turbine plant for closed-loop runs of the controller
+ *      without Bladed (discon_closedloop). The turbine is described by a
+ *      Bladed project (.prj, e.g. Bladed_NREL5MW_model/NREL_5MW_CPC.prj):
+ *
+ *        rotor       rigid, with the aerodynamic coefficients of a blade
+ *                    element momentum (BEM) solution of the blade geometry
+ *                    and aerofoils of the project, tabulated over tip speed
+ *                    ratio and pitch when the project is loaded
+ *        drivetrain  one mass: rotor, hub and generator inertia on the low
+ *                    speed shaft; a first-order generator torque lag
+ *        pitch       a first-order, rate and position limited actuator per
+ *                    blade
+ *        tower       the first fore-aft mode, from the tower stiffness and
+ *                    mass (Rayleigh), loaded by the rotor thrust; the
+ *                    nacelle velocity feeds back into the rotor inflow
+ *        loads       blade root out-of-plane and in-plane moments: every
+ *                    blade sees the wind sheared to its azimuth and its own
+ *                    pitch, and the turbulence a wind file adds to it,
+ *                    which gives the 1P blade and 3P rotor loads;
+ *                    the in-plane moments also carry the blade weight
+ *
+ *      Coning, the yaw system, side-side tower motion and the flexibility
+ *      of blades and shafts are not modelled. The plant is integrated with
+ *      semi-implicit Euler steps of at most disconPlantParams.step.
+ *
+ *      Angles are in rad, speeds in rad/s, moments in Nm, all as in the
+ *      avrSwap array.
+ */
+
+#ifndef DISCON_PLANT_H
+#define DISCON_PLANT_H
+
+#include "discon.h"
+
+#define DISCON_PLANT_MAX_BLADES 3
+
+/* Parameters, from the project; may be changed before disconPlantStart */
+typedef struct {
+    int    nBlades;                 /* RCON NB                              */
+    double radius;                  /* DIAM/2                               */
+    double hubRadius;               /* ROOT                                 */
+    double hubHeight;               /* HEIGHT                               */
+    double tilt;                    /* TILT                                 */
+    double rotorInertia;            /* hub and blades, about the shaft      */
+    double bladeMass;
+    double bladeMoment;             /* first mass moment about the root     */
+    double gearRatio;               /* DTRAIN GRATIO                        */
+    double genInertia;              /* GINERT, high speed shaft             */
+    double efficiency;              /* LOSS EFFICY, electrical              */
+    double genTorqueMax;            /* GENER GTMAX                          */
+    double genTau;                  /* GENER GTAU, torque lag               */
+    double pitchMin, pitchMax;      /* CONTROL PITMIN, PITMAX               */
+    double pitchRateMin;            /* PITRMIN, PITRMAX                     */
+    double pitchRateMax;
+    double pitchTau;                /* actuator lag (not in the project)    */
+    double towerMass;               /* modal mass of the fore-aft mode      */
+    double towerFreq;               /* Hz                                   */
+    double towerDamping;            /* EIGENT DTOWF, ratio to critical      */
+    double airDensity;              /* CONSTANTS RHO                        */
+    double gravity;                 /* GRAVITY                              */
+    double shear;                   /* WINDV WSHEAR, power law exponent     */
+    double shearRadius;             /* blade radius that sees the shear     */
+    double meanWind;                /* WINDSEL UBAR                         */
+    double turbulence[3];           /* WINDSEL TI, TI_V, TI_W, fractions    */
+    double sampleTime;              /* DISCON SAMPLETIME                    */
+    double step;                    /* largest integration step             */
+    /* Set points passed to the controller in avrSwap */
+    double minGenSpeed;             /* CONTROL OMMIN       avrSwap[16]      */
+    double maxGenSpeed;             /* OMMAX               avrSwap[17]      */
+    double ratedGenSpeed;           /* OMDEM_PS            avrSwap[18]      */
+    double ratedTorque;             /* GTORREF             avrSwap[21]      */
+    double modeGain;                /* GAIN_TSR            avrSwap[15]      */
+} disconPlantParams;
+
+/* State and loads, after disconPlantStart and every disconPlantAdvance */
+typedef struct {
+    double time;
+    double wind;                    /* hub height, free stream              */
+    double rotorSpeed;
+    double azimuth;                 /* blade 1, 0 pointing up               */
+    double pitch[DISCON_PLANT_MAX_BLADES];
+    double pitchDemand[DISCON_PLANT_MAX_BLADES];
+    double genTorque;               /* high speed shaft                     */
+    double torqueDemand;
+    double towerX;                  /* nacelle fore-aft displacement        */
+    double towerV;
+    double towerA;
+    double thrust;
+    double aeroTorque;
+    double shaftTorque;             /* low speed shaft                      */
+    double power;                   /* electrical                           */
+    double flap[DISCON_PLANT_MAX_BLADES];   /* root out-of-plane moment     */
+    double edge[DISCON_PLANT_MAX_BLADES];   /* root in-plane moment         */
+} disconPlantState;
+
+typedef struct disconPlant disconPlant;
+
+/*
+ * Turbulence the blades see, e.g. from a wind file (discon_wind.h): the
+ * effective wind of every blade less the hub height wind, at time t with
+ * blade 1 at an azimuth; blade b is 2 pi b/nBlades further on.
+ */
+typedef void (*disconPlantBladeWindFcn)(void *context, double t, double azimuth,
+                                        int nBlades, double *deviation);
+
+/*
+ * Load a turbine from a Bladed project and tabulate its rotor. Returns
+ * NULL and fills errorMsg (at least 257 characters) on failure.
+ */
+DISCON_LOCAL disconPlant *disconPlantOpen(const char *project, char *errorMsg);
+
+/* Parameters of a plant, to adjust before disconPlantStart */
+DISCON_LOCAL disconPlantParams *disconPlantParameters(disconPlant *plant);
+
+/* State of a plant */
+DISCON_LOCAL const disconPlantState *disconPlantGetState(const disconPlant *plant);
+
+/*
+ * Put the plant at time 0 in steady operation at a wind speed: rotor speed
+ * and pitch on the steady operating curve, tower deflected by the thrust.
+ */
+DISCON_LOCAL void disconPlantStart(disconPlant *plant, double wind);
+
+/*
+ * Write the measurements and set points of the plant into the avrSwap
+ * records a host passes to the controller. The host sets the status, time
+ * and string sizes.
+ */
+DISCON_LOCAL void disconPlantMeasure(const disconPlant *plant, float *avrSwap);
+
+/*
+ * Take the pitch and torque demands the controller returned in avrSwap
+ * (individual pitch when avrSwap[27] is 1, else collective).
+ */
+DISCON_LOCAL void disconPlantDemand(disconPlant *plant, const float *avrSwap);
+
+/*
+ * Add the turbulence of fcn, called at every integration step, to the
+ * sheared hub height wind of every blade; NULL removes it.
+ */
+DISCON_LOCAL void disconPlantSetBladeWind(disconPlant *plant, disconPlantBladeWindFcn fcn,
+                                          void *context);
+
+/* Advance the plant by dt at a hub height wind speed */
+DISCON_LOCAL void disconPlantAdvance(disconPlant *plant, double wind, double dt);
+
+/* Aerodynamic coefficients of the rotor at a tip speed ratio and pitch */
+DISCON_LOCAL void disconPlantCoefficients(const disconPlant *plant, double lambda,
+                                          double pitch, double *cp, double *ct);
+
+/* Free a plant. NULL is ignored. */
+DISCON_LOCAL void disconPlantClose(disconPlant *plant);
+
+#endif /* DISCON_PLANT_H */
+
+/* EOF: discon_plant.h */
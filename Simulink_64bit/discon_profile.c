@@ -0,0 +1,143 @@
+/*
+ * File    : discon_profile.c
+ *
+ * Abstract:
+ *      Monotonic clock and latency histograms, see discon_profile.h.
+ */
+
+#if !(defined _WIN32 || defined __CYGWIN__) && !defined _POSIX_C_SOURCE
+# define _POSIX_C_SOURCE 200112L        /* clock_gettime with -std=c99 */
+#endif
+
+#include <string.h>
+#if defined _WIN32 || defined __CYGWIN__
+# include <windows.h>
+#else
+# include <time.h>
+#endif
+
+#include "discon_profile.h"
+
+/*=================*
+ * Local functions *
+ *=================*/
+
+/* Function: highestBit ===================================================
+ *
+ * Abstract:
+ *      Index of the most significant set bit of v > 0.
+ */
+static int highestBit(uint64_t v) {
+#if defined __GNUC__
+    return 63 - __builtin_clzll(v);
+#else
+    int n = 0;
+
+    while (v >>= 1) n++;
+    return n;
+#endif
+}  /* end highestBit */
+
+/* Function: bucketOf =====================================================
+ *
+ * Abstract:
+ *      Histogram bucket of a value. Values below 2^SUB_BITS have a bucket
+ *      each; above, the SUB_BITS bits below the leading one select one of
+ *      2^SUB_BITS buckets of the power of two.
+ */
+static int bucketOf(uint64_t v) {
+    int shift;
+
+    if (v < ((uint64_t)1 << DISCON_HIST_SUB_BITS)) return (int)v;
+    shift = highestBit(v) - DISCON_HIST_SUB_BITS;
+    return ((shift + 1) << DISCON_HIST_SUB_BITS) +
+           (int)((v >> shift) - ((uint64_t)1 << DISCON_HIST_SUB_BITS));
+}  /* end bucketOf */
+
+/* Function: bucketValue ==================================================
+ *
+ * Abstract:
+ *      Midpoint of the values counted in a bucket, the inverse of bucketOf.
+ */
+static uint64_t bucketValue(int b) {
+    int      shift = (b >> DISCON_HIST_SUB_BITS) - 1;
+    uint64_t base;
+
+    if (shift < 0) return (uint64_t)b;
+    base = (uint64_t)(b & ((1 << DISCON_HIST_SUB_BITS) - 1)) +
+           ((uint64_t)1 << DISCON_HIST_SUB_BITS);
+    return (base << shift) + (((uint64_t)1 << shift) >> 1);
+}  /* end bucketValue */
+
+/*===================*
+ * Visible functions *
+ *===================*/
+
+/* Function: disconClockNs ================================================
+ *
+ * Abstract:
+ *      Read the monotonic clock.
+ */
+uint64_t disconClockNs(void) {
+#if defined _WIN32 || defined __CYGWIN__
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER        now;
+
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (uint64_t)((double)now.QuadPart*1e9/(double)freq.QuadPart);
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}  /* end disconClockNs */
+
+/* Function: disconHistReset ==============================================
+ *
+ * Abstract:
+ *      Empty a histogram.
+ */
+void disconHistReset(disconHist *h) {
+    (void)memset(h, 0, sizeof(*h));
+}  /* end disconHistReset */
+
+/* Function: disconHistAdd ================================================
+ *
+ * Abstract:
+ *      Count one value.
+ */
+void disconHistAdd(disconHist *h, uint64_t value) {
+    if (h->count == 0 || value < h->min) h->min = value;
+    if (value > h->max) h->max = value;
+    h->count++;
+    h->sum += (double)value;
+    h->bucket[bucketOf(value)]++;
+}  /* end disconHistAdd */
+
+/* Function: disconHistPercentile =========================================
+ *
+ * Abstract:
+ *      Walk the buckets up to the requested rank. The result is clamped to
+ *      the exact minimum and maximum, so p = 0 and p = 100 are exact.
+ */
+uint64_t disconHistPercentile(const disconHist *h, double p) {
+    uint64_t rank, seen = 0, value;
+    int      b;
+
+    if (h->count == 0) return 0;
+    rank = (uint64_t)(p/100.0*(double)h->count + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank >= h->count) return h->max;
+    for (b=0; b<DISCON_HIST_BUCKETS; b++) {
+        seen += h->bucket[b];
+        if (seen >= rank) break;
+    }
+    value = bucketValue(b);
+    if (value < h->min) value = h->min;
+    if (value > h->max) value = h->max;
+    return value;
+}  /* end disconHistPercentile */
+
+/* EOF: discon_profile.c */
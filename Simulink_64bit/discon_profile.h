@@ -0,0 +1,50 @@
+/*
+ * File    : discon_profile.h
+ *
+ * Abstract:
+ *      Timing support of the DISCON library and its tools: a monotonic
+ *      nanosecond clock and log-linear latency histograms.
+ *
+ *      A histogram counts values exactly below 2^DISCON_HIST_SUB_BITS and in
+ *      2^DISCON_HIST_SUB_BITS buckets per power of two above, so percentiles
+ *      are reported to within 1% for any value up to 2^64 ns in fixed memory.
+ *
+ *      The library measures itself only when it is built with DISCON_PROFILE
+ *      (see discon.h, DISCON_GetPhaseTimes).
+ */
+
+#ifndef DISCON_PROFILE_H
+#define DISCON_PROFILE_H
+
+#include <stdint.h>
+
+#include "discon.h"
+
+/* Measure the phases of every call (template makefile option) */
+#ifndef DISCON_PROFILE
+# define DISCON_PROFILE 0
+#endif
+
+#define DISCON_HIST_SUB_BITS  7
+#define DISCON_HIST_BUCKETS   ((64 - DISCON_HIST_SUB_BITS + 1) << DISCON_HIST_SUB_BITS)
+
+typedef struct {
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    double   sum;
+    uint64_t bucket[DISCON_HIST_BUCKETS];
+} disconHist;
+
+/* Nanoseconds since an arbitrary fixed point, never decreasing */
+DISCON_LOCAL uint64_t disconClockNs(void);
+
+DISCON_LOCAL void     disconHistReset(disconHist *h);
+DISCON_LOCAL void     disconHistAdd(disconHist *h, uint64_t value);
+
+/* Value below which p percent (0..100) of the added values lie */
+DISCON_LOCAL uint64_t disconHistPercentile(const disconHist *h, double p);
+
+#endif /* DISCON_PROFILE_H */
+
+/* EOF: discon_profile.h */
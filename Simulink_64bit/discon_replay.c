@@ -0,0 +1,791 @@
+/*
+ * File    : discon_replay.c
+ *
+ * Abstract:
+ *      Open-loop regression replay of recorded avrSwap traces. Every call
+ *      of a trace (discon_trace.h) is fed to a controller library (loaded
+ *      with dlopen) as fast as it runs, and, with -ref, to a reference
+ *      build of the controller as well. The demanded pitch, torque and yaw
+ *      (avrSwap[41..47]) and every logging channel of the two are compared
+ *      after each call, and the first call and channel that differ by more
+ *      than their tolerance are reported. Without -ref, the outputs stored
+ *      in a captured trace (discon_capture.h) are the reference.
+ *
+ *      Traces are spread over worker processes (-j, one per processor by
+ *      default), each of which loads its own copy of both libraries, so
+ *      controllers with the classic interface (one instance per process)
+ *      run in parallel too, and a controller that crashes only loses the
+ *      trace it was replaying; the worker is replaced.
+ *
+ *      A value passes when it is bit-identical to the reference or
+ *          |value - reference| <= atol + rtol*|reference|
+ *      with the tolerances of its channel (-tol name=atol[,rtol]) or else
+ *      the defaults (-atol, -rtol, both 0: bit-exact).
+ *
+ *      With -stats, every trace is replayed to its end, also past a
+ *      divergence, and the deviation of every compared channel from the
+ *      reference is accumulated over all traces and written to the given
+ *      file, one line per channel:
+ *          channel <TAB> values <TAB> max |dev| <TAB> RMS dev <TAB> max rel dev
+ *                  <TAB> trace <TAB> call
+ *      the last two locating the largest deviation. The relative deviation
+ *      is taken where the reference is not 0. This measures, e.g., how far
+ *      a single-precision build (DISCON_SINGLE) is from the double one.
+ *
+ *      The report has one line per trace, in the order given:
+ *          trace <TAB> OK <TAB> calls
+ *          trace <TAB> DIVERGED <TAB> call <TAB> channel <TAB> value <TAB> reference
+ *          trace <TAB> ERROR|CRASHED <TAB> call <TAB> message
+ *      on stdout or in the file given with -o; a summary goes to stderr.
+ *      The exit status is 0 when every trace passed.
+ *
+ *      usage: discon_replay [-lib library] [-ref library] [-j jobs]
+ *                           [-atol a] [-rtol r] [-tol name=atol[,rtol]]...
+ *                           [-list file] [-o report] [-stats file] trace...
+ *
+ *      The reference must be another file than the library under test,
+ *      else the dynamic loader returns the same copy. Unless DISCON_LOG_FILE
+ *      is set, the controller logs of a replay go to /dev/null.
+ *
+ *      Built with the library by the Linux template makefile (discon.tmf).
+ */
+
+#ifndef _POSIX_C_SOURCE
+# define _POSIX_C_SOURCE 200112L        /* setenv with -std=c99 */
+#endif
+#ifndef _DEFAULT_SOURCE
+# define _DEFAULT_SOURCE                /* MAP_ANONYMOUS */
+#endif
+
+#include <dlfcn.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "discon.h"
+#include "discon_log.h"
+#include "discon_profile.h"
+#include "discon_trace.h"
+
+#ifndef MAP_ANONYMOUS
+# define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/*=========*
+ * Defines *
+ *=========*/
+
+#define SWAP_SIZE       4096        /* records of the avrSwap array          */
+#define OUTNAME_SIZE    32768       /* avrSwap[50]                           */
+#define MSG_SIZE        1024        /* avrSwap[48]                           */
+#define FIRST_OUTPUT    41          /* avrSwap[41..47], the demands          */
+#define LAST_OUTPUT     47
+#define MAX_CHANNELS    (LAST_OUTPUT - FIRST_OUTPUT + 1 + SWAP_SIZE)
+#define MAX_WORKERS     256
+#define STATS_CHANNELS  256         /* channels with deviation statistics    */
+
+typedef void (CDECL *DisconFcn)(float *avrSwap, int *aviFail, char *accInfile,
+                                char *avcOutname, char *avcMsg);
+
+/* A controller library loaded by a worker */
+typedef struct {
+    void      *handle;
+    DisconFcn discon;
+    float     *avrSwap;
+    char      *outName;
+    char      msg[MSG_SIZE + 1];
+    int       aviFail;
+} Controller;
+
+/* Tolerance of a channel, by name */
+typedef struct {
+    const char *name;
+    double     atol;
+    double     rtol;
+} Tolerance;
+
+/* Outcome of a trace, in memory shared by all workers */
+enum { STATE_PENDING, STATE_RUNNING, STATE_DONE };
+enum { REPLAY_OK, REPLAY_DIVERGED, REPLAY_ERROR, REPLAY_CRASHED };
+
+typedef struct {
+    int    state;
+    int    status;
+    int    worker;                          /* slot that claimed the trace */
+    long   calls;                           /* calls replayed              */
+    long   call;                            /* first divergent call        */
+    double value;
+    double reference;
+    char   channel[DISCON_LOG_NAME_LEN];
+    char   message[160];
+} Result;
+
+/* Deviation of a channel from the reference over a trace (-stats) */
+typedef struct {
+    long   n;                               /* values compared             */
+    double sumSq;                           /* of the deviation            */
+    double maxAbs;
+    double maxRel;
+    long   call;                            /* of maxAbs                   */
+} Deviation;
+
+typedef struct {
+    long   next;                            /* next trace to claim         */
+    int    nStats;                          /* channels named in statNames */
+    char   statNames[STATS_CHANNELS][DISCON_LOG_NAME_LEN];
+    Result result[1];                       /* one per trace               */
+} Shared;
+
+/* Options and the compared channels of the current trace */
+static struct {
+    const char  *library;
+    const char  *reference;
+    double      atol;
+    double      rtol;
+    Tolerance   *tol;
+    int         nTol;
+    const char  **trace;
+    long        nTraces;
+    const char  *stats;
+} Opt = { "./DISCON.so", NULL, 0.0, 0.0, NULL, 0, NULL, 0, NULL };
+
+/* -stats: STATS_CHANNELS deviations per trace, in memory shared by all workers */
+static Deviation *Stats;
+
+/* Names of the demanded outputs, from the port table of discon_io.h */
+static const char *OutputNames[LAST_OUTPUT - FIRST_OUTPUT + 1];
+
+#define REPLAY_OUTPUT(name, i) \
+    if ((i) >= FIRST_OUTPUT && (i) <= LAST_OUTPUT) OutputNames[(i) - FIRST_OUTPUT] = #name;
+#define REPLAY_LOG(name, unit)
+
+/*=================*
+ * Local functions *
+ *=================*/
+
+/* Function: fail =========================================================
+ *
+ * Abstract:
+ *      Report a fatal error and exit.
+ */
+static void fail(const char *what, const char *detail) {
+    (void)fprintf(stderr, "discon_replay: %s%s%s\n", what,
+                  detail != NULL ? ": " : "", detail != NULL ? detail : "");
+    exit(EXIT_FAILURE);
+}  /* end fail */
+
+/* Function: addTrace =====================================================
+ *
+ * Abstract:
+ *      Append a trace to the list to replay.
+ */
+static void addTrace(const char *path) {
+    static long capacity = 0;
+
+    if (Opt.nTraces == capacity) {
+        capacity = capacity > 0 ? 2*capacity : 256;
+        Opt.trace = (const char **)realloc((void *)Opt.trace, capacity*sizeof(char *));
+        if (Opt.trace == NULL) fail("out of memory", NULL);
+    }
+    Opt.trace[Opt.nTraces++] = path;
+}  /* end addTrace */
+
+/* Function: readList =====================================================
+ *
+ * Abstract:
+ *      Add the traces listed in a file, one path per line.
+ */
+static void readList(const char *path) {
+    FILE *file = fopen(path, "r");
+    char line[4096];
+
+    if (file == NULL) fail("unable to open", path);
+    while (fgets(line, sizeof(line), file) != NULL) {
+        size_t n = strcspn(line, "\r\n");
+        char   *copy;
+
+        if (n == 0 || line[0] == '#') continue;
+        line[n] = '\0';
+        copy = (char *)malloc(n + 1);
+        if (copy == NULL) fail("out of memory", NULL);
+        (void)memcpy(copy, line, n + 1);
+        addTrace(copy);
+    }
+    (void)fclose(file);
+}  /* end readList */
+
+/* Function: addTolerance =================================================
+ *
+ * Abstract:
+ *      Parse name=atol[,rtol].
+ */
+static void addTolerance(char *spec) {
+    char      *eq = strchr(spec, '=');
+    Tolerance *t;
+
+    if (eq == NULL || eq == spec) fail("expected -tol name=atol[,rtol], found", spec);
+    Opt.tol = (Tolerance *)realloc(Opt.tol, (Opt.nTol + 1)*sizeof(Tolerance));
+    if (Opt.tol == NULL) fail("out of memory", NULL);
+    t = &Opt.tol[Opt.nTol++];
+    *eq = '\0';
+    t->name = spec;
+    t->rtol = 0.0;
+    if (sscanf(eq + 1, "%lf,%lf", &t->atol, &t->rtol) < 1) {
+        fail("invalid tolerance for", spec);
+    }
+}  /* end addTolerance */
+
+/* Function: loadController ===============================================
+ *
+ * Abstract:
+ *      Load a copy of a controller library and allocate its buffers.
+ */
+static void loadController(Controller *c, const char *library) {
+    c->handle = dlopen(library, RTLD_NOW | RTLD_LOCAL);
+    if (c->handle == NULL) fail("unable to load the controller", dlerror());
+    *(void **)&c->discon = dlsym(c->handle, "DISCON");
+    if (c->discon == NULL) fail("no DISCON entry point in", library);
+    c->avrSwap = (float *)calloc(SWAP_SIZE, sizeof(float));
+    c->outName = (char *)calloc(OUTNAME_SIZE + 1, 1);
+    if (c->avrSwap == NULL || c->outName == NULL) fail("out of memory", NULL);
+}  /* end loadController */
+
+/* Function: callController ===============================================
+ *
+ * Abstract:
+ *      One DISCON call with the inputs of a trace record. The string sizes
+ *      of the host and the logging record are limited to the buffers of
+ *      the replay.
+ */
+static void callController(Controller *c, const float *record, int nSwap, int first) {
+    float *avrSwap = c->avrSwap;
+    char  inFile[1] = {'\0'};
+    int   iFirstLog;
+
+    (void)memcpy(avrSwap, record, nSwap*sizeof(float));
+    if (first) avrSwap[0] = 0;              /* a trace always starts afresh */
+    if (avrSwap[48] > MSG_SIZE) avrSwap[48] = (float)MSG_SIZE;
+    avrSwap[49] = 0;
+    if (avrSwap[50] > OUTNAME_SIZE) avrSwap[50] = (float)OUTNAME_SIZE;
+    iFirstLog = (int)avrSwap[62];
+    if (iFirstLog < 1 || iFirstLog > SWAP_SIZE) {
+        avrSwap[62] = (float)(iFirstLog = SWAP_SIZE);
+    }
+    if (avrSwap[63] > SWAP_SIZE - iFirstLog + 1) {
+        avrSwap[63] = (float)(SWAP_SIZE - iFirstLog + 1);
+    }
+    c->msg[0] = '\0';
+    c->discon(avrSwap, &c->aviFail, inFile, c->outName, c->msg);
+    c->msg[MSG_SIZE] = '\0';
+}  /* end callController */
+
+/* Function: channelNames =================================================
+ *
+ * Abstract:
+ *      Split the "name:unit;name:unit;..." string of the logging channels
+ *      into the names of channels FIRST_OUTPUT.. onwards of the compared
+ *      list; returns the number of logging channels.
+ */
+static int channelNames(char *outName, const char **names) {
+    int  n = 0;
+    char *p = outName;
+
+    while (*p != '\0' && n < SWAP_SIZE) {
+        char *end = p + strcspn(p, ";");
+        char *colon = strchr(p, ':');
+
+        if (colon != NULL && colon < end) *colon = '\0';
+        names[n++] = p;
+        if (*end == '\0') break;
+        *end = '\0';
+        p = end + 1;
+    }
+    return n;
+}  /* end channelNames */
+
+/* Function: tolerances ===================================================
+ *
+ * Abstract:
+ *      Look up the tolerances of n named channels.
+ */
+static void tolerances(const char *const *names, int n, double *atol, double *rtol) {
+    int i, k;
+
+    for (i=0; i<n; i++) {
+        atol[i] = Opt.atol;
+        rtol[i] = Opt.rtol;
+        for (k=0; names[i] != NULL && k<Opt.nTol; k++) {
+            if (strcmp(Opt.tol[k].name, names[i]) == 0) {
+                atol[i] = Opt.tol[k].atol;
+                rtol[i] = Opt.tol[k].rtol;
+                break;
+            }
+        }
+    }
+}  /* end tolerances */
+
+/* Function: differs ======================================================
+ *
+ * Abstract:
+ *      Compare a value with its reference.
+ */
+static int differs(float value, float reference, double atol, double rtol) {
+    if (memcmp(&value, &reference, sizeof(float)) == 0) return 0;
+    return !(fabs((double)value - (double)reference) <= atol + rtol*fabs((double)reference));
+}  /* end differs */
+
+/* Function: addDeviation =================================================
+ *
+ * Abstract:
+ *      Accumulate the deviation of a value from its reference.
+ */
+static void addDeviation(Deviation *dev, long call, float value, float reference) {
+    double d = fabs((double)value - (double)reference);
+
+    if (dev == NULL) return;
+    dev->n++;
+    dev->sumSq += d*d;
+    if (d > dev->maxAbs) {
+        dev->maxAbs = d;
+        dev->call   = call;
+    }
+    if (reference != 0.0f && d/fabs((double)reference) > dev->maxRel) {
+        dev->maxRel = d/fabs((double)reference);
+    }
+}  /* end addDeviation */
+
+/* Function: statNames ====================================================
+ *
+ * Abstract:
+ *      Publish the names of the compared channels for the statistics, once:
+ *      the first trace to get here names them for all.
+ */
+static void statNames(Shared *shared, const char *const *names, int n) {
+    int i;
+
+    if (!__sync_bool_compare_and_swap(&shared->nStats, 0, -1)) return;
+    if (n > STATS_CHANNELS) n = STATS_CHANNELS;
+    for (i=0; i<n; i++) {
+        if (names[i] != NULL) {
+            (void)snprintf(shared->statNames[i], DISCON_LOG_NAME_LEN, "%s", names[i]);
+        } else {
+            (void)snprintf(shared->statNames[i], DISCON_LOG_NAME_LEN, "avrSwap[%d]",
+                           FIRST_OUTPUT + i);
+        }
+    }
+    __sync_synchronize();
+    shared->nStats = n;
+}  /* end statNames */
+
+/* Function: diverged =====================================================
+ *
+ * Abstract:
+ *      Record the first divergence of a trace.
+ */
+static void diverged(Result *res, long call, const char *channel, double value,
+                     double reference) {
+    res->status    = REPLAY_DIVERGED;
+    res->call      = call;
+    res->value     = value;
+    res->reference = reference;
+    (void)snprintf(res->channel, sizeof(res->channel), "%s", channel);
+}  /* end diverged */
+
+/* Function: recordedOutputs ==============================================
+ *
+ * Abstract:
+ *      Set up a controller that, instead of being called, returns the
+ *      outputs stored in the records of a captured trace, with the logging
+ *      channels named by the controller under test.
+ */
+static void recordedOutputs(Controller *rec, const Controller *test, const float *out) {
+    float *avrSwap = rec->avrSwap;
+    int   n = (int)out[DISCON_TRACE_OUT_NLOG];
+
+    rec->aviFail = (int)out[DISCON_TRACE_OUT_FAIL];
+    rec->outName = test->outName;
+    (void)memcpy(avrSwap + FIRST_OUTPUT, out + DISCON_TRACE_OUT_DEMANDS,
+                 (LAST_OUTPUT - FIRST_OUTPUT + 1)*sizeof(float));
+    avrSwap[62] = test->avrSwap[62];
+    avrSwap[64] = (float)n;
+    if (n > 0 && n <= SWAP_SIZE - (int)avrSwap[62] + 1) {
+        (void)memcpy(avrSwap + (int)avrSwap[62] - 1, out + DISCON_TRACE_OUT_LOG,
+                     n*sizeof(float));
+    }
+}  /* end recordedOutputs */
+
+/* Function: replayTrace ==================================================
+ *
+ * Abstract:
+ *      Feed one trace to the controller and, if loaded, the reference, and
+ *      compare them after every call. Without a reference, a captured
+ *      trace is compared with its recorded outputs. Stops at the first
+ *      divergence, unless dev collects the deviations (-stats), or failed
+ *      call.
+ */
+static void replayTrace(const char *path, Controller *test, Controller *ref, Result *res,
+                        Shared *shared, Deviation *dev) {
+    static const char *names[MAX_CHANNELS];
+    static double     atol[MAX_CHANNELS], rtol[MAX_CHANNELS];
+    static char       refNames[OUTNAME_SIZE + 1];
+    static float      recSwap[SWAP_SIZE];
+    Controller        rec;
+    disconTraceReader *trace;
+    const float       *record;
+    char              errorMsg[257], swapName[32];
+    int               nSwap, nIn, nOut = LAST_OUTPUT - FIRST_OUTPUT + 1, nLog = 0, i;
+    long              call;
+
+    trace = disconTraceOpen(path, errorMsg);
+    if (trace == NULL) {
+        res->status = REPLAY_ERROR;
+        (void)snprintf(res->message, sizeof(res->message), "%.159s", errorMsg);
+        return;
+    }
+    nSwap = (int)disconTraceInfo(trace)->nSwap;
+    nIn   = nSwap < SWAP_SIZE ? nSwap : SWAP_SIZE;
+    if (ref == NULL && disconTraceInfo(trace)->nOut > DISCON_TRACE_OUT_LOG) {
+        (void)memset(&rec, 0, sizeof(rec));
+        rec.avrSwap = recSwap;
+        ref = &rec;
+    }
+
+    for (call=0; (record = disconTraceNext(trace)) != NULL; call++) {
+        callController(test, record, nIn, call == 0);
+        res->calls = call + 1;
+        if (ref == NULL) {
+            if (test->aviFail < 0) break;
+            continue;
+        }
+        if (ref == &rec) {
+            recordedOutputs(&rec, test, record + nSwap);
+        } else {
+            callController(ref, record, nIn, call == 0);
+        }
+
+        if (call == 0) {
+            /* The channels of this trace, named by the reference */
+            for (i=0; i<nOut; i++) names[i] = OutputNames[i];
+            (void)memcpy(refNames, ref->outName, sizeof(refNames));
+            nLog = channelNames(refNames, names + nOut);
+            tolerances(names, nOut + nLog, atol, rtol);
+            if (dev != NULL) statNames(shared, names, nOut + nLog);
+        }
+        if ((test->aviFail < 0) != (ref->aviFail < 0)) {
+            diverged(res, call, "aviFail", test->aviFail, ref->aviFail);
+            break;
+        }
+        if (test->aviFail < 0) break;
+
+        for (i=0; i<nOut; i++) {
+            int k = FIRST_OUTPUT + i;
+
+            addDeviation(dev != NULL ? &dev[i] : NULL, call,
+                         test->avrSwap[k], ref->avrSwap[k]);
+            if (res->status == REPLAY_OK &&
+                differs(test->avrSwap[k], ref->avrSwap[k], atol[i], rtol[i])) {
+                if (names[i] == NULL) {
+                    (void)sprintf(swapName, "avrSwap[%d]", k);
+                }
+                diverged(res, call, names[i] != NULL ? names[i] : swapName,
+                         test->avrSwap[k], ref->avrSwap[k]);
+                if (dev == NULL) break;
+            }
+        }
+        if (res->status != REPLAY_OK && dev == NULL) break;
+
+        if (test->avrSwap[64] != ref->avrSwap[64]) {
+            if (res->status == REPLAY_OK) {
+                diverged(res, call, "avrSwap[64]", test->avrSwap[64], ref->avrSwap[64]);
+            }
+            break;
+        }
+        {
+            const float *y = test->avrSwap + (int)ref->avrSwap[62] - 1;
+            const float *yRef = ref->avrSwap + (int)ref->avrSwap[62] - 1;
+            int         n = (int)ref->avrSwap[64];
+
+            for (i=0; i<n; i++) {
+                int c = nOut + (i < nLog ? i : nLog - 1);
+
+                if (dev != NULL && nOut + i < STATS_CHANNELS) {
+                    addDeviation(&dev[nOut + i], call, y[i], yRef[i]);
+                }
+                if (res->status == REPLAY_OK && differs(y[i], yRef[i], atol[c], rtol[c])) {
+                    if (i >= nLog) (void)sprintf(swapName, "log %d", i + 1);
+                    diverged(res, call, i < nLog ? names[nOut + i] : swapName,
+                             y[i], yRef[i]);
+                    if (dev == NULL) break;
+                }
+            }
+        }
+        if (res->status != REPLAY_OK && dev == NULL) break;
+    }
+    if (res->status == REPLAY_OK && test->aviFail < 0) {
+        res->status = REPLAY_ERROR;
+        res->call   = res->calls - 1;
+        (void)snprintf(res->message, sizeof(res->message), "%.159s", test->msg);
+    }
+    disconTraceClose(trace);
+}  /* end replayTrace */
+
+/* Function: worker =======================================================
+ *
+ * Abstract:
+ *      Body of a worker process: load the libraries, then claim and replay
+ *      traces until none are left.
+ */
+static void worker(Shared *shared, int slot) {
+    Controller test, ref;
+    long       i;
+
+    /* The controllers may print; keep the report on stdout clean */
+    if (freopen("/dev/null", "w", stdout) == NULL) fail("unable to open /dev/null", NULL);
+    (void)memset(&test, 0, sizeof(test));
+    (void)memset(&ref, 0, sizeof(ref));
+    loadController(&test, Opt.library);
+    if (Opt.reference != NULL) {
+        loadController(&ref, Opt.reference);
+        if (ref.handle == test.handle) {
+            fail("the reference is the same library, copy it to another file",
+                 Opt.reference);
+        }
+    }
+
+    while ((i = __sync_fetch_and_add(&shared->next, 1)) < Opt.nTraces) {
+        Result *res = &shared->result[i];
+
+        res->worker = slot;
+        res->state  = STATE_RUNNING;
+        __sync_synchronize();
+        replayTrace(Opt.trace[i], &test, Opt.reference != NULL ? &ref : NULL, res,
+                    shared, Stats != NULL ? Stats + i*STATS_CHANNELS : NULL);
+        __sync_synchronize();
+        res->state = STATE_DONE;
+    }
+    exit(EXIT_SUCCESS);
+}  /* end worker */
+
+/* Function: startWorker ==================================================
+ *
+ * Abstract:
+ *      Fork the worker of a slot.
+ */
+static pid_t startWorker(Shared *shared, int slot) {
+    pid_t pid;
+
+    (void)fflush(NULL);
+    pid = fork();
+    if (pid < 0) fail("unable to start a worker process", NULL);
+    if (pid == 0) worker(shared, slot);
+    return pid;
+}  /* end startWorker */
+
+/* Function: writeReport ==================================================
+ *
+ * Abstract:
+ *      One line per trace, in the order given.
+ */
+static void writeReport(FILE *out, const Shared *shared, long *count) {
+    long i;
+
+    for (i=0; i<Opt.nTraces; i++) {
+        const Result *res = &shared->result[i];
+
+        count[res->status]++;
+        switch (res->status) {
+          case REPLAY_OK:
+            (void)fprintf(out, "%s\tOK\t%ld\n", Opt.trace[i], res->calls);
+            break;
+          case REPLAY_DIVERGED:
+            (void)fprintf(out, "%s\tDIVERGED\t%ld\t%s\t%.9g\t%.9g\n", Opt.trace[i],
+                          res->call, res->channel, res->value, res->reference);
+            break;
+          default:
+            (void)fprintf(out, "%s\t%s\t%ld\t%s\n", Opt.trace[i],
+                          res->status == REPLAY_ERROR ? "ERROR" : "CRASHED",
+                          res->call, res->message);
+            break;
+        }
+    }
+}  /* end writeReport */
+
+/* Function: writeStats ===================================================
+ *
+ * Abstract:
+ *      Merge the deviations of every channel over the traces and write one
+ *      line per channel.
+ */
+static void writeStats(FILE *out, const Shared *shared) {
+    int  c;
+    long i;
+
+    (void)fprintf(out, "channel\tvalues\tmax_abs\trms\tmax_rel\ttrace\tcall\n");
+    for (c=0; c<shared->nStats; c++) {
+        Deviation  all;
+        const char *where = "-";
+
+        (void)memset(&all, 0, sizeof(all));
+        all.call = -1;
+        for (i=0; i<Opt.nTraces; i++) {
+            const Deviation *dev = &Stats[i*STATS_CHANNELS + c];
+
+            all.n     += dev->n;
+            all.sumSq += dev->sumSq;
+            if (dev->n > 0 && (all.call < 0 || dev->maxAbs > all.maxAbs)) {
+                all.maxAbs = dev->maxAbs;
+                all.call   = dev->call;
+                where      = Opt.trace[i];
+            }
+            if (dev->maxRel > all.maxRel) all.maxRel = dev->maxRel;
+        }
+        (void)fprintf(out, "%s\t%ld\t%.9g\t%.9g\t%.9g\t%s\t%ld\n",
+                      shared->statNames[c], all.n, all.maxAbs,
+                      all.n > 0 ? sqrt(all.sumSq/all.n) : 0.0, all.maxRel,
+                      where, all.call);
+    }
+}  /* end writeStats */
+
+/*===================*
+ * Visible functions *
+ *===================*/
+
+int main(int argc, char *argv[]) {
+    const char *outPath = NULL;
+    Shared     *shared;
+    size_t     sharedSize, statsSize = 0;
+    pid_t      pid[MAX_WORKERS];
+    long       count[REPLAY_CRASHED + 1] = {0}, calls = 0, i;
+    int        nJobs = 0, running, status, slot, lost;
+    uint64_t   start;
+    double     elapsed;
+    FILE       *out = stdout;
+
+    DISCON_OUTPUTS(REPLAY_OUTPUT, REPLAY_LOG)
+
+    for (i=1; i<argc; i++) {
+        if (strcmp(argv[i], "-lib") == 0 && i+1 < argc) {
+            Opt.library = argv[++i];
+        } else if (strcmp(argv[i], "-ref") == 0 && i+1 < argc) {
+            Opt.reference = argv[++i];
+        } else if (strcmp(argv[i], "-j") == 0 && i+1 < argc) {
+            nJobs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-atol") == 0 && i+1 < argc) {
+            Opt.atol = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-rtol") == 0 && i+1 < argc) {
+            Opt.rtol = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-tol") == 0 && i+1 < argc) {
+            addTolerance(argv[++i]);
+        } else if (strcmp(argv[i], "-list") == 0 && i+1 < argc) {
+            readList(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i+1 < argc) {
+            outPath = argv[++i];
+        } else if (strcmp(argv[i], "-stats") == 0 && i+1 < argc) {
+            Opt.stats = argv[++i];
+        } else if (argv[i][0] != '-') {
+            addTrace(argv[i]);
+        } else {
+            (void)fprintf(stderr, "usage: %s [-lib library] [-ref library] [-j jobs] "
+                          "[-atol a] [-rtol r] [-tol name=atol[,rtol]]... "
+                          "[-list file] [-o report] [-stats file] trace...\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (Opt.nTraces == 0) fail("no traces to replay", NULL);
+    if (nJobs <= 0) nJobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (nJobs < 1) nJobs = 1;
+    if (nJobs > MAX_WORKERS) nJobs = MAX_WORKERS;
+    if (nJobs > Opt.nTraces) nJobs = (int)Opt.nTraces;
+
+    if (getenv("DISCON_LOG_FILE") == NULL) {
+        (void)setenv("DISCON_LOG_FILE", "/dev/null", 1);
+    }
+
+    sharedSize = sizeof(Shared) + (size_t)Opt.nTraces*sizeof(Result);
+    shared = (Shared *)mmap(NULL, sharedSize, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) fail("out of memory", NULL);
+    if (Opt.stats != NULL) {
+        statsSize = (size_t)Opt.nTraces*STATS_CHANNELS*sizeof(Deviation);
+        Stats = (Deviation *)mmap(NULL, statsSize, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (Stats == MAP_FAILED) fail("out of memory", NULL);
+    }
+
+    /* Keep nJobs workers busy, replacing those that crash */
+    start = disconClockNs();
+    for (slot=0; slot<nJobs; slot++) pid[slot] = startWorker(shared, slot);
+    running = nJobs;
+    while (running > 0) {
+        pid_t done = wait(&status);
+
+        if (done < 0) break;
+        for (slot=0; slot<nJobs && pid[slot] != done; slot++);
+        if (slot == nJobs) continue;
+        running--;
+        if (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS) continue;
+
+        /* A worker that fails without a trace (e.g. to load) is not replaced */
+        lost = 0;
+        for (i=0; i<Opt.nTraces; i++) {
+            Result *res = &shared->result[i];
+
+            if (res->state == STATE_RUNNING && res->worker == slot) {
+                res->state  = STATE_DONE;
+                res->status = REPLAY_CRASHED;
+                res->call   = res->calls;
+                if (WIFSIGNALED(status)) {
+                    (void)snprintf(res->message, sizeof(res->message),
+                                   "controller crashed (signal %d)", WTERMSIG(status));
+                } else {
+                    (void)snprintf(res->message, sizeof(res->message),
+                                   "worker exited with status %d", WEXITSTATUS(status));
+                }
+                lost = 1;
+            }
+        }
+        if (lost && shared->next < Opt.nTraces) {
+            pid[slot] = startWorker(shared, slot);
+            running++;
+        }
+    }
+    elapsed = (double)(disconClockNs() - start)*1e-9;
+
+    for (i=0; i<Opt.nTraces; i++) {
+        if (shared->result[i].state != STATE_DONE) {
+            shared->result[i].status = REPLAY_CRASHED;
+            (void)snprintf(shared->result[i].message,
+                           sizeof(shared->result[i].message), "not replayed");
+        }
+        calls += shared->result[i].calls;
+    }
+
+    if (outPath != NULL && (out = fopen(outPath, "w")) == NULL) {
+        fail("unable to create", outPath);
+    }
+    writeReport(out, shared, count);
+    if (out != stdout) (void)fclose(out);
+    if (Opt.stats != NULL) {
+        if ((out = fopen(Opt.stats, "w")) == NULL) fail("unable to create", Opt.stats);
+        writeStats(out, shared);
+        (void)fclose(out);
+        (void)munmap(Stats, statsSize);
+    }
+
+    (void)fprintf(stderr, "%s: %ld traces on %d workers, %ld OK, %ld diverged, "
+                  "%ld errors, %ld crashed\n  %ld calls in %.2f s (%.0f calls/s)\n",
+                  Opt.library, Opt.nTraces, nJobs, count[REPLAY_OK],
+                  count[REPLAY_DIVERGED], count[REPLAY_ERROR], count[REPLAY_CRASHED],
+                  calls, elapsed, elapsed > 0.0 ? calls/elapsed : 0.0);
+
+    (void)munmap(shared, sharedSize);
+    return count[REPLAY_OK] == Opt.nTraces ? EXIT_SUCCESS : EXIT_FAILURE;
+}  /* end main */
+
+/* EOF: discon_replay.c */
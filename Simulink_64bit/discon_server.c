@@ -0,0 +1,216 @@
+/*
+ * File    : discon_server.c
+ *
+ * Abstract:
+ *      Controller server of the DISCON shim (discon_shim.c). Started by the
+ *      shim with the descriptor of the shared-memory channel
+ *      (discon_ipc.h) and the controller library, it loads the library and
+ *      serves the calls posted to the channel in order, until the shim
+ *      stops it or the host process is gone.
+ *
+ *      The controller binds every avrSwap buffer to its own instance, so
+ *      the server keeps one avrSwap buffer per avrSwap buffer of the host:
+ *      the calls of one host instance always reach the same controller
+ *      instance. A buffer is dropped after the final call (iStatus -1).
+ *
+ *      usage: discon_server fd library
+ *
+ *      Not meant to be run by hand. Built with the shim by the Linux
+ *      template makefile (discon.tmf).
+ */
+
+#ifndef _DEFAULT_SOURCE
+# define _DEFAULT_SOURCE                /* MAP_SHARED, getppid */
+#endif
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "discon.h"
+#include "discon_ipc.h"
+
+/*=========*
+ * Defines *
+ *=========*/
+
+#define MAX_INSTANCES   256         /* host avrSwap buffers at a time       */
+#define MIN_SWAP        64          /* records any call passes, at least    */
+#define PARENT_MS       1000        /* check for the host this often, idle  */
+
+#define NINT(a) ((a) >= 0.0 ? (int)((a)+0.5) : (int)((a)-0.5))
+
+typedef void (CDECL *DisconFcn)(float *avrSwap, int *aviFail, char *accInfile,
+                                char *avcOutname, char *avcMsg);
+
+/*==================================*
+ * Global data local to this module *
+ *==================================*/
+
+/* avrSwap buffers of the controller, by host buffer */
+static struct {
+    uint32_t keyLo;
+    uint32_t keyHi;
+    float    *avrSwap;              /* NULL: free entry                     */
+} Instances[MAX_INSTANCES];
+
+/*=================*
+ * Local functions *
+ *=================*/
+
+/* Function: failStart ====================================================
+ *
+ * Abstract:
+ *      Report a start-up failure to the shim and exit.
+ */
+static void failStart(disconIpcHeader *hdr, const char *what, const char *detail) {
+    (void)snprintf(hdr->error, sizeof(hdr->error), "%s%s%.200s", what,
+                   detail != NULL ? ": " : "", detail != NULL ? detail : "");
+    __sync_synchronize();
+    hdr->state = DISCON_IPC_FAILED;
+    disconIpcWake(&hdr->state, &hdr->hostWaiting);
+    exit(EXIT_FAILURE);
+}  /* end failStart */
+
+/* Function: instanceSwap =================================================
+ *
+ * Abstract:
+ *      The avrSwap buffer of the controller for a host buffer, allocated
+ *      on its first call. NULL when there is no room.
+ */
+static float *instanceSwap(const disconIpcSlot *slot) {
+    int k, unused = -1;
+
+    for (k=0; k<MAX_INSTANCES; k++) {
+        if (Instances[k].avrSwap == NULL) {
+            if (unused < 0) unused = k;
+        } else if (Instances[k].keyLo == slot->keyLo && Instances[k].keyHi == slot->keyHi) {
+            return Instances[k].avrSwap;
+        }
+    }
+    if (unused < 0) return NULL;
+    Instances[unused].avrSwap = (float *)calloc(DISCON_IPC_SWAP, sizeof(float));
+    Instances[unused].keyLo   = slot->keyLo;
+    Instances[unused].keyHi   = slot->keyHi;
+    return Instances[unused].avrSwap;
+}  /* end instanceSwap */
+
+/* Function: releaseSwap ==================================================
+ *
+ * Abstract:
+ *      Drop the buffer of a host instance after its final call.
+ */
+static void releaseSwap(const float *avrSwap) {
+    int k;
+
+    for (k=0; k<MAX_INSTANCES; k++) {
+        if (Instances[k].avrSwap == avrSwap) {
+            free(Instances[k].avrSwap);
+            Instances[k].avrSwap = NULL;
+            return;
+        }
+    }
+}  /* end releaseSwap */
+
+/* Function: serve ========================================================
+ *
+ * Abstract:
+ *      One call of the controller with the inputs of a slot; the outputs
+ *      go back into the slot. The string sizes the controller sees are
+ *      limited to the slot buffers, and restored for the host.
+ */
+static void serve(DisconFcn discon, disconIpcSlot *slot) {
+    float *avrSwap = instanceSwap(slot);
+    int   nSwap    = slot->nSwap;
+    float sizes[3];
+
+    if (avrSwap == NULL) {
+        slot->aviFail = -1;
+        (void)snprintf(slot->msg, sizeof(slot->msg),
+                       "DISCON server: more than %d controller instances", MAX_INSTANCES);
+        return;
+    }
+    if (nSwap < MIN_SWAP || nSwap > DISCON_IPC_SWAP) nSwap = DISCON_IPC_SWAP;
+    (void)memcpy(avrSwap, slot->avrSwap, (size_t)nSwap*sizeof(float));
+    (void)memcpy(sizes, avrSwap + 48, sizeof(sizes));
+    if (avrSwap[48] > DISCON_IPC_MSG) avrSwap[48] = (float)DISCON_IPC_MSG;
+    avrSwap[49] = (float)strlen(slot->inFile);
+    if (avrSwap[50] > DISCON_IPC_OUTNAME) avrSwap[50] = (float)DISCON_IPC_OUTNAME;
+    slot->msg[0]     = '\0';
+    slot->outName[0] = '\0';
+
+    slot->aviFail = 0;
+    discon(avrSwap, &slot->aviFail, slot->inFile, slot->outName, slot->msg);
+
+    (void)memcpy(avrSwap + 48, sizes, sizeof(sizes));
+    (void)memcpy(slot->avrSwap, avrSwap, (size_t)nSwap*sizeof(float));
+    slot->msg[DISCON_IPC_MSG - 1]         = '\0';
+    slot->outName[DISCON_IPC_OUTNAME - 1] = '\0';
+    if (NINT(avrSwap[0]) == -1) releaseSwap(avrSwap);
+}  /* end serve */
+
+/*===================*
+ * Visible functions *
+ *===================*/
+
+int main(int argc, char *argv[]) {
+    disconIpcChannel *ch;
+    disconIpcHeader  *hdr;
+    void             *handle;
+    DisconFcn        discon;
+    uint32_t         tail = 0;
+    pid_t            parent = getppid();
+
+    if (argc != 3) {
+        (void)fprintf(stderr, "usage: %s fd library (started by the DISCON shim)\n",
+                      argv[0]);
+        return EXIT_FAILURE;
+    }
+    ch = (disconIpcChannel *)mmap(NULL, sizeof(disconIpcChannel),
+                                  PROT_READ | PROT_WRITE, MAP_SHARED, atoi(argv[1]), 0);
+    if (ch == MAP_FAILED) {
+        (void)fprintf(stderr, "%s: unable to map the channel\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    (void)close(atoi(argv[1]));
+    hdr = &ch->header;
+    hdr->serverPid = (int32_t)getpid();
+    if (hdr->magic != DISCON_IPC_MAGIC || hdr->version != DISCON_IPC_VERSION ||
+        hdr->slotSize != sizeof(disconIpcSlot)) {
+        failStart(hdr, "the DISCON shim and server are of different versions", NULL);
+    }
+
+    handle = dlopen(argv[2], RTLD_NOW | RTLD_LOCAL);
+    if (handle == NULL) failStart(hdr, "unable to load the controller", dlerror());
+    *(void **)&discon = dlsym(handle, "DISCON");
+    if (discon == NULL) failStart(hdr, "no DISCON entry point in", argv[2]);
+    __sync_synchronize();
+    hdr->state = DISCON_IPC_READY;
+    disconIpcWake(&hdr->state, &hdr->hostWaiting);
+
+    for (;;) {
+        disconIpcSlot *slot = &ch->slot[tail & (DISCON_IPC_SLOTS - 1)];
+
+        while (slot->seq != tail + 1) {
+            uint32_t bell = hdr->doorbell;
+
+            if (slot->seq == tail + 1) break;
+            if (hdr->state == DISCON_IPC_STOP) return EXIT_SUCCESS;
+            if (disconIpcWait(&hdr->doorbell, bell, &hdr->serverWaiting,
+                              PARENT_MS) != 0 && getppid() != parent) {
+                return EXIT_SUCCESS;        /* the host is gone */
+            }
+        }
+        __sync_synchronize();
+        serve(discon, slot);
+        __sync_synchronize();
+        slot->reply = 1;
+        disconIpcWake(&slot->reply, &slot->hostWaiting);
+        tail++;
+    }
+}  /* end main */
+
+/* EOF: discon_server.c */
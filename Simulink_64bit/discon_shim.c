@@ -0,0 +1,385 @@
+/*
+ * File    : discon_shim.c
+ *
+ * Abstract:
+ *      DISCON entry point that runs the controller in another process.
+ *      Built as a shared library (DISCON_shim.so) and loaded by the host in
+ *      place of the controller, it starts the controller server
+ *      (discon_server.c) on the first call and forwards every call to it
+ *      through the shared-memory channel of discon_ipc.h: the avrSwap
+ *      records the call uses, accInfile, and back the outputs, avcOutname
+ *      and avcMsg. A round trip costs a few microseconds.
+ *
+ *      The server is a separate executable, so the shim and the server can
+ *      differ in word size (a 32-bit host driving a 64-bit controller), and
+ *      a controller that crashes or calls exit() only ends the server: the
+ *      call fails with aviFail = -1 and a message, as do all later calls,
+ *      and the host carries on.
+ *
+ *      Environment:
+ *          DISCON_SERVER           server executable; default discon_server
+ *                                  in the folder of the shim
+ *          DISCON_SERVER_LIBRARY   controller library the server loads;
+ *                                  default DISCON_controller.so in the
+ *                                  folder of the shim
+ *
+ *      Every call passes avrSwap[0..MIN_SWAP-1] and, when the host asks
+ *      for logging channels, the logging record up to avrSwap[62] +
+ *      avrSwap[63] - 2. Linux only.
+ */
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE                    /* dladdr */
+#endif
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "discon.h"
+#include "discon_ipc.h"
+#include "discon_threads.h"
+
+extern char **environ;
+
+/*=========*
+ * Defines *
+ *=========*/
+
+#define SERVER_NAME    "discon_server"
+#define LIBRARY_NAME   "DISCON_controller.so"
+#define MIN_SWAP       170          /* the records of the DISCON interface */
+#define LIVENESS_MS    100          /* check the server after this long    */
+#define STOP_MS        2000         /* wait for the server to exit         */
+
+#define NINT(a) ((a) >= 0.0 ? (int)((a)+0.5) : (int)((a)-0.5))
+
+/*==================================*
+ * Global data local to this module *
+ *==================================*/
+
+/* The server of this process */
+static struct {
+    disconMutex      lock;          /* start, stop and reaping             */
+    volatile int     state;         /* 0 not started, 1 running, -1 failed */
+    disconIpcChannel *ch;
+    pid_t            pid;
+    char             error[257];    /* message of every failed call        */
+} Server = { DISCON_MUTEX_INITIALIZER, 0, NULL, 0, "" };
+
+/*=================*
+ * Local functions *
+ *=================*/
+
+/* Function: besideShim ===================================================
+ *
+ * Abstract:
+ *      Path of a file named by an environment variable, else of the file
+ *      name in the folder of this library.
+ */
+static void besideShim(const char *var, const char *name, char *path, size_t size) {
+    const char *value = getenv(var);
+    Dl_info    info;
+    const char *slash;
+
+    if (value != NULL && value[0] != '\0') {
+        (void)snprintf(path, size, "%s", value);
+    } else if (dladdr((void *)&besideShim, &info) != 0 && info.dli_fname != NULL &&
+               (slash = strrchr(info.dli_fname, '/')) != NULL) {
+        (void)snprintf(path, size, "%.*s/%s", (int)(slash - info.dli_fname),
+                       info.dli_fname, name);
+    } else {
+        (void)snprintf(path, size, "./%s", name);
+    }
+}  /* end besideShim */
+
+/* Function: serverFailed =================================================
+ *
+ * Abstract:
+ *      Mark the server as failed with a message for all calls from now on.
+ *      Called with Server.lock held.
+ */
+static void serverFailed(const char *msg) {
+    if (Server.state >= 0) {
+        (void)snprintf(Server.error, sizeof(Server.error), "DISCON shim: %.200s", msg);
+        __sync_synchronize();
+        Server.state = -1;
+    }
+}  /* end serverFailed */
+
+/* Function: checkServer ==================================================
+ *
+ * Abstract:
+ *      Check that the started server is still running, and mark it as
+ *      failed if not. A host process forked after the start cannot reap
+ *      the server and checks that it exists instead. Called with
+ *      Server.lock held.
+ */
+static int checkServer(void) {
+    char  msg[128];
+    int   status;
+    pid_t done = waitpid(Server.pid, &status, WNOHANG);
+
+    if (done == Server.pid) {
+        if (WIFSIGNALED(status)) {
+            (void)sprintf(msg, "controller server crashed (signal %d)",
+                          WTERMSIG(status));
+        } else {
+            (void)sprintf(msg, "controller server exited with status %d",
+                          WEXITSTATUS(status));
+        }
+        serverFailed(msg);
+        return 0;
+    }
+    if (done < 0 && kill(Server.pid, 0) != 0) {
+        serverFailed("controller server ended");
+        return 0;
+    }
+    return 1;
+}  /* end checkServer */
+
+/* Function: serverAlive ==================================================
+ *
+ * Abstract:
+ *      checkServer after a wait for the server timed out.
+ */
+static int serverAlive(void) {
+    disconMutexLock(&Server.lock);
+    if (Server.state > 0) (void)checkServer();
+    disconMutexUnlock(&Server.lock);
+    return Server.state > 0;
+}  /* end serverAlive */
+
+/* Function: startServer ==================================================
+ *
+ * Abstract:
+ *      Create the channel and start the server on it, then wait until it
+ *      has loaded the controller. The server inherits the descriptor of
+ *      the channel, which has no name left in the file system. Called with
+ *      Server.lock held.
+ */
+static void startServer(void) {
+    char              server[4096], library[4096], fdArg[16], name[64];
+    char              *argv[4];
+    disconIpcChannel  *ch;
+    disconIpcHeader   *hdr;
+    int               fd;
+
+    besideShim("DISCON_SERVER", SERVER_NAME, server, sizeof(server));
+    besideShim("DISCON_SERVER_LIBRARY", LIBRARY_NAME, library, sizeof(library));
+
+    (void)sprintf(name, "/discon_shim.%ld.%p", (long)getpid(), (void *)&Server);
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        serverFailed("unable to create the shared-memory channel");
+        return;
+    }
+    (void)shm_unlink(name);
+    if (ftruncate(fd, sizeof(disconIpcChannel)) != 0 ||
+        (ch = (disconIpcChannel *)mmap(NULL, sizeof(disconIpcChannel),
+                                       PROT_READ | PROT_WRITE, MAP_SHARED,
+                                       fd, 0)) == MAP_FAILED) {
+        (void)close(fd);
+        serverFailed("unable to map the shared-memory channel");
+        return;
+    }
+    hdr = &ch->header;
+    hdr->magic    = DISCON_IPC_MAGIC;
+    hdr->version  = DISCON_IPC_VERSION;
+    hdr->slotSize = sizeof(disconIpcSlot);
+    hdr->state    = DISCON_IPC_STARTING;
+    {
+        uint32_t k;
+
+        for (k=0; k<DISCON_IPC_SLOTS; k++) ch->slot[k].seq = k;
+    }
+
+    (void)fcntl(fd, F_SETFD, 0);            /* inherited by the server */
+    (void)sprintf(fdArg, "%d", fd);
+    argv[0] = server;
+    argv[1] = fdArg;
+    argv[2] = library;
+    argv[3] = NULL;
+    if (posix_spawn(&Server.pid, server, NULL, NULL, argv, environ) != 0) {
+        (void)close(fd);
+        (void)munmap(ch, sizeof(disconIpcChannel));
+        (void)snprintf(name, sizeof(name), "unable to start %.40s",
+                       strrchr(server, '/') != NULL ? strrchr(server, '/') + 1 : server);
+        serverFailed(name);
+        return;
+    }
+    (void)close(fd);
+    Server.ch = ch;
+
+    while (disconIpcWait(&hdr->state, DISCON_IPC_STARTING, &hdr->hostWaiting,
+                         LIVENESS_MS) != 0 && checkServer()) {
+        continue;
+    }
+    if (hdr->state == DISCON_IPC_READY) {
+        __sync_synchronize();
+        Server.state = 1;
+    } else if (Server.state == 0) {
+        hdr->error[sizeof(hdr->error)-1] = '\0';
+        serverFailed(hdr->error[0] != '\0' ? hdr->error :
+                     "controller server failed to start");
+    }
+}  /* end startServer */
+
+/* Function: stopServer ===================================================
+ *
+ * Abstract:
+ *      Ask the server to exit when the shim is unloaded or the host exits,
+ *      and reap it; kill it if it does not exit in time.
+ */
+static void stopServer(void) __attribute__((destructor));
+static void stopServer(void) {
+    disconIpcHeader *hdr;
+    int             status, waited;
+
+    if (Server.ch == NULL) return;
+    hdr = &Server.ch->header;
+    hdr->state = DISCON_IPC_STOP;
+    (void)__sync_add_and_fetch(&hdr->doorbell, 1);
+    disconIpcWake(&hdr->doorbell, &hdr->serverWaiting);
+    for (waited=0; waited<STOP_MS; waited++) {
+        pid_t done = waitpid(Server.pid, &status, WNOHANG);
+
+        if (done == Server.pid || done < 0) break;
+        (void)usleep(1000);
+    }
+    if (waited == STOP_MS) {
+        (void)kill(Server.pid, SIGKILL);
+        (void)waitpid(Server.pid, &status, 0);
+    }
+    (void)munmap(Server.ch, sizeof(disconIpcChannel));
+    Server.ch = NULL;
+}  /* end stopServer */
+
+/* Function: callFailed ===================================================
+ *
+ * Abstract:
+ *      Fail a call with the message of the failed server.
+ */
+static void callFailed(const float *avrSwap, int *aviFail, char *avcMsg) {
+    int size = NINT(avrSwap[48]);
+
+    *aviFail = -1;
+    if (size > 0) {
+        (void)snprintf(avcMsg, (size_t)size, "%s", Server.error);
+    }
+}  /* end callFailed */
+
+/* Function: claimSlot ====================================================
+ *
+ * Abstract:
+ *      Claim the next free slot of the ring. Another thread that claimed
+ *      the same position first makes the loop read head again; a full ring
+ *      (all slots in flight) yields until one is freed.
+ */
+static disconIpcSlot *claimSlot(disconIpcChannel *ch, uint32_t *pos) {
+    for (;;) {
+        uint32_t      p    = ch->header.head;
+        disconIpcSlot *slot = &ch->slot[p & (DISCON_IPC_SLOTS - 1)];
+        int32_t       diff = (int32_t)(slot->seq - p);
+
+        if (diff == 0) {
+            if (__sync_bool_compare_and_swap(&ch->header.head, p, p + 1)) {
+                *pos = p;
+                return slot;
+            }
+        } else if (diff < 0) {
+            if (!serverAlive()) return NULL;
+            (void)sched_yield();
+        }
+    }
+}  /* end claimSlot */
+
+/*===================*
+ * Visible functions *
+ *===================*/
+
+/* Function: DISCON =======================================================
+ *
+ * Abstract:
+ *      Forward one call to the server and wait for its outputs.
+ */
+void CDECL DISCON(float *avrSwap, int *aviFail, char *accInfile, char *avcOutname,
+                  char *avcMsg) {
+    disconIpcSlot *slot;
+    uint32_t      pos;
+    uintptr_t     key = (uintptr_t)avrSwap;
+    int           nSwap = MIN_SWAP, n;
+
+    if (Server.state == 0) {
+        disconMutexLock(&Server.lock);
+        if (Server.state == 0) startServer();
+        disconMutexUnlock(&Server.lock);
+    }
+    __sync_synchronize();
+    if (Server.state < 0 || (slot = claimSlot(Server.ch, &pos)) == NULL) {
+        callFailed(avrSwap, aviFail, avcMsg);
+        return;
+    }
+
+    /* Inputs */
+    if (NINT(avrSwap[62]) > 0 && NINT(avrSwap[63]) > 0) {
+        n = NINT(avrSwap[62]) - 1 + NINT(avrSwap[63]);
+        if (n > nSwap) nSwap = n;
+    }
+    if (nSwap > DISCON_IPC_SWAP) nSwap = DISCON_IPC_SWAP;
+    slot->nSwap = nSwap;
+    slot->keyLo = (uint32_t)key;
+    slot->keyHi = (uint32_t)((uint64_t)key >> 32);
+    (void)memcpy(slot->avrSwap, avrSwap, (size_t)nSwap*sizeof(float));
+    n = NINT(avrSwap[49]);
+    if (n < 0 || accInfile == NULL) n = 0;
+    if (n > DISCON_IPC_INFILE - 1) n = DISCON_IPC_INFILE - 1;
+    (void)memcpy(slot->inFile, accInfile, (size_t)n);
+    slot->inFile[n] = '\0';
+    slot->reply = 0;
+
+    /* Publish, then wait for the reply */
+    __sync_synchronize();
+    slot->seq = pos + 1;
+    (void)__sync_add_and_fetch(&Server.ch->header.doorbell, 1);
+    disconIpcWake(&Server.ch->header.doorbell, &Server.ch->header.serverWaiting);
+    while (disconIpcWait(&slot->reply, 0, &slot->hostWaiting, LIVENESS_MS) != 0) {
+        if (!serverAlive()) {
+            callFailed(avrSwap, aviFail, avcMsg);
+            return;
+        }
+    }
+
+    /* Outputs */
+    (void)memcpy(avrSwap, slot->avrSwap, (size_t)nSwap*sizeof(float));
+    *aviFail = slot->aviFail;
+    n = NINT(avrSwap[50]);
+    if (n > DISCON_IPC_OUTNAME) n = DISCON_IPC_OUTNAME;
+    if (n > 0 && avcOutname != NULL) {
+        size_t len = strnlen(slot->outName, (size_t)n - 1);
+
+        (void)memcpy(avcOutname, slot->outName, len);
+        avcOutname[len] = '\0';
+    }
+    n = NINT(avrSwap[48]);
+    if (n > DISCON_IPC_MSG) n = DISCON_IPC_MSG;
+    if (n > 0 && avcMsg != NULL) {
+        size_t len = strnlen(slot->msg, (size_t)n - 1);
+
+        (void)memcpy(avcMsg, slot->msg, len);
+        avcMsg[len] = '\0';
+    }
+    __sync_synchronize();
+    slot->seq = pos + DISCON_IPC_SLOTS;
+}  /* end DISCON */
+
+/* EOF: discon_shim.c */
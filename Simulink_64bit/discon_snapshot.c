@@ -0,0 +1,243 @@
+/*
+ * File    : discon_snapshot.c
+ *
+ * Abstract:
+ *      Writing, checking and restoring controller state snapshots, see
+ *      discon_snapshot.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined _WIN32 || defined __CYGWIN__
+# include <windows.h>
+#endif
+
+#include "discon_snapshot.h"
+
+#define PADDED(n) (((n) + 7u) & ~(size_t)7u)
+
+/*=================*
+ * Local functions *
+ *=================*/
+
+/* Function: clearKept ===================================================
+ *
+ * Abstract:
+ *      Zero the keep words of a section copied to data.
+ */
+static void clearKept(const disconSection *sec, char *data) {
+    int k;
+
+    for (k=0; k<sec->nKeep; k++) {
+        (void)memset(data + sec->keep[k], 0, sizeof(void *));
+    }
+}  /* end clearKept */
+
+/* Function: copyKeeping ==================================================
+ *
+ * Abstract:
+ *      Copy the data of a section from a snapshot into the section, but for
+ *      its keep words.
+ */
+static void copyKeeping(const disconSection *sec, const char *data) {
+    char   *dst = (char *)sec->data;
+    size_t from = 0;
+    int    k;
+
+    for (k=0; k<sec->nKeep; k++) {
+        (void)memcpy(dst + from, data + from, sec->keep[k] - from);
+        from = sec->keep[k] + sizeof(void *);
+    }
+    (void)memcpy(dst + from, data + from, sec->size - from);
+}  /* end copyKeeping */
+
+/*===================*
+ * Visible functions *
+ *===================*/
+
+/* Function: disconSnapshotSize ===========================================
+ *
+ * Abstract:
+ *      Header, entry table and padded section data.
+ */
+size_t disconSnapshotSize(const disconSection *sec, int n) {
+    size_t size = sizeof(disconSnapshotHeader) + n*sizeof(disconSnapshotEntry);
+    int    k;
+
+    for (k=0; k<n; k++) {
+        size += PADDED(sec[k].size);
+    }
+    return size;
+}  /* end disconSnapshotSize */
+
+/* Function: disconSnapshotWrite ==========================================
+ *
+ * Abstract:
+ *      Fill in the header and entry table and copy the sections.
+ */
+size_t disconSnapshotWrite(const char *model, const disconSection *sec, int n,
+                           void *buf, size_t size, char *errorMsg) {
+    size_t               need = disconSnapshotSize(sec, n);
+    disconSnapshotHeader *header = (disconSnapshotHeader *)buf;
+    disconSnapshotEntry  *entry;
+    char                 *data;
+    int                  k;
+
+    if (size < need) {
+        sprintf(errorMsg, "Snapshot buffer too small (%lu bytes needed)",
+                (unsigned long)need);
+        return 0;
+    }
+    (void)memset(buf, 0, need);
+    (void)memcpy(header->magic, DISCON_SNAPSHOT_MAGIC, sizeof(DISCON_SNAPSHOT_MAGIC));
+    header->version   = DISCON_SNAPSHOT_VERSION;
+    header->nSections = (uint32_t)n;
+    header->size      = need;
+    (void)strncpy(header->model, model, DISCON_SNAPSHOT_MODEL_LEN-1);
+
+    entry = (disconSnapshotEntry *)(header + 1);
+    data  = (char *)(entry + n);
+    for (k=0; k<n; k++) {
+        entry[k].id   = sec[k].id;
+        entry[k].size = sec[k].size;
+        (void)memcpy(data, sec[k].data, sec[k].size);
+        clearKept(&sec[k], data);
+        data += PADDED(sec[k].size);
+    }
+    return need;
+}  /* end disconSnapshotWrite */
+
+/* Function: disconSnapshotRead ===========================================
+ *
+ * Abstract:
+ *      Check the whole snapshot before touching any section, then copy the
+ *      sections around their keep words.
+ */
+int disconSnapshotRead(const char *model, const disconSection *sec, int n,
+                       const void *buf, size_t size, char *errorMsg) {
+    const disconSnapshotHeader *header = (const disconSnapshotHeader *)buf;
+    const disconSnapshotEntry  *entry;
+    const char                 *data;
+    int                        k;
+
+    if (size < sizeof(*header) ||
+        memcmp(header->magic, DISCON_SNAPSHOT_MAGIC, sizeof(DISCON_SNAPSHOT_MAGIC)) != 0) {
+        sprintf(errorMsg, "Not a controller snapshot");
+        return -1;
+    }
+    if (header->version != DISCON_SNAPSHOT_VERSION) {
+        sprintf(errorMsg, "Unsupported snapshot version %u (expected %d)",
+                (unsigned)header->version, DISCON_SNAPSHOT_VERSION);
+        return -1;
+    }
+    if (strncmp(header->model, model, DISCON_SNAPSHOT_MODEL_LEN) != 0) {
+        sprintf(errorMsg, "Snapshot of model %.48s, not of %.48s",
+                header->model, model);
+        return -1;
+    }
+    if (header->nSections != (uint32_t)n || header->size != disconSnapshotSize(sec, n) ||
+        size < header->size) {
+        sprintf(errorMsg, "Snapshot does not match the model data (%lu bytes expected)",
+                (unsigned long)disconSnapshotSize(sec, n));
+        return -1;
+    }
+    entry = (const disconSnapshotEntry *)(header + 1);
+    for (k=0; k<n; k++) {
+        if (entry[k].id != sec[k].id || entry[k].size != sec[k].size) {
+            sprintf(errorMsg, "Snapshot section %d does not match the model data", k);
+            return -1;
+        }
+    }
+
+    data = (const char *)(entry + n);
+    for (k=0; k<n; k++) {
+        copyKeeping(&sec[k], data);
+        data += PADDED(sec[k].size);
+    }
+    return 0;
+}  /* end disconSnapshotRead */
+
+/* Function: disconSnapshotSave ===========================================
+ *
+ * Abstract:
+ *      Write to path.tmp and move it over path, so a crash while writing a
+ *      checkpoint leaves the previous one intact.
+ */
+int disconSnapshotSave(const char *path, const void *buf, size_t size, char *errorMsg) {
+    char tmp[1024];
+    FILE *file;
+    int  ok;
+
+    if (strlen(path) + 5 > sizeof(tmp)) {
+        sprintf(errorMsg, "Snapshot file name too long");
+        return -1;
+    }
+    sprintf(tmp, "%s.tmp", path);
+    file = fopen(tmp, "wb");
+    if (file == NULL) {
+        sprintf(errorMsg, "Unable to create %.200s", tmp);
+        return -1;
+    }
+    ok = fwrite(buf, 1, size, file) == size;
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        (void)remove(tmp);
+        sprintf(errorMsg, "Unable to write %.200s", tmp);
+        return -1;
+    }
+#if defined _WIN32 || defined __CYGWIN__
+    ok = MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    ok = rename(tmp, path) == 0;
+#endif
+    if (!ok) {
+        (void)remove(tmp);
+        sprintf(errorMsg, "Unable to replace %.200s", path);
+        return -1;
+    }
+    return 0;
+}  /* end disconSnapshotSave */
+
+/* Function: disconSnapshotLoad ===========================================
+ *
+ * Abstract:
+ *      Read the header for the size, then the whole snapshot.
+ */
+void *disconSnapshotLoad(const char *path, size_t *size, char *errorMsg) {
+    disconSnapshotHeader header;
+    FILE                 *file;
+    char                 *buf;
+
+    file = fopen(path, "rb");
+    if (file == NULL) {
+        sprintf(errorMsg, "Unable to open %.200s", path);
+        return NULL;
+    }
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, DISCON_SNAPSHOT_MAGIC, sizeof(DISCON_SNAPSHOT_MAGIC)) != 0 ||
+        header.size < sizeof(header) || header.size > ((size_t)-1)/2) {
+        (void)fclose(file);
+        sprintf(errorMsg, "%.200s is not a controller snapshot", path);
+        return NULL;
+    }
+    buf = (char *)malloc((size_t)header.size);
+    if (buf == NULL) {
+        (void)fclose(file);
+        sprintf(errorMsg, "%.200s: out of memory", path);
+        return NULL;
+    }
+    (void)memcpy(buf, &header, sizeof(header));
+    if (fread(buf + sizeof(header), 1, (size_t)header.size - sizeof(header), file) !=
+        (size_t)header.size - sizeof(header)) {
+        (void)fclose(file);
+        free(buf);
+        sprintf(errorMsg, "%.200s: truncated snapshot", path);
+        return NULL;
+    }
+    (void)fclose(file);
+    *size = (size_t)header.size;
+    return buf;
+}  /* end disconSnapshotLoad */
+
+/* EOF: discon_snapshot.c */
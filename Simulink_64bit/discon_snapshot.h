@@ -0,0 +1,100 @@
+/*
+ * File    : discon_snapshot.h
+ *
+ * Abstract:
+ *      Controller state snapshots of the DISCON library.
+ *
+ *      A snapshot is a flat copy of the memory sections that make up the
+ *      state of a controller instance (see DISCON_Snapshot in discon.h for
+ *      the sections of the model). The library stays independent of the
+ *      model here: it only sees a list of sections, each with an id, an
+ *      address and a size.
+ *
+ *      A snapshot holds no pointers. A section may list pointer words
+ *      (keep) that belong to the instance rather than to its state, such
+ *      as work vectors that point into its parameter set: they are written
+ *      as 0 and a restore leaves those of the instance as they are.
+ *      Snapshots can therefore be restored into another instance, or by
+ *      another process running the same library.
+ *
+ *      Blob layout (native byte order):
+ *          disconSnapshotHeader
+ *          nSections disconSnapshotEntry
+ *          the section data, each padded to a multiple of 8 bytes
+ */
+
+#ifndef DISCON_SNAPSHOT_H
+#define DISCON_SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "discon.h"
+
+#define DISCON_SNAPSHOT_MAGIC       "DISCONS"
+#define DISCON_SNAPSHOT_VERSION     2
+#define DISCON_SNAPSHOT_MODEL_LEN   48
+#define DISCON_SNAPSHOT_SECTIONS    16
+
+typedef struct {
+    char     magic[8];                  /* DISCON_SNAPSHOT_MAGIC, NUL padded  */
+    uint32_t version;                   /* DISCON_SNAPSHOT_VERSION            */
+    uint32_t nSections;
+    uint64_t size;                      /* whole blob, in bytes               */
+    char     model[DISCON_SNAPSHOT_MODEL_LEN];  /* model name, NUL padded     */
+} disconSnapshotHeader;                 /* 72 bytes */
+
+typedef struct {
+    uint32_t id;
+    uint32_t flags;                     /* none defined, 0                    */
+    uint64_t size;                      /* bytes, without the padding         */
+    uint64_t reserved;                  /* 0                                  */
+} disconSnapshotEntry;                  /* 24 bytes */
+
+typedef struct {
+    uint32_t     id;
+    void         *data;
+    size_t       size;
+    const size_t *keep;                 /* ascending offsets of the pointer   */
+    int          nKeep;                 /*   words the instance keeps         */
+} disconSection;
+
+/* Size of the snapshot of n sections */
+DISCON_LOCAL size_t disconSnapshotSize(const disconSection *sec, int n);
+
+/*
+ * Write the snapshot of n sections of the named model to buf, which holds
+ * size bytes. Returns the size of the snapshot, or 0 with errorMsg filled
+ * (at least 257 characters) when buf is too small.
+ */
+DISCON_LOCAL size_t disconSnapshotWrite(const char *model, const disconSection *sec,
+                                        int n, void *buf, size_t size,
+                                        char *errorMsg);
+
+/*
+ * Check a snapshot against the n sections of the named model and copy it
+ * into them, but for their keep words. The ids and sizes of the sections
+ * must match those of the snapshot exactly; nothing is copied otherwise.
+ * Returns 0, or -1 with errorMsg filled.
+ */
+DISCON_LOCAL int disconSnapshotRead(const char *model, const disconSection *sec,
+                                    int n, const void *buf, size_t size,
+                                    char *errorMsg);
+
+/*
+ * Write a snapshot to a file, replacing it only once the whole snapshot
+ * has been written. Returns 0, or -1 with errorMsg filled.
+ */
+DISCON_LOCAL int disconSnapshotSave(const char *path, const void *buf, size_t size,
+                                    char *errorMsg);
+
+/*
+ * Read a snapshot file into memory. Returns the buffer, to be freed with
+ * free(), and its size in *size; returns NULL with errorMsg filled on
+ * failure.
+ */
+DISCON_LOCAL void *disconSnapshotLoad(const char *path, size_t *size, char *errorMsg);
+
+#endif /* DISCON_SNAPSHOT_H */
+
+/* EOF: discon_snapshot.h */
@@ -0,0 +1,747 @@
+/*
+ * File    : discon_sweep.c
+ *
+ * Abstract:
+ *      Parameter sweep of the controller over one recorded avrSwap trace
+ *      (discon_trace.h). The trace is read once into memory, as the
+ *      struct-of-arrays inputs of discon.h, and every variant, a set of
+ *      values of the user variables rUserVar1..20 (avrSwap[119..138],
+ *      normally the gains of the parameter file), is run open-loop through
+ *      the whole trace with those user variables replaced. Per variant the
+ *      sweep reports
+ *          pitch_activity      mean rate of the demanded blade pitch,
+ *                              |d pitch/dt| averaged over time and blades
+ *          torque_var          variance of the demanded generator torque
+ *      Open-loop, the measurements are those of the trace whatever the
+ *      gains, so no metric of the turbine response, such as the speed
+ *      error, is reported; run discon_closedloop for those.
+ *
+ *      The variants come either from a file (-p), whose first line names
+ *      the varied user variables (userVar1..userVar20) and every further
+ *      line gives one variant, values separated by blanks or commas, '#'
+ *      starting a comment; or from -vary, one per user variable, giving n
+ *      values evenly spaced from lo to hi; the variants are then every
+ *      combination of them.
+ *
+ *      Variants are spread over worker processes (-j, one per processor by
+ *      default) as in discon_replay, each of which loads its own copy of
+ *      the library and inherits the trace. A worker creates up to -batch
+ *      controller instances (only one with the classic interface) and runs
+ *      a batch of variants on them together, a block of time steps at a
+ *      time, so the inputs of a block are read from memory once for the
+ *      whole batch and stay in the cache while the instances step through
+ *      them. An instance is restarted (DISCON_Reset) between batches. A
+ *      worker that crashes loses the variants of its batch; it is replaced.
+ *
+ *      The trace is stepped once per record with DISCON_RunSoA, which
+ *      makes one model step per call: record it at the sample time of the
+ *      controller. The user variables of the initialization record are
+ *      those of the host, before the parameter file was applied, so the
+ *      sweep takes them from the record after it.
+ *
+ *      The report, one line per variant in order, is
+ *          variant <TAB> value... <TAB> steps <TAB> pitch_activity
+ *                  <TAB> torque_var <TAB> OK
+ *          ... <TAB> ERROR|CRASHED <TAB> message
+ *      after a header line, on stdout or in the file given with -o; a
+ *      summary goes to stderr. The exit status is 0 when every variant ran
+ *      through the whole trace.
+ *
+ *      usage: discon_sweep [-lib library] [-j jobs] [-batch n] [-o report]
+ *                          (-p variants | -vary userVarN=lo:hi:n...) trace
+ *
+ *      Unless DISCON_LOG is set, the instances of a sweep do not log;
+ *      capture and telemetry are off.
+ *
+ *      Built with the library by the Linux template makefile (discon.tmf).
+ */
+
+#ifndef _POSIX_C_SOURCE
+# define _POSIX_C_SOURCE 200112L        /* setenv with -std=c99 */
+#endif
+#ifndef _DEFAULT_SOURCE
+# define _DEFAULT_SOURCE                /* MAP_ANONYMOUS */
+#endif
+
+#include <dlfcn.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "discon.h"
+#include "discon_profile.h"
+#include "discon_trace.h"
+
+#ifndef MAP_ANONYMOUS
+# define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/*=========*
+ * Defines *
+ *=========*/
+
+#define MAX_WORKERS     256
+#define MAX_BATCH       256         /* instances per worker                  */
+#define BLOCK_STEPS     256         /* time steps run per instance at a time */
+#define NUM_USERVARS    20          /* rUserVar1..20, avrSwap[119..138]      */
+#define FIRST_USERVAR   119
+#define TORQUE_SWAP     46          /* demanded generator torque             */
+#define FIRST_PITCH     41          /* demanded pitch of blades 1..3         */
+#define LAST_PITCH      43
+
+#define NINT(a) ((a) >= 0.0 ? (int)((a)+0.5) : (int)((a)-0.5))
+
+typedef DISCON_Instance *(*InitiateFcn)(char *errorMsg);
+typedef int (*CleanupFcn)(DISCON_Instance *inst, char *errorMsg);
+typedef int (*ResetFcn)(DISCON_Instance *inst, char *errorMsg);
+typedef int (*RunSoAFcn)(DISCON_Instance *inst, const float *in, float *out, int nSteps);
+
+/* A controller library loaded by a worker, and its instances */
+typedef struct {
+    void            *handle;
+    InitiateFcn     initiate;
+    CleanupFcn      cleanup;
+    ResetFcn        reset;
+    RunSoAFcn       run;
+    DISCON_Instance *inst[MAX_BATCH];
+    int             used[MAX_BATCH];    /* stepped since it was (re)started */
+    int             nInst;
+} Controller;
+
+/* Running metrics of a variant */
+typedef struct {
+    long   steps;
+    double pitchTravel;                 /* sum of |change| over the blades  */
+    float  prevPitch[LAST_PITCH - FIRST_PITCH + 1];
+    double torqueMean;                  /* Welford                          */
+    double torqueM2;
+    int    active;
+} Metrics;
+
+/* Outcome of a variant, in memory shared by all workers */
+enum { STATE_PENDING, STATE_RUNNING, STATE_DONE };
+enum { SWEEP_OK, SWEEP_ERROR, SWEEP_CRASHED };
+
+typedef struct {
+    int    state;
+    int    status;
+    int    worker;                          /* slot that claimed it        */
+    long   steps;                           /* steps completed             */
+    double pitchActivity;
+    double torqueVar;
+    char   message[160];
+} Result;
+
+typedef struct {
+    long   next;                            /* next variant to claim       */
+    int    instances[MAX_WORKERS];          /* per worker                  */
+    Result result[1];                       /* one per variant             */
+} Shared;
+
+/* Options, the trace and the variants */
+static struct {
+    const char *library;
+    const char *trace;
+    int        batch;
+    long       nSteps;
+    double     stepSize;
+    float      *in;                     /* in[k*nSteps + t], input k, step t */
+    int        nVaried;
+    int        varied[NUM_USERVARS];    /* input numbers of the varied ones  */
+    int        userVar[NUM_USERVARS];   /* and their numbers, 1..20          */
+    double     *values;                 /* values[v*nVaried + j]             */
+    long       nVariants;
+} Opt = { "./DISCON.so", NULL, 64, 0, 0.0, NULL, 0, {0}, {0}, NULL, 0 };
+
+/* avrSwap record of every input, and of every output or -1 for logging */
+#define SWEEP_INPUT(name, i)  (i),
+#define SWEEP_OUTPUT(name, i) (i),
+#define SWEEP_LOG(name, unit) -1,
+
+static const int InputSwap[DISCON_NUM_INPUTS] = { DISCON_INPUTS(SWEEP_INPUT) };
+static const int OutputSwap[DISCON_NUM_OUTPUTS] = {
+    DISCON_OUTPUTS(SWEEP_OUTPUT, SWEEP_LOG)
+};
+
+/* Outputs the metrics are taken from, -1 where the model has none */
+static int TorqueOut = -1;
+static int PitchOut[LAST_PITCH - FIRST_PITCH + 1];
+static int NumPitch = 0;
+
+/*=================*
+ * Local functions *
+ *=================*/
+
+/* Function: fail =========================================================
+ *
+ * Abstract:
+ *      Report a fatal error and exit.
+ */
+static void fail(const char *what, const char *detail) {
+    (void)fprintf(stderr, "discon_sweep: %s%s%s\n", what,
+                  detail != NULL ? ": " : "", detail != NULL ? detail : "");
+    exit(EXIT_FAILURE);
+}  /* end fail */
+
+/* Function: inputOf ======================================================
+ *
+ * Abstract:
+ *      The input number of an avrSwap record, or -1.
+ */
+static int inputOf(int swap) {
+    int k;
+
+    for (k=0; k<DISCON_NUM_INPUTS; k++) {
+        if (InputSwap[k] == swap) return k;
+    }
+    return -1;
+}  /* end inputOf */
+
+/* Function: findSignals ==================================================
+ *
+ * Abstract:
+ *      Locate the signals of the metrics in the port tables.
+ */
+static void findSignals(void) {
+    int k;
+
+    for (k=0; k<DISCON_NUM_OUTPUTS; k++) {
+        if (OutputSwap[k] == TORQUE_SWAP) TorqueOut = k;
+        if (OutputSwap[k] >= FIRST_PITCH && OutputSwap[k] <= LAST_PITCH) {
+            PitchOut[NumPitch++] = k;
+        }
+    }
+}  /* end findSignals */
+
+/* Function: addVaried ====================================================
+ *
+ * Abstract:
+ *      Add a user variable, by name, to the varied ones.
+ */
+static void addVaried(const char *name) {
+    int n, k, j;
+
+    if (sscanf(name, "userVar%d", &n) != 1 || n < 1 || n > NUM_USERVARS) {
+        fail("expected userVar1..userVar20, found", name);
+    }
+    k = inputOf(FIRST_USERVAR + n - 1);
+    if (k < 0) fail("the user variable is not an input of the model", name);
+    for (j=0; j<Opt.nVaried; j++) {
+        if (Opt.varied[j] == k) fail("the user variable is varied twice", name);
+    }
+    Opt.userVar[Opt.nVaried] = n;
+    Opt.varied[Opt.nVaried++] = k;
+}  /* end addVaried */
+
+/* Function: addVariant ===================================================
+ *
+ * Abstract:
+ *      Append a variant of Opt.nVaried values.
+ */
+static void addVariant(const double *values) {
+    static long capacity = 0;
+
+    if (Opt.nVariants == capacity) {
+        capacity = capacity > 0 ? 2*capacity : 1024;
+        Opt.values = (double *)realloc(Opt.values,
+                                       (size_t)capacity*Opt.nVaried*sizeof(double));
+        if (Opt.values == NULL) fail("out of memory", NULL);
+    }
+    (void)memcpy(Opt.values + Opt.nVariants*Opt.nVaried, values,
+                 Opt.nVaried*sizeof(double));
+    Opt.nVariants++;
+}  /* end addVariant */
+
+/* Function: readVariants =================================================
+ *
+ * Abstract:
+ *      Read the varied user variables and their variants from a file.
+ */
+static void readVariants(const char *path) {
+    FILE   *file = fopen(path, "r");
+    char   line[8192];
+    double values[NUM_USERVARS];
+    int    header = 1;
+    long   lineNo = 0;
+
+    if (file == NULL) fail("unable to open", path);
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char *p, *token;
+        int  n = 0;
+
+        lineNo++;
+        line[strcspn(line, "#\r\n")] = '\0';
+        for (p=line; (token = strtok(p, " \t,")) != NULL; p=NULL) {
+            if (header) {
+                if (n++ == NUM_USERVARS) fail("too many columns in", path);
+                addVaried(token);
+            } else {
+                char *end;
+
+                if (n == Opt.nVaried) break;
+                values[n++] = strtod(token, &end);
+                if (*end != '\0') fail("not a number", token);
+            }
+        }
+        if (n == 0) continue;
+        if (header) {
+            header = 0;
+        } else if (n != Opt.nVaried) {
+            (void)sprintf(line, "%s, line %ld", path, lineNo);
+            fail("too few values", line);
+        } else {
+            addVariant(values);
+        }
+    }
+    (void)fclose(file);
+}  /* end readVariants */
+
+/* Function: gridVariants =================================================
+ *
+ * Abstract:
+ *      Every combination of the ranges of the -vary options, the first
+ *      varying slowest.
+ */
+static void gridVariants(const double *lo, const double *hi, const int *n) {
+    double values[NUM_USERVARS];
+    int    index[NUM_USERVARS] = {0};
+    int    j;
+
+    for (;;) {
+        for (j=0; j<Opt.nVaried; j++) {
+            values[j] = n[j] > 1 ? lo[j] + (hi[j] - lo[j])*index[j]/(n[j] - 1) : lo[j];
+        }
+        addVariant(values);
+        for (j=Opt.nVaried-1; j>=0 && ++index[j] == n[j]; j--) index[j] = 0;
+        if (j < 0) break;
+    }
+}  /* end gridVariants */
+
+/* Function: loadTrace ====================================================
+ *
+ * Abstract:
+ *      Read the inputs of every step of the trace into Opt.in, up to the
+ *      final call or a restart of the controller.
+ */
+static void loadTrace(const char *path) {
+    disconTraceReader *trace;
+    const float       *record;
+    char              errorMsg[257];
+    long              capacity, t;
+    int               nSwap, k;
+
+    trace = disconTraceOpen(path, errorMsg);
+    if (trace == NULL) fail(errorMsg, NULL);
+    nSwap         = (int)disconTraceInfo(trace)->nSwap;
+    capacity      = disconTraceLength(trace);
+    Opt.stepSize  = disconTraceInfo(trace)->stepSize;
+    if (capacity < 1) fail("no calls in", path);
+    Opt.in = (float *)malloc((size_t)capacity*DISCON_NUM_INPUTS*sizeof(float));
+    if (Opt.in == NULL) fail("out of memory", NULL);
+
+    for (t=0; t<capacity && (record = disconTraceNext(trace)) != NULL; t++) {
+        int iStatus = NINT(record[0]);
+
+        if (iStatus < 0 || (iStatus == 0 && t > 0)) break;
+        if (t == 0 && Opt.stepSize <= 0.0 && nSwap > 2) Opt.stepSize = record[2];
+        for (k=0; k<DISCON_NUM_INPUTS; k++) {
+            Opt.in[k*capacity + t] = InputSwap[k] < nSwap ? record[InputSwap[k]] : 0.0f;
+        }
+    }
+    disconTraceClose(trace);
+    if (t == 0) fail("no steps in", path);
+
+    /* Pack the rows to the steps found */
+    Opt.nSteps = t;
+    for (k=1; k<DISCON_NUM_INPUTS; k++) {
+        (void)memmove(Opt.in + k*t, Opt.in + k*capacity, t*sizeof(float));
+    }
+    k = inputOf(0);
+    if (k >= 0) Opt.in[k*t] = 0.0f;             /* a trace always starts afresh */
+    for (k=0; k<DISCON_NUM_INPUTS && t > 1; k++) {
+        if (InputSwap[k] >= FIRST_USERVAR && InputSwap[k] < FIRST_USERVAR + NUM_USERVARS) {
+            Opt.in[k*t] = Opt.in[k*t + 1];
+        }
+    }
+    if (Opt.stepSize <= 0.0) fail("no step size in", path);
+}  /* end loadTrace */
+
+/* Function: loadController ===============================================
+ *
+ * Abstract:
+ *      Load a copy of the library and create up to Opt.batch instances.
+ */
+static void loadController(Controller *c) {
+    char errorMsg[257];
+
+    c->handle = dlopen(Opt.library, RTLD_NOW | RTLD_LOCAL);
+    if (c->handle == NULL) fail("unable to load the controller", dlerror());
+    *(void **)&c->initiate = dlsym(c->handle, "initiateController");
+    *(void **)&c->cleanup  = dlsym(c->handle, "performCleanup");
+    *(void **)&c->reset    = dlsym(c->handle, "DISCON_Reset");
+    *(void **)&c->run      = dlsym(c->handle, "DISCON_RunSoA");
+    if (c->initiate == NULL || c->cleanup == NULL || c->reset == NULL || c->run == NULL) {
+        fail("no struct-of-arrays interface in", Opt.library);
+    }
+    for (c->nInst=0; c->nInst<Opt.batch; c->nInst++) {
+        c->inst[c->nInst] = c->initiate(errorMsg);
+        if (c->inst[c->nInst] == NULL) break;
+    }
+    if (c->nInst == 0) fail("unable to create a controller instance", errorMsg);
+}  /* end loadController */
+
+/* Function: startInstance ================================================
+ *
+ * Abstract:
+ *      Have instance i ready at its initial state: restart it if it has
+ *      been stepped, create it again if it was lost to an error.
+ */
+static int startInstance(Controller *c, int i, char *errorMsg) {
+    if (c->inst[i] != NULL && c->used[i]) {
+        if (c->reset(c->inst[i], errorMsg) != 0) c->inst[i] = NULL;
+    }
+    if (c->inst[i] == NULL) c->inst[i] = c->initiate(errorMsg);
+    c->used[i] = 0;
+    return c->inst[i] != NULL ? 0 : -1;
+}  /* end startInstance */
+
+/* Function: accumulate ===================================================
+ *
+ * Abstract:
+ *      Add n steps of a block of len steps to the metrics of a variant.
+ */
+static void accumulate(Metrics *m, const float *out, int n, int len) {
+    int t, b;
+
+    for (t=0; t<n; t++) {
+        for (b=0; b<NumPitch; b++) {
+            float pitch = out[PitchOut[b]*len + t];
+
+            if (m->steps > 0) m->pitchTravel += fabs((double)pitch - m->prevPitch[b]);
+            m->prevPitch[b] = pitch;
+        }
+        if (TorqueOut >= 0) {
+            double torque = out[TorqueOut*len + t];
+            double delta  = torque - m->torqueMean;
+
+            m->torqueMean += delta/(m->steps + 1);
+            m->torqueM2   += delta*(torque - m->torqueMean);
+        }
+        m->steps++;
+    }
+}  /* end accumulate */
+
+/* Function: finish =======================================================
+ *
+ * Abstract:
+ *      The metrics of a variant into its result.
+ */
+static void finish(const Metrics *m, Result *res) {
+    res->steps = m->steps;
+    if (m->steps > 1 && NumPitch > 0) {
+        res->pitchActivity = m->pitchTravel/(NumPitch*(m->steps - 1)*Opt.stepSize);
+    }
+    if (m->steps > 1) res->torqueVar = m->torqueM2/(m->steps - 1);
+}  /* end finish */
+
+/* Function: runBatch =====================================================
+ *
+ * Abstract:
+ *      Run variants first..first+n-1 through the trace on the instances of
+ *      a worker, a block of steps at a time: the block is copied once and
+ *      only the varied user variables are written over for each variant.
+ */
+static void runBatch(Controller *c, Shared *shared, long first, int n,
+                     float *blockIn, float *blockOut) {
+    static Metrics metrics[MAX_BATCH];
+    char           errorMsg[257];
+    long           t0;
+    int            i, j, k, t, len, done;
+
+    for (i=0; i<n; i++) {
+        Result *res = &shared->result[first + i];
+
+        (void)memset(&metrics[i], 0, sizeof(Metrics));
+        metrics[i].active = startInstance(c, i, errorMsg) == 0;
+        if (!metrics[i].active) {
+            res->status = SWEEP_ERROR;
+            (void)snprintf(res->message, sizeof(res->message), "%.159s", errorMsg);
+        }
+        c->used[i] = 1;
+    }
+
+    for (t0=0; t0<Opt.nSteps; t0+=BLOCK_STEPS) {
+        len = Opt.nSteps - t0 < BLOCK_STEPS ? (int)(Opt.nSteps - t0) : BLOCK_STEPS;
+        for (k=0; k<DISCON_NUM_INPUTS; k++) {
+            (void)memcpy(blockIn + k*len, Opt.in + k*Opt.nSteps + t0, len*sizeof(float));
+        }
+        for (i=0; i<n; i++) {
+            const double *values = Opt.values + (first + i)*Opt.nVaried;
+            Result       *res = &shared->result[first + i];
+
+            if (!metrics[i].active) continue;
+            for (j=0; j<Opt.nVaried; j++) {
+                float *row = blockIn + Opt.varied[j]*len;
+
+                for (t=0; t<len; t++) row[t] = (float)values[j];
+            }
+            done = c->run(c->inst[i], blockIn, blockOut, len);
+            accumulate(&metrics[i], blockOut, done, len);
+            res->steps = metrics[i].steps;
+            if (done < len) {
+                /* The error of the step is reported when the instance ends */
+                metrics[i].active = 0;
+                res->status = SWEEP_ERROR;
+                (void)snprintf(res->message, sizeof(res->message),
+                               "step %ld failed", metrics[i].steps);
+                if (c->cleanup(c->inst[i], errorMsg) != 0) {
+                    (void)snprintf(res->message, sizeof(res->message),
+                                   "step %ld: %.140s", metrics[i].steps, errorMsg);
+                }
+                c->inst[i] = NULL;
+            }
+        }
+    }
+    for (i=0; i<n; i++) finish(&metrics[i], &shared->result[first + i]);
+}  /* end runBatch */
+
+/* Function: worker =======================================================
+ *
+ * Abstract:
+ *      Body of a worker process: load the library, then claim and run
+ *      batches of variants until none are left.
+ */
+static void worker(Shared *shared, int slot) {
+    static Controller c;
+    float             *blockIn, *blockOut;
+    char              errorMsg[257];
+    long              first;
+    int               n, i;
+
+    /* The controllers may print; keep the report on stdout clean */
+    if (freopen("/dev/null", "w", stdout) == NULL) fail("unable to open /dev/null", NULL);
+    loadController(&c);
+    shared->instances[slot] = c.nInst;
+    blockIn  = (float *)malloc(DISCON_NUM_INPUTS*BLOCK_STEPS*sizeof(float));
+    blockOut = (float *)malloc(DISCON_NUM_OUTPUTS*BLOCK_STEPS*sizeof(float));
+    if (blockIn == NULL || blockOut == NULL) fail("out of memory", NULL);
+
+    while ((first = __sync_fetch_and_add(&shared->next, c.nInst)) < Opt.nVariants) {
+        n = Opt.nVariants - first < c.nInst ? (int)(Opt.nVariants - first) : c.nInst;
+        for (i=0; i<n; i++) {
+            shared->result[first + i].worker = slot;
+            shared->result[first + i].state  = STATE_RUNNING;
+        }
+        __sync_synchronize();
+        runBatch(&c, shared, first, n, blockIn, blockOut);
+        __sync_synchronize();
+        for (i=0; i<n; i++) shared->result[first + i].state = STATE_DONE;
+    }
+    for (i=0; i<c.nInst; i++) {
+        if (c.inst[i] != NULL) (void)c.cleanup(c.inst[i], errorMsg);
+    }
+    exit(EXIT_SUCCESS);
+}  /* end worker */
+
+/* Function: startWorker ==================================================
+ *
+ * Abstract:
+ *      Fork the worker of a slot.
+ */
+static pid_t startWorker(Shared *shared, int slot) {
+    pid_t pid;
+
+    (void)fflush(NULL);
+    pid = fork();
+    if (pid < 0) fail("unable to start a worker process", NULL);
+    if (pid == 0) worker(shared, slot);
+    return pid;
+}  /* end startWorker */
+
+/* Function: writeReport ==================================================
+ *
+ * Abstract:
+ *      A header line, then one line per variant, in order.
+ */
+static void writeReport(FILE *out, const Shared *shared, long *count) {
+    static const char *status[] = { "OK", "ERROR", "CRASHED" };
+    long i;
+    int  j;
+
+    (void)fprintf(out, "variant");
+    for (j=0; j<Opt.nVaried; j++) (void)fprintf(out, "\tuserVar%d", Opt.userVar[j]);
+    (void)fprintf(out, "\tsteps\tpitch_activity\ttorque_var\tstatus\n");
+
+    for (i=0; i<Opt.nVariants; i++) {
+        const Result *res = &shared->result[i];
+
+        count[res->status]++;
+        (void)fprintf(out, "%ld", i);
+        for (j=0; j<Opt.nVaried; j++) {
+            (void)fprintf(out, "\t%.9g", Opt.values[i*Opt.nVaried + j]);
+        }
+        (void)fprintf(out, "\t%ld\t%.9g\t%.9g\t%s", res->steps, res->pitchActivity,
+                      res->torqueVar, status[res->status]);
+        if (res->status != SWEEP_OK) (void)fprintf(out, "\t%s", res->message);
+        (void)fprintf(out, "\n");
+    }
+}  /* end writeReport */
+
+/*===================*
+ * Visible functions *
+ *===================*/
+
+int main(int argc, char *argv[]) {
+    const char *outPath = NULL, *variants = NULL;
+    double     lo[NUM_USERVARS], hi[NUM_USERVARS];
+    int        nGrid[NUM_USERVARS];
+    Shared     *shared;
+    size_t     sharedSize;
+    pid_t      pid[MAX_WORKERS];
+    long       count[SWEEP_CRASHED + 1] = {0}, steps = 0, i;
+    int        nJobs = 0, running, status, slot, lost, instances = 0;
+    uint64_t   start;
+    double     readTime, elapsed;
+    FILE       *out = stdout;
+
+    for (i=1; i<argc; i++) {
+        if (strcmp(argv[i], "-lib") == 0 && i+1 < argc) {
+            Opt.library = argv[++i];
+        } else if (strcmp(argv[i], "-j") == 0 && i+1 < argc) {
+            nJobs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-batch") == 0 && i+1 < argc) {
+            Opt.batch = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i+1 < argc) {
+            outPath = argv[++i];
+        } else if (strcmp(argv[i], "-p") == 0 && i+1 < argc) {
+            variants = argv[++i];
+        } else if (strcmp(argv[i], "-vary") == 0 && i+1 < argc &&
+                   Opt.nVaried < NUM_USERVARS) {
+            char *spec = argv[++i], *eq = strchr(spec, '=');
+            int  j = Opt.nVaried;
+
+            if (eq == NULL) fail("expected -vary userVarN=lo:hi:n, found", spec);
+            *eq = '\0';
+            addVaried(spec);
+            nGrid[j] = 1;
+            if (sscanf(eq + 1, "%lf:%lf:%d", &lo[j], &hi[j], &nGrid[j]) < 1 ||
+                nGrid[j] < 1) {
+                fail("invalid range for", spec);
+            }
+        } else if (argv[i][0] != '-' && Opt.trace == NULL) {
+            Opt.trace = argv[i];
+        } else {
+            (void)fprintf(stderr, "usage: %s [-lib library] [-j jobs] [-batch n] "
+                          "[-o report] (-p variants | -vary userVarN=lo:hi:n...) "
+                          "trace\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (Opt.trace == NULL) fail("no trace to sweep over", NULL);
+    if (variants != NULL) {
+        if (Opt.nVaried > 0) fail("give either -p or -vary", NULL);
+        readVariants(variants);
+    } else if (Opt.nVaried > 0) {
+        gridVariants(lo, hi, nGrid);
+    }
+    if (Opt.nVariants == 0) fail("no variants to run", NULL);
+    if (Opt.batch < 1) Opt.batch = 1;
+    if (Opt.batch > MAX_BATCH) Opt.batch = MAX_BATCH;
+    if (nJobs <= 0) nJobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (nJobs < 1) nJobs = 1;
+    if (nJobs > MAX_WORKERS) nJobs = MAX_WORKERS;
+    if (nJobs > Opt.nVariants) nJobs = (int)Opt.nVariants;
+    if ((Opt.nVariants + nJobs - 1)/nJobs < Opt.batch) {
+        Opt.batch = (int)((Opt.nVariants + nJobs - 1)/nJobs);
+    }
+
+    if (getenv("DISCON_LOG") == NULL) (void)setenv("DISCON_LOG", "0", 1);
+    (void)unsetenv("DISCON_CAPTURE_FILE");
+    (void)unsetenv("DISCON_TELEMETRY");
+
+    /* The trace is read once; the workers inherit it */
+    findSignals();
+    start = disconClockNs();
+    loadTrace(Opt.trace);
+    readTime = (double)(disconClockNs() - start)*1e-9;
+
+    sharedSize = sizeof(Shared) + (size_t)Opt.nVariants*sizeof(Result);
+    shared = (Shared *)mmap(NULL, sharedSize, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) fail("out of memory", NULL);
+
+    /* Keep nJobs workers busy, replacing those that crash */
+    start = disconClockNs();
+    for (slot=0; slot<nJobs; slot++) pid[slot] = startWorker(shared, slot);
+    running = nJobs;
+    while (running > 0) {
+        pid_t done = wait(&status);
+
+        if (done < 0) break;
+        for (slot=0; slot<nJobs && pid[slot] != done; slot++);
+        if (slot == nJobs) continue;
+        running--;
+        if (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS) continue;
+
+        /* A worker that fails without a batch (e.g. to load) is not replaced */
+        lost = 0;
+        for (i=0; i<Opt.nVariants; i++) {
+            Result *res = &shared->result[i];
+
+            if (res->state == STATE_RUNNING && res->worker == slot) {
+                res->state  = STATE_DONE;
+                res->status = SWEEP_CRASHED;
+                if (WIFSIGNALED(status)) {
+                    (void)snprintf(res->message, sizeof(res->message),
+                                   "controller crashed (signal %d)", WTERMSIG(status));
+                } else {
+                    (void)snprintf(res->message, sizeof(res->message),
+                                   "worker exited with status %d", WEXITSTATUS(status));
+                }
+                lost = 1;
+            }
+        }
+        if (lost && shared->next < Opt.nVariants) {
+            pid[slot] = startWorker(shared, slot);
+            running++;
+        }
+    }
+    elapsed = (double)(disconClockNs() - start)*1e-9;
+
+    for (i=0; i<Opt.nVariants; i++) {
+        if (shared->result[i].state != STATE_DONE) {
+            shared->result[i].status = SWEEP_CRASHED;
+            (void)snprintf(shared->result[i].message,
+                           sizeof(shared->result[i].message), "not run");
+        }
+        steps += shared->result[i].steps;
+    }
+    for (slot=0; slot<nJobs; slot++) {
+        if (shared->instances[slot] > instances) instances = shared->instances[slot];
+    }
+
+    if (outPath != NULL && (out = fopen(outPath, "w")) == NULL) {
+        fail("unable to create", outPath);
+    }
+    writeReport(out, shared, count);
+    if (out != stdout) (void)fclose(out);
+
+    (void)fprintf(stderr, "%s: %ld variants of %ld steps on %d workers of up to %d "
+                  "instances, %ld OK, %ld errors, %ld crashed\n  %ld steps in %.2f s "
+                  "(%.0f steps/s), %.1f times the %.3f s to read the trace\n",
+                  Opt.library, Opt.nVariants, Opt.nSteps, nJobs, instances,
+                  count[SWEEP_OK], count[SWEEP_ERROR], count[SWEEP_CRASHED], steps,
+                  elapsed, elapsed > 0.0 ? steps/elapsed : 0.0,
+                  readTime > 0.0 ? elapsed/readTime : 0.0, readTime);
+
+    (void)munmap(shared, sharedSize);
+    return count[SWEEP_OK] == Opt.nVariants ? EXIT_SUCCESS : EXIT_FAILURE;
+}  /* end main */
+
+/* EOF: discon_sweep.c */
@@ -0,0 +1,531 @@
+/*
+ * File    : discon_telemetry.c
+ *
+ * Abstract:
+ *      Lock-free telemetry rings and the background sender thread, see
+ *      discon_telemetry.h.
+ */
+
+#if !defined _WIN32 && !defined _POSIX_C_SOURCE
+# define _POSIX_C_SOURCE 200112L        /* getaddrinfo, nanosleep with -std=c99 */
+#endif
+
+#ifdef _WIN32
+# include <winsock2.h>                  /* before windows.h (discon_threads.h) */
+# include <ws2tcpip.h>
+# ifdef _MSC_VER
+#  pragma comment(lib, "ws2_32.lib")
+# endif
+#else
+# include <fcntl.h>
+# include <netdb.h>
+# include <sys/socket.h>
+# include <sys/un.h>
+# include <time.h>
+# include <unistd.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "discon_telemetry.h"
+#include "discon_threads.h"
+
+/*=========*
+ * Defines *
+ *=========*/
+
+#ifdef _WIN32
+typedef SOCKET TelemetrySocket;
+# define NO_SOCKET     INVALID_SOCKET
+# define closeSocket   closesocket
+# define currentPid()  ((uint32_t)GetCurrentProcessId())
+# define sleepMs(ms)   Sleep(ms)
+#else
+typedef int TelemetrySocket;
+# define NO_SOCKET     (-1)
+# define closeSocket   close
+# define currentPid()  ((uint32_t)getpid())
+#endif
+
+/*
+ * Ring positions: the producer publishes a record by storing head after
+ * the record, the sender frees records by storing tail after copying
+ * them. Volatile accesses have acquire and release semantics with
+ * Microsoft compilers (/volatile:ms, the default on x86 and x64).
+ */
+#ifdef _MSC_VER
+# define LOAD_ACQUIRE(p)     (*(p))
+# define STORE_RELEASE(p, v) (*(p) = (v))
+#else
+# define LOAD_ACQUIRE(p)     __atomic_load_n(p, __ATOMIC_ACQUIRE)
+# define STORE_RELEASE(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#endif
+
+#define MIN(a,b) ((a)>(b)?(b):(a))
+#define MAX(a,b) ((a)<(b)?(b):(a))
+
+#define RING_MASK   (DISCON_TELEMETRY_RECORDS - 1)
+#define NAMES_TICKS (1000/DISCON_TELEMETRY_PERIOD_MS)   /* names once a second */
+
+typedef char checkRingSize[(DISCON_TELEMETRY_RECORDS & RING_MASK) == 0 ? 1 : -1];
+typedef char checkHeaderSize[sizeof(disconTelemetryHeader) == 40 ? 1 : -1];
+
+/*==================================*
+ * Global data local to this module *
+ *==================================*/
+
+struct disconTelemetry {
+    disconTelemetry          *next;         /* sender list                  */
+    TelemetrySocket          sock;
+    struct sockaddr_storage  addr;          /* receiver                     */
+    int                      addrLen;
+    int                      nSelected;
+    int                      *selected;     /* channel of every field       */
+    size_t                   recordBytes;   /* time and fields              */
+    size_t                   recordDoubles; /* ring stride                  */
+    double                   *ring;         /* DISCON_TELEMETRY_RECORDS     */
+    volatile uint32_t        head;          /* producer: records queued     */
+    volatile uint32_t        tail;          /* sender: records taken        */
+    volatile uint32_t        dropped;       /* producer: ring full          */
+    uint32_t                 sendDropped;   /* sender: socket would block   */
+    int                      decimation;
+    int                      countdown;     /* steps to the next record     */
+    int                      ticks;         /* sender periods since names   */
+    disconTelemetryHeader    header;        /* of the next datagram         */
+    char                     *names;        /* of the selected channels     */
+    size_t                   namesLen;
+    unsigned char            *datagram;
+    size_t                   datagramSize;
+};
+
+/* The sender thread shared by all open streams */
+static struct {
+    disconMutex     openLock;   /* serializes opening and closing       */
+    disconMutex     lock;       /* protects everything below            */
+    disconTelemetry *streams;
+    int             nStreams;
+    int             stop;
+    disconThread    thread;
+} Sender = { DISCON_MUTEX_INITIALIZER, DISCON_MUTEX_INITIALIZER, NULL, 0, 0, 0 };
+
+/*=================*
+ * Local functions *
+ *=================*/
+
+#ifndef _WIN32
+/* Function: sleepMs ======================================================
+ *
+ * Abstract:
+ *      Sleep for ms milliseconds.
+ */
+static void sleepMs(int ms) {
+    struct timespec ts;
+
+    ts.tv_sec  = ms/1000;
+    ts.tv_nsec = (long)(ms%1000)*1000000L;
+    (void)nanosleep(&ts, NULL);
+}  /* end sleepMs */
+#endif
+
+/* Function: sendDatagram =================================================
+ *
+ * Abstract:
+ *      Send the header and size bytes of payload from the datagram buffer
+ *      without waiting. Returns 0, or -1 when the datagram was not sent:
+ *      socket buffer full, no receiver, or any other error.
+ */
+static int sendDatagram(disconTelemetry *tm, int type, uint32_t count, size_t size) {
+    tm->header.type    = (uint16_t)type;
+    tm->header.count   = count;
+    tm->header.dropped = tm->dropped + tm->sendDropped;
+    (void)memcpy(tm->datagram, &tm->header, sizeof(tm->header));
+    tm->header.seq++;
+    return sendto(tm->sock, (const char *)tm->datagram, (int)(sizeof(tm->header) + size),
+                  0, (const struct sockaddr *)&tm->addr, tm->addrLen) < 0 ? -1 : 0;
+}  /* end sendDatagram */
+
+/* Function: sendNames ====================================================
+ *
+ * Abstract:
+ *      Send the names of the selected channels.
+ */
+static void sendNames(disconTelemetry *tm) {
+    (void)memcpy(tm->datagram + sizeof(tm->header), tm->names, tm->namesLen);
+    (void)sendDatagram(tm, DISCON_TELEMETRY_NAMES, (uint32_t)tm->namesLen, tm->namesLen);
+    tm->ticks = 0;
+}  /* end sendNames */
+
+/* Function: drainStream ==================================================
+ *
+ * Abstract:
+ *      Send the queued records of a stream, as many per datagram as fit.
+ *      The records are copied out of the ring and freed before the send,
+ *      so the producer gets the room back as early as possible.
+ */
+static void drainStream(disconTelemetry *tm) {
+    uint32_t head = LOAD_ACQUIRE(&tm->head);
+    uint32_t tail = tm->tail;
+    uint32_t perDatagram, n, k;
+
+    if (++tm->ticks >= NAMES_TICKS) sendNames(tm);
+
+    perDatagram = (uint32_t)((DISCON_TELEMETRY_DATAGRAM - sizeof(tm->header))/
+                             tm->recordBytes);
+    if (perDatagram == 0) perDatagram = 1;
+    while (tail != head) {
+        unsigned char *dst = tm->datagram + sizeof(tm->header);
+
+        n = head - tail < perDatagram ? head - tail : perDatagram;
+        for (k=0; k<n; k++, dst += tm->recordBytes) {
+            (void)memcpy(dst, tm->ring + ((tail + k) & RING_MASK)*tm->recordDoubles,
+                         tm->recordBytes);
+        }
+        tail += n;
+        STORE_RELEASE(&tm->tail, tail);
+        if (sendDatagram(tm, DISCON_TELEMETRY_DATA, n, n*tm->recordBytes) != 0) {
+            tm->sendDropped += n;
+        }
+    }
+}  /* end drainStream */
+
+/* Function: senderThread =================================================
+ *
+ * Abstract:
+ *      Drain every open stream once per period until asked to stop.
+ */
+static void senderThread(void *arg) {
+    disconTelemetry *tm;
+
+    (void)arg;
+    for (;;) {
+        disconMutexLock(&Sender.lock);
+        if (Sender.stop) break;
+        for (tm=Sender.streams; tm!=NULL; tm=tm->next) {
+            drainStream(tm);
+        }
+        disconMutexUnlock(&Sender.lock);
+        sleepMs(DISCON_TELEMETRY_PERIOD_MS);
+    }
+    disconMutexUnlock(&Sender.lock);
+}  /* end senderThread */
+
+/* Function: openSocket ===================================================
+ *
+ * Abstract:
+ *      Create a non-blocking datagram socket for target and fill in the
+ *      address of the receiver. Returns 0, or -1 with errorMsg filled.
+ */
+static int openSocket(disconTelemetry *tm, const char *target, char *errorMsg) {
+    int family;
+
+    if (strncmp(target, "udp:", 4) == 0) {
+        struct addrinfo hints, *res;
+        const char      *host = target + 4, *port = strrchr(host, ':');
+        char            name[64];
+        size_t          len;
+
+        if (port == NULL || port == host || (len = (size_t)(port - host)) >= sizeof(name)) {
+            sprintf(errorMsg, "Telemetry target %.100s: expected udp:<address>:<port>",
+                    target);
+            return -1;
+        }
+        if (host[0] == '[' && host[len-1] == ']') {     /* [IPv6]:port */
+            host++;
+            len -= 2;
+        }
+        (void)memcpy(name, host, len);
+        name[len] = '\0';
+        if (strcmp(name, "localhost") == 0) strcpy(name, "127.0.0.1");
+
+        (void)memset(&hints, 0, sizeof(hints));
+        hints.ai_family   = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM;
+        hints.ai_flags    = AI_NUMERICHOST | AI_NUMERICSERV;
+        if (getaddrinfo(name, port + 1, &hints, &res) != 0) {
+            sprintf(errorMsg, "Telemetry target %.100s: not a numeric address and port",
+                    target);
+            return -1;
+        }
+        (void)memcpy(&tm->addr, res->ai_addr, res->ai_addrlen);
+        tm->addrLen = (int)res->ai_addrlen;
+        family = res->ai_family;
+        freeaddrinfo(res);
+#ifndef _WIN32
+    } else if (strncmp(target, "unix:", 5) == 0) {
+        struct sockaddr_un *un = (struct sockaddr_un *)&tm->addr;
+
+        if (strlen(target + 5) == 0 || strlen(target + 5) >= sizeof(un->sun_path)) {
+            sprintf(errorMsg, "Telemetry target %.100s: bad socket path", target);
+            return -1;
+        }
+        un->sun_family = AF_UNIX;
+        strcpy(un->sun_path, target + 5);
+        tm->addrLen = (int)sizeof(*un);
+        family = AF_UNIX;
+#endif
+    } else {
+        sprintf(errorMsg, "Telemetry target %.100s: expected udp:<address>:<port>"
+#ifndef _WIN32
+                " or unix:<path>"
+#endif
+                , target);
+        return -1;
+    }
+
+    tm->sock = socket(family, SOCK_DGRAM, 0);
+    if (tm->sock == NO_SOCKET) {
+        sprintf(errorMsg, "Telemetry target %.100s: unable to create a socket", target);
+        return -1;
+    }
+#ifdef _WIN32
+    {
+        u_long nonBlocking = 1;
+
+        (void)ioctlsocket(tm->sock, FIONBIO, &nonBlocking);
+    }
+#else
+    (void)fcntl(tm->sock, F_SETFL, fcntl(tm->sock, F_GETFL) | O_NONBLOCK);
+    (void)fcntl(tm->sock, F_SETFD, FD_CLOEXEC);
+#endif
+    return 0;
+}  /* end openSocket */
+
+/* Function: matches ======================================================
+ *
+ * Abstract:
+ *      Whether a channel name matches the selection item of length len,
+ *      exactly or, for an item ending in '*', by its start.
+ */
+static int matches(const char *name, const char *item, size_t len) {
+    if (len > 0 && item[len-1] == '*') {
+        return strncmp(name, item, len-1) == 0;
+    }
+    return strlen(name) == len && strncmp(name, item, len) == 0;
+}  /* end matches */
+
+/* Function: selectChannels ===============================================
+ *
+ * Abstract:
+ *      Find the channels of a selection, in channel order, and collect
+ *      their names. Returns 0, or -1 with errorMsg filled when an item
+ *      matches no channel.
+ */
+static int selectChannels(disconTelemetry *tm, int nNames, const char *const *names,
+                          const char *selection, char *errorMsg) {
+    const char *item;
+    size_t     len;
+    int        k;
+
+    if (selection != NULL && selection[0] != '\0') {
+        for (item=selection; *item!='\0'; item+=len+(item[len]==',')) {
+            len = strcspn(item, ",");
+            for (k=0; k<nNames && !matches(names[k], item, len); k++);
+            if (len > 0 && k == nNames) {
+                sprintf(errorMsg, "Telemetry: no channel matches %.*s", (int)MIN(len, 100),
+                        item);
+                return -1;
+            }
+        }
+    }
+    tm->nSelected = 0;
+    tm->namesLen  = 0;
+    for (k=0; k<nNames; k++) {
+        int selected = selection == NULL || selection[0] == '\0';
+
+        for (item=selection; !selected && *item!='\0'; item+=len+(item[len]==',')) {
+            len = strcspn(item, ",");
+            selected = len > 0 && matches(names[k], item, len);
+        }
+        if (selected) {
+            tm->selected[tm->nSelected++] = k;
+            tm->namesLen += strlen(names[k]) + 1;
+        }
+    }
+    tm->names = (char *)malloc(tm->namesLen + 1);
+    if (tm->names == NULL) {
+        sprintf(errorMsg, "Telemetry: out of memory");
+        return -1;
+    }
+    for (k=0, len=0; k<tm->nSelected; k++) {
+        strcpy(tm->names + len, names[tm->selected[k]]);
+        len += strlen(names[tm->selected[k]]) + 1;
+    }
+    return 0;
+}  /* end selectChannels */
+
+/* Function: freeTelemetry ================================================
+ *
+ * Abstract:
+ *      Free a stream that is not (or no longer) known to the sender.
+ */
+static void freeTelemetry(disconTelemetry *tm) {
+    if (tm->sock != NO_SOCKET) {
+        (void)closeSocket(tm->sock);
+#ifdef _WIN32
+        (void)WSACleanup();
+#endif
+    }
+    free(tm->selected);
+    free(tm->names);
+    free(tm->ring);
+    free(tm->datagram);
+    free(tm);
+}  /* end freeTelemetry */
+
+/*===================*
+ * Visible functions *
+ *===================*/
+
+/* Function: disconTelemetryOpen ==========================================
+ *
+ * Abstract:
+ *      Create the socket, ring and datagram buffer of a stream, send its
+ *      names and hand it to the sender, which starts with the first open
+ *      stream.
+ */
+disconTelemetry *disconTelemetryOpen(const char *target, int nNames,
+                                     const char *const *names, const char *selection,
+                                     int decimation, int instance, double stepSize,
+                                     char *errorMsg) {
+    disconTelemetry *tm;
+#ifdef _WIN32
+    WSADATA         wsa;
+#endif
+
+    tm = (disconTelemetry *)calloc(1, sizeof(*tm));
+    if (tm == NULL || (tm->selected = (int *)malloc((nNames + 1)*sizeof(int))) == NULL) {
+        sprintf(errorMsg, "Telemetry: out of memory");
+        free(tm);
+        return NULL;
+    }
+    tm->sock = NO_SOCKET;
+#ifdef _WIN32
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        sprintf(errorMsg, "Telemetry: unable to start Winsock");
+        freeTelemetry(tm);
+        return NULL;
+    }
+#endif
+    if (openSocket(tm, target, errorMsg) != 0 ||
+        selectChannels(tm, nNames, names, selection, errorMsg) != 0) {
+#ifdef _WIN32
+        if (tm->sock == NO_SOCKET) (void)WSACleanup();
+#endif
+        freeTelemetry(tm);
+        return NULL;
+    }
+    tm->recordBytes   = sizeof(double) + tm->nSelected*sizeof(float);
+    tm->recordDoubles = (tm->recordBytes + sizeof(double) - 1)/sizeof(double);
+    tm->datagramSize  = sizeof(tm->header) + MAX(tm->namesLen, MAX(tm->recordBytes,
+                                                 DISCON_TELEMETRY_DATAGRAM - sizeof(tm->header)));
+    if (sizeof(tm->header) + tm->namesLen > DISCON_TELEMETRY_MAX_NAMES ||
+        sizeof(tm->header) + tm->recordBytes > DISCON_TELEMETRY_MAX_NAMES) {
+        sprintf(errorMsg, "Telemetry: %d channels do not fit a datagram, select fewer",
+                tm->nSelected);
+        freeTelemetry(tm);
+        return NULL;
+    }
+    tm->ring     = (double *)malloc(DISCON_TELEMETRY_RECORDS*tm->recordDoubles*sizeof(double));
+    tm->datagram = (unsigned char *)malloc(tm->datagramSize);
+    if (tm->ring == NULL || tm->datagram == NULL) {
+        sprintf(errorMsg, "Telemetry: out of memory");
+        freeTelemetry(tm);
+        return NULL;
+    }
+    tm->decimation       = decimation > 1 ? decimation : 1;
+    tm->countdown        = 1;
+    tm->header.magic     = DISCON_TELEMETRY_MAGIC;
+    tm->header.version   = DISCON_TELEMETRY_VERSION;
+    tm->header.pid       = currentPid();
+    tm->header.instance  = (uint32_t)instance;
+    tm->header.nChannels = (uint32_t)tm->nSelected;
+    tm->header.stepSize  = stepSize*tm->decimation;
+    sendNames(tm);
+
+    disconMutexLock(&Sender.openLock);
+    disconMutexLock(&Sender.lock);
+    if (Sender.nStreams == 0) {
+        Sender.stop = 0;
+        if (disconThreadCreate(&Sender.thread, senderThread, NULL) != 0) {
+            disconMutexUnlock(&Sender.lock);
+            disconMutexUnlock(&Sender.openLock);
+            sprintf(errorMsg, "Telemetry: unable to start the sender thread");
+            freeTelemetry(tm);
+            return NULL;
+        }
+    }
+    Sender.nStreams++;
+    tm->next = Sender.streams;
+    Sender.streams = tm;
+    disconMutexUnlock(&Sender.lock);
+    disconMutexUnlock(&Sender.openLock);
+    return tm;
+}  /* end disconTelemetryOpen */
+
+/* Function: disconTelemetryDue ===========================================
+ *
+ * Abstract:
+ *      Count down the decimation; a step to be sent that finds the ring
+ *      full is dropped.
+ */
+int disconTelemetryDue(disconTelemetry *tm) {
+    if (--tm->countdown > 0) return 0;
+    tm->countdown = tm->decimation;
+    if (tm->head - LOAD_ACQUIRE(&tm->tail) >= DISCON_TELEMETRY_RECORDS) {
+        tm->dropped++;
+        return 0;
+    }
+    return 1;
+}  /* end disconTelemetryDue */
+
+/* Function: disconTelemetryPut ===========================================
+ *
+ * Abstract:
+ *      Write the selected channels to the next record and publish it.
+ */
+void disconTelemetryPut(disconTelemetry *tm, double t, const float *row) {
+    double *record = tm->ring + (tm->head & RING_MASK)*tm->recordDoubles;
+    float  *field  = (float *)(record + 1);
+    int    k;
+
+    record[0] = t;
+    for (k=0; k<tm->nSelected; k++) {
+        field[k] = row[tm->selected[k]];
+    }
+    STORE_RELEASE(&tm->head, tm->head + 1);
+}  /* end disconTelemetryPut */
+
+/* Function: disconTelemetryClose =========================================
+ *
+ * Abstract:
+ *      Take the stream from the sender, which stops with the last open
+ *      stream, then send what is left and the end of the stream.
+ */
+uint32_t disconTelemetryClose(disconTelemetry *tm) {
+    disconTelemetry **p;
+    uint32_t        dropped;
+    int             last;
+
+    if (tm == NULL) return 0;
+
+    disconMutexLock(&Sender.openLock);
+    disconMutexLock(&Sender.lock);
+    for (p=&Sender.streams; *p!=tm; p=&(*p)->next);
+    *p = tm->next;
+    last = (--Sender.nStreams == 0);
+    if (last) Sender.stop = 1;
+    disconMutexUnlock(&Sender.lock);
+    if (last) {
+        disconThreadJoin(Sender.thread);
+    }
+    disconMutexUnlock(&Sender.openLock);
+
+    drainStream(tm);
+    (void)sendDatagram(tm, DISCON_TELEMETRY_END, 0, 0);
+    dropped = tm->dropped + tm->sendDropped;
+    freeTelemetry(tm);
+    return dropped;
+}  /* end disconTelemetryClose */
+
+/* EOF: discon_telemetry.c */
@@ -0,0 +1,111 @@
+/*
+ * File    : discon_telemetry.h
+ *
+ * Abstract:
+ *      Streaming telemetry of selected controller signals to a local or
+ *      remote receiver (discon_telemetry_rx) over UDP or a Unix datagram
+ *      socket, a lightweight alternative to External Mode for watching a
+ *      running controller.
+ *
+ *      The control step copies the selected channels of a step into the
+ *      next record of a lock-free single-producer, single-consumer ring and
+ *      carries on; it never takes a lock, waits or makes a system call. A
+ *      single background sender thread, shared by all open streams, drains
+ *      the rings every DISCON_TELEMETRY_PERIOD_MS milliseconds into
+ *      datagrams and sends them without blocking. A step that finds the
+ *      ring full, or a datagram the socket cannot take at once, is dropped
+ *      and counted: telemetry never holds the controller back.
+ *
+ *      Datagrams, in host byte order: a disconTelemetryHeader followed by
+ *
+ *        DISCON_TELEMETRY_NAMES  the nChannels channel names, each NUL
+ *                                terminated (count bytes); sent when the
+ *                                stream opens and once a second, so that
+ *                                a receiver can join at any time;
+ *        DISCON_TELEMETRY_DATA   count records of a double time followed
+ *                                by nChannels floats;
+ *        DISCON_TELEMETRY_END    nothing; the stream has closed.
+ */
+
+#ifndef DISCON_TELEMETRY_H
+#define DISCON_TELEMETRY_H
+
+#include <stdint.h>
+
+#include "discon.h"
+
+#define DISCON_TELEMETRY_MAGIC    0x4D4C5444u   /* "DTLM"                    */
+#define DISCON_TELEMETRY_VERSION  1
+
+/* Records per ring, a power of 2, and the sender period */
+#ifndef DISCON_TELEMETRY_RECORDS
+# define DISCON_TELEMETRY_RECORDS  1024
+#endif
+#ifndef DISCON_TELEMETRY_PERIOD_MS
+# define DISCON_TELEMETRY_PERIOD_MS 20
+#endif
+
+/* Largest data datagram: one Ethernet frame. A names datagram may be larger */
+#define DISCON_TELEMETRY_DATAGRAM 1472
+#define DISCON_TELEMETRY_MAX_NAMES 65000
+
+/* Datagram types, disconTelemetryHeader.type */
+enum {
+    DISCON_TELEMETRY_NAMES = 1,
+    DISCON_TELEMETRY_DATA,
+    DISCON_TELEMETRY_END
+};
+
+typedef struct {
+    uint32_t magic;             /* DISCON_TELEMETRY_MAGIC                   */
+    uint16_t version;           /* DISCON_TELEMETRY_VERSION                 */
+    uint16_t type;              /* DISCON_TELEMETRY_xxx                     */
+    uint32_t pid;               /* process and instance number (1..) of the */
+    uint32_t instance;          /* controller: the stream                   */
+    uint32_t seq;               /* datagram number in the stream            */
+    uint32_t nChannels;
+    uint32_t count;             /* records, or bytes of names               */
+    uint32_t dropped;           /* records dropped so far                   */
+    double   stepSize;          /* time between records, s                  */
+} disconTelemetryHeader;        /* 40 bytes */
+
+typedef struct disconTelemetry disconTelemetry;
+
+/*
+ * Open a stream to target, "udp:<address>:<port>" (a numeric IPv4 or IPv6
+ * address or localhost, so that opening never waits for a name lookup) or
+ * "unix:<path>". Of the nNames channels of names, those matching
+ * selection are sent: a comma-separated list of names, where a name
+ * ending in '*' matches every channel starting with it; NULL or "" selects
+ * all. Every decimation-th step is sent, as a record stepSize*decimation
+ * apart.
+ * Returns NULL and fills errorMsg (at least 257 characters) on failure.
+ */
+DISCON_LOCAL disconTelemetry *disconTelemetryOpen(const char *target, int nNames,
+                                                  const char *const *names,
+                                                  const char *selection, int decimation,
+                                                  int instance, double stepSize,
+                                                  char *errorMsg);
+
+/*
+ * Count a step. Returns 1 when the step is to be sent and there is room
+ * for it, so that the caller gathers its channels only then; 0 when it is
+ * decimated away or dropped.
+ */
+DISCON_LOCAL int disconTelemetryDue(disconTelemetry *tm);
+
+/*
+ * Send the step approved by disconTelemetryDue at time t: row holds all
+ * nNames channels, of which the selected ones are queued.
+ */
+DISCON_LOCAL void disconTelemetryPut(disconTelemetry *tm, double t, const float *row);
+
+/*
+ * Send the queued records and the end of the stream, and free it. Returns
+ * the number of records dropped. NULL is ignored.
+ */
+DISCON_LOCAL uint32_t disconTelemetryClose(disconTelemetry *tm);
+
+#endif /* DISCON_TELEMETRY_H */
+
+/* EOF: discon_telemetry.h */
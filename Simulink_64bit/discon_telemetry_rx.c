@@ -0,0 +1,394 @@
+/*
+ * File    : discon_telemetry_rx.c
+ *
+ * Abstract:
+ *      Receiver of the telemetry streams of running controllers
+ *      (discon_telemetry.h). Binds the address the controllers send to,
+ *      $DISCON_TELEMETRY of the controller process, and either shows the
+ *      streams live, one table per controller instance refreshed every
+ *      -every seconds:
+ *
+ *          pid 4711 instance 1   t 123.450 s   80 records/s   dropped 0   lost 0
+ *            GenSpeed             122.9         122.7 .. 123.1
+ *            ...
+ *
+ *      with the last value and the range since the previous refresh of
+ *      every channel, or, with -csv, writes every record as a line
+ *
+ *          pid.instance <TAB> time <TAB> channel values...
+ *
+ *      preceded by a line "#pid.instance <TAB> time <TAB> channel names..."
+ *      whenever a stream starts. "dropped" counts the records the controller did not send,
+ *      "lost" the datagrams that did not arrive. Stops on Ctrl-C.
+ *
+ *      usage: discon_telemetry_rx [-csv] [-every seconds] target
+ *          target  udp:<address>:<port>, e.g. udp:0.0.0.0:50555 to receive
+ *                  from anywhere, or unix:<path>
+ *
+ *      Built with the library by the Linux template makefile (discon.tmf).
+ */
+
+#ifndef _POSIX_C_SOURCE
+# define _POSIX_C_SOURCE 200112L        /* getaddrinfo with -std=c99 */
+#endif
+
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "discon_telemetry.h"
+
+/*=========*
+ * Defines *
+ *=========*/
+
+#define MAX_STREAMS  64
+#define MAX_DATAGRAM 65536
+
+typedef struct {
+    uint32_t pid;
+    uint32_t instance;
+    int      nChannels;             /* 0: names not received yet        */
+    char     *names;                /* NUL terminated, one per channel  */
+    size_t   namesLen;
+    char     **name;
+    float    *last;
+    float    *min;                  /* since the last refresh           */
+    float    *max;
+    double   t;                     /* time of the last record          */
+    uint32_t nextSeq;
+    uint32_t lost;                  /* datagrams                        */
+    uint32_t dropped;               /* records, by the controller       */
+    uint32_t records;               /* since the last refresh           */
+    int      ended;
+} Stream;
+
+/*==================================*
+ * Global data local to this module *
+ *==================================*/
+
+static Stream Streams[MAX_STREAMS];
+static int    NumStreams;
+
+static volatile sig_atomic_t Stop;
+
+/*=================*
+ * Local functions *
+ *=================*/
+
+static void onSignal(int sig) {
+    (void)sig;
+    Stop = 1;
+}
+
+/* Function: openSocket ===================================================
+ *
+ * Abstract:
+ *      Bind a datagram socket to target. Exits on failure.
+ */
+static int openSocket(const char *target) {
+    struct sockaddr_storage addr;
+    socklen_t               addrLen;
+    int                     sock, family;
+
+    (void)memset(&addr, 0, sizeof(addr));
+    if (strncmp(target, "udp:", 4) == 0) {
+        struct addrinfo hints, *res;
+        const char      *host = target + 4, *port = strrchr(host, ':');
+        char            name[64];
+        size_t          len;
+
+        if (port == NULL || (len = (size_t)(port - host)) >= sizeof(name)) {
+            (void)fprintf(stderr, "%s: expected udp:<address>:<port>\n", target);
+            exit(EXIT_FAILURE);
+        }
+        if (len >= 2 && host[0] == '[' && host[len-1] == ']') {
+            host++;
+            len -= 2;
+        }
+        (void)memcpy(name, host, len);
+        name[len] = '\0';
+        (void)memset(&hints, 0, sizeof(hints));
+        hints.ai_family   = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM;
+        hints.ai_flags    = AI_PASSIVE;
+        if (getaddrinfo(len > 0 ? name : NULL, port + 1, &hints, &res) != 0) {
+            (void)fprintf(stderr, "%s: unknown address\n", target);
+            exit(EXIT_FAILURE);
+        }
+        (void)memcpy(&addr, res->ai_addr, res->ai_addrlen);
+        addrLen = res->ai_addrlen;
+        family  = res->ai_family;
+        freeaddrinfo(res);
+    } else if (strncmp(target, "unix:", 5) == 0) {
+        struct sockaddr_un *un = (struct sockaddr_un *)&addr;
+
+        if (strlen(target + 5) == 0 || strlen(target + 5) >= sizeof(un->sun_path)) {
+            (void)fprintf(stderr, "%s: bad socket path\n", target);
+            exit(EXIT_FAILURE);
+        }
+        un->sun_family = AF_UNIX;
+        strcpy(un->sun_path, target + 5);
+        (void)unlink(un->sun_path);     /* left over by an earlier receiver */
+        addrLen = sizeof(*un);
+        family  = AF_UNIX;
+    } else {
+        (void)fprintf(stderr, "%s: expected udp:<address>:<port> or unix:<path>\n", target);
+        exit(EXIT_FAILURE);
+    }
+
+    sock = socket(family, SOCK_DGRAM, 0);
+    if (sock < 0 || bind(sock, (struct sockaddr *)&addr, addrLen) != 0) {
+        perror(target);
+        exit(EXIT_FAILURE);
+    }
+    return sock;
+}  /* end openSocket */
+
+/* Function: findStream ===================================================
+ *
+ * Abstract:
+ *      The stream of a controller instance, added on its first datagram.
+ *      NULL when the table is full.
+ */
+static Stream *findStream(const disconTelemetryHeader *h) {
+    int k;
+
+    for (k=0; k<NumStreams; k++) {
+        if (Streams[k].pid == h->pid && Streams[k].instance == h->instance) {
+            return &Streams[k];
+        }
+    }
+    if (NumStreams == MAX_STREAMS) return NULL;
+    Streams[NumStreams].pid      = h->pid;
+    Streams[NumStreams].instance = h->instance;
+    Streams[NumStreams].nextSeq  = h->seq;
+    return &Streams[NumStreams++];
+}  /* end findStream */
+
+/* Function: setNames =====================================================
+ *
+ * Abstract:
+ *      Take the channel names of a stream from a names datagram; a stream
+ *      restarted with other channels starts over.
+ */
+static void setNames(Stream *s, const disconTelemetryHeader *h, const char *names,
+                     int csv) {
+    int    k, n = (int)h->nChannels;
+    size_t pos;
+
+    if (s->nChannels == n && s->namesLen == h->count &&
+        memcmp(s->names, names, h->count) == 0) return;
+    free(s->names);
+    free(s->name);
+    free(s->last);
+    s->nChannels = 0;
+    s->names = (char *)malloc(h->count + 1);
+    s->name  = (char **)malloc((size_t)(n + 1)*sizeof(char *));
+    s->last  = (float *)calloc((size_t)(3*n + 1), sizeof(float));
+    if (s->names == NULL || s->name == NULL || s->last == NULL) {
+        (void)fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    (void)memcpy(s->names, names, h->count);
+    s->names[h->count] = '\0';
+    s->namesLen = h->count;
+    for (k=0, pos=0; k<n; k++) {
+        if (pos >= h->count) return;    /* malformed: ignore the stream */
+        s->name[k] = s->names + pos;
+        pos += strlen(s->name[k]) + 1;
+    }
+    s->min = s->last + n;
+    s->max = s->min + n;
+    for (k=0; k<n; k++) {
+        s->min[k] = 1e30f;
+        s->max[k] = -1e30f;
+    }
+    s->nChannels = n;
+    s->ended     = 0;
+    if (csv) {
+        (void)printf("#%u.%u\ttime", (unsigned)s->pid, (unsigned)s->instance);
+        for (k=0; k<n; k++) {
+            (void)printf("\t%s", s->name[k]);
+        }
+        (void)printf("\n");
+    }
+}  /* end setNames */
+
+/* Function: addRecords ===================================================
+ *
+ * Abstract:
+ *      Take the records of a data datagram.
+ */
+static void addRecords(Stream *s, const disconTelemetryHeader *h,
+                       const unsigned char *data, int csv) {
+    size_t   recordBytes = sizeof(double) + (size_t)s->nChannels*sizeof(float);
+    float    v;
+    uint32_t r;
+    int      k;
+
+    for (r=0; r<h->count; r++, data += recordBytes) {
+        (void)memcpy(&s->t, data, sizeof(double));
+        if (csv) (void)printf("%u.%u\t%.6f", (unsigned)s->pid, (unsigned)s->instance, s->t);
+        for (k=0; k<s->nChannels; k++) {
+            (void)memcpy(&v, data + sizeof(double) + k*sizeof(float), sizeof(float));
+            s->last[k] = v;
+            if (v < s->min[k]) s->min[k] = v;
+            if (v > s->max[k]) s->max[k] = v;
+            if (csv) (void)printf("\t%.7g", v);
+        }
+        if (csv) (void)printf("\n");
+    }
+    s->records += h->count;
+}  /* end addRecords */
+
+/* Function: receive ======================================================
+ *
+ * Abstract:
+ *      Check and take one datagram.
+ */
+static void receive(const unsigned char *buf, size_t size, int csv) {
+    disconTelemetryHeader h;
+    Stream                *s;
+
+    if (size < sizeof(h)) return;
+    (void)memcpy(&h, buf, sizeof(h));
+    if (h.magic != DISCON_TELEMETRY_MAGIC || h.version != DISCON_TELEMETRY_VERSION) return;
+    s = findStream(&h);
+    if (s == NULL) return;
+
+    if (h.seq != s->nextSeq) s->lost += h.seq - s->nextSeq;
+    s->nextSeq = h.seq + 1;
+    s->dropped = h.dropped;
+
+    switch (h.type) {
+      case DISCON_TELEMETRY_NAMES:
+        if (size == sizeof(h) + h.count && h.count > 0) {
+            setNames(s, &h, (const char *)buf + sizeof(h), csv);
+        }
+        break;
+      case DISCON_TELEMETRY_DATA:
+        if (s->nChannels == (int)h.nChannels && s->nChannels > 0 &&
+            size == sizeof(h) + h.count*(sizeof(double) + h.nChannels*sizeof(float))) {
+            addRecords(s, &h, buf + sizeof(h), csv);
+        }
+        break;
+      case DISCON_TELEMETRY_END:
+        s->ended = 1;
+        break;
+      default:
+        break;
+    }
+}  /* end receive */
+
+/* Function: show =========================================================
+ *
+ * Abstract:
+ *      Draw the tables of all streams and start the next interval.
+ */
+static void show(double interval, int tty) {
+    int k, i;
+
+    if (tty) (void)printf("\033[H\033[J");
+    if (NumStreams == 0) (void)printf("waiting for telemetry...\n");
+    for (k=0; k<NumStreams; k++) {
+        Stream *s = &Streams[k];
+
+        (void)printf("pid %u instance %u   t %.3f s   %.0f records/s   dropped %u   lost %u%s\n",
+                     (unsigned)s->pid, (unsigned)s->instance, s->t, s->records/interval,
+                     (unsigned)s->dropped, (unsigned)s->lost, s->ended ? "   ENDED" : "");
+        for (i=0; i<s->nChannels; i++) {
+            if (s->records > 0) {
+                (void)printf("  %-24s %14.6g   %14.6g .. %-14.6g\n", s->name[i],
+                             s->last[i], s->min[i], s->max[i]);
+            } else {
+                (void)printf("  %-24s %14.6g\n", s->name[i], s->last[i]);
+            }
+            s->min[i] = 1e30f;
+            s->max[i] = -1e30f;
+        }
+        s->records = 0;
+    }
+    (void)fflush(stdout);
+}  /* end show */
+
+/* Function: monotonic ====================================================
+ *
+ * Abstract:
+ *      Monotonic clock in seconds.
+ */
+static double monotonic(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec*1e-9;
+}  /* end monotonic */
+
+/*===================*
+ * Visible functions *
+ *===================*/
+
+int main(int argc, char *argv[]) {
+    static unsigned char buf[MAX_DATAGRAM];
+    const char           *target = NULL;
+    double               every = 0.5, next;
+    int                  csv = 0, tty = isatty(STDOUT_FILENO), i, sock;
+    struct pollfd        pfd;
+    struct sigaction     sa;
+
+    for (i=1; i<argc; i++) {
+        if (strcmp(argv[i], "-csv") == 0) {
+            csv = 1;
+        } else if (strcmp(argv[i], "-every") == 0 && i+1 < argc) {
+            every = atof(argv[++i]);
+        } else if (argv[i][0] != '-' && target == NULL) {
+            target = argv[i];
+        } else {
+            target = NULL;
+            break;
+        }
+    }
+    if (target == NULL || every <= 0.0) {
+        (void)fprintf(stderr, "usage: %s [-csv] [-every seconds] "
+                      "udp:<address>:<port> | unix:<path>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    sock = openSocket(target);
+    (void)memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onSignal;
+    (void)sigaction(SIGINT, &sa, NULL);
+    (void)sigaction(SIGTERM, &sa, NULL);
+
+    pfd.fd     = sock;
+    pfd.events = POLLIN;
+    next = monotonic() + every;
+    if (!csv) show(every, tty);
+    while (!Stop) {
+        int wait = csv ? 1000 : (int)((next - monotonic())*1000.0);
+
+        if (poll(&pfd, 1, wait > 0 ? wait : 0) > 0) {
+            ssize_t size = recv(sock, buf, sizeof(buf), 0);
+
+            if (size > 0) receive(buf, (size_t)size, csv);
+        }
+        if (!csv && monotonic() >= next) {
+            show(every, tty);
+            next += every;
+            if (next < monotonic()) next = monotonic() + every;
+        }
+    }
+
+    (void)close(sock);
+    if (strncmp(target, "unix:", 5) == 0) (void)unlink(target + 5);
+    return EXIT_SUCCESS;
+}  /* end main */
+
+/* EOF: discon_telemetry_rx.c */
@@ -0,0 +1,271 @@
+/*
+ * File    : discon_threads.c
+ *
+ * Abstract:
+ *      Portable threading layer and worker pool of the DISCON library,
+ *      see discon_threads.h.
+ */
+
+#include <stdlib.h>
+#if !(defined _WIN32 || defined __CYGWIN__)
+#  include <unistd.h>
+#endif
+
+#include "discon_threads.h"
+
+/*=========*
+ * Defines *
+ *=========*/
+
+#ifndef DISCON_MAX_THREADS
+#define DISCON_MAX_THREADS 256
+#endif
+
+/*==================================*
+ * Global data local to this module *
+ *==================================*/
+
+static struct {
+    disconMutex   runLock;      /* one batch at a time                  */
+    disconMutex   lock;         /* protects everything below            */
+    disconCond    start;
+    disconCond    done;
+    int           nWorkers;     /* including the calling thread; 0=none */
+    int           stop;
+    unsigned long generation;   /* incremented for every batch          */
+    unsigned long startGeneration; /* generation when the workers started */
+    int           pending;      /* workers still busy with the batch    */
+    disconPoolFcn fcn;
+    void          *ctx;
+    int           n;
+    disconThread  threads[DISCON_MAX_THREADS];
+} Pool = { DISCON_MUTEX_INITIALIZER, DISCON_MUTEX_INITIALIZER,
+           DISCON_COND_INITIALIZER,  DISCON_COND_INITIALIZER,
+           0, 0, 0UL, 0UL, 0, NULL, NULL, 0, { 0 } };
+
+/*=====================*
+ * Threading functions *
+ *=====================*/
+
+#if defined _WIN32 || defined __CYGWIN__
+
+void disconMutexInit(disconMutex *m)    { InitializeSRWLock(m); }
+void disconMutexDestroy(disconMutex *m) { (void)m; }
+void disconMutexLock(disconMutex *m)    { AcquireSRWLockExclusive(m); }
+void disconMutexUnlock(disconMutex *m)  { ReleaseSRWLockExclusive(m); }
+
+void disconCondInit(disconCond *c)      { InitializeConditionVariable(c); }
+void disconCondDestroy(disconCond *c)   { (void)c; }
+void disconCondWait(disconCond *c, disconMutex *m) {
+    SleepConditionVariableSRW(c, m, INFINITE, 0);
+}
+void disconCondBroadcast(disconCond *c) { WakeAllConditionVariable(c); }
+
+typedef struct { disconThreadFcn fcn; void *arg; } ThreadStart;
+
+static DWORD WINAPI threadTrampoline(LPVOID p) {
+    ThreadStart start = *(ThreadStart *)p;
+    free(p);
+    start.fcn(start.arg);
+    return 0;
+}
+
+int disconThreadCreate(disconThread *t, disconThreadFcn fcn, void *arg) {
+    ThreadStart *start = (ThreadStart *)malloc(sizeof(ThreadStart));
+    if (start == NULL) return -1;
+    start->fcn = fcn;
+    start->arg = arg;
+    *t = CreateThread(NULL, 0, threadTrampoline, start, 0, NULL);
+    if (*t == NULL) {
+        free(start);
+        return -1;
+    }
+    return 0;
+}
+
+void disconThreadJoin(disconThread t) {
+    WaitForSingleObject(t, INFINITE);
+    CloseHandle(t);
+}
+
+int disconNumProcessors(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+}
+
+#else /* POSIX threads */
+
+void disconMutexInit(disconMutex *m)    { (void)pthread_mutex_init(m, NULL); }
+void disconMutexDestroy(disconMutex *m) { (void)pthread_mutex_destroy(m); }
+void disconMutexLock(disconMutex *m)    { (void)pthread_mutex_lock(m); }
+void disconMutexUnlock(disconMutex *m)  { (void)pthread_mutex_unlock(m); }
+
+void disconCondInit(disconCond *c)      { (void)pthread_cond_init(c, NULL); }
+void disconCondDestroy(disconCond *c)   { (void)pthread_cond_destroy(c); }
+void disconCondWait(disconCond *c, disconMutex *m) {
+    (void)pthread_cond_wait(c, m);
+}
+void disconCondBroadcast(disconCond *c) { (void)pthread_cond_broadcast(c); }
+
+typedef struct { disconThreadFcn fcn; void *arg; } ThreadStart;
+
+static void *threadTrampoline(void *p) {
+    ThreadStart start = *(ThreadStart *)p;
+    free(p);
+    start.fcn(start.arg);
+    return NULL;
+}
+
+int disconThreadCreate(disconThread *t, disconThreadFcn fcn, void *arg) {
+    ThreadStart *start = (ThreadStart *)malloc(sizeof(ThreadStart));
+    if (start == NULL) return -1;
+    start->fcn = fcn;
+    start->arg = arg;
+    if (pthread_create(t, NULL, threadTrampoline, start) != 0) {
+        free(start);
+        return -1;
+    }
+    return 0;
+}
+
+void disconThreadJoin(disconThread t) {
+    (void)pthread_join(t, NULL);
+}
+
+int disconNumProcessors(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+#endif
+
+/*=============*
+ * Worker pool *
+ *=============*/
+
+/* Function: runBlock =====================================================
+ *
+ * Abstract:
+ *      Run the contiguous block of the index range owned by worker w.
+ */
+static void runBlock(disconPoolFcn fcn, void *ctx, int n, int w, int nWorkers) {
+    int i;
+    int lo = (int)(((long)n * w) / nWorkers);
+    int hi = (int)(((long)n * (w+1)) / nWorkers);
+
+    for (i=lo; i<hi; i++) {
+        fcn(ctx, i);
+    }
+}
+
+static void poolWorker(void *arg) {
+    int           w = (int)(size_t)arg;
+    unsigned long seen;
+
+    disconMutexLock(&Pool.lock);
+    seen = Pool.startGeneration;
+    for (;;) {
+        disconPoolFcn fcn;
+        void          *ctx;
+        int           n;
+
+        while (Pool.generation == seen && !Pool.stop) {
+            disconCondWait(&Pool.start, &Pool.lock);
+        }
+        if (Pool.stop) break;
+        seen = Pool.generation;
+        fcn  = Pool.fcn;
+        ctx  = Pool.ctx;
+        n    = Pool.n;
+        disconMutexUnlock(&Pool.lock);
+
+        runBlock(fcn, ctx, n, w, Pool.nWorkers);
+
+        disconMutexLock(&Pool.lock);
+        if (--Pool.pending == 0) {
+            disconCondBroadcast(&Pool.done);
+        }
+    }
+    disconMutexUnlock(&Pool.lock);
+}
+
+/* Function: startPool ====================================================
+ *
+ * Abstract:
+ *      Start the workers. Called with Pool.runLock held.
+ */
+static void startPool(void) {
+    const char *env = getenv("DISCON_NUM_THREADS");
+    int        nWorkers = (env != NULL) ? atoi(env) : disconNumProcessors();
+    int        w;
+
+    if (nWorkers < 1) nWorkers = 1;
+    if (nWorkers > DISCON_MAX_THREADS) nWorkers = DISCON_MAX_THREADS;
+
+    disconCondInit(&Pool.start);
+    disconCondInit(&Pool.done);
+    Pool.stop = 0;
+    Pool.startGeneration = Pool.generation;
+    Pool.nWorkers = 1;
+    for (w=1; w<nWorkers; w++) {
+        if (disconThreadCreate(&Pool.threads[w], poolWorker, (void *)(size_t)w) != 0) {
+            break;
+        }
+        Pool.nWorkers++;
+    }
+}
+
+void disconPoolRun(disconPoolFcn fcn, void *ctx, int n) {
+    disconMutexLock(&Pool.runLock);
+    if (Pool.nWorkers == 0) {
+        startPool();
+    }
+
+    if (Pool.nWorkers == 1 || n < 2) {
+        runBlock(fcn, ctx, n, 0, 1);
+    } else {
+        disconMutexLock(&Pool.lock);
+        Pool.fcn     = fcn;
+        Pool.ctx     = ctx;
+        Pool.n       = n;
+        Pool.pending = Pool.nWorkers - 1;
+        Pool.generation++;
+        disconCondBroadcast(&Pool.start);
+        disconMutexUnlock(&Pool.lock);
+
+        runBlock(fcn, ctx, n, 0, Pool.nWorkers);
+
+        disconMutexLock(&Pool.lock);
+        while (Pool.pending > 0) {
+            disconCondWait(&Pool.done, &Pool.lock);
+        }
+        disconMutexUnlock(&Pool.lock);
+    }
+    disconMutexUnlock(&Pool.runLock);
+}
+
+int disconPoolSize(void) {
+    return Pool.nWorkers;
+}
+
+void disconPoolShutdown(void) {
+    int w;
+
+    disconMutexLock(&Pool.runLock);
+    if (Pool.nWorkers > 0) {
+        disconMutexLock(&Pool.lock);
+        Pool.stop = 1;
+        disconCondBroadcast(&Pool.start);
+        disconMutexUnlock(&Pool.lock);
+        for (w=1; w<Pool.nWorkers; w++) {
+            disconThreadJoin(Pool.threads[w]);
+        }
+        disconCondDestroy(&Pool.start);
+        disconCondDestroy(&Pool.done);
+        Pool.nWorkers = 0;
+    }
+    disconMutexUnlock(&Pool.runLock);
+}
+
+/* EOF: discon_threads.c */
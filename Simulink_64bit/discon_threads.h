@@ -0,0 +1,73 @@
+/*
+ * File    : discon_threads.h
+ *
+ * Abstract:
+ *      Minimal portable threading layer (Win32 / POSIX threads) used by the
+ *      DISCON library: mutexes, condition variables, threads and a worker
+ *      pool that runs one function over an index range.
+ */
+
+#ifndef DISCON_THREADS_H
+#define DISCON_THREADS_H
+
+#if defined _WIN32 || defined __CYGWIN__
+#  include <windows.h>
+typedef SRWLOCK            disconMutex;
+typedef CONDITION_VARIABLE disconCond;
+typedef HANDLE             disconThread;
+#  define DISCON_MUTEX_INITIALIZER SRWLOCK_INIT
+#  define DISCON_COND_INITIALIZER  CONDITION_VARIABLE_INIT
+#else
+#  include <pthread.h>
+typedef pthread_mutex_t    disconMutex;
+typedef pthread_cond_t     disconCond;
+typedef pthread_t          disconThread;
+#  define DISCON_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#  define DISCON_COND_INITIALIZER  PTHREAD_COND_INITIALIZER
+#endif
+
+#include "discon.h"
+
+/* Storage class of per-thread variables */
+#if defined _MSC_VER
+# define THREAD_LOCAL __declspec(thread)
+#else
+# define THREAD_LOCAL __thread
+#endif
+
+typedef void (*disconThreadFcn)(void *arg);
+
+DISCON_LOCAL void disconMutexInit(disconMutex *m);
+DISCON_LOCAL void disconMutexDestroy(disconMutex *m);
+DISCON_LOCAL void disconMutexLock(disconMutex *m);
+DISCON_LOCAL void disconMutexUnlock(disconMutex *m);
+
+DISCON_LOCAL void disconCondInit(disconCond *c);
+DISCON_LOCAL void disconCondDestroy(disconCond *c);
+DISCON_LOCAL void disconCondWait(disconCond *c, disconMutex *m);
+DISCON_LOCAL void disconCondBroadcast(disconCond *c);
+
+DISCON_LOCAL int  disconThreadCreate(disconThread *t, disconThreadFcn fcn, void *arg);
+DISCON_LOCAL void disconThreadJoin(disconThread t);
+
+/* Number of processors available to this process */
+DISCON_LOCAL int  disconNumProcessors(void);
+
+/*
+ * Worker pool: disconPoolRun calls fcn(ctx, i) for every i in [0, n) and
+ * returns when all calls have completed. The range is split statically
+ * into one contiguous block per worker; the calling thread works on the
+ * first block. The pool is created on first use with DISCON_NUM_THREADS
+ * workers (environment variable), or one per processor.
+ */
+typedef void (*disconPoolFcn)(void *ctx, int i);
+
+DISCON_LOCAL void disconPoolRun(disconPoolFcn fcn, void *ctx, int n);
+DISCON_LOCAL int  disconPoolSize(void);
+
+/* Stop and join the workers; the next disconPoolRun starts them again */
+DISCON_LOCAL void disconPoolShutdown(void);
+
+#endif /* DISCON_THREADS_H */
+
+/* EOF: discon_threads.h */
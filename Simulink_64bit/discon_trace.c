@@ -0,0 +1,380 @@
+/*
+ * File    : discon_trace.c
+ *
+ * Abstract:
+ *      Reader of avrSwap traces, see discon_trace.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#if defined _WIN32
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+#include "discon_trace.h"
+
+/*==================================*
+ * Global data local to this module *
+ *==================================*/
+
+struct disconTraceReader {
+    const char        *view;        /* the mapped file                      */
+    size_t            size;
+    disconTraceHeader header;
+    size_t            nWords;       /* nSwap+nOut                           */
+    long              nCalls;
+    long              next;         /* call returned by disconTraceNext     */
+    /* DISCON_TRACE_XOR */
+    size_t            end;          /* end of the last complete chunk       */
+    size_t            pos;          /* next encoded byte                    */
+    size_t            chunkEnd;     /* end of the current chunk             */
+    long              chunkLeft;    /* records left in the current chunk    */
+    float             *record;      /* last decoded record                  */
+};
+
+/*=================*
+ * Local functions *
+ *=================*/
+
+#if defined _WIN32
+
+/* Function: mapFile ======================================================
+ *
+ * Abstract:
+ *      Map a file read-only, so a trace is read straight from the page
+ *      cache.
+ */
+static const char *mapFile(const char *path, size_t size) {
+    HANDLE     file, mapping;
+    const char *view;
+
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) return NULL;
+    view = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+    CloseHandle(mapping);   /* the view keeps the mapping alive */
+    return view;
+}  /* end mapFile */
+
+static void unmapFile(const char *view, size_t size) {
+    (void)size;
+    UnmapViewOfFile(view);
+}  /* end unmapFile */
+
+#else
+
+/* Function: mapFile ======================================================
+ *
+ * Abstract:
+ *      Map a file read-only, so a trace is read straight from the page
+ *      cache. The whole trace is read in order, so tell the kernel.
+ */
+static const char *mapFile(const char *path, size_t size) {
+    void *view;
+    int  fd = open(path, O_RDONLY);
+
+    if (fd < 0) return NULL;
+    view = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);              /* the mapping keeps the file open */
+    if (view == MAP_FAILED) return NULL;
+#ifdef MADV_SEQUENTIAL
+    (void)madvise(view, size, MADV_SEQUENTIAL);
+#endif
+    return (const char *)view;
+}  /* end mapFile */
+
+static void unmapFile(const char *view, size_t size) {
+    munmap((void *)view, size);
+}  /* end unmapFile */
+
+#endif
+
+/* Function: countChunks ==================================================
+ *
+ * Abstract:
+ *      Walk the chunks of an encoded trace up to the first incomplete one;
+ *      returns the number of calls in the complete ones.
+ */
+static long countChunks(disconTraceReader *trace) {
+    disconTraceChunkHeader chunk;
+    size_t                 pos = sizeof(disconTraceHeader);
+    long                   n = 0;
+
+    while (pos + sizeof(chunk) <= trace->size) {
+        (void)memcpy(&chunk, trace->view + pos, sizeof(chunk));
+        if (chunk.magic != DISCON_TRACE_CHUNK_MAGIC ||
+            chunk.size > trace->size - pos - sizeof(chunk)) {
+            break;
+        }
+        pos += sizeof(chunk) + chunk.size;
+        n   += (long)chunk.calls;
+    }
+    trace->end = pos;
+    return n;
+}  /* end countChunks */
+
+/* Function: getVarint ====================================================
+ *
+ * Abstract:
+ *      Read an unsigned LEB128 number; returns -1 past end.
+ */
+static int getVarint(const unsigned char **p, const unsigned char *end, size_t *value) {
+    int shift = 0;
+
+    *value = 0;
+    while (*p < end && shift < 35) {
+        unsigned char b = *(*p)++;
+
+        *value |= (size_t)(b & 0x7fu) << shift;
+        if ((b & 0x80u) == 0) return 0;
+        shift += 7;
+    }
+    return -1;
+}  /* end getVarint */
+
+/* Function: putVarint ====================================================
+ *
+ * Abstract:
+ *      Write an unsigned LEB128 number.
+ */
+static unsigned char *putVarint(unsigned char *p, size_t value) {
+    while (value >= 0x80u) {
+        *p++ = (unsigned char)(value | 0x80u);
+        value >>= 7;
+    }
+    *p++ = (unsigned char)value;
+    return p;
+}  /* end putVarint */
+
+/* Function: decodeRecord =================================================
+ *
+ * Abstract:
+ *      Decode the next record of the current chunk onto the previous one,
+ *      see discon_trace.h. Returns -1 when the data is corrupt.
+ */
+static int decodeRecord(disconTraceReader *trace) {
+    const unsigned char *p   = (const unsigned char *)trace->view + trace->pos;
+    const unsigned char *end = (const unsigned char *)trace->view + trace->chunkEnd;
+    uint32_t            *word = (uint32_t *)trace->record;
+    size_t              i = 0, zeros, n, k;
+
+    while (i < trace->nWords) {
+        const unsigned char *lengths;
+
+        if (getVarint(&p, end, &zeros) != 0 || getVarint(&p, end, &n) != 0 ||
+            zeros > trace->nWords - i || n > trace->nWords - i - zeros ||
+            (size_t)(end - p) < (n + 3)/4) {
+            return -1;
+        }
+        i += zeros;
+        lengths = p;
+        p += (n + 3)/4;
+        for (k=0; k<n; k++, i++) {
+            unsigned len = ((lengths[k/4] >> (2*(k%4))) & 3u) + 1u;
+            uint32_t x = 0;
+            unsigned b;
+
+            if ((size_t)(end - p) < len) return -1;
+            for (b=0; b<len; b++) {
+                x |= (uint32_t)p[b] << (8*b);
+            }
+            p += len;
+            word[i] ^= x;
+        }
+    }
+    trace->pos = (size_t)(p - (const unsigned char *)trace->view);
+    return 0;
+}  /* end decodeRecord */
+
+/*===================*
+ * Visible functions *
+ *===================*/
+
+/* Function: disconTraceOpen ==============================================
+ *
+ * Abstract:
+ *      Map the file and check its header.
+ */
+disconTraceReader *disconTraceOpen(const char *path, char *errorMsg) {
+    disconTraceReader *trace;
+    struct stat       st;
+
+    if (stat(path, &st) != 0) {
+        sprintf(errorMsg, "Unable to open %.200s", path);
+        return NULL;
+    }
+    if ((size_t)st.st_size < sizeof(disconTraceHeader)) {
+        sprintf(errorMsg, "%.200s is not an avrSwap trace", path);
+        return NULL;
+    }
+    trace = (disconTraceReader *)calloc(1, sizeof(*trace));
+    if (trace == NULL) {
+        sprintf(errorMsg, "%.200s: out of memory", path);
+        return NULL;
+    }
+    trace->size = (size_t)st.st_size;
+    trace->view = mapFile(path, trace->size);
+    if (trace->view == NULL) {
+        free(trace);
+        sprintf(errorMsg, "Unable to map %.200s", path);
+        return NULL;
+    }
+    (void)memcpy(&trace->header, trace->view, sizeof(trace->header));
+    if (memcmp(trace->header.magic, DISCON_TRACE_MAGIC, sizeof(DISCON_TRACE_MAGIC)) != 0 ||
+        trace->header.nSwap == 0) {
+        disconTraceClose(trace);
+        sprintf(errorMsg, "%.200s is not an avrSwap trace", path);
+        return NULL;
+    }
+    if (trace->header.version != DISCON_TRACE_VERSION) {
+        sprintf(errorMsg, "%.200s: unsupported trace version %u (expected %d)",
+                path, (unsigned)trace->header.version, DISCON_TRACE_VERSION);
+        disconTraceClose(trace);
+        return NULL;
+    }
+    trace->nWords = (size_t)trace->header.nSwap + trace->header.nOut;
+    if (trace->header.flags & DISCON_TRACE_XOR) {
+        trace->record = (float *)malloc(trace->nWords*sizeof(float));
+        if (trace->record == NULL) {
+            disconTraceClose(trace);
+            sprintf(errorMsg, "%.200s: out of memory", path);
+            return NULL;
+        }
+        trace->nCalls = countChunks(trace);
+        disconTraceRewind(trace);
+    } else {
+        trace->nCalls = (long)((trace->size - sizeof(disconTraceHeader)) /
+                               (trace->nWords*sizeof(float)));
+    }
+    return trace;
+}  /* end disconTraceOpen */
+
+/* Function: disconTraceInfo ==============================================
+ *
+ * Abstract:
+ *      Header of an open trace.
+ */
+const disconTraceHeader *disconTraceInfo(const disconTraceReader *trace) {
+    return &trace->header;
+}  /* end disconTraceInfo */
+
+/* Function: disconTraceLength ============================================
+ *
+ * Abstract:
+ *      Complete calls of a trace.
+ */
+long disconTraceLength(const disconTraceReader *trace) {
+    return trace->nCalls;
+}  /* end disconTraceLength */
+
+/* Function: disconTraceNext ==============================================
+ *
+ * Abstract:
+ *      Plain records are used in place in the mapped file; encoded ones are
+ *      decoded into the record of the reader, starting over from zeros at
+ *      every chunk. A corrupt chunk ends the trace.
+ */
+const float *disconTraceNext(disconTraceReader *trace) {
+    const char *record;
+
+    if (trace->next >= trace->nCalls) return NULL;
+    if (trace->header.flags & DISCON_TRACE_XOR) {
+        while (trace->chunkLeft == 0) {
+            disconTraceChunkHeader chunk;
+
+            (void)memcpy(&chunk, trace->view + trace->chunkEnd, sizeof(chunk));
+            trace->pos       = trace->chunkEnd + sizeof(chunk);
+            trace->chunkEnd  = trace->pos + chunk.size;
+            trace->chunkLeft = (long)chunk.calls;
+            (void)memset(trace->record, 0, trace->nWords*sizeof(float));
+        }
+        if (decodeRecord(trace) != 0) {
+            trace->nCalls = trace->next;
+            return NULL;
+        }
+        trace->chunkLeft--;
+        trace->next++;
+        return trace->record;
+    }
+    record = trace->view + sizeof(disconTraceHeader) +
+             (size_t)trace->next*trace->nWords*sizeof(float);
+    trace->next++;
+    return (const float *)record;
+}  /* end disconTraceNext */
+
+/* Function: disconTraceRewind ============================================
+ *
+ * Abstract:
+ *      Back to the first call.
+ */
+void disconTraceRewind(disconTraceReader *trace) {
+    trace->next      = 0;
+    trace->chunkEnd  = sizeof(disconTraceHeader);
+    trace->chunkLeft = 0;
+}  /* end disconTraceRewind */
+
+/* Function: disconTraceClose =============================================
+ *
+ * Abstract:
+ *      Unmap the file and free the reader.
+ */
+void disconTraceClose(disconTraceReader *trace) {
+    if (trace == NULL) return;
+    unmapFile(trace->view, trace->size);
+    free(trace->record);
+    free(trace);
+}  /* end disconTraceClose */
+
+/* Function: disconTraceEncode ============================================
+ *
+ * Abstract:
+ *      XOR the record with the previous one and write the groups of zero
+ *      and literal words, see discon_trace.h.
+ */
+size_t disconTraceEncode(const float *record, float *prev, size_t n,
+                         unsigned char *out) {
+    const uint32_t *word = (const uint32_t *)record;
+    uint32_t       *last = (uint32_t *)prev;
+    unsigned char  *p = out;
+    size_t         i = 0;
+
+    while (i < n) {
+        size_t        zeros = i, first, k;
+        unsigned char *lengths;
+
+        while (i < n && word[i] == last[i]) i++;
+        zeros = i - zeros;
+        first = i;
+        while (i < n && word[i] != last[i]) i++;
+
+        p = putVarint(p, zeros);
+        p = putVarint(p, i - first);
+        lengths = p;
+        (void)memset(lengths, 0, (i - first + 3)/4);
+        p += (i - first + 3)/4;
+        for (k=first; k<i; k++) {
+            uint32_t x = word[k] ^ last[k];
+            unsigned len = x > 0xffffffu ? 4u : x > 0xffffu ? 3u : x > 0xffu ? 2u : 1u;
+            unsigned b;
+
+            lengths[(k - first)/4] |= (unsigned char)((len - 1u) << (2*((k - first)%4)));
+            for (b=0; b<len; b++) {
+                *p++ = (unsigned char)(x >> (8*b));
+            }
+            last[k] = word[k];
+        }
+    }
+    return (size_t)(p - out);
+}  /* end disconTraceEncode */
+
+/* EOF: discon_trace.c */
@@ -0,0 +1,111 @@
+/*
+ * File    : discon_trace.h
+ *
+ * Abstract:
+ *      Binary avrSwap traces of the DISCON library.
+ *
+ *      A trace records, for every call of DISCON, the first nSwap records
+ *      of the avrSwap array as the host passed them in, iStatus included,
+ *      so a controller can be driven open-loop through exactly the calls a
+ *      simulation made (discon_replay). A captured trace (discon_capture.h)
+ *      also holds nOut values of what the call returned, laid out as
+ *      DISCON_TRACE_OUT_xxx below; the record of a call is then nSwap
+ *      inputs followed by nOut outputs.
+ *
+ *      File layout (native byte order):
+ *          disconTraceHeader
+ *          plain:      one record of nSwap+nOut floats per call
+ *          DISCON_TRACE_XOR:
+ *                      chunks, each a disconTraceChunkHeader followed by
+ *                      the encoded records of up to chunkCalls calls
+ *      A trace ends at the end of the file; a partially written last
+ *      record or chunk is ignored.
+ *
+ *      Encoding (DISCON_TRACE_XOR): every record is XORed, as 32-bit words,
+ *      with the record before it in the chunk (the first with zeros), so
+ *      the values that did not change become zero words. The words of a
+ *      record are then written as groups of
+ *          varint  zero words
+ *          varint  n literal words
+ *          n/4 rounded up bytes of 2-bit lengths, then the low 1..4 bytes
+ *                  (little-endian) of each literal word
+ *      until all nSwap+nOut words are covered. Every chunk decodes on its
+ *      own.
+ */
+
+#ifndef DISCON_TRACE_H
+#define DISCON_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "discon.h"
+
+#define DISCON_TRACE_MAGIC       "DISCONT"
+#define DISCON_TRACE_VERSION     1
+#define DISCON_TRACE_CHUNK_MAGIC 0x4b484354u   /* "TCHK" */
+
+/* Header flags */
+#define DISCON_TRACE_XOR         0x1u          /* chunks of encoded records */
+
+/* The outputs of a call, after its nSwap inputs */
+#define DISCON_TRACE_OUT_FAIL    0             /* aviFail                   */
+#define DISCON_TRACE_OUT_DEMANDS 1             /* avrSwap[41..47]           */
+#define DISCON_TRACE_OUT_NLOG    8             /* avrSwap[64]               */
+#define DISCON_TRACE_OUT_LOG     9             /* the logging channels      */
+
+typedef struct {
+    char     magic[8];              /* DISCON_TRACE_MAGIC, NUL padded      */
+    uint32_t version;               /* DISCON_TRACE_VERSION                */
+    uint32_t nSwap;                 /* avrSwap records per call            */
+    uint32_t nOut;                  /* output values per call, or 0        */
+    uint32_t flags;                 /* DISCON_TRACE_xxx                    */
+    double   stepSize;              /* communication interval, or 0        */
+} disconTraceHeader;                /* 32 bytes */
+
+typedef struct {
+    uint32_t magic;                 /* DISCON_TRACE_CHUNK_MAGIC            */
+    uint32_t calls;                 /* records in this chunk               */
+    uint32_t size;                  /* bytes of encoded records            */
+    uint32_t reserved;
+} disconTraceChunkHeader;           /* 16 bytes */
+
+typedef struct disconTraceReader disconTraceReader;
+
+/*
+ * Open a trace for reading. Returns NULL and fills errorMsg (at least 257
+ * characters) on failure.
+ */
+DISCON_LOCAL disconTraceReader *disconTraceOpen(const char *path, char *errorMsg);
+
+/* Header of an open trace */
+DISCON_LOCAL const disconTraceHeader *disconTraceInfo(const disconTraceReader *trace);
+
+/* Number of complete calls in a trace */
+DISCON_LOCAL long disconTraceLength(const disconTraceReader *trace);
+
+/*
+ * Record of the next call, nSwap+nOut floats, or NULL at the end of the
+ * trace. The record stays valid until the next call.
+ */
+DISCON_LOCAL const float *disconTraceNext(disconTraceReader *trace);
+
+/* Start reading from the first call again */
+DISCON_LOCAL void disconTraceRewind(disconTraceReader *trace);
+
+/* Close a trace. NULL is ignored. */
+DISCON_LOCAL void disconTraceClose(disconTraceReader *trace);
+
+/* Largest encoding of a record of n words */
+#define DISCON_TRACE_MAX_ENCODED(n) (5*(size_t)(n) + 16)
+
+/*
+ * Encode a record of n words against prev, the record before it in the
+ * chunk, and copy the record to prev. Returns the bytes written to out.
+ */
+DISCON_LOCAL size_t disconTraceEncode(const float *record, float *prev, size_t n,
+                                      unsigned char *out);
+
+#endif /* DISCON_TRACE_H */
+
+/* EOF: discon_trace.h */
@@ -0,0 +1,688 @@
+/*
+ * File    : discon_wind.c
+ *
+ * Abstract:
+ *      Reader of Bladed turbulent wind files, see discon_wind.h.
+ *
+ *      File layout (little endian), as read by InflowWind and written by
+ *      TurbSim:
+ *          int16  -99
+ *          int16  turbulence model
+ *          model 4:    int32 nComp, float latitude, roughness, reference
+ *                      height, intensities (%) of the nComp components
+ *          model 7, 8: int32 header size, int32 nComp
+ *          float  dz, dy, dx
+ *          int32  nSteps/2
+ *          float  mean wind speed
+ *          float  3 length scales; int32 unused, seed
+ *          int32  nZ, nY
+ *          3 components: 6 more length scales
+ *          (models 7 and 8: further parameters)
+ *      then the planes, each nZ rows (bottom up) of nY points of nComp
+ *      int16 values. The planes end the file, which is how they are found
+ *      after the longer headers of models 7 and 8.
+ */
+
+#if !defined _WIN32 && !defined _FILE_OFFSET_BITS
+# define _FILE_OFFSET_BITS 64               /* files over 2 GB on 32 bit */
+#endif
+#if !defined _WIN32 && !defined _POSIX_C_SOURCE
+# define _POSIX_C_SOURCE 200112L            /* posix_madvise */
+#endif
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined _WIN32
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <sys/types.h>
+# include <unistd.h>
+#endif
+
+#include "discon_wind.h"
+
+/*=========*
+ * Defines *
+ *=========*/
+
+#define PI              3.14159265358979323846
+
+#define HEADER_SIZE     512         /* bytes read for the header             */
+#define ROTOR_RINGS     10          /* equal-area rings of the rotor average */
+#define BLADE_POINTS    20          /* along a blade                         */
+
+/* Reduced values of a plane */
+enum { REDUCED_HUB, REDUCED_ROTOR, REDUCED_BLADE, NUM_REDUCED = REDUCED_BLADE + DISCON_WIND_AZIMUTHS };
+
+/* Grid points (iz*nY + iy) and weights of a reduced value */
+typedef struct {
+    int   n;
+    int   *index;
+    float *weight;
+} Stencil;
+
+struct disconWind {
+    disconWindInfo     info;
+#if defined _WIN32
+    HANDLE             mapping;
+#else
+    int                fd;
+#endif
+    unsigned long long granularity;         /* of mapping offsets          */
+    unsigned long long dataStart;           /* of the first plane          */
+    size_t             planeBytes;
+    long               nSlabs;
+    double             scale;               /* m/s per unit of the file    */
+    Stencil            stencil[NUM_REDUCED];
+    float              *reduced;            /* NUM_REDUCED per plane       */
+    unsigned char      *slabReduced;        /* per slab                    */
+    float              *decoded[2];         /* u of two slabs, nY*nZ/plane */
+    long               decodedSlab[2];
+    int                lastDecoded;
+    char               errorMsg[257];       /* first read error            */
+};
+
+/*=================*
+ * Local functions *
+ *=================*/
+
+/* Function: getI16 etc. ==================================================
+ *
+ * Abstract:
+ *      Little-endian values of the header.
+ */
+static int getI16(const unsigned char *p) {
+    return (int16_t)(uint16_t)(p[0] | p[1] << 8);
+}  /* end getI16 */
+
+static long getI32(const unsigned char *p) {
+    return (long)(int32_t)((uint32_t)p[0] | (uint32_t)p[1] << 8 |
+                           (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+}  /* end getI32 */
+
+static double getF32(const unsigned char *p) {
+    uint32_t bits = (uint32_t)p[0] | (uint32_t)p[1] << 8 |
+                    (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+    float    value;
+
+    (void)memcpy(&value, &bits, sizeof(value));
+    return value;
+}  /* end getF32 */
+
+/* Function: readHeader ===================================================
+ *
+ * Abstract:
+ *      Parse the header; returns the bytes it takes, or 0 and fills
+ *      errorMsg.
+ */
+static size_t readHeader(const unsigned char *h, size_t n, disconWindInfo *info,
+                         int *hasTi, char *errorMsg) {
+    size_t pos = 4;
+    int    k;
+
+    if (n < 4 || getI16(h) != -99) {
+        (void)sprintf(errorMsg, "not a wind file with the current Bladed header");
+        return 0;
+    }
+    info->model = getI16(h + 2);
+    *hasTi = 0;
+    switch (info->model) {
+      case 1: case 2:
+        info->nComp = 1;
+        break;
+      case 3: case 5:
+        info->nComp = 3;
+        break;
+      case 4:
+        if (n < 32) break;
+        info->nComp = (int)getI32(h + 4);
+        for (k=0; k<3; k++) info->ti[k] = 0.01*getF32(h + 20 + 4*k);
+        *hasTi = 1;
+        pos = 32;
+        break;
+      case 7: case 8:
+        if (n < 12) break;
+        info->nComp = (int)getI32(h + 8);
+        pos = 12;
+        break;
+      default:
+        (void)sprintf(errorMsg, "turbulence model %d of the wind file not supported",
+                      info->model);
+        return 0;
+    }
+    if (n < pos + 48 || info->nComp < 1 || info->nComp > 3) {
+        (void)sprintf(errorMsg, "invalid wind file header");
+        return 0;
+    }
+    info->dz       = getF32(h + pos);
+    info->dy       = getF32(h + pos + 4);
+    info->dx       = getF32(h + pos + 8);
+    info->nSteps   = 2*getI32(h + pos + 12);
+    info->meanWind = getF32(h + pos + 16);
+    info->nZ       = (int)getI32(h + pos + 40);
+    info->nY       = (int)getI32(h + pos + 44);
+    pos += 48 + (info->nComp == 3 ? 24 : 0);
+    if (info->nSteps < 1 || info->nY < 1 || info->nZ < 1 || !(info->dx > 0.0) ||
+        (info->nY > 1 && !(info->dy > 0.0)) || (info->nZ > 1 && !(info->dz > 0.0))) {
+        (void)sprintf(errorMsg, "invalid wind file grid");
+        return 0;
+    }
+    return pos;
+}  /* end readHeader */
+
+#if defined _WIN32
+
+/* Function: openFile =====================================================
+ *
+ * Abstract:
+ *      Open a file for mapping; returns its size, or 0.
+ */
+static unsigned long long openFile(disconWind *w, const char *path) {
+    HANDLE        file;
+    LARGE_INTEGER size;
+    SYSTEM_INFO   sys;
+
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return 0;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0) {
+        CloseHandle(file);
+        return 0;
+    }
+    w->mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);      /* the mapping keeps the file open */
+    if (w->mapping == NULL) return 0;
+    GetSystemInfo(&sys);
+    w->granularity = sys.dwAllocationGranularity;
+    return (unsigned long long)size.QuadPart;
+}  /* end openFile */
+
+/* Function: mapWindow ====================================================
+ *
+ * Abstract:
+ *      Map size bytes at offset; *base and *baseSize are what to unmap.
+ */
+static const unsigned char *mapWindow(const disconWind *w, unsigned long long offset,
+                                      size_t size, void **base, size_t *baseSize) {
+    unsigned long long start = offset - offset % w->granularity;
+
+    *baseSize = size + (size_t)(offset - start);
+    *base = MapViewOfFile(w->mapping, FILE_MAP_READ, (DWORD)(start >> 32),
+                          (DWORD)(start & 0xffffffffu), *baseSize);
+    if (*base == NULL) return NULL;
+    return (const unsigned char *)*base + (offset - start);
+}  /* end mapWindow */
+
+static void unmapWindow(void *base, size_t baseSize) {
+    (void)baseSize;
+    UnmapViewOfFile(base);
+}  /* end unmapWindow */
+
+static void closeFile(disconWind *w) {
+    if (w->mapping != NULL) CloseHandle(w->mapping);
+}  /* end closeFile */
+
+#else
+
+/* Function: openFile =====================================================
+ *
+ * Abstract:
+ *      Open a file for mapping; returns its size, or 0.
+ */
+static unsigned long long openFile(disconWind *w, const char *path) {
+    struct stat st;
+
+    w->fd = open(path, O_RDONLY);
+    if (w->fd < 0) return 0;
+    if (fstat(w->fd, &st) != 0 || st.st_size <= 0) return 0;
+    w->granularity = (unsigned long long)sysconf(_SC_PAGESIZE);
+    return (unsigned long long)st.st_size;
+}  /* end openFile */
+
+/* Function: mapWindow ====================================================
+ *
+ * Abstract:
+ *      Map size bytes at offset; *base and *baseSize are what to unmap.
+ *      A slab is read once, in order, so ask for it to be read ahead.
+ */
+static const unsigned char *mapWindow(const disconWind *w, unsigned long long offset,
+                                      size_t size, void **base, size_t *baseSize) {
+    unsigned long long start = offset - offset % w->granularity;
+
+    *baseSize = size + (size_t)(offset - start);
+    *base = mmap(NULL, *baseSize, PROT_READ, MAP_PRIVATE, w->fd, (off_t)start);
+    if (*base == MAP_FAILED) return NULL;
+#ifdef POSIX_MADV_WILLNEED
+    (void)posix_madvise(*base, *baseSize, POSIX_MADV_WILLNEED);
+#endif
+    return (const unsigned char *)*base + (offset - start);
+}  /* end mapWindow */
+
+static void unmapWindow(void *base, size_t baseSize) {
+    (void)munmap(base, baseSize);
+}  /* end unmapWindow */
+
+static void closeFile(disconWind *w) {
+    if (w->fd >= 0) (void)close(w->fd);
+}  /* end closeFile */
+
+#endif
+
+/* Function: gridWeights ================================================
+ *
+ * Abstract:
+ *      The grid points around a point (m from the hub) and their bilinear
+ *      weights; the grid is held at its edges. Returns how many (1..4).
+ */
+static int gridWeights(const disconWindInfo *info, double y, double z, int *index,
+                       double *weight) {
+    double gy = info->nY > 1 ? y/info->dy + 0.5*(info->nY - 1) : 0.0;
+    double gz = info->nZ > 1 ? z/info->dz + 0.5*(info->nZ - 1) : 0.0;
+    int    iy, iz, n = 0;
+
+    if (gy < 0.0) gy = 0.0;
+    if (gy > info->nY - 1) gy = info->nY - 1;
+    if (gz < 0.0) gz = 0.0;
+    if (gz > info->nZ - 1) gz = info->nZ - 1;
+    iy = (int)gy < info->nY - 1 ? (int)gy : info->nY > 1 ? info->nY - 2 : 0;
+    iz = (int)gz < info->nZ - 1 ? (int)gz : info->nZ > 1 ? info->nZ - 2 : 0;
+    gy -= iy;
+    gz -= iz;
+    index[n] = iz*info->nY + iy;
+    weight[n++] = (1.0 - gy)*(1.0 - gz);
+    if (info->nY > 1) {
+        index[n] = iz*info->nY + iy + 1;
+        weight[n++] = gy*(1.0 - gz);
+    }
+    if (info->nZ > 1) {
+        index[n] = (iz + 1)*info->nY + iy;
+        weight[n++] = (1.0 - gy)*gz;
+        if (info->nY > 1) {
+            index[n] = (iz + 1)*info->nY + iy + 1;
+            weight[n++] = gy*gz;
+        }
+    }
+    return n;
+}  /* end gridWeights */
+
+/* Function: addPoint =====================================================
+ *
+ * Abstract:
+ *      Add the weights of a point to a dense grid of weights.
+ */
+static void addPoint(const disconWindInfo *info, double *dense, double y, double z,
+                     double weight) {
+    int    index[4], n, i;
+    double w[4];
+
+    n = gridWeights(info, y, z, index, w);
+    for (i=0; i<n; i++) dense[index[i]] += weight*w[i];
+}  /* end addPoint */
+
+/* Function: makeStencil ==================================================
+ *
+ * Abstract:
+ *      Keep the grid points of a dense grid of weights, normalised to sum
+ *      to 1, and clear it. Returns 0 when out of memory.
+ */
+static int makeStencil(Stencil *st, double *dense, int nPoints) {
+    double sum = 0.0;
+    int    i, n = 0;
+
+    for (i=0; i<nPoints; i++) {
+        if (dense[i] != 0.0) n++;
+        sum += dense[i];
+    }
+    st->index  = (int *)malloc(n*sizeof(int));
+    st->weight = (float *)malloc(n*sizeof(float));
+    if (st->index == NULL || st->weight == NULL) return 0;
+    for (i=0, st->n=0; i<nPoints; i++) {
+        if (dense[i] == 0.0) continue;
+        st->index[st->n]  = i;
+        st->weight[st->n] = (float)(dense[i]/sum);
+        st->n++;
+        dense[i] = 0.0;
+    }
+    return 1;
+}  /* end makeStencil */
+
+/* Function: makeStencils =================================================
+ *
+ * Abstract:
+ *      The hub point, the rotor disc in equal-area rings and every blade
+ *      azimuth. Returns 0 when out of memory.
+ */
+static int makeStencils(disconWind *w) {
+    const disconWindInfo *info = &w->info;
+    int                  nPoints = info->nY*info->nZ, i, j, a, ok = 1;
+    double               R = info->radius;
+    double               *dense = (double *)calloc(nPoints, sizeof(double));
+
+    if (dense == NULL) return 0;
+    addPoint(info, dense, 0.0, 0.0, 1.0);
+    ok = ok && makeStencil(&w->stencil[REDUCED_HUB], dense, nPoints);
+
+    for (i=0; i<ROTOR_RINGS; i++) {
+        double r = R*sqrt((i + 0.5)/ROTOR_RINGS);
+
+        for (j=0; j<DISCON_WIND_AZIMUTHS; j++) {
+            double psi = 2.0*PI*j/DISCON_WIND_AZIMUTHS;
+
+            addPoint(info, dense, r*sin(psi), r*cos(psi), 1.0);
+        }
+    }
+    ok = ok && makeStencil(&w->stencil[REDUCED_ROTOR], dense, nPoints);
+
+    for (a=0; a<DISCON_WIND_AZIMUTHS; a++) {
+        double psi = 2.0*PI*a/DISCON_WIND_AZIMUTHS;
+
+        for (j=0; j<BLADE_POINTS; j++) {
+            double r = R*(j + 0.5)/BLADE_POINTS;
+
+            addPoint(info, dense, r*sin(psi), r*cos(psi), r*r);
+        }
+        ok = ok && makeStencil(&w->stencil[REDUCED_BLADE + a], dense, nPoints);
+    }
+    free(dense);
+    return ok;
+}  /* end makeStencils */
+
+/* Function: readSlab =====================================================
+ *
+ * Abstract:
+ *      Map a slab and reduce its planes, if not done yet, and decode the
+ *      longitudinal wind into u, if given. A slab that cannot be mapped
+ *      reads as the mean wind, and the error is kept.
+ */
+static void readSlab(disconWind *w, long slab, float *u) {
+    const disconWindInfo *info = &w->info;
+    long                 first = slab*DISCON_WIND_SLAB, nPlanes = info->nSteps - first;
+    int                  nPoints = info->nY*info->nZ, stride = 2*info->nComp, i, k;
+    const unsigned char  *planes;
+    void                 *base;
+    size_t               baseSize;
+    long                 t;
+
+    if (nPlanes > DISCON_WIND_SLAB) nPlanes = DISCON_WIND_SLAB;
+    planes = mapWindow(w, w->dataStart + (unsigned long long)first*w->planeBytes,
+                       (size_t)nPlanes*w->planeBytes, &base, &baseSize);
+    if (planes == NULL && w->errorMsg[0] == '\0') {
+        (void)sprintf(w->errorMsg, "unable to map planes %ld.. of the wind file", first);
+    }
+
+    for (t=0; t<nPlanes; t++) {
+        const unsigned char *plane = planes != NULL ? planes + t*w->planeBytes : NULL;
+
+        if (!w->slabReduced[slab]) {
+            float *r = w->reduced + (first + t)*NUM_REDUCED;
+
+            for (k=0; k<NUM_REDUCED; k++) {
+                const Stencil *st = &w->stencil[k];
+                double        sum = 0.0;
+
+                for (i=0; plane != NULL && i<st->n; i++) {
+                    sum += st->weight[i]*getI16(plane + st->index[i]*stride);
+                }
+                r[k] = (float)(info->meanWind + w->scale*sum);
+            }
+        }
+        if (u != NULL) {
+            float *row = u + t*nPoints;
+
+            for (i=0; i<nPoints; i++) {
+                row[i] = (float)(info->meanWind +
+                                 (plane != NULL ? w->scale*getI16(plane + i*stride) : 0.0));
+            }
+        }
+    }
+    w->slabReduced[slab] = 1;
+    if (planes != NULL) unmapWindow(base, baseSize);
+}  /* end readSlab */
+
+/* Function: planeAt ======================================================
+ *
+ * Abstract:
+ *      The plane before time t and the fraction of the way to the next,
+ *      the box repeating.
+ */
+static long planeAt(const disconWind *w, double t, double *f) {
+    double x = fmod(t/w->info.dt, (double)w->info.nSteps);
+    long   i;
+
+    if (x < 0.0) x += w->info.nSteps;
+    i  = (long)x;
+    if (i >= w->info.nSteps) i = w->info.nSteps - 1;
+    *f = x - i;
+    return i;
+}  /* end planeAt */
+
+/* Function: reducedAt ====================================================
+ *
+ * Abstract:
+ *      Reduced values of a plane, reading its slab on first use.
+ */
+static const float *reducedAt(disconWind *w, long i) {
+    long slab = i/DISCON_WIND_SLAB;
+
+    if (!w->slabReduced[slab]) readSlab(w, slab, NULL);
+    return w->reduced + i*NUM_REDUCED;
+}  /* end reducedAt */
+
+/* Function: interpolate ==================================================
+ *
+ * Abstract:
+ *      A reduced value k at time t.
+ */
+static double interpolate(disconWind *w, double t, int k) {
+    double f;
+    long   i = planeAt(w, t, &f);
+    double v0 = reducedAt(w, i)[k];
+    double v1 = reducedAt(w, (i + 1) % w->info.nSteps)[k];
+
+    return v0 + f*(v1 - v0);
+}  /* end interpolate */
+
+/* Function: decodedPlane =================================================
+ *
+ * Abstract:
+ *      The decoded longitudinal wind of a plane, keeping the last two
+ *      slabs; NULL when out of memory.
+ */
+static const float *decodedPlane(disconWind *w, long i) {
+    long   slab = i/DISCON_WIND_SLAB;
+    size_t planeSize = (size_t)w->info.nY*w->info.nZ;
+    int    c;
+
+    for (c=0; c<2; c++) {
+        if (w->decodedSlab[c] == slab) {
+            w->lastDecoded = c;
+            return w->decoded[c] + (i - slab*DISCON_WIND_SLAB)*planeSize;
+        }
+    }
+    c = 1 - w->lastDecoded;
+    if (w->decoded[c] == NULL) {
+        w->decoded[c] = (float *)malloc(DISCON_WIND_SLAB*planeSize*sizeof(float));
+        if (w->decoded[c] == NULL) return NULL;
+    }
+    readSlab(w, slab, w->decoded[c]);
+    w->decodedSlab[c] = slab;
+    w->lastDecoded    = c;
+    return w->decoded[c] + (i - slab*DISCON_WIND_SLAB)*planeSize;
+}  /* end decodedPlane */
+
+/*===================*
+ * Visible functions *
+ *===================*/
+
+/* Function: disconWindOpen ===============================================
+ *
+ * Abstract:
+ *      Read the header, locate the planes and set up the reductions.
+ */
+disconWind *disconWindOpen(const char *path, double radius, double meanWind,
+                           const double *ti, char *errorMsg) {
+    unsigned char      header[HEADER_SIZE];
+    unsigned long long size, dataBytes;
+    disconWindInfo     *info;
+    disconWind         *w;
+    size_t             n, headerBytes;
+    FILE               *file;
+    int                hasTi, k;
+
+    if ((file = fopen(path, "rb")) == NULL) {
+        (void)sprintf(errorMsg, "unable to open the wind file %.200s", path);
+        return NULL;
+    }
+    n = fread(header, 1, sizeof(header), file);
+    (void)fclose(file);
+
+    w = (disconWind *)calloc(1, sizeof(disconWind));
+    if (w == NULL) {
+        (void)sprintf(errorMsg, "out of memory");
+        return NULL;
+    }
+#if !defined _WIN32
+    w->fd = -1;
+#endif
+    w->decodedSlab[0] = w->decodedSlab[1] = -1;
+    info = &w->info;
+    if ((headerBytes = readHeader(header, n, info, &hasTi, errorMsg)) == 0) {
+        disconWindClose(w);
+        return NULL;
+    }
+    if (meanWind > 0.0) info->meanWind = meanWind;
+    for (k=0; k<3; k++) {
+        if (ti != NULL && ti[k] > 0.0) info->ti[k] = ti[k];
+    }
+    if (!(info->meanWind > 0.0) || !(info->ti[0] > 0.0)) {
+        (void)sprintf(errorMsg, "the wind file %.160s has no %s; give it", path,
+                      !(info->meanWind > 0.0) ? "mean wind speed" :
+                      hasTi ? "longitudinal turbulence intensity" :
+                      "turbulence intensities");
+        disconWindClose(w);
+        return NULL;
+    }
+    info->radius   = radius;
+    info->dt       = info->dx/info->meanWind;
+    info->duration = info->nSteps*info->dt;
+    w->scale       = 0.001*info->meanWind*info->ti[0];
+
+    /* The planes end the file */
+    w->planeBytes = (size_t)info->nY*info->nZ*info->nComp*2;
+    dataBytes     = (unsigned long long)info->nSteps*w->planeBytes;
+    size          = openFile(w, path);
+    if (size < headerBytes + dataBytes) {
+        (void)sprintf(errorMsg, "the wind file %.160s is %s", path,
+                      size == 0 ? "unreadable" : "shorter than its grid");
+        disconWindClose(w);
+        return NULL;
+    }
+    w->dataStart = size - dataBytes;
+
+    w->nSlabs      = (info->nSteps + DISCON_WIND_SLAB - 1)/DISCON_WIND_SLAB;
+    w->reduced     = (float *)malloc((size_t)info->nSteps*NUM_REDUCED*sizeof(float));
+    w->slabReduced = (unsigned char *)calloc(w->nSlabs, 1);
+    if (w->reduced == NULL || w->slabReduced == NULL || !makeStencils(w)) {
+        (void)sprintf(errorMsg, "out of memory");
+        disconWindClose(w);
+        return NULL;
+    }
+    return w;
+}  /* end disconWindOpen */
+
+/* Function: disconWindGetInfo ============================================
+ *
+ * Abstract:
+ *      Grid and scaling of a file.
+ */
+const disconWindInfo *disconWindGetInfo(const disconWind *wind) {
+    return &wind->info;
+}  /* end disconWindGetInfo */
+
+/* Function: disconWindError ============================================
+ *
+ * Abstract:
+ *      First read error of a file.
+ */
+const char *disconWindError(const disconWind *wind) {
+    return wind->errorMsg[0] != '\0' ? wind->errorMsg : NULL;
+}  /* end disconWindError */
+
+/* Function: disconWindHub etc. ===========================================
+ *
+ * Abstract:
+ *      Reduced winds, linear between planes and, for a blade, between the
+ *      azimuths.
+ */
+double disconWindHub(disconWind *wind, double t) {
+    return interpolate(wind, t, REDUCED_HUB);
+}  /* end disconWindHub */
+
+double disconWindRotor(disconWind *wind, double t) {
+    return interpolate(wind, t, REDUCED_ROTOR);
+}  /* end disconWindRotor */
+
+double disconWindBlade(disconWind *wind, double t, double azimuth) {
+    double x = fmod(azimuth/(2.0*PI)*DISCON_WIND_AZIMUTHS, (double)DISCON_WIND_AZIMUTHS);
+    double f, u0, u1;
+    int    a;
+
+    if (x < 0.0) x += DISCON_WIND_AZIMUTHS;
+    a  = (int)x;
+    if (a >= DISCON_WIND_AZIMUTHS) a = DISCON_WIND_AZIMUTHS - 1;
+    f  = x - a;
+    u0 = interpolate(wind, t, REDUCED_BLADE + a);
+    u1 = interpolate(wind, t, REDUCED_BLADE + (a + 1) % DISCON_WIND_AZIMUTHS);
+    return u0 + f*(u1 - u0);
+}  /* end disconWindBlade */
+
+/* Function: disconWindPoint ==============================================
+ *
+ * Abstract:
+ *      Full-field wind at a point.
+ */
+double disconWindPoint(disconWind *wind, double t, double y, double z) {
+    const disconWindInfo *info = &wind->info;
+    int                  index[4], n, i, k;
+    double               weight[4], f, u[2];
+    long                 plane = planeAt(wind, t, &f);
+
+    n = gridWeights(info, y, z, index, weight);
+    for (i=0; i<2; i++) {
+        const float *p = decodedPlane(wind, (plane + i) % info->nSteps);
+
+        u[i] = info->meanWind;
+        if (p == NULL) continue;
+        for (k=0, u[i]=0.0; k<n; k++) u[i] += weight[k]*p[index[k]];
+    }
+    return u[0] + f*(u[1] - u[0]);
+}  /* end disconWindPoint */
+
+/* Function: disconWindClose ==============================================
+ *
+ * Abstract:
+ *      Close the file and free the reductions.
+ */
+void disconWindClose(disconWind *wind) {
+    int k;
+
+    if (wind == NULL) return;
+    closeFile(wind);
+    for (k=0; k<NUM_REDUCED; k++) {
+        free(wind->stencil[k].index);
+        free(wind->stencil[k].weight);
+    }
+    free(wind->reduced);
+    free(wind->slabReduced);
+    free(wind->decoded[0]);
+    free(wind->decoded[1]);
+    free(wind);
+}  /* end disconWindClose */
+
+/* EOF: discon_wind.c */
@@ -0,0 +1,101 @@
+/*
+ * File    : discon_wind.h
+ *
+ * Abstract:
+ *      Reader of Bladed turbulent wind files (.wnd, e.g. wind012.wnd of the
+ *      NREL 5MW model, or TurbSim's Bladed-style output) for closed-loop
+ *      runs outside Bladed (discon_closedloop) and synthetic avrSwap
+ *      traces.
+ *
+ *      A .wnd file is a box of frozen turbulence: nSteps planes of nY by
+ *      nZ grid points, each of nComp 16-bit components scaled by 1000
+ *      standard deviations, which Taylor's hypothesis carries through the
+ *      rotor at the mean wind speed, one plane every dx/meanWind seconds;
+ *      the box repeats when it runs out. The file is read in slabs of
+ *      DISCON_WIND_SLAB planes, each memory mapped only while it is
+ *      decoded, so a file of any size is streamed in bounded memory. Only
+ *      the longitudinal component is decoded, to
+ *          u = meanWind*(1 + ti[0]*value/1000)
+ *      The grid is taken as centred on the hub, as Bladed places it
+ *      (TURBHTTYPE 0), with the lateral axis of the file.
+ *
+ *      When a slab is first decoded, its planes are reduced to the hub
+ *      height wind, the rotor average (over the disc of the given radius)
+ *      and the wind a blade sees at DISCON_WIND_AZIMUTHS azimuths (a blade
+ *      at azimuth psi, 0 up, at lateral r sin(psi) and vertical r cos(psi)
+ *      of the hub; the average along the blade weighted by r^2, as the
+ *      root flap moment weighs it). These few values per plane are kept for
+ *      the whole file: after the first pass, a run over the same seed, or
+ *      many runs (e.g. of other controllers or gains), interpolate them in
+ *      time and azimuth without touching the file.
+ *
+ *      Only the -99 header of current files is read (turbulence models 1
+ *      to 5, 7 and 8); the pre-2000 header is not. The file is little
+ *      endian, as Bladed and TurbSim write it.
+ */
+
+#ifndef DISCON_WIND_H
+#define DISCON_WIND_H
+
+#include "discon.h"
+
+#define DISCON_WIND_SLAB      256   /* planes per slab                      */
+#define DISCON_WIND_AZIMUTHS  36    /* of the blade winds, 10 deg apart      */
+
+/* Grid and scaling of a wind file */
+typedef struct {
+    int    model;                   /* turbulence model of the header       */
+    int    nComp;
+    int    nY, nZ;
+    long   nSteps;                  /* planes                               */
+    double dy, dz, dx;              /* m                                    */
+    double meanWind;                /* m/s, of the file or as given         */
+    double ti[3];                   /* turbulence intensities, fractions    */
+    double radius;                  /* of the rotor quantities              */
+    double dt;                      /* s between planes, dx/meanWind        */
+    double duration;                /* s, nSteps*dt                         */
+} disconWindInfo;
+
+typedef struct disconWind disconWind;
+
+/*
+ * Open a wind file for a rotor of the given radius. A meanWind or ti[k]
+ * above 0 replaces that of the file (as Bladed scales a file with UBAR and
+ * TI of the project); only files of model 4 hold intensities, for the
+ * others they must be given. ti may be NULL. Returns NULL and fills errorMsg (at
+ * least 257 characters) on failure.
+ */
+DISCON_LOCAL disconWind *disconWindOpen(const char *path, double radius, double meanWind,
+                                        const double *ti, char *errorMsg);
+
+/* Grid and scaling of an open file */
+DISCON_LOCAL const disconWindInfo *disconWindGetInfo(const disconWind *wind);
+
+/*
+ * Winds at time t (s, from the first plane; the box repeats), interpolated
+ * between planes: at the hub, averaged over the rotor, and along a blade
+ * at an azimuth (rad).
+ */
+DISCON_LOCAL double disconWindHub(disconWind *wind, double t);
+DISCON_LOCAL double disconWindRotor(disconWind *wind, double t);
+DISCON_LOCAL double disconWindBlade(disconWind *wind, double t, double azimuth);
+
+/*
+ * Longitudinal wind at time t at lateral y and vertical z (m) from the
+ * hub, bilinear in the grid (held at its edges) and linear in time. Keeps
+ * the last two slabs decoded.
+ */
+DISCON_LOCAL double disconWindPoint(disconWind *wind, double t, double y, double z);
+
+/*
+ * The first error reading the planes of a file, or NULL. Planes that could
+ * not be read give the mean wind.
+ */
+DISCON_LOCAL const char *disconWindError(const disconWind *wind);
+
+/* Close a wind file. NULL is ignored. */
+DISCON_LOCAL void disconWindClose(disconWind *wind);
+
+#endif /* DISCON_WIND_H */
+
+/* EOF: discon_wind.h */